@@ -119,6 +119,13 @@ namespace Falcor
         */
         void* map(MapType Type) const;
 
+        /** Map a buffer created with CpuAccess::Write to a new allocation, like map(MapType::WriteDiscard), and get the data of the previous allocation.
+            The previous data can be read until the GPU finishes the commands which are currently being recorded, so the parts which didn't change can be copied from it.
+            \param[out] pPreviousData The data of the previous allocation
+            eturn The data of the new allocation, or nullptr if the buffer wasn't created with CpuAccess::Write
+        */
+        void* mapWriteDiscard(const void*& pPreviousData) const;
+
         /** Unmap the buffer
         */
         void unmap() const;
@@ -93,11 +93,13 @@ namespace Falcor
         void prepareForDispatch();
         void applyComputeState();
         void applyComputeVars();
+        void onCommandListReset() override;
 
         std::stack<ComputeState::SharedPtr> mpComputeStateStack;
         std::stack<ComputeVars::SharedPtr> mpComputeVarsStack;
 
         ComputeVars::SharedPtr mpComputeVars;
         ComputeState::SharedPtr mpComputeState;
+        RootBindingCache mComputeBindings;      // The compute root signature and root arguments set on the command list
     };
 }
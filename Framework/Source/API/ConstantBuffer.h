@@ -135,6 +135,29 @@ namespace Falcor
             return VariablesBuffer::setVariableArray(name, 0, pValue, count);
         }
 
+        /** Set a variable into the buffer using a handle from getVariableHandle(). This doesn't perform any string operations.
+        In debug builds, the function will validate that the handle matches the buffer layout and that the value Type matches the declaration in the shader. If there's a mismatch, an error will be logged and the call will be ignored.
+        \param[in] handle The variable handle
+        \param[in] value Value to set
+        */
+        template<typename T>
+        void setVariable(const ProgramReflection::VariableHandle& handle, const T& value)
+        {
+            return VariablesBuffer::setVariable(handle, 0, value);
+        }
+
+        /** Set a variable array in the buffer using a handle from getVariableHandle(). The array stride is taken from the handle.
+        In debug builds, the function will validate that the handle matches the buffer layout and that the value Type matches the declaration in the shader. If there's a mismatch, an error will be logged and the call will be ignored.
+        \param[in] handle The handle of the first element to set
+        \param[in] pValue Pointer to an array of values to set
+        \param[in] count pValue array size
+        */
+        template<typename T>
+        void setVariableArray(const ProgramReflection::VariableHandle& handle, const T* pValue, size_t count)
+        {
+            return VariablesBuffer::setVariableArray(handle, 0, pValue, count);
+        }
+
         /** Set a texture or image.
         The function will validate that the resource Type matches the declaration in the shader. If there's a mismatch, an error will be logged and the call will be ignored.
         \param[in] name The variable name in the program. See notes about naming in the ConstantBuffer class description.
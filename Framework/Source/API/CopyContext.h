@@ -50,6 +50,26 @@ namespace Falcor
         void updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData);
         std::vector<uint8> readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
 
+        /** Layout of a texture subresource after it was copied into a buffer with copyTextureSubresourceToBuffer()
+        */
+        struct ReadbackLayout
+        {
+            uint64_t size = 0;      ///< Required buffer size in bytes
+            uint32_t rowPitch = 0;  ///< Distance in bytes between rows in the buffer. Rows are padded to the API's alignment requirements.
+            uint32_t rowSize = 0;   ///< Size in bytes of the texel data of a row
+            uint32_t rowCount = 0;  ///< Number of rows in a depth slice
+            uint32_t depth = 0;     ///< Number of depth slices
+        };
+
+        /** Get the buffer layout of a texture subresource for copyTextureSubresourceToBuffer()
+        */
+        static ReadbackLayout getReadbackLayout(const Texture* pTexture, uint32_t subresourceIndex);
+
+        /** Record a copy of a texture subresource into a buffer, using the layout returned by getReadbackLayout(). The call doesn't wait for the copy, use flush() and the context's fence to find out when the buffer can be mapped.
+            \param[in] pBuffer Destination buffer. Should be created with Buffer::CpuAccess::Read.
+        */
+        void copyTextureSubresourceToBuffer(const Texture* pTexture, uint32_t subresourceIndex, const Buffer* pBuffer);
+
         /** Reset
         */
         void reset();
@@ -86,6 +106,11 @@ namespace Falcor
 #endif
     protected:
         void bindDescriptorHeaps();
+
+        /** Called after the command list was reset. Derived contexts use it to drop the state they tracked for the previous command list.
+        */
+        virtual void onCommandListReset() {}
+
         CopyContext() = default;
         bool mCommandsPending = false;
 #ifdef FALCOR_LOW_LEVEL_API
@@ -209,6 +209,15 @@ namespace Falcor
         }        
     }
 
+    void* Buffer::mapWriteDiscard(const void*& pPreviousData) const
+    {
+        BufferData* pApiData = (BufferData*)mpApiData;
+
+        // The allocator reuses the released memory only after the GPU is done with it, so the previous data stays valid
+        pPreviousData = (mCpuAccess == CpuAccess::Write) ? pApiData->dynamicData.pData : nullptr;
+        return map(MapType::WriteDiscard);
+    }
+
     uint64_t Buffer::getGpuAddress() const
     {
         if (mCpuAccess == CpuAccess::Write)
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "API/ComputeContext.h"
+#include "D3D12RootBindingSink.h"
 #include "glm/gtc/type_ptr.hpp"
 
 namespace Falcor
@@ -51,19 +52,25 @@ namespace Falcor
         assert(mpComputeState);
 
         // Bind the root signature and the root signature data
+        D3D12RootBindingSink<false> sink(mpLowLevelData->getCommandList());
         if (mpComputeVars)
         {
-            mpComputeVars->apply(const_cast<ComputeContext*>(this));
+            mpComputeVars->apply(const_cast<ComputeContext*>(this), mComputeBindings, &sink);
         }
         else
         {
-            mpLowLevelData->getCommandList()->SetComputeRootSignature(RootSignature::getEmpty()->getApiHandle());
+            mComputeBindings.setRootSignature(&sink, RootSignature::getEmpty());
         }
 
         mpLowLevelData->getCommandList()->SetPipelineState(mpComputeState->getCSO(mpComputeVars.get())->getApiHandle());
         mCommandsPending = true;
     }
 
+    void ComputeContext::onCommandListReset()
+    {
+        mComputeBindings.invalidate();
+    }
+
     void ComputeContext::dispatch(uint32_t groupSizeX, uint32_t groupSizeY, uint32_t groupSizeZ)
     {
         prepareForDispatch();
@@ -54,6 +54,7 @@ namespace Falcor
         flush();
         mpLowLevelData->reset();
         bindDescriptorHeaps();
+        onCommandListReset();
     }
 
     void copySubresourceData(const D3D12_SUBRESOURCE_DATA& srcData, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& dstFootprint, uint8_t* pDstStart, uint64_t rowSize, uint64_t rowsToCopy)
@@ -83,6 +84,7 @@ namespace Falcor
             mpLowLevelData->flush();
             mCommandsPending = false;
             bindDescriptorHeaps();
+            onCommandListReset();
         }
 
         if (wait)
@@ -107,13 +109,13 @@ namespace Falcor
         mCommandsPending = true;
         // Allocate a buffer on the upload heap
         Buffer::SharedPtr pUploadBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
-        pUploadBuffer->updateData(pData, offset, size);
+        pUploadBuffer->updateData(pData, 0, size);
         ID3D12ResourcePtr pResource = pUploadBuffer->getApiHandle();
 
         resourceBarrier(pBuffer, Resource::State::CopyDest);
 
-        offset = pUploadBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
-        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), 0, pResource, offset, size);
+        size_t uploadOffset = pUploadBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
+        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), offset, pResource, uploadOffset, size);
     }
 
     void CopyContext::updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData)
@@ -174,42 +176,66 @@ namespace Falcor
         updateTextureSubresources(pTexture, subresourceIndex, 1, pData);
     }
 
-    std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadbackLayout CopyContext::getReadbackLayout(const Texture* pTexture, uint32_t subresourceIndex)
     {
-        //Get footprint
         D3D12_RESOURCE_DESC texDesc = pTexture->getApiHandle()->GetDesc();
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
         uint32_t rowCount;
         uint64_t rowSize;
         uint64_t size;
-        ID3D12Device* pDevice = gpDevice->getApiHandle();
-        pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &rowCount, &rowSize, &size);
+        gpDevice->getApiHandle()->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &rowCount, &rowSize, &size);
+
+        ReadbackLayout layout;
+        layout.size = size;
+        layout.rowPitch = footprint.Footprint.RowPitch;
+        layout.rowSize = footprint.Footprint.Width * getFormatBytesPerBlock(pTexture->getFormat());
+        layout.rowCount = rowCount;
+        layout.depth = footprint.Footprint.Depth;
+        return layout;
+    }
 
-        //Create buffer 
-        Buffer::SharedPtr pBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+    void CopyContext::copyTextureSubresourceToBuffer(const Texture* pTexture, uint32_t subresourceIndex, const Buffer* pBuffer)
+    {
+        D3D12_RESOURCE_DESC texDesc = pTexture->getApiHandle()->GetDesc();
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        gpDevice->getApiHandle()->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, nullptr, nullptr, nullptr);
 
-        //Copy from texture to buffer
+        // Buffers can be sub-allocated from a larger resource
+        ID3D12ResourcePtr pResource = pBuffer->getApiHandle();
+        footprint.Offset = pBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
+
+        resourceBarrier(pTexture, Resource::State::CopySource);
         D3D12_TEXTURE_COPY_LOCATION srcLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
-        D3D12_TEXTURE_COPY_LOCATION dstLoc = { pBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
-        RenderContext* pContext = gpDevice->getRenderContext().get();
+        D3D12_TEXTURE_COPY_LOCATION dstLoc = { pResource, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
         mpLowLevelData->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-        pContext->flush(true);
+        mCommandsPending = true;
+    }
+
+    std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    {
+        ReadbackLayout layout = getReadbackLayout(pTexture, subresourceIndex);
+
+        //Create buffer 
+        Buffer::SharedPtr pBuffer = Buffer::create(layout.size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+
+        //Copy from texture to buffer
+        copyTextureSubresourceToBuffer(pTexture, subresourceIndex, pBuffer.get());
+        flush(true);
 
         //Get buffer data
         std::vector<uint8> result;
-		uint32_t actualRowSize = footprint.Footprint.Width * getFormatBytesPerBlock(pTexture->getFormat());
-        result.resize(rowCount * actualRowSize);
+        result.resize(layout.depth * layout.rowCount * layout.rowSize);
         uint8* pData = reinterpret_cast<uint8*>(pBuffer->map(Buffer::MapType::Read));
 
-        for(uint32_t z = 0 ; z < footprint.Footprint.Depth ; z++)
+        for(uint32_t z = 0 ; z < layout.depth ; z++)
         {
-            const uint8_t* pSrcZ = pData + z * footprint.Footprint.RowPitch * rowCount;
-            uint8_t* pDstZ = result.data() + z * actualRowSize * rowCount;
-            for (uint32_t y = 0; y < rowCount; y++)
+            const uint8_t* pSrcZ = pData + z * layout.rowPitch * layout.rowCount;
+            uint8_t* pDstZ = result.data() + z * layout.rowSize * layout.rowCount;
+            for (uint32_t y = 0; y < layout.rowCount; y++)
             {
-                const uint8_t* pSrc = pSrcZ + y *  footprint.Footprint.RowPitch;
-                uint8_t* pDst = pDstZ + y * actualRowSize;
-                memcpy(pDst, pSrc, actualRowSize);
+                const uint8_t* pSrc = pSrcZ + y * layout.rowPitch;
+                uint8_t* pDst = pDstZ + y * layout.rowSize;
+                memcpy(pDst, pSrc, layout.rowSize);
             }
         }
 
@@ -262,7 +262,8 @@ namespace Falcor
         mpRenderContext->resourceBarrier(pData->frameData[pData->currentBackBufferIndex].pFbo->getColorTexture(0).get(), Resource::State::Present);
         mpRenderContext->flush();
         pData->pSwapChain->Present(pData->syncInterval, 0);
-        pData->pFrameFence->gpuSignal(mpRenderContext->getLowLevelData()->getCommandQueue().GetInterfacePtr());
+        uint64_t frameFenceValue = pData->pFrameFence->gpuSignal(mpRenderContext->getLowLevelData()->getCommandQueue().GetInterfacePtr());
+        mpSrvHeap->endFrame(frameFenceValue, pData->pFrameFence->getGpuValue());
         executeDeferredReleases();
         mpRenderContext->reset();
         pData->currentBackBufferIndex = (pData->currentBackBufferIndex + 1) % kSwapChainBuffers;
@@ -295,7 +296,7 @@ namespace Falcor
 		}
 
         // Create the descriptor heaps
-        mpSrvHeap = DescriptorHeap::create(DescriptorHeap::Type::SRV, 16 * 1024);
+        mpSrvHeap = DescriptorHeap::create(DescriptorHeap::Type::SRV, 16 * 1024, true, 4 * 1024);
         mpSamplerHeap = DescriptorHeap::create(DescriptorHeap::Type::Sampler, 2048);
         mpRtvHeap = DescriptorHeap::create(DescriptorHeap::Type::RTV, 1024, false);
         mpDsvHeap = DescriptorHeap::create(DescriptorHeap::Type::DSV, 1024, false);
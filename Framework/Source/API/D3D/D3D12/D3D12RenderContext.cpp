@@ -31,6 +31,7 @@
 #include "API/Device.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "D3D12Resource.h"
+#include "D3D12RootBindingSink.h"
 #include "API/D3D/D3DState.h"
 
 namespace Falcor
@@ -175,9 +176,16 @@ namespace Falcor
         pList->RSSetScissorRects(D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE, (D3D12_RECT*)sc);
     }
 
-    void RenderContext::prepareForDraw()
+    bool RenderContext::prepareForDraw()
     {
         assert(mpGraphicsState);
+        // No GSO means that the program failed to compile, or that the state opted into a fallback and the version isn't ready
+        GraphicsStateObject::SharedPtr pGso = mpGraphicsState->getGSO(mpGraphicsVars.get());
+        if (pGso == nullptr)
+        {
+            return false;
+        }
+
 #if _ENABLE_NVAPI
         if(mpGraphicsState->isSinglePassStereoEnabled())
         {
@@ -188,13 +196,14 @@ namespace Falcor
         assert(mpGraphicsState->isSinglePassStereoEnabled() == false);
 #endif
         // Bind the root signature and the root signature data
+        D3D12RootBindingSink<true> sink(mpLowLevelData->getCommandList());
         if (mpGraphicsVars)
         {
-            mpGraphicsVars->apply(const_cast<RenderContext*>(this));
+            mpGraphicsVars->apply(const_cast<RenderContext*>(this), mGraphicsBindings, &sink);
         }
         else
         {
-            mpLowLevelData->getCommandList()->SetGraphicsRootSignature(RootSignature::getEmpty()->getApiHandle());
+            mGraphicsBindings.setRootSignature(&sink, RootSignature::getEmpty());
         }
 
         CommandListHandle pList = mpLowLevelData->getCommandList();
@@ -203,18 +212,21 @@ namespace Falcor
         D3D12SetFbo(this, mpGraphicsState->getFbo().get());
         D3D12SetViewports(pList, &mpGraphicsState->getViewport(0));
         D3D12SetScissors(pList, &mpGraphicsState->getScissors(0));
-        pList->SetPipelineState(mpGraphicsState->getGSO(mpGraphicsVars.get())->getApiHandle());
+        pList->SetPipelineState(pGso->getApiHandle());
 
         const auto pDsState = mpGraphicsState->getDepthStencilState();
         pList->OMSetStencilRef(pDsState == nullptr ? 0 : pDsState->getStencilRef());
 
         mCommandsPending = true;
+        return true;
     }
 
     void RenderContext::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation)
     {
-        prepareForDraw();
-        mpLowLevelData->getCommandList()->DrawInstanced(vertexCount, instanceCount, startVertexLocation, startInstanceLocation);
+        if (prepareForDraw())
+        {
+            mpLowLevelData->getCommandList()->DrawInstanced(vertexCount, instanceCount, startVertexLocation, startInstanceLocation);
+        }
     }
 
     void RenderContext::draw(uint32_t vertexCount, uint32_t startVertexLocation)
@@ -224,8 +236,10 @@ namespace Falcor
 
     void RenderContext::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int baseVertexLocation, uint32_t startInstanceLocation)
     {
-        prepareForDraw();
-        mpLowLevelData->getCommandList()->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+        if (prepareForDraw())
+        {
+            mpLowLevelData->getCommandList()->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+        }
     }
 
     void RenderContext::drawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int baseVertexLocation)
@@ -233,6 +247,12 @@ namespace Falcor
         drawIndexedInstanced(indexCount, 1, startIndexLocation, baseVertexLocation, 0);
     }
 
+    void RenderContext::onCommandListReset()
+    {
+        ComputeContext::onCommandListReset();
+        mGraphicsBindings.invalidate();
+    }
+
     void RenderContext::applyProgramVars() {}
     void RenderContext::applyGraphicsState() {}
 }
@@ -0,0 +1,83 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "API/LowLevel/RootBindingCache.h"
+#include "API/LowLevel/RootSignature.h"
+
+namespace Falcor
+{
+    /** Records the bindings forwarded by a RootBindingCache into a D3D12 command list
+        \tparam forGraphics Selects between the graphics and compute root arguments
+    */
+    template<bool forGraphics>
+    class D3D12RootBindingSink : public RootBindingCache::Sink
+    {
+    public:
+        D3D12RootBindingSink(ID3D12GraphicsCommandList* pList) : mpList(pList) {}
+
+        void setRootSignature(const RootSignature* pRootSig) override
+        {
+            if(forGraphics)
+            {
+                mpList->SetGraphicsRootSignature(pRootSig->getApiHandle());
+            }
+            else
+            {
+                mpList->SetComputeRootSignature(pRootSig->getApiHandle());
+            }
+        }
+
+        void setRootConstantBufferView(uint32_t rootOffset, uint64_t gpuAddress) override
+        {
+            if(forGraphics)
+            {
+                mpList->SetGraphicsRootConstantBufferView(rootOffset, gpuAddress);
+            }
+            else
+            {
+                mpList->SetComputeRootConstantBufferView(rootOffset, gpuAddress);
+            }
+        }
+
+        void setRootDescriptorTable(uint32_t rootOffset, uint64_t gpuHandle) override
+        {
+            D3D12_GPU_DESCRIPTOR_HANDLE handle;
+            handle.ptr = gpuHandle;
+            if(forGraphics)
+            {
+                mpList->SetGraphicsRootDescriptorTable(rootOffset, handle);
+            }
+            else
+            {
+                mpList->SetComputeRootDescriptorTable(rootOffset, handle);
+            }
+        }
+    private:
+        ID3D12GraphicsCommandList* mpList;
+    };
+}
@@ -51,7 +51,7 @@ namespace Falcor
         }
     }
 
-    DescriptorHeap::DescriptorHeap(Type type, uint32_t descriptorsCount) : mCount(descriptorsCount), mType (type)
+    DescriptorHeap::DescriptorHeap(Type type, uint32_t descriptorsCount, uint32_t transientCount) : mCount(descriptorsCount + transientCount), mType (type), mAllocator(descriptorsCount), mTransientRing(descriptorsCount, transientCount)
     {
 		ID3D12DevicePtr pDevice = gpDevice->getApiHandle();
         mDescriptorSize = pDevice->GetDescriptorHandleIncrementSize(getHeapType(type));
@@ -59,16 +59,16 @@ namespace Falcor
 
     DescriptorHeap::~DescriptorHeap() = default;
 
-    DescriptorHeap::SharedPtr DescriptorHeap::create(Type type, uint32_t descriptorsCount, bool shaderVisible)
+    DescriptorHeap::SharedPtr DescriptorHeap::create(Type type, uint32_t descriptorsCount, bool shaderVisible, uint32_t transientCount)
     {
 		ID3D12DevicePtr pDevice = gpDevice->getApiHandle();
 
-        DescriptorHeap::SharedPtr pHeap = SharedPtr(new DescriptorHeap(type, descriptorsCount));
+        DescriptorHeap::SharedPtr pHeap = SharedPtr(new DescriptorHeap(type, descriptorsCount, transientCount));
         D3D12_DESCRIPTOR_HEAP_DESC desc = {};
 
         desc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
         desc.Type = getHeapType(type);
-        desc.NumDescriptors = descriptorsCount;
+        desc.NumDescriptors = pHeap->mCount;
         if(FAILED(pDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&pHeap->mApiHandle))))
         {
             logError("Can't create descriptor heap");
@@ -89,35 +89,51 @@ namespace Falcor
 
     DescriptorHeap::CpuHandle DescriptorHeap::getCpuHandle(uint32_t index) const
     {
-        assert(index < mCurDesc);
+        assert(index < mCount);
         return getHandleCommon(mCpuHeapStart, index, mDescriptorSize);
     }
 
     DescriptorHeap::GpuHandle DescriptorHeap::getGpuHandle(uint32_t index) const
     {
-        assert(index < mCurDesc);
+        assert(index < mCount);
         return getHandleCommon(mGpuHeapStart, index, mDescriptorSize);
     }
 
     DescriptorHeapEntry::SharedPtr DescriptorHeap::allocateEntry()
     {
-        uint32_t entry;
-        if (mFreeEntries.empty() == false)
+        DescriptorRange range = mAllocator.allocate(1);
+        if (range.isValid() == false)
         {
-            entry = mFreeEntries.front();
-            mFreeEntries.pop();
+            logError("Can't find free CPU handle in descriptor heap");
+            return nullptr;
+        }
+
+        return DescriptorHeapEntry::create(shared_from_this(), range.offset);
+    }
+
+    DescriptorRange DescriptorHeap::allocateRange(uint32_t count)
+    {
+        DescriptorRange range = mAllocator.allocate(count);
+        if (range.isValid() == false)
+        {
+            logError("Can't find " + std::to_string(count) + " contiguous free descriptors in descriptor heap");
         }
-        else
+        return range;
+    }
+
+    DescriptorRange DescriptorHeap::allocateTransientRange(uint32_t count)
+    {
+        DescriptorRange range = mTransientRing.allocate(count);
+        if (range.isValid() == false)
         {
-            if (mCurDesc >= mCount)
-            {
-                logError("Can't find free CPU handle in descriptor heap");
-                return nullptr;
-            }
-            entry = mCurDesc;
-            mCurDesc++;
+            logError("Can't allocate " + std::to_string(count) + " transient descriptors. The transient part of the descriptor heap is full.");
         }
+        return range;
+    }
 
-        return DescriptorHeapEntry::create(shared_from_this(), entry);
+    void DescriptorHeap::endFrame(uint64_t fenceValue, uint64_t completedFenceValue)
+    {
+        mTransientRing.endFrame(fenceValue);
+        mTransientRing.releaseCompleted(completedFenceValue);
     }
 }
@@ -75,10 +75,16 @@ namespace Falcor
     void GpuFence::syncCpu()
     {
         assert(mCpuValue);
+        syncCpu(mCpuValue);
+    }
+
+    void GpuFence::syncCpu(uint64_t value)
+    {
+        assert(value <= mCpuValue);
         uint64_t gpuVal = getGpuValue();
-        if (gpuVal < mCpuValue)
+        if (gpuVal < value)
         {
-            d3d_call(mApiHandle->SetEventOnCompletion(mCpuValue, mEvent));
+            d3d_call(mApiHandle->SetEventOnCompletion(value, mEvent));
             WaitForSingleObject(mEvent, INFINITE);
         }
     }
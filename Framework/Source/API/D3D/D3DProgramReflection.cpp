@@ -314,6 +314,11 @@ namespace Falcor
             desc.isRowMajor = (typeDesc.Class == D3D_SVC_MATRIX_ROWS);
             desc.location = offset;
             desc.type = getVariableType(typeDesc.Type, typeDesc.Rows, typeDesc.Columns);
+            if (desc.arraySize > 0)
+            {
+                // Array elements in constant buffers start at a new 16-byte row. Structured buffers are tightly packed.
+                desc.arrayStride = (uint32_t)(isStructured ? getBytesPerVarType(desc.type) : getRowCountFromType(desc.type) * 16);
+            }
             varMap[name] = desc;
         }
     }
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include <vector>
 #include "API/Shader.h"
+#include "Utils/ShaderCache.h"
 
 namespace Falcor
 {
@@ -49,6 +50,18 @@ namespace Falcor
         flags |= D3DCOMPILE_DEBUG;
 #endif
 
+        // The source is preprocessed, so the key covers the defines and the included files
+        const ShaderCache::Key key = ShaderCache::computeKey(source, target, flags, D3D_COMPILER_VERSION);
+        std::vector<uint8_t> cachedBlob;
+        if(ShaderCache::load(key, cachedBlob))
+        {
+            if(SUCCEEDED(D3DCreateBlob(cachedBlob.size(), &pCode)))
+            {
+                memcpy(pCode->GetBufferPointer(), cachedBlob.data(), cachedBlob.size());
+                return pCode;
+            }
+        }
+
         HRESULT hr = D3DCompile(source.c_str(), source.size(), nullptr, nullptr, nullptr, kEntryPoint, target.c_str(), flags, 0, &pCode, &pErrors);
         if(FAILED(hr))
         {
@@ -56,6 +69,7 @@ namespace Falcor
             return nullptr;
         }
 
+        ShaderCache::store(key, pCode->GetBufferPointer(), pCode->GetBufferSize());
         return pCode;
     }
 
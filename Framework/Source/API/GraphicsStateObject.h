@@ -83,6 +83,7 @@ namespace Falcor
             const Fbo::Desc& getFboDesc() const { return mFboDesc; }
             ProgramVersion::SharedConstPtr getProgramVersion() const { return mpProgram; }
             bool getSinglePassStereoEnabled() const { return mSinglePassStereoEnabled; }
+            RootSignature::SharedPtr getRootSignature() const { return mpRootSignature; }
         private:
             friend class GraphicsStateObject;
             VertexLayout::SharedConstPtr mpLayout;
@@ -27,7 +27,8 @@
 ***************************************************************************/
 #pragma once
 #include "Framework.h"
-#include <queue>
+#include "API/LowLevel/DescriptorRangeAllocator.h"
+#include "API/LowLevel/TransientDescriptorRing.h"
 
 namespace Falcor
 {
@@ -53,31 +54,63 @@ namespace Falcor
             DSV,
             UAV
         };
-        static SharedPtr create(Type type, uint32_t descriptorsCount, bool shaderVisible = true);
+        /** Create a descriptor heap
+            \param[in] type The descriptor type
+            \param[in] descriptorsCount The number of descriptors for entries and ranges
+            \param[in] shaderVisible Whether shaders can access the heap
+            \param[in] transientCount The number of additional descriptors reserved for per-frame ranges. See allocateTransientRange().
+        */
+        static SharedPtr create(Type type, uint32_t descriptorsCount, bool shaderVisible = true, uint32_t transientCount = 0);
 
+        /** Allocate a single descriptor. It's released when the entry is destroyed.
+        */
         Entry allocateEntry();
+
+        /** Allocate a contiguous range of descriptors, which can be used as a descriptor table. The range must be released with releaseRange().
+            \return The range, or an invalid range if the heap is full
+        */
+        DescriptorRange allocateRange(uint32_t count);
+
+        /** Release a range returned by allocateRange(). The caller is responsible for making sure the GPU no longer uses it.
+        */
+        void releaseRange(const DescriptorRange& range) { mAllocator.release(range); }
+
+        /** Allocate a contiguous range which is only valid for the current frame. It's recycled once the GPU finished the frame, there's no need to release it.
+            \return The range, or an invalid range if the transient part of the heap is full
+        */
+        DescriptorRange allocateTransientRange(uint32_t count);
+
+        /** Mark the end of a frame for the transient ranges
+            \param[in] fenceValue The value the frame fence will reach when the GPU finishes the frame
+            \param[in] completedFenceValue The frame fence's current GPU value. Transient ranges of frames up to this value are recycled.
+        */
+        void endFrame(uint64_t fenceValue, uint64_t completedFenceValue);
+
+        CpuHandle getCpuHandle(uint32_t index) const;
+        GpuHandle getGpuHandle(uint32_t index) const;
         ApiHandle getApiHandle() const { return mApiHandle; }
         Type getType() const { return mType; }
     private:
         friend DescriptorHeapEntry;
-        DescriptorHeap(Type type, uint32_t descriptorsCount);
+        DescriptorHeap(Type type, uint32_t descriptorsCount, uint32_t transientCount);
 
-        CpuHandle getCpuHandle(uint32_t index) const;
-        GpuHandle getGpuHandle(uint32_t index) const;
         void releaseEntry(uint32_t handle)
         {
-            mFreeEntries.push(handle);
+            DescriptorRange range;
+            range.offset = handle;
+            range.count = 1;
+            mAllocator.release(range);
         }
 
         CpuHandle mCpuHeapStart = {};
         GpuHandle mGpuHeapStart = {};
         uint32_t mDescriptorSize;
-        uint32_t mCount;
-        uint32_t mCurDesc = 0;
+        uint32_t mCount;                            // Total number of descriptors, including the transient ones
         ApiHandle mApiHandle;
         Type mType;
 
-        std::queue<uint32_t> mFreeEntries;
+        DescriptorRangeAllocator mAllocator;        // Manages the first descriptorsCount descriptors
+        TransientDescriptorRing mTransientRing;     // Manages the transientCount descriptors after them
     };
 
     // Ideally this would be nested inside the Descriptor heap. Unfortunately, we need to forward declare it in FalcorD3D12.h, which is impossible with nesting
@@ -0,0 +1,164 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "API/LowLevel/DescriptorRangeAllocator.h"
+
+namespace Falcor
+{
+    const uint32_t DescriptorRange::kInvalidOffset;
+    const uint32_t DescriptorRangeAllocator::kNone;
+
+    DescriptorRangeAllocator::DescriptorRangeAllocator(uint32_t capacity) : mCapacity(capacity), mNext(capacity), mPrev(capacity), mFreeOrder(capacity, 0)
+    {
+        for (uint32_t& head : mFreeHeads)
+        {
+            head = kNone;
+        }
+
+        // Cover the capacity with the largest aligned blocks which fit
+        uint32_t offset = 0;
+        while (offset < mCapacity)
+        {
+            uint32_t order = 0;
+            while (order < kMaxOrder - 1)
+            {
+                uint32_t size = 1u << (order + 1);
+                if ((offset & (size - 1)) != 0 || size > mCapacity - offset)
+                {
+                    break;
+                }
+                order++;
+            }
+            pushFreeBlock(offset, order);
+            offset += 1u << order;
+        }
+    }
+
+    uint32_t DescriptorRangeAllocator::getOrder(uint32_t count)
+    {
+        uint32_t order = 0;
+        while ((uint64_t(1) << order) < count)
+        {
+            order++;
+        }
+        return order;
+    }
+
+    void DescriptorRangeAllocator::pushFreeBlock(uint32_t offset, uint32_t order)
+    {
+        mPrev[offset] = kNone;
+        mNext[offset] = mFreeHeads[order];
+        if (mFreeHeads[order] != kNone)
+        {
+            mPrev[mFreeHeads[order]] = offset;
+        }
+        mFreeHeads[order] = offset;
+        mFreeOrder[offset] = uint8_t(order + 1);
+    }
+
+    void DescriptorRangeAllocator::removeFreeBlock(uint32_t offset, uint32_t order)
+    {
+        assert(mFreeOrder[offset] == order + 1);
+        if (mPrev[offset] != kNone)
+        {
+            mNext[mPrev[offset]] = mNext[offset];
+        }
+        else
+        {
+            mFreeHeads[order] = mNext[offset];
+        }
+
+        if (mNext[offset] != kNone)
+        {
+            mPrev[mNext[offset]] = mPrev[offset];
+        }
+        mFreeOrder[offset] = 0;
+    }
+
+    DescriptorRange DescriptorRangeAllocator::allocate(uint32_t count)
+    {
+        DescriptorRange range;
+        if (count == 0 || count > mCapacity)
+        {
+            return range;
+        }
+
+        // Find the smallest free block which is large enough
+        const uint32_t order = getOrder(count);
+        uint32_t blockOrder = order;
+        while (blockOrder < kMaxOrder && mFreeHeads[blockOrder] == kNone)
+        {
+            blockOrder++;
+        }
+        if (blockOrder == kMaxOrder)
+        {
+            return range;
+        }
+
+        // Split it until it has the requested size. The upper halves go back to the free lists.
+        uint32_t offset = mFreeHeads[blockOrder];
+        removeFreeBlock(offset, blockOrder);
+        while (blockOrder > order)
+        {
+            blockOrder--;
+            pushFreeBlock(offset + (1u << blockOrder), blockOrder);
+        }
+
+        mAllocatedCount += 1u << order;
+        range.offset = offset;
+        range.count = count;
+        return range;
+    }
+
+    void DescriptorRangeAllocator::release(const DescriptorRange& range)
+    {
+        if (range.isValid() == false)
+        {
+            return;
+        }
+        assert(range.offset < mCapacity && mFreeOrder[range.offset] == 0);
+
+        uint32_t order = getOrder(range.count);
+        uint32_t offset = range.offset;
+        mAllocatedCount -= 1u << order;
+
+        // Merge with the buddy for as long as it's free and has the same size
+        while (order < kMaxOrder - 1)
+        {
+            uint32_t buddy = offset ^ (1u << order);
+            if (buddy >= mCapacity || mFreeOrder[buddy] != order + 1)
+            {
+                break;
+            }
+            removeFreeBlock(buddy, order);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        pushFreeBlock(offset, order);
+    }
+}
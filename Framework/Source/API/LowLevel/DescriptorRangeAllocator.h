@@ -0,0 +1,87 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** A contiguous range of descriptors in a heap. This is a value type, copying it doesn't allocate or change the ownership of the descriptors.
+    */
+    struct DescriptorRange
+    {
+        static const uint32_t kInvalidOffset = uint32_t(-1);
+        uint32_t offset = kInvalidOffset;   ///< Index of the first descriptor in the heap
+        uint32_t count = 0;                 ///< Number of descriptors in the range
+        bool isValid() const { return offset != kInvalidOffset; }
+    };
+
+    /** Allocates contiguous descriptor ranges using a buddy allocator.
+        Ranges are rounded up to a power of two. Free blocks are kept in a list per size, and a released range is merged with its free neighbor of the same size, so that allocation and release are O(log(capacity)) and never allocate memory.
+        The class only manages indices, so it doesn't depend on the graphics API.
+    */
+    class DescriptorRangeAllocator
+    {
+    public:
+        /** Create an allocator
+            \param[in] capacity The number of descriptors it manages. Doesn't need to be a power of two.
+        */
+        DescriptorRangeAllocator(uint32_t capacity = 0);
+
+        /** Allocate a contiguous range
+            \param[in] count The number of descriptors
+            \return The range, or an invalid range if there is no free block which is large enough
+        */
+        DescriptorRange allocate(uint32_t count);
+
+        /** Release a range returned by allocate()
+        */
+        void release(const DescriptorRange& range);
+
+        /** Get the number of descriptors the allocator manages
+        */
+        uint32_t getCapacity() const { return mCapacity; }
+
+        /** Get the number of allocated descriptors, including the padding added when rounding up the ranges
+        */
+        uint32_t getAllocatedCount() const { return mAllocatedCount; }
+    private:
+        static const uint32_t kNone = uint32_t(-1);
+        static const uint32_t kMaxOrder = 32;
+        static uint32_t getOrder(uint32_t count);
+
+        void pushFreeBlock(uint32_t offset, uint32_t order);
+        void removeFreeBlock(uint32_t offset, uint32_t order);
+
+        uint32_t mCapacity = 0;
+        uint32_t mAllocatedCount = 0;
+        uint32_t mFreeHeads[kMaxOrder];         // The first free block of each size
+        std::vector<uint32_t> mNext;            // Free list links, stored at the block's first descriptor
+        std::vector<uint32_t> mPrev;
+        std::vector<uint8_t> mFreeOrder;        // 1 + the order of the free block starting at the descriptor, 0 if no free block starts there
+    };
+}
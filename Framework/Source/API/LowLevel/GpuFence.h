@@ -65,6 +65,10 @@ namespace Falcor
         */
         void syncCpu();
 
+        /** Tell the CPU to wait until the fence reaches a value. Returns immediately if the GPU already signaled it.
+        */
+        void syncCpu(uint64_t value);
+
         /** Insert a signal command into the command queue. This will increase the internal value
         */
         uint64_t gpuSignal(CommandQueueHandle pQueue);
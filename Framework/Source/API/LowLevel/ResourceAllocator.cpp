@@ -0,0 +1,302 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "API/LowLevel/ResourceAllocator.h"
+
+namespace Falcor
+{
+    const uint32_t ResourceAllocator::kNotMegaPage;
+    const uint32_t ResourceAllocator::kMegaPageIdleFrames;
+    const uint32_t ResourceAllocator::kNoPage;
+
+    static std::atomic<uint64_t> sNextAllocatorId(1);
+
+    // The context the calling thread used last. Allocator IDs are never reused, so an entry of a destroyed allocator can't match.
+    struct CachedThreadContext
+    {
+        uint64_t allocatorId = 0;
+        void* pContext = nullptr;
+    };
+    static thread_local CachedThreadContext tCachedContext;
+
+    static uint32_t getMegaPageSizeClass(size_t size)
+    {
+        uint32_t sizeClass = 0;
+        while ((size_t(1) << sizeClass) < size)
+        {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+
+    ResourceAllocator::ResourceAllocator(size_t pageSize, std::unique_ptr<Backend> pBackend) : mpBackend(std::move(pBackend)), mPageSize(pageSize), mAllocatorId(sNextAllocatorId++)
+    {
+    }
+
+    ResourceAllocator::~ResourceAllocator()
+    {
+        executeDeferredReleases();
+    }
+
+    ResourceAllocator::SharedPtr ResourceAllocator::create(size_t pageSize, std::unique_ptr<Backend> pBackend)
+    {
+        return SharedPtr(new ResourceAllocator(pageSize, std::move(pBackend)));
+    }
+
+    ResourceAllocator::ThreadContext* ResourceAllocator::getThreadContext()
+    {
+        if (tCachedContext.allocatorId == mAllocatorId)
+        {
+            return (ThreadContext*)tCachedContext.pContext;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        ThreadContext::UniquePtr& pContext = mThreadContexts[std::this_thread::get_id()];
+        if (pContext == nullptr)
+        {
+            pContext = std::make_unique<ThreadContext>();
+        }
+        tCachedContext.allocatorId = mAllocatorId;
+        tCachedContext.pContext = pContext.get();
+        return pContext.get();
+    }
+
+    uint32_t ResourceAllocator::createPage(size_t size, uint32_t sizeClass)
+    {
+        PageData::UniquePtr pPage = std::make_unique<PageData>();
+        pPage->size = size;
+        pPage->sizeClass = sizeClass;
+        if (mpBackend->createPage(size, pPage->pResourceHandle, pPage->gpuAddress, pPage->pData) == false)
+        {
+            logError("ResourceAllocator - can't create a page of size " + std::to_string(size));
+            return kNoPage;
+        }
+
+        uint32_t pageId;
+        if (mFreePageIds.size())
+        {
+            pageId = mFreePageIds.back();
+            mFreePageIds.pop_back();
+        }
+        else
+        {
+            pageId = (uint32_t)mPages.size();
+            mPages.emplace_back();
+        }
+        mPages[pageId] = std::move(pPage);
+        return pageId;
+    }
+
+    uint32_t ResourceAllocator::acquirePage()
+    {
+        uint32_t pageId;
+        if (mAvailablePages.size())
+        {
+            pageId = mAvailablePages.back();
+            mAvailablePages.pop_back();
+        }
+        else
+        {
+            pageId = createPage(mPageSize, kNotMegaPage);
+            if (pageId == kNoPage)
+            {
+                return kNoPage;
+            }
+            mStats.pageCount++;
+        }
+
+        PageData* pPage = mPages[pageId].get();
+        pPage->currentOffset = 0;
+        pPage->retired = false;
+        return pageId;
+    }
+
+    void ResourceAllocator::retirePage(uint32_t pageId)
+    {
+        PageData* pPage = mPages[pageId].get();
+        pPage->retired = true;
+        if (pPage->allocationsCount == 0)
+        {
+            mAvailablePages.push_back(pageId);
+        }
+    }
+
+    void ResourceAllocator::releasePage(uint32_t pageId)
+    {
+        PageData* pPage = mPages[pageId].get();
+        assert(pPage->allocationsCount > 0);
+        if (--pPage->allocationsCount != 0 || pPage->retired == false)
+        {
+            return;
+        }
+
+        if (pPage->sizeClass == kNotMegaPage)
+        {
+            mAvailablePages.push_back(pageId);
+            return;
+        }
+
+        pPage->pooledFrame = mFrameCount;
+        mAvailableMegaPages[pPage->sizeClass].push_back(pageId);
+    }
+
+    ResourceAllocator::AllocationData ResourceAllocator::allocateMegaPage(size_t size)
+    {
+        AllocationData data;
+        const uint32_t sizeClass = getMegaPageSizeClass(size);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint32_t pageId;
+        auto& pool = mAvailableMegaPages[sizeClass];
+        if (pool.size())
+        {
+            pageId = pool.back();
+            pool.pop_back();
+            mStats.megaPageReuseCount++;
+        }
+        else
+        {
+            pageId = createPage(size_t(1) << sizeClass, sizeClass);
+            if (pageId == kNoPage)
+            {
+                return data;
+            }
+            mStats.megaPageCount++;
+        }
+
+        // A mega-page holds a single allocation, so it's retired right away and returns to the pool when the allocation is released
+        PageData* pPage = mPages[pageId].get();
+        pPage->allocationsCount = 1;
+        pPage->retired = true;
+
+        data.pageID = pageId;
+        data.pResourceHandle = pPage->pResourceHandle;
+        data.gpuAddress = pPage->gpuAddress;
+        data.pData = pPage->pData;
+        return data;
+    }
+
+    ResourceAllocator::AllocationData ResourceAllocator::allocate(size_t size, size_t alignment)
+    {
+        AllocationData data;
+        if (size > mPageSize)
+        {
+            data = allocateMegaPage(size);
+        }
+        else
+        {
+            // Bump-allocate from the thread's page
+            ThreadContext* pContext = getThreadContext();
+            PageData* pPage = pContext->pActivePage;
+            size_t currentOffset = pPage ? align_to(alignment, pPage->currentOffset) : 0;
+            if (pPage == nullptr || currentOffset + size > mPageSize)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (pPage)
+                {
+                    retirePage(pContext->activePageId);
+                }
+                pContext->activePageId = acquirePage();
+                pContext->pActivePage = (pContext->activePageId == kNoPage) ? nullptr : mPages[pContext->activePageId].get();
+                pPage = pContext->pActivePage;
+                currentOffset = 0;
+                if (pPage == nullptr)
+                {
+                    return data;
+                }
+            }
+
+            data.pageID = pContext->activePageId;
+            data.gpuAddress = pPage->gpuAddress + currentOffset;
+            data.pData = pPage->pData + currentOffset;
+            data.pResourceHandle = pPage->pResourceHandle;
+            pPage->currentOffset = currentOffset + size;
+            pPage->allocationsCount++;
+        }
+
+        data.fenceValue = mpBackend->getCpuFenceValue();
+        return data;
+    }
+
+    void ResourceAllocator::release(AllocationData& data)
+    {
+        if (data.pData == nullptr)
+        {
+            return;
+        }
+
+        // Batch the release with the other releases of the thread which are waiting for the same fence value
+        ThreadContext* pContext = getThreadContext();
+        const uint64_t fenceValue = mpBackend->getCpuFenceValue();
+        std::lock_guard<std::mutex> lock(pContext->releaseMutex);
+        if (pContext->releases.empty() || pContext->releases.back().fenceValue != fenceValue)
+        {
+            pContext->releases.push_back({ fenceValue, {} });
+        }
+        pContext->releases.back().pageIds.push_back((uint32_t)data.pageID);
+    }
+
+    void ResourceAllocator::executeDeferredReleases()
+    {
+        // Commands recorded while the fence had the batch's value complete once the GPU passes it
+        const uint64_t gpuValue = mpBackend->getGpuFenceValue();
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& contextIt : mThreadContexts)
+        {
+            ThreadContext* pContext = contextIt.second.get();
+            std::lock_guard<std::mutex> releaseLock(pContext->releaseMutex);
+            while (pContext->releases.size() && pContext->releases.front().fenceValue < gpuValue)
+            {
+                for (uint32_t pageId : pContext->releases.front().pageIds)
+                {
+                    releasePage(pageId);
+                }
+                pContext->releases.pop_front();
+            }
+        }
+
+        // Destroy the mega-pages which stayed in the pool for too long. The most recently returned pages are reused first, so the old ones are at the front.
+        mFrameCount++;
+        for (auto& poolIt : mAvailableMegaPages)
+        {
+            auto& pool = poolIt.second;
+            while (pool.size() && mFrameCount - mPages[pool.front()]->pooledFrame > kMegaPageIdleFrames)
+            {
+                mPages[pool.front()] = nullptr;
+                mFreePageIds.push_back(pool.front());
+                pool.pop_front();
+            }
+        }
+    }
+
+    ResourceAllocator::Stats ResourceAllocator::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+}
@@ -27,19 +27,49 @@
 ***************************************************************************/
 #pragma once
 #ifdef FALCOR_LOW_LEVEL_API
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
-#include <queue>
+#include <thread>
 #include "GpuFence.h"
 
 namespace Falcor
 {
+    /** Allocates upload-heap memory for dynamic buffers.
+        Small allocations are bump-allocated from pages. Every thread allocates from its own page, so allocation only takes a lock when the thread needs a new page.
+        Allocations larger than a page get a dedicated mega-page. Mega-pages are rounded up to a power of two and pooled by size, so they are reused instead of being created for every allocation.
+        Released allocations are retired in batches per fence value, and their memory is reused once the GPU passed that value. Pooled mega-pages which aren't reused for a while are destroyed.
+    */
     class ResourceAllocator
     {
     public:
         using SharedPtr = std::shared_ptr<ResourceAllocator>;
         using SharedConstPtr = std::shared_ptr<const ResourceAllocator>;
 
+        /** The objects the allocator depends on. The default implementation creates mapped upload buffers and reads a GpuFence. Tests can provide their own to run without a device.
+        */
+        class Backend
+        {
+        public:
+            virtual ~Backend() = default;
+
+            /** Create a CPU-visible buffer, and return its handle, GPU address and mapped pointer
+            */
+            virtual bool createPage(size_t size, ResourceHandle& pResourceHandle, GpuAddress& gpuAddress, uint8_t*& pData) = 0;
+
+            /** Get the last fence value which was signaled. The commands which are currently being recorded complete when the GPU passes it.
+            */
+            virtual uint64_t getCpuFenceValue() const = 0;
+
+            /** Get the last fence value the GPU reached
+            */
+            virtual uint64_t getGpuFenceValue() const = 0;
+        };
+
         static SharedPtr create(size_t pageSize, GpuFence::SharedPtr pFence);
+        static SharedPtr create(size_t pageSize, std::unique_ptr<Backend> pBackend);
+
         struct AllocationData
         {
             ResourceHandle pResourceHandle = nullptr;
@@ -47,40 +77,93 @@ namespace Falcor
             uint8_t* pData = nullptr;
             uint64_t pageID = 0;
             uint64_t fenceValue = 0;
+        };
 
-            static const uint64_t kMegaPageId = -1;
-            bool operator<(const AllocationData& other)  const { return fenceValue > other.fenceValue; }
+        struct Stats
+        {
+            uint32_t pageCount = 0;             ///< Number of pages created
+            uint32_t megaPageCount = 0;         ///< Number of mega-pages created
+            uint64_t megaPageReuseCount = 0;    ///< Number of large allocations which reused a pooled mega-page
         };
+
         ~ResourceAllocator();
 
+        /** Allocate memory. Thread-safe.
+        */
         AllocationData allocate(size_t size, size_t alignment = 1);
+
+        /** Release an allocation. The memory is reused after the GPU finishes the commands which are currently being recorded. Thread-safe.
+        */
         void release(AllocationData& data);
+
         size_t getPageSize() const { return mPageSize; }
+
+        /** Reuse the memory of the allocations which the GPU is done with. Call it once per frame.
+        */
         void executeDeferredReleases();
 
+        Stats getStats() const;
+
     private:
-        ResourceAllocator(size_t pageSize, GpuFence::SharedPtr pFence) : mPageSize(pageSize), mpFence(pFence) {}
+        ResourceAllocator(size_t pageSize, std::unique_ptr<Backend> pBackend);
+
         struct PageData
         {
-            uint32_t allocationsCount = 0;
+            std::atomic<uint32_t> allocationsCount;
             size_t currentOffset = 0;
+            size_t size = 0;
+            uint32_t sizeClass = kNotMegaPage;
+            bool retired = false;           // The page is no longer an active page, and is recycled once all of its allocations are released
+            uint64_t pooledFrame = 0;       // For mega-pages, the frame in which the page was returned to the pool
             ResourceHandle pResourceHandle = nullptr;
             GpuAddress gpuAddress = 0;
             uint8_t* pData = nullptr;
 
             using UniquePtr = std::unique_ptr<PageData>;
+            PageData() : allocationsCount(0) {}
         };
-        
-        GpuFence::SharedPtr mpFence;
-        size_t mPageSize = 0;
-        size_t mCurrentPageId = 0;
-        PageData::UniquePtr mpActivePage;
+        static const uint32_t kNotMegaPage = uint32_t(-1);
+        static const uint32_t kMegaPageIdleFrames = 60;    // Pooled mega-pages which weren't reused for this many frames are destroyed
+
+        // Allocation state of a single thread
+        struct ThreadContext
+        {
+            uint32_t activePageId = kNoPage;
+            PageData* pActivePage = nullptr;    // Pointers to pages are stable, so the thread can use its page without the lock
 
-        std::priority_queue<AllocationData> mDeferredReleases;
-        std::unordered_map<size_t, PageData::UniquePtr> mUsedPages;
-        std::queue<PageData::UniquePtr> mAvailablePages;
+            // Releases waiting for the GPU, batched by fence value
+            std::mutex releaseMutex;
+            struct ReleaseBatch
+            {
+                uint64_t fenceValue;
+                std::vector<uint32_t> pageIds;
+            };
+            std::deque<ReleaseBatch> releases;
+
+            using UniquePtr = std::unique_ptr<ThreadContext>;
+        };
+        static const uint32_t kNoPage = uint32_t(-1);
+
+        ThreadContext* getThreadContext();
+        uint32_t acquirePage();
+        AllocationData allocateMegaPage(size_t size);
+        void retirePage(uint32_t pageId);
+        void releasePage(uint32_t pageId);
+        uint32_t createPage(size_t size, uint32_t sizeClass);
+
+        std::unique_ptr<Backend> mpBackend;
+        size_t mPageSize = 0;
+        const uint64_t mAllocatorId;                        // Identifies the allocator in the thread-local context cache
 
-        void allocateNewPage();
+        // Everything below is protected by mMutex
+        mutable std::mutex mMutex;
+        std::vector<PageData::UniquePtr> mPages;
+        std::vector<uint32_t> mAvailablePages;
+        std::vector<uint32_t> mFreePageIds;                 // Slots of mega-pages which were destroyed
+        std::unordered_map<uint32_t, std::deque<uint32_t>> mAvailableMegaPages;      // Per size class, ordered by the time the pages were returned
+        uint64_t mFrameCount = 0;                           // Number of executeDeferredReleases() calls
+        std::unordered_map<std::thread::id, ThreadContext::UniquePtr> mThreadContexts;
+        Stats mStats;
     };
 }
-#endif // FALCOR_LOW_LEVEL_API
\ No newline at end of file
+#endif // FALCOR_LOW_LEVEL_API
@@ -0,0 +1,85 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "API/LowLevel/RootBindingCache.h"
+
+namespace Falcor
+{
+    const uint64_t RootBindingCache::kUnbound;
+
+    bool RootBindingCache::setRootSignature(Sink* pSink, const std::shared_ptr<const RootSignature>& pRootSig)
+    {
+        if(mpRootSig == pRootSig)
+        {
+            return false;
+        }
+
+        mpRootSig = pRootSig;
+        mSlots.assign(mSlots.size(), kUnbound);
+        pSink->setRootSignature(pRootSig.get());
+        return true;
+    }
+
+    bool RootBindingCache::updateSlot(uint32_t rootOffset, uint64_t value)
+    {
+        assert(value != kUnbound);
+        if(rootOffset >= mSlots.size())
+        {
+            mSlots.resize(rootOffset + 1, kUnbound);
+        }
+
+        if(mSlots[rootOffset] == value)
+        {
+            return false;
+        }
+        mSlots[rootOffset] = value;
+        return true;
+    }
+
+    void RootBindingCache::setRootConstantBufferView(Sink* pSink, uint32_t rootOffset, uint64_t gpuAddress)
+    {
+        if(updateSlot(rootOffset, gpuAddress))
+        {
+            pSink->setRootConstantBufferView(rootOffset, gpuAddress);
+        }
+    }
+
+    void RootBindingCache::setRootDescriptorTable(Sink* pSink, uint32_t rootOffset, uint64_t gpuHandle)
+    {
+        if(updateSlot(rootOffset, gpuHandle))
+        {
+            pSink->setRootDescriptorTable(rootOffset, gpuHandle);
+        }
+    }
+
+    void RootBindingCache::invalidate()
+    {
+        mpRootSig = nullptr;
+        mSlots.assign(mSlots.size(), kUnbound);
+    }
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+    class RootSignature;
+
+    /** Tracks the root signature and root arguments which were last set on a command list, and filters out redundant binding calls.
+        The cache doesn't issue API calls itself. It forwards the bindings which changed to a Sink, which records them into the command list.
+        Setting a different root signature clears the tracked arguments, matching the API rules. Call invalidate() when the command list is reset.
+    */
+    class RootBindingCache
+    {
+    public:
+        /** Receives the bindings which need to be issued
+        */
+        class Sink
+        {
+        public:
+            virtual ~Sink() = default;
+            virtual void setRootSignature(const RootSignature* pRootSig) = 0;
+            virtual void setRootConstantBufferView(uint32_t rootOffset, uint64_t gpuAddress) = 0;
+            virtual void setRootDescriptorTable(uint32_t rootOffset, uint64_t gpuHandle) = 0;
+        };
+
+        /** Bind a root signature. If it's the one which is already bound, the call is ignored.
+            \return true if the root signature changed, and all the root arguments need to be set
+        */
+        bool setRootSignature(Sink* pSink, const std::shared_ptr<const RootSignature>& pRootSig);
+
+        /** Bind a constant buffer view at a root offset. Ignored if the same address is already bound there.
+        */
+        void setRootConstantBufferView(Sink* pSink, uint32_t rootOffset, uint64_t gpuAddress);
+
+        /** Bind a descriptor table at a root offset. Ignored if the same handle is already bound there.
+        */
+        void setRootDescriptorTable(Sink* pSink, uint32_t rootOffset, uint64_t gpuHandle);
+
+        /** Forget everything which was bound. Call it after the command list was reset, or after making raw API calls which change the root signature or root arguments.
+        */
+        void invalidate();
+
+        /** Get the currently bound root signature
+        */
+        const std::shared_ptr<const RootSignature>& getRootSignature() const { return mpRootSig; }
+    private:
+        static const uint64_t kUnbound = 0;
+        bool updateSlot(uint32_t rootOffset, uint64_t value);
+
+        std::shared_ptr<const RootSignature> mpRootSig;     // Holding a reference, so that a new root signature can't be mistaken for a released one with the same address
+        std::vector<uint64_t> mSlots;                       // The GPU address or handle bound at each root offset
+    };
+}
@@ -0,0 +1,77 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "API/LowLevel/TransientDescriptorRing.h"
+
+namespace Falcor
+{
+    DescriptorRange TransientDescriptorRing::allocate(uint32_t count)
+    {
+        DescriptorRange range;
+        if (count == 0 || count > mCount)
+        {
+            return range;
+        }
+
+        // If the range doesn't fit before the end of the ring, skip to the start
+        uint32_t index = uint32_t(mHead % mCount);
+        uint32_t padding = (index + count > mCount) ? mCount - index : 0;
+        if (getUsedCount() + padding + count > mCount)
+        {
+            return range;
+        }
+
+        mHead += padding;
+        range.offset = mFirstDescriptor + uint32_t(mHead % mCount);
+        range.count = count;
+        mHead += count;
+        return range;
+    }
+
+    void TransientDescriptorRing::endFrame(uint64_t fenceValue)
+    {
+        if (mFrames.size() && mFrames.back().fenceValue == fenceValue)
+        {
+            mFrames.back().end = mHead;
+        }
+        else
+        {
+            assert(mFrames.empty() || mFrames.back().fenceValue < fenceValue);
+            mFrames.push({ fenceValue, mHead });
+        }
+    }
+
+    void TransientDescriptorRing::releaseCompleted(uint64_t completedFenceValue)
+    {
+        while (mFrames.size() && mFrames.front().fenceValue <= completedFenceValue)
+        {
+            mTail = mFrames.front().end;
+            mFrames.pop();
+        }
+    }
+}
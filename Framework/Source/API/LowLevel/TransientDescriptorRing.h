@@ -0,0 +1,81 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <queue>
+#include "API/LowLevel/DescriptorRangeAllocator.h"
+
+namespace Falcor
+{
+    /** Linear allocator for descriptor tables which are only used during the current frame.
+        Ranges are carved out of a ring of descriptors, and are released in bulk once the GPU finished the frame which used them. The ring doesn't access a fence directly, the caller passes the fence values, so it doesn't depend on the graphics API.
+    */
+    class TransientDescriptorRing
+    {
+    public:
+        /** Create a ring
+            \param[in] firstDescriptor The index of the first descriptor in the heap
+            \param[in] count The number of descriptors in the ring
+        */
+        TransientDescriptorRing(uint32_t firstDescriptor = 0, uint32_t count = 0) : mFirstDescriptor(firstDescriptor), mCount(count) {}
+
+        /** Allocate a contiguous range. Ranges never wrap around the end of the ring.
+            \return The range, or an invalid range if the ring is full
+        */
+        DescriptorRange allocate(uint32_t count);
+
+        /** Mark the end of a frame. The ranges allocated since the previous call stay in use until the fence reaches fenceValue.
+        */
+        void endFrame(uint64_t fenceValue);
+
+        /** Release the ranges of all the frames whose fence value is less than or equal to completedFenceValue
+        */
+        void releaseCompleted(uint64_t completedFenceValue);
+
+        /** Get the number of descriptors which are in use, including the ones skipped when wrapping around
+        */
+        uint32_t getUsedCount() const { return uint32_t(mHead - mTail); }
+
+        /** Get the number of descriptors in the ring
+        */
+        uint32_t getCapacity() const { return mCount; }
+    private:
+        uint32_t mFirstDescriptor;
+        uint32_t mCount;
+
+        // Positions keep increasing, the ring index is the position modulo mCount
+        uint64_t mHead = 0;         // Where the next range is allocated
+        uint64_t mTail = 0;         // The start of the oldest range which is still in use
+
+        struct FrameData
+        {
+            uint64_t fenceValue;
+            uint64_t end;           // mHead at the end of the frame
+        };
+        std::queue<FrameData> mFrames;
+    };
+}
@@ -133,6 +133,30 @@ namespace Falcor
         return getVariableData(name, t, allowNonIndexedArray);
     }
 
+    ProgramReflection::VariableHandle ProgramReflection::BufferReflection::getVariableHandle(const std::string& name, bool allowNonIndexedArray) const
+    {
+        VariableHandle handle;
+        const Variable* pVar = getVariableData(name, handle.offset, allowNonIndexedArray);
+        if(pVar == nullptr)
+        {
+            handle.offset = kInvalidLocation;
+            return handle;
+        }
+
+        handle.type = pVar->type;
+        handle.layoutHash = mLayoutHash;
+        if(pVar->arraySize > 0)
+        {
+            handle.arrayStride = pVar->arrayStride;
+            handle.arraySize = pVar->arraySize;
+            if(pVar->arrayStride > 0)
+            {
+                handle.arraySize -= (uint32_t)((handle.offset - pVar->location) / pVar->arrayStride);
+            }
+        }
+        return handle;
+    }
+
     ProgramReflection::BufferReflection::SharedConstPtr ProgramReflection::getBufferDesc(uint32_t bindLocation, ShaderAccess shaderAccess, BufferReflection::Type bufferType) const
     {
         const auto& descMap = mBuffers[uint32_t(bufferType)].descMap;
@@ -169,7 +193,19 @@ namespace Falcor
         mRegIndex(registerIndex),
         mShaderAccess(shaderAccess)
     {
-
+        // The variable map is unordered, so combine the variable hashes with an order-independent operation
+        std::hash<std::string> stringHash;
+        std::hash<size_t> valueHash;
+        mLayoutHash = valueHash(mSizeInBytes);
+        for(const auto& var : mVariables)
+        {
+            size_t h = stringHash(var.first);
+            h = h * 31 + valueHash(var.second.location);
+            h = h * 31 + valueHash((size_t)var.second.type);
+            h = h * 31 + valueHash(var.second.arraySize);
+            h = h * 31 + valueHash(var.second.arrayStride);
+            mLayoutHash += h;
+        }
     }
 
     ProgramReflection::BufferReflection::SharedPtr ProgramReflection::BufferReflection::create(const std::string& name, uint32_t regIndex, uint32_t regSpace, Type type, size_t size, const VariableMap& varMap, const ResourceMap& resourceMap, ShaderAccess shaderAccess)
@@ -172,6 +172,31 @@ namespace Falcor
         */
         static const uint32_t kInvalidLocation = -1;
 
+        /** A variable inside a buffer, resolved from its name once.
+            Setting a variable through a handle doesn't require any string operations. The handle can be used with any buffer with the same layout, see BufferReflection::getLayoutHash().
+        */
+        struct VariableHandle
+        {
+            size_t offset = kInvalidLocation;   ///< Byte offset of the variable inside the buffer
+            Variable::Type type = Variable::Type::Unknown;
+            uint32_t arraySize = 0;             ///< Number of array elements starting at the handle, or 0 if not an array
+            uint32_t arrayStride = 0;           ///< Stride between elements in the array. 0 if not an array
+            size_t layoutHash = 0;              ///< Layout hash of the buffer the handle was resolved from
+
+            bool isValid() const { return offset != kInvalidLocation; }
+
+            /** Get a handle to an element of the array, starting at this handle
+            */
+            VariableHandle operator[](uint32_t index) const
+            {
+                assert(index < arraySize);
+                VariableHandle element = *this;
+                element.offset += index * arrayStride;
+                element.arraySize -= index;
+                return element;
+            }
+        };
+
         /** This class holds all of the data required to reflect a buffer, either constant buffer or SSBO
         */
         class BufferReflection
@@ -219,6 +244,15 @@ namespace Falcor
             */
             const Variable* getVariableData(const std::string& name, bool allowNonIndexedArray = false) const;
 
+            /** Resolve a variable name into a handle. Names follow the same rules as getVariableData().
+            \return A handle to the variable. If the name wasn't found, the handle is invalid.
+            */
+            VariableHandle getVariableHandle(const std::string& name, bool allowNonIndexedArray = false) const;
+
+            /** Get a hash of the variables' names, offsets and types. Buffers with the same hash have the same layout, so variable handles can be shared between them.
+            */
+            size_t getLayoutHash() const { return mLayoutHash; }
+
             /** Get resource data
             \param[in] name The name of the requested resource
             \return Pointer to the resource data, or nullptr if the name wasn't found or is not a resource
@@ -288,6 +322,7 @@ namespace Falcor
             uint32_t mRegIndex;
             uint32_t mRegSpace = 0;
             ShaderAccess mShaderAccess;
+            size_t mLayoutHash = 0;
         };
 
         /** Create a new object
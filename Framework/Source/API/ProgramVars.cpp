@@ -99,16 +99,29 @@ namespace Falcor
         return true;
     }
 
+    template<typename ViewType>
+    void setResourceData(ProgramVars::ResourceData<ViewType>& data, const typename ViewType::SharedPtr& pView, const Resource::SharedPtr& pResource)
+    {
+        data.pView = pView;
+        data.pResource = pResource;
+
+        // Resolve everything applyCommon() needs, so that it doesn't have to do it on every draw
+        data.pTypedBuffer = dynamic_cast<const TypedBufferBase*>(pResource.get());
+        data.pStructuredBuffer = dynamic_cast<const StructuredBuffer*>(pResource.get());
+        const ViewType* pBoundView = pResource ? pView.get() : ViewType::getNullView().get();
+        data.gpuHandle = pBoundView->getApiHandle()->getGpuHandle().ptr;
+    }
+
     ProgramVars::ProgramVars(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers, const RootSignature::SharedPtr& pRootSig) : mpReflector(pReflector)
     {
         // Initialize the CB and StructuredBuffer maps. We always do it, to mark which slots are used in the shader.
         mpRootSignature = pRootSig ? pRootSig : RootSignature::create(pReflector.get());
 
-        auto getNullptrFunc = [](const Resource::SharedPtr& pResource) { return nullptr; };
+        auto getCbFunc = [](const Resource::SharedPtr& pResource) { return std::static_pointer_cast<ConstantBuffer>(pResource); };
         auto getSrvFunc = [](const Resource::SharedPtr& pResource) { return pResource->getSRV(0, 1, 0, 1); };
         auto getUavFunc = [](const Resource::SharedPtr& pResource) { return pResource->getUAV(0, 0, 1); };
 
-        initializeBuffersMap<ConstantBuffer, ConstantBuffer, RootSignature::DescType::CBV>(mAssignedCbs, createBuffers, getNullptrFunc, mpReflector->getBufferMap(ProgramReflection::BufferReflection::Type::Constant), ProgramReflection::ShaderAccess::Read, mpRootSignature.get());
+        initializeBuffersMap<ConstantBuffer, ConstantBuffer, RootSignature::DescType::CBV>(mAssignedCbs, createBuffers, getCbFunc, mpReflector->getBufferMap(ProgramReflection::BufferReflection::Type::Constant), ProgramReflection::ShaderAccess::Read, mpRootSignature.get());
         initializeBuffersMap<StructuredBuffer, ShaderResourceView, RootSignature::DescType::SRV>(mAssignedSrvs, createBuffers, getSrvFunc, mpReflector->getBufferMap(ProgramReflection::BufferReflection::Type::Structured), ProgramReflection::ShaderAccess::Read, mpRootSignature.get());
         initializeBuffersMap<StructuredBuffer, UnorderedAccessView, RootSignature::DescType::UAV>(mAssignedUavs, createBuffers, getUavFunc, mpReflector->getBufferMap(ProgramReflection::BufferReflection::Type::Structured), ProgramReflection::ShaderAccess::ReadWrite, mpRootSignature.get());
 
@@ -140,6 +153,16 @@ namespace Falcor
                 should_not_get_here();
             }
         }
+
+        // Resolve the GPU handles of the initial SRVs and UAVs
+        for (auto& srvIt : mAssignedSrvs)
+        {
+            setResourceData(srvIt.second, srvIt.second.pView, srvIt.second.pResource);
+        }
+        for (auto& uavIt : mAssignedUavs)
+        {
+            setResourceData(uavIt.second, uavIt.second.pView, uavIt.second.pResource);
+        }
     }
 
     GraphicsVars::SharedPtr GraphicsVars::create(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers, const RootSignature::SharedPtr& pRootSig)
@@ -181,7 +204,7 @@ namespace Falcor
             return nullptr;
         }
 
-        return std::static_pointer_cast<ConstantBuffer>(it->second.pResource);
+        return it->second.pView;
     }
 
     bool ProgramVars::setConstantBuffer(uint32_t index, const ConstantBuffer::SharedPtr& pCB)
@@ -203,6 +226,7 @@ namespace Falcor
 
         assert(mAssignedCbs.find(index) != mAssignedCbs.end());
         mAssignedCbs[index].pResource = pCB;
+        mAssignedCbs[index].pView = pCB;
         return true;
     }
 
@@ -228,8 +252,7 @@ namespace Falcor
             auto uavIt = assignedUavs.find(regIndex);
             assert(uavIt != assignedUavs.end());
 
-            uavIt->second.pResource = resource;
-            uavIt->second.pView = resource->getUAV();
+            setResourceData(uavIt->second, resource->getUAV(), resource);
             break;
         }
 
@@ -238,8 +261,7 @@ namespace Falcor
             auto srvIt = assignedSrvs.find(regIndex);
             assert(srvIt != assignedSrvs.end());
 
-            srvIt->second.pResource = resource;
-            srvIt->second.pView = resource->getSRV();
+            setResourceData(srvIt->second, resource->getSRV(), resource);
             break;
         }
 
@@ -425,7 +447,9 @@ namespace Falcor
 
     bool ProgramVars::setSampler(uint32_t index, const Sampler::SharedPtr& pSampler)
     {
-        mAssignedSamplers.at(index).pSampler = pSampler;
+        auto& data = mAssignedSamplers.at(index);
+        data.pSampler = pSampler;
+        data.gpuHandle = pSampler ? pSampler->getApiHandle()->getGpuHandle().ptr : 0;
         return true;
     }
 
@@ -531,10 +555,8 @@ namespace Falcor
         auto it = mAssignedSrvs.find(index);
         if (it != mAssignedSrvs.end())
         {
-            it->second.pView = pSrv;
-
             // TODO: Fix resource/view const-ness so we don't need to do this
-            it->second.pResource = getResourceFromView(pSrv.get());
+            setResourceData(it->second, pSrv, getResourceFromView(pSrv.get()));
         }
         else
         {
@@ -550,10 +572,8 @@ namespace Falcor
         auto it = mAssignedUavs.find(index);
         if (it != mAssignedUavs.end())
         {
-            it->second.pView = pUav;
-
             // TODO: Fix resource/view const-ness so we don't need to do this
-            it->second.pResource = getResourceFromView(pUav.get());
+            setResourceData(it->second, pUav, getResourceFromView(pUav.get()));
         }
         else
         {
@@ -564,124 +584,80 @@ namespace Falcor
         return true;
     }
 
-    template<typename ViewType, bool isUav, bool forGraphics, typename ContextType>
-    void bindUavSrvCommon(ContextType* pContext, const ProgramVars::ResourceMap<ViewType>& resMap)
+    template<typename ViewType, bool isUav>
+    void bindUavSrvCommon(CopyContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink, const ProgramVars::ResourceMap<ViewType>& resMap)
     {
-        ID3D12GraphicsCommandList* pList = pContext->getLowLevelData()->getCommandList();
         for (auto& resIt : resMap)
         {
             const auto& resDesc = resIt.second;
-            uint32_t rootOffset = resDesc.rootSigOffset;
             const Resource* pResource = resDesc.pResource.get();
 
-            ViewType::ApiHandle handle;
             if (pResource)
             {
-                // If it's a typed buffer, upload it to the GPU
-                const TypedBufferBase* pTypedBuffer = dynamic_cast<const TypedBufferBase*>(pResource);
-                if (pTypedBuffer)
+                // If it's a typed or a structured buffer, upload it to the GPU
+                if (resDesc.pTypedBuffer)
                 {
-                    pTypedBuffer->uploadToGPU();
+                    resDesc.pTypedBuffer->uploadToGPU();
                 }
-
-                const StructuredBuffer* pStructured = dynamic_cast<const StructuredBuffer*>(pResource);
-                if (pStructured)
+                if (resDesc.pStructuredBuffer)
                 {
-                    pStructured->uploadToGPU();
+                    resDesc.pStructuredBuffer->uploadToGPU();
                 }
 
                 pContext->resourceBarrier(pResource, isUav ? Resource::State::UnorderedAccess : Resource::State::ShaderResource);
 
                 if (isUav)
                 {
-                    if (pTypedBuffer)
+                    if (resDesc.pTypedBuffer)
                     {
-                        pTypedBuffer->setGpuCopyDirty();
+                        resDesc.pTypedBuffer->setGpuCopyDirty();
                     }
-                    if (pStructured)
+                    if (resDesc.pStructuredBuffer)
                     {
-                        pStructured->setGpuCopyDirty();
+                        resDesc.pStructuredBuffer->setGpuCopyDirty();
                     }
                 }
-
-                handle = resDesc.pView->getApiHandle();
-            }
-            else
-            {
-                handle = isUav ? UnorderedAccessView::getNullView()->getApiHandle() : ShaderResourceView::getNullView()->getApiHandle();
             }
 
-            if(forGraphics)
-            {
-                pList->SetGraphicsRootDescriptorTable(rootOffset, handle->getGpuHandle());
-            }
-            else
-            {
-                pList->SetComputeRootDescriptorTable(rootOffset, handle->getGpuHandle());
-            }
+            // The handle was resolved when the resource was set. If it's the one already bound at this offset, nothing is recorded.
+            bindings.setRootDescriptorTable(pSink, resDesc.rootSigOffset, resDesc.gpuHandle);
         }
     }
 
-    template<bool forGraphics, typename ContextType>
-    void ProgramVars::applyCommon(ContextType* pContext) const
+    void ProgramVars::applyCommon(CopyContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const
     {
-        // Get the command list
-        ID3D12GraphicsCommandList* pList = pContext->getLowLevelData()->getCommandList();
-        if(forGraphics)
-        {
-            pList->SetGraphicsRootSignature(mpRootSignature->getApiHandle());
-        }
-        else
-        {
-            pList->SetComputeRootSignature(mpRootSignature->getApiHandle());
-        }
+        // Only the bindings which differ from the ones already set on the command list are passed to the sink
+        bindings.setRootSignature(pSink, mpRootSignature);
 
-        // Bind the constant-buffers
+        // Bind the constant-buffers. Uploading a buffer may move it, so the address is only known after the upload.
         for (auto& bufIt : mAssignedCbs)
         {
-            uint32_t rootOffset = bufIt.second.rootSigOffset;
-            const ConstantBuffer* pCB = dynamic_cast<const ConstantBuffer*>(bufIt.second.pResource.get());
+            const ConstantBuffer* pCB = bufIt.second.pView.get();
             pCB->uploadToGPU();
-            if(forGraphics)
-            {
-                pList->SetGraphicsRootConstantBufferView(rootOffset, pCB->getGpuAddress());
-            }
-            else
-            {
-                pList->SetComputeRootConstantBufferView(rootOffset, pCB->getGpuAddress());
-            }
+            bindings.setRootConstantBufferView(pSink, bufIt.second.rootSigOffset, pCB->getGpuAddress());
         }
 
         // Bind the SRVs and UAVs
-        bindUavSrvCommon<ShaderResourceView, false, forGraphics>(pContext, mAssignedSrvs);
-        bindUavSrvCommon<UnorderedAccessView, true, forGraphics>(pContext, mAssignedUavs);
+        bindUavSrvCommon<ShaderResourceView, false>(pContext, bindings, pSink, mAssignedSrvs);
+        bindUavSrvCommon<UnorderedAccessView, true>(pContext, bindings, pSink, mAssignedUavs);
 
         // Bind the samplers
         for (auto& samplerIt : mAssignedSamplers)
         {
-            uint32_t rootOffset = samplerIt.second.rootSigOffset;
-            const Sampler* pSampler = samplerIt.second.pSampler.get();
-            if (pSampler)
+            if (samplerIt.second.pSampler)
             {
-                if(forGraphics)
-                {
-                    pList->SetGraphicsRootDescriptorTable(rootOffset, pSampler->getApiHandle()->getGpuHandle());
-                }
-                else
-                {
-                    pList->SetComputeRootDescriptorTable(rootOffset, pSampler->getApiHandle()->getGpuHandle());
-                }
+                bindings.setRootDescriptorTable(pSink, samplerIt.second.rootSigOffset, samplerIt.second.gpuHandle);
             }
         }
     }
 
-    void ComputeVars::apply(CopyContext* pContext) const
+    void ComputeVars::apply(CopyContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const
     {
-        applyCommon<false>(pContext);
+        applyCommon(pContext, bindings, pSink);
     }
 
-    void GraphicsVars::apply(RenderContext* pContext) const
+    void GraphicsVars::apply(RenderContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const
     {
-        applyCommon<true>(pContext);
+        applyCommon(pContext, bindings, pSink);
     }
 }
\ No newline at end of file
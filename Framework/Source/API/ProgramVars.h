@@ -34,6 +34,7 @@
 #include "API/StructuredBuffer.h"
 #include "API/TypedBuffer.h"
 #include "API/LowLevel/RootSignature.h"
+#include "API/LowLevel/RootBindingCache.h"
 
 namespace Falcor
 {
@@ -192,12 +193,18 @@ namespace Falcor
         */
         RootSignature::SharedPtr getRootSignature() const { return mpRootSignature; }
 
+        /** Data for a bound resource. For constant buffers, pView holds the buffer itself.
+            The GPU handle and the buffer pointers are resolved when the resource is set, so that applying the vars doesn't need to look them up.
+        */
         template<typename ViewType>
         struct ResourceData
         {
             typename ViewType::SharedPtr pView;
             Resource::SharedPtr pResource;
             uint32_t rootSigOffset = 0;
+            uint64_t gpuHandle = 0;                                 // The view's descriptor, or the null view's descriptor if no resource is bound
+            const TypedBufferBase* pTypedBuffer = nullptr;          // Set if the resource is a typed buffer, which needs to be uploaded before use
+            const StructuredBuffer* pStructuredBuffer = nullptr;    // Set if the resource is a structured buffer, which needs to be uploaded before use
         };
 
         template<>
@@ -205,14 +212,14 @@ namespace Falcor
         {
             Sampler::SharedPtr pSampler;
             uint32_t rootSigOffset = 0;
+            uint64_t gpuHandle = 0;
         };
 
         template<typename T>
         using ResourceMap = std::unordered_map<uint32_t, ResourceData<T>>;
 
     protected:
-        template<bool forGraphics, typename ContextType>
-        void applyCommon(ContextType* pContext) const;
+        void applyCommon(CopyContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const;
 
         ProgramVars(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers, const RootSignature::SharedPtr& pRootSig);
 
@@ -237,7 +244,13 @@ namespace Falcor
             \param[in] pRootSignature A root-signature describing how to bind resources into the shader. If this parameter is nullptr, a root-signature object will be created from the program reflection object
         */
         static SharedPtr create(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers = true, const RootSignature::SharedPtr& pRootSig = nullptr);
-        void apply(RenderContext* pContext) const;
+
+        /** Upload the buffers, transition the resources and bind the root signature and root arguments.
+            \param[in] pContext The context used to upload and transition the resources
+            \param[in] bindings The graphics bindings which are currently set on the command list. Only the ones which differ are issued.
+            \param[in] pSink Records the issued bindings into the command list
+        */
+        void apply(RenderContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const;
     private:
         GraphicsVars(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers, const RootSignature::SharedPtr& pRootSig) :
             ProgramVars(pReflector, createBuffers, pRootSig) {}
@@ -255,7 +268,13 @@ namespace Falcor
             \param[in] pRootSignature A root-signature describing how to bind resources into the shader. If this parameter is nullptr, a root-signature object will be created from the program reflection object
         */
         static SharedPtr create(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers = true, const RootSignature::SharedPtr& pRootSig = nullptr);
-        void apply(CopyContext* pContext) const;
+
+        /** Upload the buffers, transition the resources and bind the root signature and root arguments.
+            \param[in] pContext The context used to upload and transition the resources
+            \param[in] bindings The compute bindings which are currently set on the command list. Only the ones which differ are issued.
+            \param[in] pSink Records the issued bindings into the command list
+        */
+        void apply(CopyContext* pContext, RootBindingCache& bindings, RootBindingCache::Sink* pSink) const;
     private:
         ComputeVars(const ProgramReflection::SharedConstPtr& pReflector, bool createBuffers, const RootSignature::SharedPtr& pRootSig) :
             ProgramVars(pReflector, createBuffers, pRootSig) {}
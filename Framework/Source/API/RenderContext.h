@@ -173,6 +173,9 @@ namespace Falcor
         // Internal functions used by the API layers
         void applyProgramVars();
         void applyGraphicsState();
-        void prepareForDraw();
+        bool prepareForDraw();  // Returns false if the draw should be skipped
+        void onCommandListReset() override;
+
+        RootBindingCache mGraphicsBindings;     // The graphics root signature and root arguments set on the command list
     };
 }
\ No newline at end of file
@@ -85,6 +85,77 @@ namespace Falcor
     {
         Buffer::init(nullptr);
         mData.assign(mSize, 0);
+        mDirtyRanges.push_back({ 0, mSize });
+    }
+
+    VariablesBuffer::AtomicUploadStats VariablesBuffer::sUploadStats;
+    VariablesBuffer::UploadStats VariablesBuffer::sLastFrameUploadStats;
+
+    // Every range costs a separate copy, so ranges which are closer than this are merged
+    static const size_t kDirtyRangeMergeGap = 256;
+    // When there are more ranges than this, the two closest ranges are merged
+    static const size_t kMaxDirtyRanges = 8;
+
+    VariablesBuffer::UploadStats VariablesBuffer::getUploadStats()
+    {
+        UploadStats stats;
+        stats.bytesWritten = sUploadStats.bytesWritten.load();
+        stats.bytesUploaded = sUploadStats.bytesUploaded.load();
+        stats.bytesCarriedOver = sUploadStats.bytesCarriedOver.load();
+        stats.uploadCount = sUploadStats.uploadCount.load();
+        return stats;
+    }
+
+    void VariablesBuffer::beginNewFrame()
+    {
+        sLastFrameUploadStats.bytesWritten = sUploadStats.bytesWritten.exchange(0);
+        sLastFrameUploadStats.bytesUploaded = sUploadStats.bytesUploaded.exchange(0);
+        sLastFrameUploadStats.bytesCarriedOver = sUploadStats.bytesCarriedOver.exchange(0);
+        sLastFrameUploadStats.uploadCount = sUploadStats.uploadCount.exchange(0);
+    }
+
+    void VariablesBuffer::markDirty(size_t offset, size_t size)
+    {
+        sUploadStats.bytesWritten += size;
+        DirtyRange range = { offset, offset + size };
+
+        // Find the first range which ends near or after the start of the new range, and merge all the ranges which start near or before its end
+        auto first = mDirtyRanges.begin();
+        while(first != mDirtyRanges.end() && first->end + kDirtyRangeMergeGap < range.begin)
+        {
+            first++;
+        }
+        auto last = first;
+        while(last != mDirtyRanges.end() && last->begin <= range.end + kDirtyRangeMergeGap)
+        {
+            range.begin = min(range.begin, last->begin);
+            range.end = max(range.end, last->end);
+            last++;
+        }
+
+        if(first == last)
+        {
+            mDirtyRanges.insert(first, range);
+        }
+        else
+        {
+            *first = range;
+            mDirtyRanges.erase(first + 1, last);
+        }
+
+        while(mDirtyRanges.size() > kMaxDirtyRanges)
+        {
+            size_t closest = 0;
+            for(size_t i = 1; i < mDirtyRanges.size() - 1; i++)
+            {
+                if(mDirtyRanges[i + 1].begin - mDirtyRanges[i].end < mDirtyRanges[closest + 1].begin - mDirtyRanges[closest].end)
+                {
+                    closest = i;
+                }
+            }
+            mDirtyRanges[closest].end = mDirtyRanges[closest + 1].end;
+            mDirtyRanges.erase(mDirtyRanges.begin() + closest + 1);
+        }
     }
 
     size_t VariablesBuffer::getVariableOffset(const std::string& varName) const
@@ -96,7 +167,7 @@ namespace Falcor
 
     void VariablesBuffer::uploadToGPU(size_t offset, size_t size) const
     {
-        if(mDirty == false)
+        if(mDirtyRanges.empty())
         {
             return;
         }
@@ -112,8 +183,71 @@ namespace Falcor
             return;
         }
 
-        updateData(mData.data(), offset, size);
-        mDirty = false;
+        // Upload the parts of the dirty ranges which are inside the requested range, and keep the rest
+        const size_t uploadEnd = offset + size;
+        std::vector<DirtyRange> uploaded;
+        std::vector<DirtyRange> remaining;
+        for(const auto& range : mDirtyRanges)
+        {
+            size_t begin = max(range.begin, offset);
+            size_t end = min(range.end, uploadEnd);
+            if(begin >= end)
+            {
+                remaining.push_back(range);
+                continue;
+            }
+
+            uploaded.push_back({ begin, end });
+            sUploadStats.bytesUploaded += end - begin;
+            sUploadStats.uploadCount++;
+
+            if(range.begin < begin)
+            {
+                remaining.push_back({ range.begin, begin });
+            }
+            if(range.end > end)
+            {
+                remaining.push_back({ end, range.end });
+            }
+        }
+        mDirtyRanges.swap(remaining);
+
+        if(uploaded.empty())
+        {
+            return;
+        }
+
+        if(mCpuAccess == CpuAccess::Write)
+        {
+            // Mapping renames the buffer. The modified ranges are copied from mData and the rest is carried over from the previous allocation.
+            const void* pPreviousData = nullptr;
+            uint8_t* pDst = (uint8_t*)mapWriteDiscard(pPreviousData);
+            if(pDst == nullptr)
+            {
+                return;
+            }
+            const uint8_t* pSrc = pPreviousData ? (const uint8_t*)pPreviousData : mData.data();
+
+            size_t carriedOver = 0;
+            size_t cursor = 0;
+            for(const auto& range : uploaded)
+            {
+                memcpy(pDst + cursor, pSrc + cursor, range.begin - cursor);
+                memcpy(pDst + range.begin, mData.data() + range.begin, range.end - range.begin);
+                carriedOver += range.begin - cursor;
+                cursor = range.end;
+            }
+            memcpy(pDst + cursor, pSrc + cursor, mSize - cursor);
+            carriedOver += mSize - cursor;
+            sUploadStats.bytesCarriedOver += carriedOver;
+        }
+        else
+        {
+            for(const auto& range : uploaded)
+            {
+                updateData(mData.data() + range.begin, range.begin, range.end - range.begin);
+            }
+        }
     }
 
     template<typename VarType>
@@ -192,6 +326,40 @@ namespace Falcor
 #endif
     }
 
+    template<typename VarType>
+    bool checkVariableHandle(const ProgramReflection::VariableHandle& handle, size_t count, const ProgramReflection::BufferReflection* pBufferDesc, size_t elementSize)
+    {
+        const size_t stride = handle.arrayStride ? handle.arrayStride : sizeof(VarType);
+        const size_t writeSize = (count - 1) * stride + sizeof(VarType);
+#if _LOG_ENABLED
+        std::string msg("Error when setting variable by handle to buffer \"" + pBufferDesc->getName() + "\". ");
+        if(handle.isValid() == false)
+        {
+            logError(msg + "The handle is invalid. Ignoring call.");
+            return false;
+        }
+        if(handle.layoutHash != pBufferDesc->getLayoutHash())
+        {
+            logError(msg + "The handle was resolved from a buffer with a different layout. Ignoring call.");
+            return false;
+        }
+        if(count > max(handle.arraySize, 1u))
+        {
+            logError(msg + "Trying to set " + std::to_string(count) + " elements, but the variable has " + std::to_string(handle.arraySize) + " elements. Ignoring call.");
+            return false;
+        }
+        if(handle.offset + writeSize > elementSize)
+        {
+            logError(msg + "The write would end past the end of the buffer element. Ignoring call.");
+            return false;
+        }
+        return checkVariableType<VarType>(handle.type, "(Set by handle)", pBufferDesc->getName());
+#else
+        // Only the cheap checks. A stale handle or one from another buffer would write out of bounds.
+        return handle.isValid() && (handle.layoutHash == pBufferDesc->getLayoutHash()) && (handle.offset + writeSize <= elementSize);
+#endif
+    }
+
 #define verify_element_index() if(elementIndex >= mElementCount) {logWarning(std::string(__FUNCTION__) + ": elementIndex is out-of-bound. Ignoring call."); return;}
 
     template<typename VarType> 
@@ -200,9 +368,9 @@ namespace Falcor
         verify_element_index();
         if(checkVariableByOffset<VarType>(offset, 1, mpReflector.get()))
         {
-            const uint8_t* pVar = mData.data() + offset + elementIndex * mElementSize;
-            *(VarType*)pVar = value;
-            mDirty = true;
+            size_t varOffset = offset + elementIndex * mElementSize;
+            *(VarType*)(mData.data() + varOffset) = value;
+            markDirty(varOffset, sizeof(VarType));
         }
     }
 
@@ -243,6 +411,55 @@ namespace Falcor
 
 #undef set_constant_by_offset
 
+    template<typename VarType>
+    void VariablesBuffer::setVariable(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const VarType& value)
+    {
+        verify_element_index();
+        if(checkVariableHandle<VarType>(handle, 1, mpReflector.get(), mElementSize))
+        {
+            size_t varOffset = handle.offset + elementIndex * mElementSize;
+            *(VarType*)(mData.data() + varOffset) = value;
+            markDirty(varOffset, sizeof(VarType));
+        }
+    }
+
+#define set_constant_by_handle(_t) template void VariablesBuffer::setVariable(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const _t& value)
+    set_constant_by_handle(bool);
+    set_constant_by_handle(glm::bvec2);
+    set_constant_by_handle(glm::bvec3);
+    set_constant_by_handle(glm::bvec4);
+
+    set_constant_by_handle(uint32_t);
+    set_constant_by_handle(glm::uvec2);
+    set_constant_by_handle(glm::uvec3);
+    set_constant_by_handle(glm::uvec4);
+
+    set_constant_by_handle(int32_t);
+    set_constant_by_handle(glm::ivec2);
+    set_constant_by_handle(glm::ivec3);
+    set_constant_by_handle(glm::ivec4);
+
+    set_constant_by_handle(float);
+    set_constant_by_handle(glm::vec2);
+    set_constant_by_handle(glm::vec3);
+    set_constant_by_handle(glm::vec4);
+
+    set_constant_by_handle(glm::mat2);
+    set_constant_by_handle(glm::mat2x3);
+    set_constant_by_handle(glm::mat2x4);
+
+    set_constant_by_handle(glm::mat3);
+    set_constant_by_handle(glm::mat3x2);
+    set_constant_by_handle(glm::mat3x4);
+
+    set_constant_by_handle(glm::mat4);
+    set_constant_by_handle(glm::mat4x2);
+    set_constant_by_handle(glm::mat4x3);
+
+    set_constant_by_handle(uint64_t);
+
+#undef set_constant_by_handle
+
     template<typename VarType>
     void VariablesBuffer::setVariable(const std::string& name, size_t element, const VarType& value)
     {
@@ -298,13 +515,13 @@ namespace Falcor
         verify_element_index();
         if(checkVariableByOffset<VarType>(offset, count, mpReflector.get()))
         {
-            const uint8_t* pVar = mData.data() + offset;
-            VarType* pData = (VarType*)pVar + elementIndex * mElementSize;
+            size_t varOffset = offset + elementIndex * mElementSize;
+            VarType* pData = (VarType*)(mData.data() + varOffset);
             for(size_t i = 0; i < count; i++)
             {
                 pData[i] = pValue[i];
             }
-            mDirty = true;
+            markDirty(varOffset, sizeof(VarType) * count);
         }
     }
 
@@ -346,6 +563,59 @@ namespace Falcor
 
 #undef set_constant_array_by_offset
 
+    template<typename VarType>
+    void VariablesBuffer::setVariableArray(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const VarType* pValue, size_t count)
+    {
+        verify_element_index();
+        if(count > 0 && checkVariableHandle<VarType>(handle, count, mpReflector.get(), mElementSize))
+        {
+            size_t varOffset = handle.offset + elementIndex * mElementSize;
+            size_t stride = handle.arrayStride ? handle.arrayStride : sizeof(VarType);
+            for(size_t i = 0; i < count; i++)
+            {
+                *(VarType*)(mData.data() + varOffset + i * stride) = pValue[i];
+            }
+            markDirty(varOffset, (count - 1) * stride + sizeof(VarType));
+        }
+    }
+
+#define set_constant_array_by_handle(_t) template void VariablesBuffer::setVariableArray(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const _t* pValue, size_t count)
+    set_constant_array_by_handle(bool);
+    set_constant_array_by_handle(glm::bvec2);
+    set_constant_array_by_handle(glm::bvec3);
+    set_constant_array_by_handle(glm::bvec4);
+
+    set_constant_array_by_handle(uint32_t);
+    set_constant_array_by_handle(glm::uvec2);
+    set_constant_array_by_handle(glm::uvec3);
+    set_constant_array_by_handle(glm::uvec4);
+
+    set_constant_array_by_handle(int32_t);
+    set_constant_array_by_handle(glm::ivec2);
+    set_constant_array_by_handle(glm::ivec3);
+    set_constant_array_by_handle(glm::ivec4);
+
+    set_constant_array_by_handle(float);
+    set_constant_array_by_handle(glm::vec2);
+    set_constant_array_by_handle(glm::vec3);
+    set_constant_array_by_handle(glm::vec4);
+
+    set_constant_array_by_handle(glm::mat2);
+    set_constant_array_by_handle(glm::mat2x3);
+    set_constant_array_by_handle(glm::mat2x4);
+
+    set_constant_array_by_handle(glm::mat3);
+    set_constant_array_by_handle(glm::mat3x2);
+    set_constant_array_by_handle(glm::mat3x4);
+
+    set_constant_array_by_handle(glm::mat4);
+    set_constant_array_by_handle(glm::mat4x2);
+    set_constant_array_by_handle(glm::mat4x3);
+
+    set_constant_array_by_handle(uint64_t);
+
+#undef set_constant_array_by_handle
+
     template<typename VarType>
     void VariablesBuffer::setVariableArray(const std::string& name, size_t elementIndex, const VarType* pValue, size_t count)
     {
@@ -397,15 +667,31 @@ namespace Falcor
 
     void VariablesBuffer::setBlob(const void* pSrc, size_t offset, size_t size)
     {
-        if((_LOG_ENABLED != 0) && (offset + size > mSize))
+        // Checked in all builds, an overflow would corrupt the heap
+        if(offset + size > mSize)
         {
+#if _LOG_ENABLED
             std::string Msg("Error when setting blob to buffer\"");
             Msg += mpReflector->getName() + "\". Blob to large and will result in overflow. Ignoring call.";
             logError(Msg);
+#endif
             return;
         }
         memcpy(mData.data() + offset, pSrc, size);
-        mDirty = true;
+        markDirty(offset, size);
+    }
+
+    void VariablesBuffer::setBlob(const ProgramReflection::VariableHandle& handle, const void* pSrc, size_t size)
+    {
+        // A handle from a buffer with a different layout would point to the wrong variable. The bounds are checked by the offset version.
+        if(isHandleCompatible(handle) == false)
+        {
+#if _LOG_ENABLED
+            logError("Error when setting blob to buffer \"" + mpReflector->getName() + "\". The handle is invalid or was resolved from a buffer with a different layout. Ignoring call.");
+#endif
+            return;
+        }
+        setBlob(pSrc, handle.offset, size);
     }
 
     bool checkResourceDimension(const Texture* pTexture, const ProgramReflection::Resource* pResourceDesc, const std::string& name, const std::string& bufferName)
@@ -560,7 +846,7 @@ namespace Falcor
 
         if(bOK)
         {
-            mDirty = true;
+            // Textures aren't stored in the buffer data, so there is no dirty range to record
             setTextureInternal(offset, pTexture, pSampler);
         }
     }
@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <atomic>
 #include <string>
 #include "ProgramReflection.h"
 #include "Texture.h"
@@ -52,7 +53,30 @@ namespace Falcor
 
         virtual ~VariablesBuffer() = 0;
 
+        /** Upload statistics, accumulated across all the variable buffers
+        */
+        struct UploadStats
+        {
+            uint64_t bytesWritten = 0;      ///< Number of bytes written by the set*() functions
+            uint64_t bytesUploaded = 0;     ///< Number of modified bytes copied to the GPU by uploadToGPU()
+            uint64_t bytesCarriedOver = 0;  ///< Number of unmodified bytes copied from the previous allocation when a CpuAccess::Write buffer was renamed
+            uint32_t uploadCount = 0;       ///< Number of copies of modified data issued by uploadToGPU()
+        };
+
+        /** Get the statistics of the current frame
+        */
+        static UploadStats getUploadStats();
+
+        /** Get the statistics of the previous frame
+        */
+        static const UploadStats& getLastFrameUploadStats() { return sLastFrameUploadStats; }
+
+        /** Start collecting the statistics of a new frame
+        */
+        static void beginNewFrame();
+
         /** Apply the changes to the actual GPU buffer.
+        Only the ranges which were modified since the last upload are copied. Buffers with CPU write access are renamed on every upload, so for them the entire requested range is written.
         Note that it is possible to use this function to update only part of the GPU copy of the buffer. This might lead to inconsistencies between the GPU and CPU buffer, so make sure you know what you are doing.
         \param[in] offset Offset into the buffer to write to
         \param[in] size   Number of bytes to upload. If this value is -1, will update the [Offset, EndOfBuffer] range.
@@ -75,6 +99,22 @@ namespace Falcor
         */
         size_t getVariableOffset(const std::string& varName) const;
 
+        /** Resolve a variable name into a handle. See notes about naming in the VariablesBuffer class description. Constant name can be provided with an implicit array-index, similar to VariablesBuffer#SetVariableArray.
+        The handle is valid for all buffers with the same layout. Store it, and use it instead of the name in functions which are called frequently.
+        */
+        ProgramReflection::VariableHandle getVariableHandle(const std::string& varName) const { return mpReflector->getVariableHandle(varName, true); }
+
+        /** Check if a handle was resolved from a buffer with the same layout as this buffer
+        */
+        bool isHandleCompatible(const ProgramReflection::VariableHandle& handle) const { return handle.isValid() && handle.layoutHash == mpReflector->getLayoutHash(); }
+
+        /** Set a block of data into the buffer, starting at the variable a handle points to.
+        \param[in] handle The variable handle
+        \param[in] pSrc Pointer to the source data.
+        \param[in] size Number of bytes in the source data.
+        */
+        void setBlob(const ProgramReflection::VariableHandle& handle, const void* pSrc, size_t size);
+
         static const size_t VariablesBuffer::kInvalidOffset = ProgramReflection::kInvalidLocation;
 
         size_t getElementCount() const { return mElementCount; }
@@ -93,6 +133,12 @@ namespace Falcor
         template<typename T>
         void setVariableArray(const std::string& name, size_t elementIndex, const T* pValue, size_t count);
 
+        template<typename T>
+        void setVariable(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const T& value);
+
+        template<typename T>
+        void setVariableArray(const ProgramReflection::VariableHandle& handle, size_t elementIndex, const T* pValue, size_t count);
+
         void setTexture(const std::string& name, const Texture* pTexture, const Sampler* pSampler);
 
         void setTextureArray(const std::string& name, const Texture* pTexture[], const Sampler* pSampler, size_t count);
@@ -101,10 +147,30 @@ namespace Falcor
 
         void setTextureInternal(size_t offset, const Texture* pTexture, const Sampler* pSampler);
 
+        void markDirty(size_t offset, size_t size);
+
         ProgramReflection::BufferReflection::SharedConstPtr mpReflector;
         std::vector<uint8_t> mData;
-        mutable bool mDirty = true;
+
+        // Byte ranges [begin, end) which were modified since the last upload. Sorted and disjoint.
+        struct DirtyRange
+        {
+            size_t begin;
+            size_t end;
+        };
+        mutable std::vector<DirtyRange> mDirtyRanges;
         size_t mElementCount;
         size_t mElementSize;
+
+        // The buffers can be updated from several threads
+        struct AtomicUploadStats
+        {
+            std::atomic<uint64_t> bytesWritten{ 0 };
+            std::atomic<uint64_t> bytesUploaded{ 0 };
+            std::atomic<uint64_t> bytesCarriedOver{ 0 };
+            std::atomic<uint32_t> uploadCount{ 0 };
+        };
+        static AtomicUploadStats sUploadStats;
+        static UploadStats sLastFrameUploadStats;
     };
 }
\ No newline at end of file
@@ -37,6 +37,7 @@ namespace Falcor
     const char* kDepthPassVSFile = "Effects/ShadowPass.vs.hlsl";
     const char* kDepthPassGsFile = "Effects/ShadowPass.gs.hlsl";
     const char* kDepthPassFsFile = "Effects/ShadowPass.ps.hlsl";
+    const Program::DefineSet::Define kTestAlphaDefine = Program::DefineSet::intern("TEST_ALPHA");
 
     const Gui::DropdownList kFilterList = {
         { (uint32_t)CsmFilterPoint, "Point" },
@@ -79,11 +80,11 @@ namespace Falcor
                 float alphaThreshold = currentData.pMaterial->getAlphaThreshold();
                 pContext->getGraphicsVars()->getConstantBuffer(1u)->setBlob(&alphaThreshold, 0u, sizeof(float));
                 pContext->getGraphicsVars()->setSrv(0u, currentData.pMaterial->getAlphaMap()->getSRV());
-                pContext->getGraphicsState()->getProgram()->addDefine("TEST_ALPHA");
+                pContext->getGraphicsState()->getProgram()->addDefine(kTestAlphaDefine);
             }
             else
             {
-                pContext->getGraphicsState()->getProgram()->removeDefine("TEST_ALPHA");
+                pContext->getGraphicsState()->getProgram()->removeDefine(kTestAlphaDefine);
             }
             
             return true;
@@ -667,8 +668,12 @@ namespace Falcor
 
         mCsmData.lightDir = glm::normalize(((DirectionalLight*)mpLight.get())->getWorldDirection());
         ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer("PerFrameCB");
-        size_t offset = pCB->getVariableOffset(varName + ".globalMat");
-        pCB->setBlob(&mCsmData, offset, sizeof(mCsmData));
+        if (varName != mCsmDataVarName || pCB->isHandleCompatible(mCsmDataHandle) == false)
+        {
+            mCsmDataHandle = pCB->getVariableHandle(varName + ".globalMat");
+            mCsmDataVarName = varName;
+        }
+        pCB->setBlob(mCsmDataHandle, &mCsmData, sizeof(mCsmData));
     }
     
     Texture::SharedPtr CascadedShadowMaps::getShadowMap() const
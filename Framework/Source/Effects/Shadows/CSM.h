@@ -154,5 +154,7 @@ namespace Falcor
         int32_t renderCascade = 0;
         Controls mControls;
         CsmData mCsmData;
+        ProgramReflection::VariableHandle mCsmDataHandle;   // Cached handle of the variable last passed to setDataIntoGraphicsVars()
+        std::string mCsmDataVarName;
     };
 }
@@ -78,8 +78,8 @@ namespace Falcor
         mpProgram = GraphicsProgram::createFromFile("Effects\\SkyBox.vs.hlsl", "Effects\\Skybox.ps.hlsl", defines);
         mpVars = GraphicsVars::create(mpProgram->getActiveVersion()->getReflector());
         ConstantBuffer::SharedPtr& pCB = mpVars->getConstantBuffer(0);
-        mScaleOffset = pCB->getVariableOffset("gScale");
-        mMatOffset = pCB->getVariableOffset("gWorld");
+        mScaleHandle = pCB->getVariableHandle("gScale");
+        mMatHandle = pCB->getVariableHandle("gWorld");
 
         mpVars->setTexture(kTextureName, pTexture);
         mpVars->setSampler(kSamplerName, pSampler);
@@ -136,8 +136,8 @@ namespace Falcor
     {
         glm::mat4 world = glm::translate(pCamera->getPosition());
         ConstantBuffer::SharedPtr& pCB = mpVars->getConstantBuffer(0);
-        pCB->setVariable(mMatOffset, world);
-        pCB->setVariable(mScaleOffset, mScale);
+        pCB->setVariable(mMatHandle, world);
+        pCB->setVariable(mScaleHandle, mScale);
 
         mpState->setFbo(pRenderCtx->getGraphicsState()->getFbo());
         pRenderCtx->pushGraphicsVars(mpVars);
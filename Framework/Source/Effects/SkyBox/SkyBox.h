@@ -59,8 +59,8 @@ namespace Falcor
         SkyBox() = default;
         bool createResources(Texture::SharedPtr& pTexture, Sampler::SharedPtr pSampler, bool renderStereo);
 
-        size_t mMatOffset;
-        size_t mScaleOffset;
+        ProgramReflection::VariableHandle mMatHandle;
+        ProgramReflection::VariableHandle mScaleHandle;
 
         float mScale = 1;
         Model::SharedPtr mpCubeModel;
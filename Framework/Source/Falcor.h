@@ -75,6 +75,7 @@
 #include "Graphics/Camera/Camera.h"
 #include "Graphics/Camera/CameraController.h"
 #include "Graphics/GraphicsState.h"
+#include "Graphics/PipelineStateCache.h"
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/TextureHelper.h"
 #include "Graphics/Light.h"
@@ -121,6 +122,8 @@
 #include "Utils/Profiler.h"
 #include "Utils/StringUtils.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/BinaryMemoryStream.h"
+#include "Utils/MemoryMappedFile.h"
 #include "Utils/Video/VideoEncoder.h"
 #include "Utils/Video/VideoEncoderUI.h"
 #include "Utils/Video/VideoDecoder.h"
@@ -37,4 +37,6 @@
 #define _PROFILING_LOG 0     /*Set this to 1 to dump profiling data while profiler is active.*/
 #define _PROFILING_LOG_BATCH_SIZE 1024*1 /*This can be used to control how many samples are accumulated before they are dumped to file.*/
 
+#define _ENABLE_SHADER_CACHE 1 /*Set this to 1 to cache compiled shaders in a 'ShaderCache' directory next to the executable. The cache directory can be changed at runtime using ShaderCache::setDirectory().*/
+
 #define _ENABLE_NVAPI false // Controls NVIDIA specific DX extensions. If it is set to true, make sure you have the NVAPI package in your 'Externals' directory. View the readme for more information
\ No newline at end of file
@@ -31,9 +31,95 @@
 #include "utils/AABB.h"
 #include "Utils/math/FalcorMath.h"
 #include "API/ConstantBuffer.h"
+#include <intrin.h>
+#include <immintrin.h>
 
 namespace Falcor
 {
+    // Frustum planes in structure-of-arrays form, used by the batched culling
+    struct FrustumPlaneArrays
+    {
+        float x[6], y[6], z[6];
+        float signX[6], signY[6], signZ[6];
+        float negW[6];
+    };
+
+    static bool isAvxSupported()
+    {
+        static const bool supported = []()
+        {
+            int info[4];
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            // Make sure the OS saves the YMM registers on context switch
+            return osxsave && avx && ((_xgetbv(0) & 0x6) == 0x6);
+        }();
+        return supported;
+    }
+
+    // The SIMD versions replicate the exact operation order of Camera::isObjectCulled(), so the results are identical
+    static uint32_t cullBoxesAvx(const FrustumPlaneArrays& planes, const BoundingBoxArrays& boxes, uint32_t first)
+    {
+        const __m256 cx = _mm256_loadu_ps(boxes.pCenterX + first);
+        const __m256 cy = _mm256_loadu_ps(boxes.pCenterY + first);
+        const __m256 cz = _mm256_loadu_ps(boxes.pCenterZ + first);
+        const __m256 ex = _mm256_loadu_ps(boxes.pExtentX + first);
+        const __m256 ey = _mm256_loadu_ps(boxes.pExtentY + first);
+        const __m256 ez = _mm256_loadu_ps(boxes.pExtentZ + first);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int plane = 0; plane < 6; plane++)
+        {
+            const __m256 tx = _mm256_add_ps(cx, _mm256_mul_ps(ex, _mm256_set1_ps(planes.signX[plane])));
+            const __m256 ty = _mm256_add_ps(cy, _mm256_mul_ps(ey, _mm256_set1_ps(planes.signY[plane])));
+            const __m256 tz = _mm256_add_ps(cz, _mm256_mul_ps(ez, _mm256_set1_ps(planes.signZ[plane])));
+
+            __m256 dr = _mm256_add_ps(_mm256_mul_ps(tx, _mm256_set1_ps(planes.x[plane])), _mm256_mul_ps(ty, _mm256_set1_ps(planes.y[plane])));
+            dr = _mm256_add_ps(dr, _mm256_mul_ps(tz, _mm256_set1_ps(planes.z[plane])));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(dr, _mm256_set1_ps(planes.negW[plane]), _CMP_GT_OQ));
+        }
+
+        return (~(uint32_t)_mm256_movemask_ps(inside)) & 0xFF;
+    }
+
+    static uint32_t cullBoxesSse(const FrustumPlaneArrays& planes, const BoundingBoxArrays& boxes, uint32_t first)
+    {
+        const __m128 cx = _mm_loadu_ps(boxes.pCenterX + first);
+        const __m128 cy = _mm_loadu_ps(boxes.pCenterY + first);
+        const __m128 cz = _mm_loadu_ps(boxes.pCenterZ + first);
+        const __m128 ex = _mm_loadu_ps(boxes.pExtentX + first);
+        const __m128 ey = _mm_loadu_ps(boxes.pExtentY + first);
+        const __m128 ez = _mm_loadu_ps(boxes.pExtentZ + first);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int plane = 0; plane < 6; plane++)
+        {
+            const __m128 tx = _mm_add_ps(cx, _mm_mul_ps(ex, _mm_set1_ps(planes.signX[plane])));
+            const __m128 ty = _mm_add_ps(cy, _mm_mul_ps(ey, _mm_set1_ps(planes.signY[plane])));
+            const __m128 tz = _mm_add_ps(cz, _mm_mul_ps(ez, _mm_set1_ps(planes.signZ[plane])));
+
+            __m128 dr = _mm_add_ps(_mm_mul_ps(tx, _mm_set1_ps(planes.x[plane])), _mm_mul_ps(ty, _mm_set1_ps(planes.y[plane])));
+            dr = _mm_add_ps(dr, _mm_mul_ps(tz, _mm_set1_ps(planes.z[plane])));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(dr, _mm_set1_ps(planes.negW[plane])));
+        }
+
+        return (~(uint32_t)_mm_movemask_ps(inside)) & 0xF;
+    }
+
+    static uint32_t cullBoxScalar(const FrustumPlaneArrays& planes, const BoundingBoxArrays& boxes, uint32_t i)
+    {
+        bool isInside = true;
+        for (int plane = 0; plane < 6; plane++)
+        {
+            const float tx = boxes.pCenterX[i] + boxes.pExtentX[i] * planes.signX[plane];
+            const float ty = boxes.pCenterY[i] + boxes.pExtentY[i] * planes.signY[plane];
+            const float tz = boxes.pCenterZ[i] + boxes.pExtentZ[i] * planes.signZ[plane];
+            const float dr = tx * planes.x[plane] + ty * planes.y[plane] + tz * planes.z[plane];
+            isInside = isInside & (dr > planes.negW[plane]);
+        }
+        return isInside ? 0 : 1;
+    }
 
     Camera::Camera()
     {
@@ -188,6 +274,77 @@ namespace Falcor
         return !isInside;
     }
 
+    Camera::FrustumTest Camera::testBoundingBox(const BoundingBox& box) const
+    {
+        calculateCameraParameters();
+
+        bool isInside = true;
+        for (int plane = 0; plane < 6; plane++)
+        {
+            // Test the corner farthest along the plane normal first. If it's behind the plane, the box is outside.
+            glm::vec3 signedExtent = box.extent * mFrustumPlanes[plane].sign;
+            float dr = glm::dot(box.center + signedExtent, mFrustumPlanes[plane].xyz);
+            if ((dr > mFrustumPlanes[plane].negW) == false)
+            {
+                return FrustumTest::Outside;
+            }
+
+            // The nearest corner tells if the box is entirely in front of the plane
+            float dn = glm::dot(box.center - signedExtent, mFrustumPlanes[plane].xyz);
+            isInside = isInside && (dn > mFrustumPlanes[plane].negW);
+        }
+
+        return isInside ? FrustumTest::Inside : FrustumTest::Intersecting;
+    }
+
+    void Camera::cullBoundingBoxes(const BoundingBoxArrays& boxes, uint32_t* pCulledMask) const
+    {
+        calculateCameraParameters();
+
+        FrustumPlaneArrays planes;
+        for (int plane = 0; plane < 6; plane++)
+        {
+            planes.x[plane] = mFrustumPlanes[plane].xyz.x;
+            planes.y[plane] = mFrustumPlanes[plane].xyz.y;
+            planes.z[plane] = mFrustumPlanes[plane].xyz.z;
+            planes.signX[plane] = mFrustumPlanes[plane].sign.x;
+            planes.signY[plane] = mFrustumPlanes[plane].sign.y;
+            planes.signZ[plane] = mFrustumPlanes[plane].sign.z;
+            planes.negW[plane] = mFrustumPlanes[plane].negW;
+        }
+
+        const bool useAvx = isAvxSupported();
+        const uint32_t wordCount = (boxes.count + 31) / 32;
+        for (uint32_t word = 0; word < wordCount; word++)
+        {
+            const uint32_t first = word * 32;
+            const uint32_t count = min(32u, boxes.count - first);
+            uint32_t mask = 0;
+            uint32_t i = 0;
+
+            if (useAvx)
+            {
+                for (; i + 8 <= count; i += 8)
+                {
+                    mask |= cullBoxesAvx(planes, boxes, first + i) << i;
+                }
+                _mm256_zeroupper();
+            }
+
+            for (; i + 4 <= count; i += 4)
+            {
+                mask |= cullBoxesSse(planes, boxes, first + i) << i;
+            }
+
+            for (; i < count; i++)
+            {
+                mask |= cullBoxScalar(planes, boxes, first + i) << i;
+            }
+
+            pCulledMask[word] = mask;
+        }
+    }
+
     void Camera::setRightEyeMatrices(const glm::mat4& view, const glm::mat4& proj)
     {
         mData.rightEyeViewMat = view;
@@ -216,6 +373,14 @@ namespace Falcor
         pBuffer->setBlob(&mData, offset, getShaderDataSize());
     }
 
+    void Camera::setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle) const
+    {
+        calculateCameraParameters();
+        assert(handle.offset + getShaderDataSize() <= pBuffer->getSize());
+
+        pBuffer->setBlob(handle, &mData, getShaderDataSize());
+    }
+
     void Camera::move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up)
     {
         setPosition(position);
@@ -32,10 +32,12 @@
 #include "Data/HostDeviceData.h"
 #include <vector>
 #include "graphics/Paths/MovableObject.h"
+#include "API/ProgramReflection.h"
 
 namespace Falcor
 {
     struct BoundingBox;
+    struct BoundingBoxArrays;
     class ConstantBuffer;
 
    /** Camera class
@@ -151,9 +153,34 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Result of a bounding box vs. frustum test
+        */
+        enum class FrustumTest
+        {
+            Outside,        ///< The box is completely outside the frustum
+            Intersecting,   ///< The box crosses at least one frustum plane
+            Inside          ///< The box is completely inside the frustum
+        };
+
+        /** Classify a bounding box against the camera frustum. Unlike isObjectCulled(), this also detects boxes which are fully inside the frustum.
+        */
+        FrustumTest testBoundingBox(const BoundingBox& box) const;
+
+        /** Check a batch of bounding boxes against the camera frustum. The boxes are tested 8 (AVX) or 4 (SSE) at a time, the results match isObjectCulled().
+            \param[in] boxes The boxes to test
+            \param[out] pCulledMask Bitmask with a bit per box. Bit i is set if box i should be culled. Must hold at least (boxes.count + 31) / 32 words.
+        */
+        void cullBoundingBoxes(const BoundingBoxArrays& boxes, uint32_t* pCulledMask) const;
+
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName) const;
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::size_t& offset) const;
 
+        /** Set the camera data into a constant buffer
+            \param[in] pBuffer The constant buffer to set the data into
+            \param[in] handle Handle of the first field of the camera variable (viewMat), as returned by ConstantBuffer::getVariableHandle()
+        */
+        void setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle) const;
+
         /** Returns the raw camera data
         */
         const CameraData& getData() const     { calculateCameraParameters(); return  mData; }
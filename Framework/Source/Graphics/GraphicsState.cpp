@@ -29,11 +29,10 @@
 #include "Framework.h"
 #include "GraphicsState.h"
 #include "API/ProgramVars.h"
+#include "Graphics/PipelineStateCache.h"
 
 namespace Falcor
 {
-    std::vector<GraphicsState*> GraphicsState::sObjects;
-
     static GraphicsStateObject::PrimitiveType topology2Type(Vao::Topology t)
     {
         switch (t)
@@ -64,32 +63,9 @@ namespace Falcor
         {
             setViewport(i, mViewports[i], true);
         }
-
-        mpGsoGraph = StateGraph::create();
-        sObjects.push_back(this);
-    }
-
-    GraphicsState::~GraphicsState()
-    {
-        // Remove the current object from the program vector
-        for (auto it = sObjects.begin(); it != sObjects.end(); it++)
-        {
-            if (*it == this)
-            {
-                sObjects.erase(it);
-                break;;
-            }
-        }
     }
 
-    void GraphicsState::beginNewFrame()
-    {
-        for (auto& pThis : sObjects)
-        {
-            pThis->mpGsoGraph->gotoStart();
-            pThis->mCachedData.pProgramVersion = nullptr;
-        }
-    }
+    GraphicsState::~GraphicsState() = default;
 
     GraphicsStateObject::SharedPtr GraphicsState::getGSO(const GraphicsVars* pVars)
     {
@@ -97,24 +73,27 @@ namespace Falcor
         {
             mpVao->getVertexLayout()->addVertexAttribDclToProg(mpProgram.get());
         }
-        const ProgramVersion::SharedConstPtr pProgVersion = mpProgram ? mpProgram->getActiveVersion() : nullptr;
-        bool newProgVersion = pProgVersion.get() != mCachedData.pProgramVersion;
-        if (newProgVersion)
+        // Blocks until the version is compiled, unless the caller opted into a fallback
+        const ProgramVersion::SharedConstPtr pProgVersion = mpProgram ? mpProgram->getActiveVersionAsync(mProgramFallback) : nullptr;
+        if (mpProgram && pProgVersion == nullptr)
+        {
+            return nullptr;
+        }
+        if (pProgVersion.get() != mCachedData.pProgramVersion)
         {
             mCachedData.pProgramVersion = pProgVersion.get();
-            mpGsoGraph->walk((void*)pProgVersion.get());
+            mGsoDirty = true;
         }
     
         RootSignature::SharedPtr pRoot = pVars ? pVars->getRootSignature() : RootSignature::getEmpty();
-
         if (mCachedData.pRootSig != pRoot.get())
         {
             mCachedData.pRootSig = pRoot.get();
-            mpGsoGraph->walk((void*)mCachedData.pRootSig);
+            mGsoDirty = true;
         }
 
-        GraphicsStateObject::SharedPtr pGso = mpGsoGraph->getCurrentNode();
-        if(pGso == nullptr)
+        // The GSO only changes when the state does. Lookups in the cache are by content, so equivalent states share a GSO.
+        if (mGsoDirty || mpGso == nullptr)
         {
             mDesc.setProgramVersion(pProgVersion);
             mDesc.setFboFormats(mpFbo ? mpFbo->getDesc() : Fbo::Desc());
@@ -124,16 +103,17 @@ namespace Falcor
 
             mDesc.setSinglePassStereoEnable(mEnableSinglePassStereo);
             
-            pGso = GraphicsStateObject::create(mDesc);
-            mpGsoGraph->setCurrentNodeData(pGso);
+            mpGso = PipelineStateCache::getGlobalCache().getGso(mDesc, mpProgram.get());
+            mGsoDirty = false;
         }
-        return pGso;
+        return mpGso;
     }
 
     GraphicsState& GraphicsState::setFbo(const Fbo::SharedConstPtr& pFbo, bool setVp0Sc0)
     {
+        // The formats of a different FBO can still match, the cache takes care of that
         mpFbo = pFbo;
-        mpGsoGraph->walk((void*)pFbo.get());
+        mGsoDirty = true;
 
         if (setVp0Sc0 && pFbo)
         {
@@ -164,36 +144,41 @@ namespace Falcor
 
     GraphicsState& GraphicsState::setVao(const Vao::SharedConstPtr& pVao)
     {
+        const VertexLayout* pLayout = mpVao ? mpVao->getVertexLayout().get() : nullptr;
+        const VertexLayout* pNewLayout = pVao ? pVao->getVertexLayout().get() : nullptr;
+        if (pLayout != pNewLayout || (pVao && mpVao && pVao->getPrimitiveTopology() != mpVao->getPrimitiveTopology()))
+        {
+            mGsoDirty = true;
+        }
         mpVao = pVao;
-        mpGsoGraph->walk((void*)pVao->getVertexLayout().get());
         return *this;
     }
 
     GraphicsState& GraphicsState::setBlendState(BlendState::SharedPtr pBlendState)
     {
+        mGsoDirty |= (pBlendState != mDesc.getBlendState());
         mDesc.setBlendState(pBlendState);
-        mpGsoGraph->walk((void*)pBlendState.get());
         return *this;
     }
 
     GraphicsState& GraphicsState::setRasterizerState(RasterizerState::SharedPtr pRasterizerState)
     {
+        mGsoDirty |= (pRasterizerState != mDesc.getRasterizerState());
         mDesc.setRasterizerState(pRasterizerState);
-        mpGsoGraph->walk((void*)pRasterizerState.get());
         return *this;
     }
 
     GraphicsState& GraphicsState::setSampleMask(uint32_t sampleMask)
     { 
+        mGsoDirty |= (sampleMask != mDesc.getSampleMask());
         mDesc.setSampleMask(sampleMask); 
-        mpGsoGraph->walk((void*)(uint64_t)sampleMask);
         return *this; 
     }
 
     GraphicsState& GraphicsState::setDepthStencilState(DepthStencilState::SharedPtr pDepthStencilState)
     {
+        mGsoDirty |= (pDepthStencilState != mDesc.getDepthStencilState());
         mDesc.setDepthStencilState(pDepthStencilState); 
-        mpGsoGraph->walk((void*)pDepthStencilState.get());
         return *this;
     }
 
@@ -255,8 +240,8 @@ namespace Falcor
     void GraphicsState::toggleSinglePassStereo(bool enable)
     {
 #if _ENABLE_NVAPI
+        mGsoDirty |= (enable != mEnableSinglePassStereo);
         mEnableSinglePassStereo = enable;
-        mpGsoGraph->walk((void*)enable);
 #else
         if (enable)
         {
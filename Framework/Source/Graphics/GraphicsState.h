@@ -34,7 +34,6 @@
 #include "API/DepthStencilState.h"
 #include "API/BlendState.h"
 #include <stack>
-#include "Utils/Graph.h"
 
 namespace Falcor
 {
@@ -203,7 +202,17 @@ namespace Falcor
         */
         uint32_t getSampleMask() const { return mDesc.getSampleMask(); }
 
-        /** Get the active graphics state object
+        /** Set what getGSO() does while the program's version for the current defines is being compiled.
+            The default, Program::AsyncFallback::Wait, blocks until the version is ready. With PreviousVersion, draws use the version of the previous defines, or are skipped if there is none. With None, draws are skipped until the version is ready.
+        */
+        GraphicsState& setProgramFallback(Program::AsyncFallback fallback) { mProgramFallback = fallback; return *this; }
+
+        /** Get what getGSO() does while the program's version for the current defines is being compiled
+        */
+        Program::AsyncFallback getProgramFallback() const { return mProgramFallback; }
+
+        /** Get the active graphics state object. The program version is selected according to the program fallback, see setProgramFallback().
+            \return The GSO, or nullptr if there is no program version to use
         */
         GraphicsStateObject::SharedPtr getGSO(const GraphicsVars* pVars);
         
@@ -214,8 +223,6 @@ namespace Falcor
         /** Get the status of single-pass-stereo
         */
         bool isSinglePassStereoEnabled() const { return mEnableSinglePassStereo; }
-
-        static void beginNewFrame();
     private:
         GraphicsState();
         Vao::SharedConstPtr mpVao;
@@ -240,8 +247,9 @@ namespace Falcor
         };
         CachedData mCachedData;
 
-        static std::vector<GraphicsState*> sObjects;
-        using StateGraph = Graph<GraphicsStateObject::SharedPtr, void*>;
-        StateGraph::SharedPtr mpGsoGraph;
+        // Looked up in the PipelineStateCache when the state changed
+        GraphicsStateObject::SharedPtr mpGso;
+        bool mGsoDirty = true;
+        Program::AsyncFallback mProgramFallback = Program::AsyncFallback::Wait;
     };
 }
\ No newline at end of file
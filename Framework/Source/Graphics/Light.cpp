@@ -49,7 +49,7 @@ namespace Falcor
     }
 
 #if _LOG_ENABLED
-#define check_offset(_a) {static bool b = true; if(b) {assert(checkOffset(pBuffer->getVariableOffset(varName + "." + #_a) - offset, offsetof(LightData, _a), #_a));} b = false;}
+#define check_offset(_a) {static bool b = true; if(b) {assert(checkOffset(pBuffer->getVariableOffset(varName + "." + #_a) - handle.offset, offsetof(LightData, _a), #_a));} b = false;}
 #else
 #define check_offset(_a)
 #endif
@@ -62,17 +62,13 @@ namespace Falcor
         sCount++;
     }
 
-    void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName)
+    ProgramReflection::VariableHandle Light::getVariableHandle(const ConstantBuffer* pBuffer, const std::string& varName)
     {
-        static const size_t dataSize = sizeof(LightData) - sizeof(MaterialData);
-        static_assert(dataSize % sizeof(float) * 4 == 0, "LightData size should be a multiple of 16");
-        static_assert(sizeof(LightData) - sizeof(MaterialData) == offsetof(LightData, material), "'material' must be the last field in LightData");
-
-        size_t offset = pBuffer->getVariableOffset(varName + ".worldPos");
-        if (offset == ConstantBuffer::kInvalidOffset)
+        ProgramReflection::VariableHandle handle = pBuffer->getVariableHandle(varName + ".worldPos");
+        if (handle.isValid() == false)
         {
-            logWarning("AreaLight::setIntoConstantBuffer() - variable \"" + varName + "\"not found in constant buffer\n");
-            return;
+            logWarning("Light::getVariableHandle() - variable \"" + varName + "\"not found in constant buffer\n");
+            return handle;
         }
 
         check_offset(worldDir);
@@ -81,10 +77,40 @@ namespace Falcor
         check_offset(aabbMax);
         check_offset(transMat);
         check_offset(numIndices);
-        assert(offset + dataSize <= pBuffer->getSize());
+        return handle;
+    }
+
+    void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName)
+    {
+        ProgramReflection::VariableHandle handle = getVariableHandle(pBuffer, varName);
+        if (handle.isValid())
+        {
+            setIntoConstantBuffer(pBuffer, handle);
+        }
+    }
+
+    void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer)
+    {
+        if (pBuffer->isHandleCompatible(mCachedHandle) == false)
+        {
+            mCachedHandle = getVariableHandle(pBuffer, mName);
+            if (mCachedHandle.isValid() == false)
+            {
+                return;
+            }
+        }
+        setIntoConstantBuffer(pBuffer, mCachedHandle);
+    }
+
+    void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle)
+    {
+        static const size_t dataSize = sizeof(LightData) - sizeof(MaterialData);
+        static_assert(dataSize % sizeof(float) * 4 == 0, "LightData size should be a multiple of 16");
+        static_assert(sizeof(LightData) - sizeof(MaterialData) == offsetof(LightData, material), "'material' must be the last field in LightData");
+        assert(handle.offset + dataSize <= pBuffer->getSize());
 
         // Set everything except for the material
-        pBuffer->setBlob(&mData, offset, dataSize);
+        pBuffer->setBlob(handle, &mData, dataSize);
         if (mData.type == LightArea)
         {
             assert(0);
@@ -349,13 +375,13 @@ namespace Falcor
 #endif
     }
 
-    void AreaLight::setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName)
+    void AreaLight::setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle)
     {
         // Upload data to GPU
         prepareGPUData();
 
         // Call base class method;
-        Light::setIntoConstantBuffer(pBuffer, varName);
+        Light::setIntoConstantBuffer(pBuffer, handle);
     }
 
     void AreaLight::prepareGPUData()
@@ -30,6 +30,7 @@
 #include <glm/common.hpp>
 #include "glm/geometric.hpp"
 #include "API/Texture.h"
+#include "API/ProgramReflection.h"
 #include "glm/mat4x4.hpp"
 #include "Data/HostDeviceData.h"
 #include "Utils/Gui.h"
@@ -56,7 +57,25 @@ namespace Falcor
             \param[in] pBuffer The constant buffer to set the parameters into.
             \param[in] varName The name of the light variable in the program.
         */
-        virtual void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName);
+        void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName);
+
+        /** Set the light parameters into a program.
+            \param[in] pBuffer The constant buffer to set the parameters into.
+            \param[in] handle Handle of the first field of the light variable, as returned by getVariableHandle().
+        */
+        virtual void setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle);
+
+        /** Set the light parameters into the variable with the same name as the light. The variable handle is cached, so the name is only looked up when the buffer layout changes.
+            \param[in] pBuffer The constant buffer to set the parameters into.
+        */
+        void setIntoConstantBuffer(ConstantBuffer* pBuffer);
+
+        /** Get the handle of a light variable, which can be passed to setIntoConstantBuffer()
+            \param[in] pBuffer The constant buffer containing the variable
+            \param[in] varName The name of the light variable in the program.
+            \return The handle, or an invalid handle if the variable wasn't found
+        */
+        static ProgramReflection::VariableHandle getVariableHandle(const ConstantBuffer* pBuffer, const std::string& varName);
 
         /** create UI elements for this light.
             \param[in] pGui The GUI to create the elements with
@@ -81,9 +100,9 @@ namespace Falcor
         */
         inline const LightData& getData() const { return mData; }
 
-        /** Name the light
+        /** Name the light. The name is the shader variable the light is set into, so the cached handle is resolved again.
         */
-        const void setName(const std::string& Name) { mName = Name; }
+        const void setName(const std::string& Name) { mName = Name; mCachedHandle = ProgramReflection::VariableHandle(); }
 
         /** Get the light's name
         */
@@ -106,6 +125,7 @@ namespace Falcor
         static uint32_t sCount;
         std::string mName;
         uint32_t mIndex;
+        ProgramReflection::VariableHandle mCachedHandle;
 
         /* These two variables track mData values for consistent UI operation.*/
         glm::vec3 mUiLightIntensityColor = glm::vec3(0.5f, 0.5f, 0.5f);
@@ -283,9 +303,10 @@ namespace Falcor
             include 'Falcor.h' inside your shader.
 
             \param[in] pBuffer The constant buffer to set the parameters into.
-            \param[in] varName The name of the light variable in the program.
+            \param[in] handle Handle of the first field of the light variable, as returned by getVariableHandle().
         */
-        void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName) override;
+        void setIntoConstantBuffer(ConstantBuffer* pBuffer, const ProgramReflection::VariableHandle& handle) override;
+        using Light::setIntoConstantBuffer;
 
         /**
             Create UI elements for this light.
@@ -299,63 +299,79 @@ namespace Falcor
     }
 
 #if _LOG_ENABLED
-#define check_offset(_a) assert(pCB->getVariableOffset(std::string(varName) + "." + #_a) == (offsetof(MaterialData, _a) + offset))
+#define check_offset(_a) assert(pCB->getVariableOffset(varName + "." + #_a) == (offsetof(MaterialData, _a) + locations.data.offset))
 #else
 #define check_offset(_a)
 #endif
 
-    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const
+    Material::BindLocations Material::getBindLocations(const ProgramVars* pVars, const ConstantBuffer* pCB, const std::string& varName)
     {
-        // OPTME:
-        // We can specialize this function based on the API we are using. This might be worth the extra maintenance cost:
-        // - DX12 - we could create a descriptor-table with all of the SRVs. This will reduce the API overhead to a single call. Pitfall - the textures might be dirty, so we will need to verify it
-        // - Bindless GL - just copy a blob with the GPU pointers. This is actually similar to DX12, but instead of SRVs we store uint64_t
-        // - DX11 - Single call at a time.
-        // Actually, looks like if we will be smart in the way we design ProgramVars::setTextureArray(), we could get away with a unified code
-
-        // First set the desc and the values
-        finalize();
         static const size_t dataSize = sizeof(MaterialDesc) + sizeof(MaterialValues);
         static_assert(dataSize % sizeof(glm::vec4) == 0, "Material::MaterialData size should be a multiple of 16");
 
-        size_t offset = pCB->getVariableOffset(std::string(varName) + ".desc.layers[0].type");
-
-        if(offset == ConstantBuffer::kInvalidOffset)
+        BindLocations locations;
+        locations.data = pCB->getVariableHandle(varName + ".desc.layers[0].type");
+        if(locations.data.isValid() == false)
         {
-            logError(std::string("Material::setIntoConstantBuffer() - variable \"") + varName + "\"not found in constant buffer\n");
-            return;
+            logError("Material::getBindLocations() - variable \"" + varName + "\"not found in constant buffer\n");
+            return locations;
         }
 
         check_offset(values.layers[0].albedo);
         check_offset(values.id);
-        assert(offset + dataSize <= pCB->getSize());
-
-        pCB->setBlob(&mData, offset, dataSize);
+        assert(locations.data.offset + dataSize <= pCB->getSize());
 
 #ifdef FALCOR_GL
 #pragma error Fix material texture bindings for OpenGL
 #endif
 
-        // Now set the textures
-        std::string resourceName = std::string(varName) + ".textures.layers[0]";
-        const auto pResourceDesc = pVars->getReflection()->getResourceDesc(resourceName);
-        if (pResourceDesc == nullptr)
+        const auto pTextureDesc = pVars->getReflection()->getResourceDesc(varName + ".textures.layers[0]");
+        const auto pSamplerDesc = pVars->getReflection()->getResourceDesc(varName + ".samplerState");
+        if (pTextureDesc == nullptr || pSamplerDesc == nullptr)
         {
-            logError(std::string("Material::setIntoConstantBuffer() - can't find the first texture object"));
-            return;
+            logError(std::string("Material::getBindLocations() - can't find the first texture object or the sampler"));
+            return locations;
         }
+        locations.firstTextureRegister = pTextureDesc->regIndex;
+        locations.samplerRegister = pSamplerDesc->regIndex;
+        return locations;
+    }
 
+    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const
+    {
+        BindLocations locations = getBindLocations(pVars, pCB, varName);
+        if (locations.isValid())
+        {
+            setIntoProgramVars(pVars, pCB, locations);
+        }
+    }
+
+    void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const BindLocations& locations) const
+    {
+        // OPTME:
+        // We can specialize this function based on the API we are using. This might be worth the extra maintenance cost:
+        // - DX12 - we could create a descriptor-table with all of the SRVs. This will reduce the API overhead to a single call. Pitfall - the textures might be dirty, so we will need to verify it
+        // - Bindless GL - just copy a blob with the GPU pointers. This is actually similar to DX12, but instead of SRVs we store uint64_t
+        // - DX11 - Single call at a time.
+        // Actually, looks like if we will be smart in the way we design ProgramVars::setTextureArray(), we could get away with a unified code
+
+        // First set the desc and the values
+        finalize();
+        static const size_t dataSize = sizeof(MaterialDesc) + sizeof(MaterialValues);
+        pCB->setBlob(locations.data, &mData, dataSize);
+
+        // Now set the textures
         auto pTextures = (Texture::SharedPtr*)&mData.textures;
 
         for (uint32_t i = 0; i < kTexCount; i++)
         {
             if (pTextures[i] != nullptr)
             {
-                pVars->setSrv(pResourceDesc->regIndex + i, pTextures[i]->getSRV());
+                pVars->setSrv(locations.firstTextureRegister + i, pTextures[i]->getSRV());
             }
         }
 
-        pVars->setSampler("gMaterial.samplerState", mData.samplerState);
+        pVars->setSampler(locations.samplerRegister, mData.samplerState);
     }
 
     bool Material::operator==(const Material& other) const
@@ -34,6 +34,7 @@
 #include "API/Texture.h"
 #include "glm/mat4x4.hpp"
 #include "API/Sampler.h"
+#include "API/ProgramReflection.h"
 #include "Data/HostDeviceData.h"
 
 namespace Falcor
@@ -276,6 +277,33 @@ namespace Falcor
         */
         void setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const;
 
+        /** Locations of a material variable inside a program. Resolving them once and passing them to setIntoProgramVars() avoids the string lookups.
+            The locations are valid for programs with the same reflection.
+        */
+        struct BindLocations
+        {
+            ProgramReflection::VariableHandle data;     ///< Handle of the material data in the constant buffer
+            uint32_t firstTextureRegister = ProgramReflection::kInvalidLocation;
+            uint32_t samplerRegister = ProgramReflection::kInvalidLocation;
+
+            bool isValid() const { return data.isValid() && firstTextureRegister != ProgramReflection::kInvalidLocation && samplerRegister != ProgramReflection::kInvalidLocation; }
+        };
+
+        /** Resolve the locations of a material variable
+            \param[in] pVars The graphics vars of the shader
+            \param[in] pCB The constant buffer which contains the material
+            \param[in] varName The name of the material variable in the buffer
+            \return The locations. If the variable wasn't found, the result is invalid.
+        */
+        static BindLocations getBindLocations(const ProgramVars* pVars, const ConstantBuffer* pCB, const std::string& varName);
+
+        /** Set the material parameters into a constant buffer using locations from getBindLocations()
+            \param[in] pVars The graphics vars of the shader to set material into.
+            \param[in] pCB The constant buffer to set the parameters into.
+            \param[in] locations The locations of the material variable
+        */
+        void setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const BindLocations& locations) const;
+
         /** Override all sampling types of materials
         */
         void setSampler(const Sampler::SharedPtr& pSampler) { mData.samplerState = pSampler; }
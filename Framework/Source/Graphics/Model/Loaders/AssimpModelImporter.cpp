@@ -44,6 +44,9 @@
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include "TangentSpaceGenerator.h"
+#include "MeshOptimizer.h"
 
 namespace Falcor
 {
@@ -57,14 +60,6 @@ namespace Falcor
 
     using VertexIdsVec = std::vector<uvec8_4>;
 
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData);
 
 
     void loadBones(const aiMesh* pAiMesh, VertexWeightsVec& weights, VertexIdsVec& ids, uint32_t vertexCount, const std::map<std::string, uint32_t>& boneNameToIdMap)
@@ -147,19 +142,74 @@ namespace Falcor
         return indices;
     }
 
-    void genTangentSpace(const aiMesh* pAiMesh)
+    void genTangentSpace(const aiMesh* pAiMesh, ThreadPool* pThreadPool)
     {
         if (pAiMesh->mFaces[0].mNumIndices == 3)
         {
             aiMesh* pMesh = const_cast<aiMesh*>(pAiMesh);
             pMesh->mBitangents = new aiVector3D[pMesh->mNumVertices];
 
-            const glm::vec3* pPos = (glm::vec3*)pMesh->mVertices;
-            glm::vec3* pBi = (glm::vec3*)pMesh->mBitangents;
-            glm::vec3* pNormals = (glm::vec3*)pMesh->mNormals;
+            std::vector<float> vertexData;
+            TangentSpaceVertices vertices = createTangentSpaceVertices(pMesh->mVertices, sizeof(aiVector3D), pMesh->mNormals, sizeof(aiVector3D), nullptr, 0, pMesh->mNumVertices, vertexData);
             std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
 
-            generateSubmeshTangentData<glm::vec3>(indices, pPos, pNormals, nullptr, 0, pBi);
+            generateTangentSpace(vertices, indices.data(), indices.size(), (glm::vec3*)pMesh->mBitangents, pThreadPool);
+        }
+    }
+
+    // Reorder the faces and vertices of a triangle mesh in place, before anything else reads them
+    void optimizeMesh(const aiMesh* pAiMesh)
+    {
+        if (pAiMesh->mFaces[0].mNumIndices != 3)
+        {
+            return;
+        }
+
+        aiMesh* pMesh = const_cast<aiMesh*>(pAiMesh);
+        const uint32_t vertexCount = pMesh->mNumVertices;
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        optimizeVertexCache(indices.data(), indices.size(), vertexCount, indices.data());
+        optimizeOverdraw(indices.data(), indices.size(), pMesh->mVertices, sizeof(aiVector3D), vertexCount, indices.data());
+
+        std::vector<uint32_t> remap(vertexCount);
+        optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap.data());
+        for (uint32_t i = 0; i < pMesh->mNumFaces; i++)
+        {
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                pMesh->mFaces[i].mIndices[j] = indices[i * 3 + j];
+            }
+        }
+
+        aiVector3D* pVectorStreams[] = { pMesh->mVertices, pMesh->mNormals, pMesh->mTangents, pMesh->mBitangents };
+        for (aiVector3D* pStream : pVectorStreams)
+        {
+            if (pStream)
+            {
+                remapVertexStream(remap.data(), vertexCount, sizeof(aiVector3D), pStream);
+            }
+        }
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+        {
+            if (pMesh->mTextureCoords[i])
+            {
+                remapVertexStream(remap.data(), vertexCount, sizeof(aiVector3D), pMesh->mTextureCoords[i]);
+            }
+        }
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+        {
+            if (pMesh->mColors[i])
+            {
+                remapVertexStream(remap.data(), vertexCount, sizeof(aiColor4D), pMesh->mColors[i]);
+            }
+        }
+        for (uint32_t i = 0; i < pMesh->mNumBones; i++)
+        {
+            aiBone* pBone = pMesh->mBones[i];
+            for (uint32_t j = 0; j < pBone->mNumWeights; j++)
+            {
+                pBone->mWeights[j].mVertexId = remap[pBone->mWeights[j].mVertexId];
+            }
         }
     }
 
@@ -723,6 +773,11 @@ namespace Falcor
 
     Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh)
     {
+        if (mFlags & Model::OptimizeMeshes)
+        {
+            optimizeMesh(pAiMesh);
+        }
+
         uint32_t vertexCount = pAiMesh->mNumVertices;
         uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
         auto pIB = createIndexBuffer(pAiMesh);
@@ -730,7 +785,7 @@ namespace Falcor
 
         if (mFlags & Model::GenerateTangentSpace)
         {
-            genTangentSpace(pAiMesh);
+            genTangentSpace(pAiMesh, (mFlags & Model::ParallelImport) ? &ThreadPool::getGlobalPool() : nullptr);
         }
 
         VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh);
@@ -779,6 +834,12 @@ namespace Falcor
 
         Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
 
+        if (mFlags & Model::KeepCpuGeometry)
+        {
+            std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+            pMesh->setCpuGeometry(pAiMesh->mVertices, sizeof(aiVector3D), indices.data());
+        }
+
         if (mFlags & Model::GenerateTangentSpace)
         {
             aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
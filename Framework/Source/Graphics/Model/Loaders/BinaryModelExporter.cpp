@@ -35,10 +35,21 @@
 #include "API/Texture.h"
 #include "BinaryImage.hpp"
 #include "Data/VertexAttrib.h"
+#include "TangentSpaceGenerator.h"
+#include "MeshOptimizer.h"
 #include "API/Device.h"
 
 namespace Falcor
 {
+    // Byte offsets of the header fields which are only known once the file was written
+    static const uint64_t kHeaderTextureCountOffset = 12;
+    static const uint64_t kHeaderChunkCountOffset = 24;
+
+    static uint64_t alignStreamOffset(uint64_t offset)
+    {
+        return (offset + kBinSceneStreamAlignment - 1) & ~(uint64_t)(kBinSceneStreamAlignment - 1);
+    }
+
     static FW::ImageFormat::ID getBinaryFormatID(ResourceFormat format)
     {
         switch(format)
@@ -154,9 +165,13 @@ namespace Falcor
         stream.write(str.c_str(), str.size());;
     }
 
-    void BinaryModelExporter::exportToFile(const std::string& filename, const Model* pModel)
+    void BinaryModelExporter::exportToFile(const std::string& filename, const Model* pModel, uint32_t flags, ExportStats* pStats)
     {
-        BinaryModelExporter(filename, pModel);
+        if(pStats)
+        {
+            *pStats = ExportStats();
+        }
+        BinaryModelExporter exporter(filename, pModel, flags, pStats);
     }
 
     void BinaryModelExporter::error(const std::string& msg)
@@ -170,10 +185,12 @@ namespace Falcor
         logError("Warning when exporting model \"" + mFilename + "\".\n" + Msg);
     }
 
-    BinaryModelExporter::BinaryModelExporter(const std::string& filename, const Model* pModel) : mFilename(filename)
+    BinaryModelExporter::BinaryModelExporter(const std::string& filename, const Model* pModel, uint32_t flags, ExportStats* pStats) : mFilename(filename)
     {
         mStream.open(filename.c_str(), BinaryFileStream::Mode::Write);
         mpModel = pModel;
+        mFlags = flags;
+        mpStats = pStats;
 
         if(mpModel->hasBones())
         {
@@ -192,6 +209,35 @@ namespace Falcor
         if(writeTextures()    == false) return;
         if(writeMeshes()      == false) return;
         if(writeInstances()   == false) return;
+        if(writeChunkTable()  == false) return;
+    }
+
+    void BinaryModelExporter::beginChunk(int32_t type, int32_t index)
+    {
+        Chunk chunk;
+        chunk.type = type;
+        chunk.index = index;
+        chunk.offset = mStream.getWritePosition();
+        chunk.size = 0;
+        mChunks.push_back(chunk);
+    }
+
+    void BinaryModelExporter::endChunk()
+    {
+        mChunks.back().size = mStream.getWritePosition() - mChunks.back().offset;
+    }
+
+    void BinaryModelExporter::writePadding(uint64_t offset)
+    {
+        uint64_t position = mStream.getWritePosition();
+        assert(position <= offset);
+        static const uint8_t zeros[kBinSceneStreamAlignment] = {};
+        while(position < offset)
+        {
+            uint64_t count = min(offset - position, (uint64_t)kBinSceneStreamAlignment);
+            mStream.write(zeros, (size_t)count);
+            position += count;
+        }
     }
 
     bool BinaryModelExporter::prepareSubmeshes()
@@ -223,8 +269,31 @@ namespace Falcor
 
     bool BinaryModelExporter::writeHeader()
     {
+        // The texture count, chunk count and chunk table offset are patched by writeChunkTable()
         mStream.write("BinScene", 8);
-        mStream << (int32_t)8 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
+        mStream << (int32_t)9 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
+        mStream << (int32_t)0 << (uint64_t)0;
+        return true;
+    }
+
+    bool BinaryModelExporter::writeChunkTable()
+    {
+        uint64_t tableOffset = mStream.getWritePosition();
+        for(const auto& chunk : mChunks)
+        {
+            mStream << chunk.type << chunk.index << chunk.offset << chunk.size;
+        }
+
+        mStream.setWritePosition(kHeaderTextureCountOffset);
+        mStream << (int32_t)mTextureCount;
+        mStream.setWritePosition(kHeaderChunkCountOffset);
+        mStream << (int32_t)mChunks.size() << tableOffset;
+
+        if(mStream.isFail())
+        {
+            error("Failed writing to the file");
+            return false;
+        }
         return true;
     }
 
@@ -258,141 +327,252 @@ namespace Falcor
         return true;
     }
 
-    bool BinaryModelExporter::writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount)
+    void BinaryModelExporter::writeSubmeshMaterial(const Mesh::SharedPtr& pMesh)
+    {
+        const auto pMaterial = pMesh->getMaterial();
+
+        BasicMaterial basicMaterial;
+        basicMaterial.initializeFromMaterial(pMaterial.get());
+
+        glm::vec3 ambient(0,0,0);
+        glm::vec4 diffuse = glm::vec4(basicMaterial.diffuseColor, basicMaterial.opacity);
+        glm::vec3 specular = basicMaterial.specularColor;
+        float glossiness = basicMaterial.shininess;
+
+        mStream << ambient << diffuse << specular << glossiness;
+
+        float displacementCoeff = basicMaterial.bumpScale;
+        float displacementBias = basicMaterial.bumpOffset;
+
+        mStream << displacementCoeff << displacementBias;
+        
+        for(uint32_t i = 0; i < TextureType_Max; i++)
+        {
+            BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
+            int32_t index = -1;
+            if(BasicMaterial::MapType::Count != falcorType)
+            {
+                index = mTextureHash[basicMaterial.pTextures[falcorType].get()];
+            }
+
+            mStream << index;
+        }
+    }
+
+    bool BinaryModelExporter::writeMesh(const std::vector<uint32_t>& submeshes)
     {
+        // All submeshes share the same VB and same layout. We use the first submesh for that.
+        const Mesh::SharedPtr& pMesh = mpModel->getMesh(submeshes[0]);
         auto pVao = pMesh->getVao();
-        const uint32_t vertexBufferCount = pMesh->getVao()->getVertexBuffersCount();
-        mStream << (int32_t)vertexBufferCount << (int32_t)pMesh->getVertexCount() << (int32_t)submeshCount;
+        const uint32_t vertexCount = pMesh->getVertexCount();
+        const uint32_t vertexBufferCount = pVao->getVertexBuffersCount();
 
-        struct vertexBufferInfo 
+        struct StreamInfo
         {
-            Buffer::SharedPtr pBuffer;
-            size_t            pData; //this had the p flag because it represents the pointer to the vertex buffers data
-            uint32_t          stride;
+            AttribType type;
+            AttribFormat format;
+            uint32_t channels;
+            uint32_t stride;
+            std::vector<uint8_t> data;
+            uint64_t offset = 0;
         };
-            
-        std::vector<vertexBufferInfo> vbInfo(vertexBufferCount);
+        std::vector<StreamInfo> streams(vertexBufferCount);
+
+        const uint32_t kInvalidStream = (uint32_t)-1;
+        uint32_t positionStream = kInvalidStream;
+        uint32_t normalStream = kInvalidStream;
+        uint32_t texCoordStream = kInvalidStream;
+        bool hasBitangents = false;
 
         for (uint32_t i = 0; i < vertexBufferCount; i++)
         {
             const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(i).get();
             assert(pLayout->getElementCount() == 1);
-            AttribType type = getBinaryAttribType(pLayout->getElementName(0));
-            AttribFormat format = GetBinaryAttribFormat(pLayout->getElementFormat(0));
-            uint32_t channels = getFormatChannelCount(pLayout->getElementFormat(0));
+            StreamInfo& stream = streams[i];
+            stream.type = getBinaryAttribType(pLayout->getElementName(0));
+            stream.format = GetBinaryAttribFormat(pLayout->getElementFormat(0));
+            stream.channels = getFormatChannelCount(pLayout->getElementFormat(0));
+            stream.stride = pLayout->getStride();
 
-            if(type == AttribType_Max)
+            if(stream.type == AttribType_Max)
             {
                 error("Unsupported attribute Type");
                 return false;
             }
 
-            if(format == AttribFormat_Max)
+            if(stream.format == AttribFormat_Max)
             {
                 error("Unsupported attribute format");
                 return false;
             }
-            mStream << (int32_t)type << (int32_t)format << (int32_t)channels;
 
-            vbInfo[i].pBuffer = pVao->getVertexBuffer(i);
-            vbInfo[i].stride = pLayout->getStride();
-            vbInfo[i].pData = (size_t)vbInfo[i].pBuffer->map(Buffer::MapType::Read);
+            switch(stream.type)
+            {
+            case AttribType_Position: positionStream = i; break;
+            case AttribType_Normal: normalStream = i; break;
+            case AttribType_TexCoord: texCoordStream = i; break;
+            case AttribType_Bitangent: hasBitangents = true; break;
+            }
+
+            const auto& pBuffer = pVao->getVertexBuffer(i);
+            const uint8_t* pData = (const uint8_t*)pBuffer->map(Buffer::MapType::Read);
+            stream.data.assign(pData, pData + (size_t)stream.stride * vertexCount);
+            pBuffer->unmap();
         }
 
-        // Write the vertex buffer
-        for (uint32_t i = 0; i < pMesh->getVertexCount(); ++i)
+        // Read the index buffers back.
+        // Most of the buffers we use were created without any access flags, so can't be mapped.
+        // We create a temporary staging buffer to overcome this.
+        std::vector<std::vector<uint32_t>> indices(submeshes.size());
+        for(size_t i = 0; i < submeshes.size(); i++)
         {
-            for (auto& a : vbInfo)
-            { 			
-                mStream.write((void*)a.pData, a.stride);
-                a.pData += a.stride;
-            }
+            const Mesh* pSubmesh = mpModel->getMesh(submeshes[i]).get();
+            uint32_t indexCount = pSubmesh->getIndexCount();
+            assert(indexCount % 3 == 0);
+
+            auto pStaging = Buffer::create(pSubmesh->getVao()->getIndexBuffer()->getSize(), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+            pSubmesh->getVao()->getIndexBuffer()->copy(pStaging.get());
+            const uint32_t* pIndices = (const uint32_t*)pStaging->map(Buffer::MapType::Read);
+            indices[i].assign(pIndices, pIndices + indexCount);
+            pStaging->unmap();
         }
 
-        for (auto& a : vbInfo)
+        // Bake the bitangents, so that the importer doesn't have to generate them
+        if((hasBitangents == false) && (normalStream != kInvalidStream) && (positionStream != kInvalidStream))
         {
-            a.pBuffer->unmap();
+            StreamInfo bitangents;
+            bitangents.type = AttribType_Bitangent;
+            bitangents.format = AttribFormat_F32;
+            bitangents.channels = 3;
+            bitangents.stride = sizeof(glm::vec3);
+            bitangents.data.resize(sizeof(glm::vec3) * vertexCount);
+
+            const StreamInfo& positions = streams[positionStream];
+            const StreamInfo& normals = streams[normalStream];
+            const StreamInfo* pTexCrd = (texCoordStream != kInvalidStream) ? &streams[texCoordStream] : nullptr;
+
+            std::vector<float> vertexData;
+            TangentSpaceVertices vertices = createTangentSpaceVertices(positions.data.data(), positions.stride, normals.data.data(), normals.stride, pTexCrd ? pTexCrd->data.data() : nullptr, pTexCrd ? pTexCrd->stride : 0, vertexCount, vertexData);
+            for(const auto& submeshIndices : indices)
+            {
+                generateTangentSpace(vertices, submeshIndices.data(), submeshIndices.size(), (glm::vec3*)bitangents.data.data());
+            }
+            streams.push_back(std::move(bitangents));
         }
 
-        return true;
-    }
-
-    bool BinaryModelExporter::writeSubmesh(const Mesh::SharedPtr& pMesh)
-    {
-        const auto pMaterial = pMesh->getMaterial();
-
-        BasicMaterial basicMaterial;
-        basicMaterial.initializeFromMaterial(pMaterial.get());
+        // The cache simulation is a pass over every index, skip it unless the caller asked for the statistics
+        if(mpStats)
+        {
+            for(const auto& submeshIndices : indices)
+            {
+                mpStats->original += analyzeVertexCache(submeshIndices.data(), submeshIndices.size(), vertexCount);
+            }
+        }
 
-        glm::vec3 ambient(0,0,0);
-        glm::vec4 diffuse = glm::vec4(basicMaterial.diffuseColor, basicMaterial.opacity);
-        glm::vec3 specular = basicMaterial.specularColor;
-        float glossiness = basicMaterial.shininess;
+        if(mFlags & OptimizeMeshes)
+        {
+            // Overdraw ordering needs float positions
+            const StreamInfo* pPositions = nullptr;
+            if((positionStream != kInvalidStream) && (streams[positionStream].format == AttribFormat_F32) && (streams[positionStream].channels >= 3))
+            {
+                pPositions = &streams[positionStream];
+            }
 
-        mStream << ambient << diffuse << specular << glossiness;
+            std::vector<uint32_t> allIndices;
+            for(auto& submeshIndices : indices)
+            {
+                optimizeVertexCache(submeshIndices.data(), submeshIndices.size(), vertexCount, submeshIndices.data());
+                if(pPositions)
+                {
+                    optimizeOverdraw(submeshIndices.data(), submeshIndices.size(), pPositions->data.data(), pPositions->stride, vertexCount, submeshIndices.data());
+                }
+                allIndices.insert(allIndices.end(), submeshIndices.begin(), submeshIndices.end());
+            }
 
-        float displacementCoeff = basicMaterial.bumpScale;
-        float displacementBias = basicMaterial.bumpOffset;
+            // The submeshes share the vertex streams, so the vertices are numbered in the order of the concatenated submeshes
+            std::vector<uint32_t> remap(vertexCount);
+            optimizeVertexFetch(allIndices.data(), allIndices.size(), vertexCount, remap.data());
+            size_t first = 0;
+            for(auto& submeshIndices : indices)
+            {
+                std::copy(allIndices.begin() + first, allIndices.begin() + first + submeshIndices.size(), submeshIndices.begin());
+                first += submeshIndices.size();
+            }
+            for(auto& stream : streams)
+            {
+                remapVertexStream(remap.data(), vertexCount, stream.stride, stream.data.data());
+            }
+        }
 
-        mStream << displacementCoeff << displacementBias;
-        
-        for(uint32_t i = 0; i < TextureType_Max; i++)
+        if(mpStats)
         {
-            BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
-            int32_t index = -1;
-            if(BasicMaterial::MapType::Count != falcorType)
+            for(const auto& submeshIndices : indices)
             {
-                index = mTextureHash[basicMaterial.pTextures[falcorType].get()];
+                mpStats->exported += analyzeVertexCache(submeshIndices.data(), submeshIndices.size(), vertexCount);
             }
+        }
 
-            mStream << index;
+        // Lay out the chunk. The streams follow the mesh header, each one at a 16-byte aligned file offset.
+        static const uint64_t kAttribStreamSize = 5 * sizeof(uint32_t);
+        static const uint64_t kSubmeshSize = 29 * sizeof(uint32_t);
+        uint64_t offset = mStream.getWritePosition() + 3 * sizeof(uint32_t) + streams.size() * kAttribStreamSize + submeshes.size() * kSubmeshSize;
+        for(auto& stream : streams)
+        {
+            stream.offset = alignStreamOffset(offset);
+            offset = stream.offset + stream.data.size();
         }
 
-        uint32_t indexCount = pMesh->getIndexCount();
-        assert(indexCount % 3 == 0);
-        uint32_t primCount = indexCount / 3;
+        std::vector<uint64_t> indexOffsets(submeshes.size());
+        for(size_t i = 0; i < submeshes.size(); i++)
+        {
+            indexOffsets[i] = alignStreamOffset(offset);
+            offset = indexOffsets[i] + indices[i].size() * sizeof(uint32_t);
+        }
 
-        mStream << (int32_t)primCount;
+        // Mesh header
+        mStream << (int32_t)streams.size() << (int32_t)vertexCount << (int32_t)submeshes.size();
+        for(const auto& stream : streams)
+        {
+            mStream << (int32_t)stream.type << (int32_t)stream.format << (int32_t)stream.channels << stream.offset;
+        }
 
-        // Output the index buffer
-        // Most of the buffers we use were created without any access flags, so can't be mapped.
-        // We create a temporary staging buffer to overcome this.
-        
-        auto pStaging = Buffer::create(pMesh->getVao()->getIndexBuffer()->getSize(), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
-        pMesh->getVao()->getIndexBuffer()->copy(pStaging.get());
-        const void* pIndices = pStaging->map(Buffer::MapType::Read);
-        mStream.write(pIndices, indexCount * sizeof(uint32_t));
-        pStaging->unmap();
+        for(size_t i = 0; i < submeshes.size(); i++)
+        {
+            const Mesh::SharedPtr& pSubmesh = mpModel->getMesh(submeshes[i]);
+            writeSubmeshMaterial(pSubmesh);
+
+            const BoundingBox& box = pSubmesh->getBoundingBox();
+            mStream << box.getMinPos() << box.getMaxPos();
+            mStream << (int32_t)(indices[i].size() / 3) << indexOffsets[i];
+        }
+
+        // Stream data
+        for(const auto& stream : streams)
+        {
+            writePadding(stream.offset);
+            mStream.write(stream.data.data(), stream.data.size());
+        }
+
+        for(size_t i = 0; i < submeshes.size(); i++)
+        {
+            writePadding(indexOffsets[i]);
+            mStream.write(indices[i].data(), indices[i].size() * sizeof(uint32_t));
+        }
 
         return true;
     }
 
     bool BinaryModelExporter::writeMeshes()
     {
-        uint32_t inst = 0;
+        int32_t meshIdx = 0;
         for(const auto& mesh : mMeshes)
         {
-            const auto& submeshes = mesh.second;
-
-            for(uint32_t meshID : submeshes)
+            beginChunk(ChunkType_Mesh, meshIdx++);
+            if(writeMesh(mesh.second) == false)
             {
-                const Mesh::SharedPtr& pMesh = mpModel->getMesh(meshID);
-
-                if(meshID == submeshes[0])
-                {
-                    // All submeshes share the same VB and same layout. We use the first submesh for that.
-                    if(writeCommonMeshData(pMesh, (uint32_t)submeshes.size()) == false)
-                    {
-                        return false;
-                    }
-                }
-
-                if(writeSubmesh(pMesh) == false)
-                {
-                    return false;
-                }
-                inst += mpModel->getMeshInstanceCount(meshID);
+                return false;
             }
+            endChunk();
         }
 
         return true;
@@ -400,6 +580,8 @@ namespace Falcor
 
     bool BinaryModelExporter::writeInstances()
     {
+        beginChunk(ChunkType_Instances, 0);
+
         int32_t meshIdx = 0;
         int32_t enabled = 1;
         for(const auto& mesh : mMeshes)
@@ -416,6 +598,8 @@ namespace Falcor
 
             meshIdx++;
         }
+
+        endChunk();
         return true;
     }
 
@@ -426,8 +610,15 @@ namespace Falcor
             // If not exported yet
             if (mTextureHash.find(pTexture.get()) == mTextureHash.end())
             {
-                mTextureHash[pTexture.get()] = texID++;
-                return exportBinaryImage(pTexture.get());
+                mTextureHash[pTexture.get()] = texID;
+                beginChunk(ChunkType_Texture, texID);
+                texID++;
+                mTextureCount = texID;
+                if (exportBinaryImage(pTexture.get()) == false)
+                {
+                    return false;
+                }
+                endChunk();
             }
         }
 
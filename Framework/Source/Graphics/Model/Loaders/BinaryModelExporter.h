@@ -31,6 +31,7 @@
 #include <map>
 #include <vector>
 #include "Graphics/Model/Mesh.h"
+#include "MeshOptimizer.h"
 
 namespace Falcor
 {
@@ -42,25 +43,48 @@ namespace Falcor
     class BinaryModelExporter
     {
     public:
+        enum ExportFlags
+        {
+            None                = 0,
+            OptimizeMeshes      = 1,    ///< Reorder the triangles of every mesh for the post-transform vertex cache and overdraw, and the vertices for fetch locality. The file stores the result, so loading it is free. See MeshOptimizer.h.
+        };
+
+        /** Post-transform vertex cache statistics of all the exported meshes
+        */
+        struct ExportStats
+        {
+            VertexCacheStats original;      ///< In the order of the model's index buffers
+            VertexCacheStats exported;      ///< In the order written to the file
+        };
+
         /** Export a model into a binary file
             \param[in] filename Model's filename. Loader will look for it in the data directories.
             \param[in] pModel The model to export
+            \param[in] flags Combination of ExportFlags
+            \param[out] pStats Optional. If not null, receives the vertex cache statistics before and after optimization. The statistics are only computed when requested.
             returns nullptr if loading failed, otherwise a new Model object
         */
-        static void exportToFile(const std::string& filename, const Model* pModel);
+        static void exportToFile(const std::string& filename, const Model* pModel, uint32_t flags = None, ExportStats* pStats = nullptr);
 
     private:
-        BinaryModelExporter(const std::string& filename, const Model* pModel);
+        BinaryModelExporter(const std::string& filename, const Model* pModel, uint32_t flags, ExportStats* pStats);
         const Model* mpModel = nullptr;
+        uint32_t mFlags = None;
+        ExportStats* mpStats = nullptr;
         BinaryFileStream mStream;
         const std::string& mFilename;
 
         bool writeHeader();
         bool writeTextures();
         bool writeMeshes();
-        bool writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount);
-        bool writeSubmesh(const Mesh::SharedPtr& pMesh);
+        bool writeMesh(const std::vector<uint32_t>& submeshes);
+        void writeSubmeshMaterial(const Mesh::SharedPtr& pMesh);
         bool writeInstances();
+        bool writeChunkTable();
+
+        void beginChunk(int32_t type, int32_t index);
+        void endChunk();
+        void writePadding(uint64_t offset);
 
         bool writeMaterialTexture(uint32_t& texID, const Texture::SharedPtr& pTexture);
         
@@ -72,6 +96,16 @@ namespace Falcor
         bool prepareSubmeshes();
         std::map<const Vao*, std::vector<uint32_t>> mMeshes; // Maps to meshID in model
         std::map<const Texture*, int32_t> mTextureHash;
+        struct Chunk
+        {
+            int32_t type;
+            int32_t index;
+            uint64_t offset;
+            uint64_t size;
+        };
+        std::vector<Chunk> mChunks;
+        uint32_t mTextureCount = 0;
+
         uint32_t mInstanceCount = 0; // Not the same as Model::Instance count. Model keeps the total instance count, while the binary format has a concept of meshes and submeshes, and the instance count there is the mesh instance count.
     };
 }
@@ -40,6 +40,9 @@
 #include "API/Texture.h"
 #include "Graphics/Material/Material.h"
 #include "glm/geometric.hpp"
+#include "Utils/ThreadPool.h"
+#include "Utils/CpuTimer.h"
+#include "TangentSpaceGenerator.h"
 
 namespace Falcor
 {
@@ -48,122 +51,12 @@ namespace Falcor
         uint32_t width  = 0;
         uint32_t height = 0;
         ResourceFormat format = ResourceFormat::Unknown;
+        const uint8_t* pData = nullptr;  // Points into the file mapping, or to 'data' if the texels had to be converted
         std::vector<uint8_t> data;
         std::string name;
+        bool expandRgb = false;          // The texels are 24-bit RGB. decodeTexture() converts them to RGBX.
     };
 
-    bool isSpecialFloat(float f)
-    {
-        uint32_t d = *(uint32_t*)&f;
-        // Check the exponent
-        d = (d >> 23) & 0xff;
-        return d == 0xff;
-    }
-
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData)
-    {
-        // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
-        for(size_t primID = 0; primID < primCount; primID++)
-        {
-            struct Data
-            {
-                posType position;
-                glm::vec3 normal;
-                glm::vec2 uv;
-            };
-            Data V[3];
-
-            // Get the data
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                uint32_t index = indices[primID * 3 + i];
-                V[i].position = vertexPosData[index];
-                V[i].normal = vertexNormalData[index];
-
-                if(texCrdData)
-                {
-                    V[i].uv = texCrdData[index * texCrdCount];
-                }
-                else
-                {
-                    V[i].uv = glm::vec2(0.f, 0.f);
-                }
-            }
-
-            // Position delta
-            posType posDelta[2];
-            posDelta[0] = V[1].position - V[0].position;
-            posDelta[1] = V[2].position - V[0].position;
-
-            // Texture offset
-            glm::vec2 s = V[1].uv - V[0].uv;
-            glm::vec2 t = V[2].uv - V[0].uv;
-            s.y = -s.y;
-            t.y = -t.y;
-
-            glm::vec3 tangent;
-            glm::vec3 bitangent;
-
-            // when t1, t2, t3 in same position in UV space, just use default UV direction.
-            if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
-            {
-				const glm::vec3 &normal = V[0].normal;
-				if(abs(normal.x) > abs(normal.y))
-					bitangent = v3(normal.z, 0.f, -normal.x) / length(v2(normal.x, normal.z));
-				else
-					bitangent = v3(0.f, normal.z, -normal.y) / length(v2(normal.y, normal.z));
-				tangent = cross(bitangent, normal);
-            }
-			else
-			{
-				float dirCorrection = (t.x * s.y - t.y * s.x) < 0.0f ? -1.0f : 1.0f;
-
-				// tangent points in the direction where to positive X axis of the texture coord's would point in model space
-				// bitangent's points along the positive Y axis of the texture coord's, respectively
-				tangent.x = (posDelta[1].x * s.y - posDelta[0].x * t.y) * dirCorrection;
-				tangent.y = (posDelta[1].y * s.y - posDelta[0].y * t.y) * dirCorrection;
-				tangent.z = (posDelta[1].z * s.y - posDelta[0].z * t.y) * dirCorrection;
-
-				bitangent.x = (posDelta[1].x * s.x - posDelta[0].x * t.x) * dirCorrection;
-				bitangent.y = (posDelta[1].y * s.x - posDelta[0].y * t.x) * dirCorrection;
-				bitangent.z = (posDelta[1].z * s.x - posDelta[0].z * t.x) * dirCorrection;
-			}
-
-            // store for every vertex of that face
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                // project tangent and bitangent into the plane formed by the vertex' normal
-                glm::vec3 localTangent = tangent - V[i].normal * (glm::dot(tangent, V[i].normal));
-                localTangent = glm::normalize(localTangent);
-                glm::vec3 localBitangent = bitangent - V[i].normal * (glm::dot(bitangent, V[i].normal));
-                localBitangent = glm::normalize(localBitangent);
-                localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
-                localBitangent = glm::normalize(localBitangent);
-
-                // reconstruct tangent/bitangent according to normal and bitangent/tangent when it's infinite or NaN.
-                bool isInvalidBitangent = isSpecialFloat(localBitangent.x) || isSpecialFloat(localBitangent.y) || isSpecialFloat(localBitangent.z);
-
-                if (isInvalidBitangent)
-                {
-                    localBitangent = glm::cross(localTangent, V[i].normal);
-                    localBitangent = glm::normalize(localBitangent);
-                }
-
-                // and write it into the mesh
-                uint32_t index = indices[primID * 3 + i];
-                bitangentData[index] = localBitangent;
-            }
-        }
-    }
-
     static BasicMaterial::MapType getFalcorMapType(TextureType map)
     {
         switch(map)
@@ -343,17 +236,15 @@ namespace Falcor
         }
     }
 
-    std::string readString(BinaryFileStream& stream)
+    std::string readString(BinaryMemoryStream& stream)
     {
         int32_t length;
         stream >> length;
-        std::vector<char> charVec(length + 1);
-        stream.read(&charVec[0], length);
-        charVec[length] = 0;
-        return std::string(charVec.data());
+        const char* pChars = (length > 0) ? (const char*)stream.getPointer(length) : nullptr;
+        return pChars ? std::string(pChars, strnlen(pChars, length)) : std::string();
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    bool loadBinaryTextureData(BinaryMemoryStream& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
         char tag[9];
@@ -439,29 +330,41 @@ namespace Falcor
         {
             dataSize = bpp * texelCount;
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
-            storageSize = 4 * texelCount;
+        const uint8_t* pSrc = stream.getPointer(dataSize);
+        if(pSrc == nullptr)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (file is truncated).";
+            logError(msg);
+            return false;
+        }
 
-        data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        // Use the texels in place. 3-channel formats are converted later by decodeTexture().
+        data.pData = pSrc;
+        data.expandRgb = (bpp == 3);
+        return true;
+    }
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
-        if(bpp == 3)
+    static void decodeTexture(TextureData& data)
+    {
+        if(data.expandRgb)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
+            const uint8_t* pSrc = data.pData;
+            const size_t texelCount = (size_t)data.width * data.height;
+            data.data.resize(4 * texelCount);
+            for(size_t i = 0; i < texelCount; i++)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
+                data.data[i * 4 + 0] = pSrc[i * 3 + 0];
+                data.data[i * 4 + 1] = pSrc[i * 3 + 1];
+                data.data[i * 4 + 2] = pSrc[i * 3 + 2];
                 data.data[i * 4 + 3] = 0xff;
             }
+            data.pData = data.data.data();
+            data.expandRgb = false;
         }
-
-        return true;
     }
 
-    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
+    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryMemoryStream& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
 
@@ -477,11 +380,17 @@ namespace Falcor
         return true;
     }
 
-    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
+    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath)
     {
+        // The whole file is mapped. Vertex, index and texture data are handed to resource creation straight from the mapping where possible.
+        mpFile = MemoryMappedFile::create(fullpath);
+        if(mpFile)
+        {
+            mStream.open(mpFile->getData(), mpFile->getSize());
+        }
     }
 
-    Model::SharedPtr BinaryModelImporter::createFromFile(const std::string& filename, uint32_t flags)
+    Model::SharedPtr BinaryModelImporter::createFromFile(const std::string& filename, uint32_t flags, LoadStats* pStats)
     {
         std::string fullpath;
         if(findFileInDataDirectories(filename, fullpath) == false)
@@ -490,8 +399,19 @@ namespace Falcor
             return nullptr;
         }
 
+        LoadStats stats;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
         BinaryModelImporter loader(fullpath);
-        Model::SharedPtr pModel = loader.createModel(flags);
+        Model::SharedPtr pModel = loader.mpFile ? loader.createModel(flags, stats) : nullptr;
+        if(pModel == nullptr)
+        {
+            return nullptr;
+        }
+        stats.totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        if(pStats)
+        {
+            *pStats = stats;
+        }
 
         pModel->setFilename(filename);
 
@@ -507,7 +427,7 @@ namespace Falcor
     {
         if(std::string(formatID) == "BinScene")
         {
-            if(version < 6 || version > 8)
+            if(version < 6 || version > 9)
             {
                 std::string Msg = "Error when loading model " + modelName + ".\nUnsupported binary scene version " + std::to_string(version);
                 logError(Msg);
@@ -579,8 +499,276 @@ namespace Falcor
         }
     }
     
-    Model::SharedPtr BinaryModelImporter::createModel(uint32_t flags)
+    struct TexSignature
+    {
+        const uint8_t* pData;
+        ResourceFormat format;
+        bool operator<(const TexSignature& other) const 
+        { 
+            if(pData < other.pData) return true;
+            if(pData == other.pData) return format < other.format;
+            return false;
+        }
+        bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+    };
+    using TextureCache = std::map<TexSignature, Texture::SharedPtr>;
+
+    static bool readSubmeshMaterial(BinaryMemoryStream& stream, uint32_t version, int numTextureSlots, const std::vector<TextureData>& texData, TextureCache& textures, bool loadTexAsSrgb, const std::string& modelName, Material::SharedPtr& pMaterial)
+    {
+        BasicMaterial basicMaterial;
+
+        glm::vec3 ambient;
+        glm::vec4 diffuse;
+        glm::vec3 specular;
+        float glossiness;
+
+        stream >> ambient >> diffuse >> specular >> glossiness;
+        basicMaterial.diffuseColor = glm::vec3(diffuse);
+        basicMaterial.opacity = 1 - diffuse.w;
+        basicMaterial.specularColor = specular;
+        basicMaterial.shininess = glossiness;
+
+        if(version >= 3)
+        {
+            float displacementCoeff;
+            float displacementBias;
+            stream >> displacementCoeff >> displacementBias;
+            basicMaterial.bumpScale = displacementCoeff;
+            basicMaterial.bumpOffset = displacementBias;
+        }
+
+        for(int i = 0; i < numTextureSlots; i++)
+        {
+            int32_t texID;
+            stream >> texID;
+            if(texID < -1 || texID >= (int32_t)texData.size())
+            {
+                std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary mesh data!";
+                logError(msg);
+                return false;
+            }
+            else if(texID != -1)
+            {
+                BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
+                if(BasicMaterial::MapType::Count == falcorType)
+                {
+                    logWarning("Texture of Type " + std::to_string(i) + " is not supported by the material system (model " + modelName + ")");
+                    continue;
+                }
+
+                // Load the texture
+                TexSignature texSig;
+                texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
+                texSig.pData = texData[texID].pData;
+                // Check if we already created a matching texture
+                auto existingTex = textures.find(texSig);
+                if(existingTex != textures.end())
+                {
+                    basicMaterial.pTextures[falcorType] = existingTex->second;
+                }
+                else
+                {
+                    auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
+                    pTexture->setSourceFilename(texData[texID].name);
+                    textures[texSig] = pTexture;
+                    basicMaterial.pTextures[falcorType] = pTexture;
+                }
+            }
+        }
+
+        pMaterial = basicMaterial.convertToMaterial();
+        return true;
+    }
+
+    static void readInstances(BinaryMemoryStream& stream, int32_t numInstances, const std::vector<std::vector<uint32_t>>& meshToSubmeshesID, const std::vector<Mesh::SharedPtr>& falcorMeshCache, Model* pModel)
+    {
+        for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
+        {
+            int32_t meshIdx = 0;
+            int32_t enabled = 1;
+            glm::mat4 transformation;
+
+            stream >> meshIdx >> enabled >> transformation;
+            //m_Stream >> inst.name >> inst.metadata;
+            readString(stream);   // Name
+            readString(stream);   // Meta-data
+
+            if(enabled && meshIdx >= 0 && meshIdx < (int32_t)meshToSubmeshesID.size())
+            {
+                for(uint32_t i : meshToSubmeshesID[meshIdx])
+                {
+                    pModel->addMeshInstance(falcorMeshCache[i], transformation);
+                }
+            }
+        }
+    }
+
+    static size_t getSubmeshMaterialSize(uint32_t version, int numTextureSlots)
+    {
+        // Must match readSubmeshMaterial(). Ambient, diffuse, specular and glossiness, followed by the displacement coefficients and the texture IDs.
+        size_t size = sizeof(glm::vec3) + sizeof(glm::vec4) + sizeof(glm::vec3) + sizeof(float);
+        if(version >= 3)
+        {
+            size += 2 * sizeof(float);
+        }
+        size += numTextureSlots * sizeof(int32_t);
+        return size;
+    }
+
+    static const uint32_t kInvalidBufferIndex = (uint32_t)-1;
+
+    struct BufferData
+    {
+        const uint8_t* pData = nullptr; // Points into the file mapping, or to 'vec' if the attribute had to be de-interleaved
+        std::vector<uint8_t> vec;
+        bool shouldSkip = false;
+        uint32_t elementSize = 0;
+    };
+
+    struct SubmeshData
+    {
+        size_t materialOffset = 0;      // The material is read when the mesh is created, since it might create textures
+        const uint32_t* pIndices = nullptr;
+        uint32_t numIndices = 0;
+        BoundingBox box;
+    };
+
+    // Everything decodeMesh() needs, so that meshes can be decoded without touching the stream
+    struct MeshData
+    {
+        int32_t numVertices = 0;
+        VertexLayout::SharedPtr pLayout;
+        std::vector<BufferData> buffers;
+        const uint8_t* pVertexData = nullptr;
+        size_t vertexSize = 0;
+        bool deinterleave = false;
+        bool genTangents = false;
+        uint32_t positionBufferIndex = kInvalidBufferIndex;
+        uint32_t normalBufferIndex = kInvalidBufferIndex;
+        uint32_t bitangentBufferIndex = kInvalidBufferIndex;
+        uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+        std::vector<SubmeshData> submeshes;
+    };
+
+    static void decodeMesh(MeshData& mesh, ThreadPool* pThreadPool)
     {
+        std::vector<BufferData>& buffers = mesh.buffers;
+        const int32_t numVertices = mesh.numVertices;
+        const size_t numAttribs = mesh.genTangents ? buffers.size() - 1 : buffers.size();
+
+        if(mesh.deinterleave)
+        {
+            // De-interleave into one buffer per attribute
+            for(size_t i = 0; i < numAttribs; i++)
+            {
+                if(buffers[i].shouldSkip == false)
+                {
+                    buffers[i].vec.resize(buffers[i].elementSize * numVertices);
+                    buffers[i].pData = buffers[i].vec.data();
+                }
+            }
+
+            for(int32_t v = 0; v < numVertices; v++)
+            {
+                const uint8_t* pSrc = mesh.pVertexData + mesh.vertexSize * v;
+                for(size_t i = 0; i < numAttribs; i++)
+                {
+                    const uint32_t elementSize = buffers[i].elementSize;
+                    if(buffers[i].shouldSkip == false)
+                    {
+                        std::memcpy(buffers[i].vec.data() + elementSize * v, pSrc, elementSize);
+                    }
+                    pSrc += elementSize;
+                }
+            }
+        }
+
+        if(mesh.genTangents)
+        {
+            BufferData& bitangents = buffers[mesh.bitangentBufferIndex];
+            bitangents.vec.resize(sizeof(glm::vec3) * numVertices);
+            bitangents.pData = bitangents.vec.data();
+        }
+
+        // The parser made sure that meshes with submeshes have positions
+        if(mesh.submeshes.empty())
+        {
+            return;
+        }
+
+        // Generate tangent space data if needed. Submeshes share the vertices, so they are processed in file order.
+        if(mesh.genTangents)
+        {
+            const BufferData& positions = buffers[mesh.positionBufferIndex];
+            const BufferData& normals = buffers[mesh.normalBufferIndex];
+            const BufferData* pTexCrd = (mesh.texCoordBufferIndex != kInvalidBufferIndex) ? &buffers[mesh.texCoordBufferIndex] : nullptr;
+
+            std::vector<float> vertexData;
+            TangentSpaceVertices vertices = createTangentSpaceVertices(positions.pData, positions.elementSize, normals.pData, normals.elementSize, pTexCrd ? pTexCrd->pData : nullptr, pTexCrd ? pTexCrd->elementSize : 0, numVertices, vertexData);
+            for(const SubmeshData& submesh : mesh.submeshes)
+            {
+                generateTangentSpace(vertices, submesh.pIndices, submesh.numIndices, (glm::vec3*)buffers[mesh.bitangentBufferIndex].vec.data(), pThreadPool);
+            }
+        }
+
+        // Calculate the bounding-boxes
+        const BufferData& positions = buffers[mesh.positionBufferIndex];
+        for(SubmeshData& submesh : mesh.submeshes)
+        {
+            // Start from the extremes, so a mesh which doesn't contain the origin doesn't get a box which does
+            glm::vec3 max(-FLT_MAX), min(FLT_MAX);
+            if(submesh.numIndices == 0)
+            {
+                max = min = glm::vec3(0);
+            }
+            for(uint32_t i = 0; i < submesh.numIndices; i++)
+            {
+                uint32_t vertexID = submesh.pIndices[i];
+                const float* pPosition = (const float*)(positions.pData + positions.elementSize * vertexID);
+
+                glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
+                min = glm::min(min, xyz);
+                max = glm::max(max, xyz);
+            }
+            submesh.box = BoundingBox::fromMinMax(min, max);
+        }
+    }
+
+    /** Decode the meshes and the textures. With a thread pool every mesh and every texture is a separate task.
+    */
+    static void decodeModelData(std::vector<MeshData>& meshes, std::vector<TextureData>& textures, ThreadPool* pThreadPool)
+    {
+        const uint32_t meshCount = (uint32_t)meshes.size();
+        auto decodeRange = [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                if(i < meshCount)
+                {
+                    decodeMesh(meshes[i], pThreadPool);
+                }
+                else
+                {
+                    decodeTexture(textures[i - meshCount]);
+                }
+            }
+        };
+
+        const uint32_t itemCount = meshCount + (uint32_t)textures.size();
+        if(pThreadPool)
+        {
+            pThreadPool->parallelFor(itemCount, 1, decodeRange);
+        }
+        else
+        {
+            decodeRange(0, itemCount);
+        }
+    }
+
+    Model::SharedPtr BinaryModelImporter::createModel(uint32_t flags, LoadStats& stats)
+    {
+        CpuTimer::TimePoint phaseStart = CpuTimer::getCurrentTimePoint();
+
         // Format ID and version.
         char formatID[9];
         mStream.read(formatID, 8);
@@ -608,6 +796,7 @@ namespace Falcor
         case 6:     numTextureSlots = TextureType_Specular + 1; break;
         case 7:     numTextureSlots = TextureType_Glossiness + 1; break;
         case 8:     numTextureSlots = TextureType_Glossiness + 1; numAttributesType = AttribType_Max; break;
+        case 9:     return createChunkedModel(flags, stats);
         default:
             should_not_get_here();
             return nullptr;
@@ -644,8 +833,6 @@ namespace Falcor
             return nullptr;
         }
 
-        // create objects
-        auto pModel = Model::create();
         bool shouldGenerateTangents = (flags & Model::GenerateTangentSpace) != 0;
 
         std::vector<TextureData> texData;
@@ -655,31 +842,14 @@ namespace Falcor
             importTextures(texData, numTextures, mStream, mModelName);
         }
 
-        // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
-        // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes Falcor IDs. This is what the next 2 variables are for.
-        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
-
-        // This importer loads mesh/submesh data before instance data, so the meshes are cached here.
-        std::vector<Mesh::SharedPtr> falcorMeshCache;
-        
-        struct TexSignature
-        {
-            const uint8_t* pData;
-            ResourceFormat format;
-            bool operator<(const TexSignature& other) const 
-            { 
-                if(pData < other.pData) return true;
-                if(pData == other.pData) return format < other.format;
-                return false;
-            }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
-        };
-        std::map<TexSignature, Texture::SharedPtr> textures;
-        bool loadTexAsSrgb = (flags & Model::AssumeLinearSpaceTextures) ? false : true;
+        // Parse the meshes. This only reads the headers and locates the vertex and index data in the file, the data itself is processed by decodeModelData().
+        std::vector<MeshData> meshes(numMeshes);
+        const size_t materialSize = getSubmeshMaterialSize(version, numTextureSlots);
 
-        // Load the meshes
         for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
         {
+            MeshData& mesh = meshes[meshIdx];
+
             // Mesh header
             int32_t numAttribs = 0;
             int32_t numVertices = 0;
@@ -703,30 +873,15 @@ namespace Falcor
                 return nullptr;
             }
 
-            Vao::BufferVec pVBs;
-            VertexLayout::SharedPtr pLayout = VertexLayout::create();
-            
-            struct BufferData
-            {
-                std::vector<uint8_t> vec;
-                bool shouldSkip = false;
-                uint32_t elementSize = 0;
-            };
-
-            std::vector<BufferData> buffers;
-            pVBs.resize(numAttribs);
+            mesh.numVertices = numVertices;
+            mesh.pLayout = VertexLayout::create();
+            std::vector<BufferData>& buffers = mesh.buffers;
             buffers.resize(numAttribs);
 
-            const uint32_t kInvalidBufferIndex = (uint32_t)-1;
-            uint32_t positionBufferIndex = kInvalidBufferIndex;
-            uint32_t normalBufferIndex = kInvalidBufferIndex;
-            uint32_t bitangentBufferIndex = kInvalidBufferIndex;
-            uint32_t texCoordBufferIndex = kInvalidBufferIndex;
-
             for(int i = 0; i < numAttribs; i++)
             {
                 VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
-                pLayout->addBufferLayout(i, pBufferLayout);
+                mesh.pLayout->addBufferLayout(i, pBufferLayout);
                 int32_t type, format, length;
                 mStream >> type >> format >> length;
 
@@ -745,19 +900,19 @@ namespace Falcor
                     switch (shaderLocation)
                     {
                     case VERTEX_POSITION_LOC:
-                        positionBufferIndex = i;
+                        mesh.positionBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float);
                         break;
                     case VERTEX_NORMAL_LOC:
-                        normalBufferIndex = i;
+                        mesh.normalBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_BITANGENT_LOC:
-                        bitangentBufferIndex = i;
+                        mesh.bitangentBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_TEXCOORD_LOC:
-                        texCoordBufferIndex = i;
+                        mesh.texCoordBufferIndex = i;
                         break;
                     }
 
@@ -765,7 +920,6 @@ namespace Falcor
                     if(shaderLocation != kUnusedShaderElement)
                     {
                         pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
                     }
                     else
                     {
@@ -774,132 +928,70 @@ namespace Falcor
                 }
             }
 
-            
-            // Check if we need to generate tangents  
-            bool genTangentForMesh = false;
-            if(shouldGenerateTangents && (bitangentBufferIndex == kInvalidBufferIndex))
+            // The vertices are stored interleaved. Grab the whole block at once.
+            uint32_t usedAttribCount = 0;
+            for(int32_t i = 0; i < numAttribs; i++)
             {
-                if(normalBufferIndex == kInvalidBufferIndex)
-                {
-                    logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
-                    genTangentForMesh = false;
-                }
-                else
-                {
-                    // Set the offsets
-                    genTangentForMesh = true;
-                    bitangentBufferIndex = (uint32_t)pVBs.size();
-                    pVBs.resize(bitangentBufferIndex + 1);
-                    buffers.resize(bitangentBufferIndex + 1);
-                   
-                    auto pBitangentLayout = VertexBufferLayout::create();
-                    pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
-                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
-                    buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
-                }
+                mesh.vertexSize += buffers[i].elementSize;
+                usedAttribCount += buffers[i].shouldSkip ? 0 : 1;
             }
-            
 
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+            mesh.pVertexData = mStream.getPointer(mesh.vertexSize * numVertices);
+            if(mesh.pVertexData == nullptr)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
-                {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
-                    {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
-                    }
-                }
+                std::string msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+                logError(msg);
+                return nullptr;
             }
 
-            for (int32_t i = 0; i < numAttribs; ++i)
+            if(numAttribs == 1 && usedAttribCount == 1)
             {
-                if(buffers[i].shouldSkip == false)
-                {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].vec.data());
-                }
+                // A single attribute is already laid out as a vertex buffer
+                buffers[0].pData = mesh.pVertexData;
             }
-
-            if(version <= 5)
+            else
             {
-                importTextures(texData, numTextures, mStream, mModelName);
-                textures.clear();
+                mesh.deinterleave = true;
             }
 
-            // Array of Submesh.
-            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
-            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            // Check if we need to generate tangents
+            if(shouldGenerateTangents && (mesh.bitangentBufferIndex == kInvalidBufferIndex))
             {
-                // create the material
-                BasicMaterial basicMaterial;
-
-                glm::vec3 ambient;
-                glm::vec4 diffuse;
-                glm::vec3 specular;
-                float glossiness;
-
-                mStream >> ambient >> diffuse >> specular >> glossiness;
-                basicMaterial.diffuseColor = glm::vec3(diffuse);
-                basicMaterial.opacity = 1 - diffuse.w;
-                basicMaterial.specularColor = specular;
-                basicMaterial.shininess = glossiness;
-
-                if(version >= 3)
+                if(mesh.normalBufferIndex == kInvalidBufferIndex)
                 {
-                    float displacementCoeff;
-                    float displacementBias;
-                    mStream >> displacementCoeff >> displacementBias;
-                    basicMaterial.bumpScale = displacementCoeff;
-                    basicMaterial.bumpOffset = displacementBias;
+                    logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
                 }
-
-                for(int i = 0; i < numTextureSlots; i++)
+                else
                 {
-                    int32_t texID;
-                    mStream >> texID;
-                    if(texID < -1 || texID >= numTextures)
+                    if(mesh.texCoordBufferIndex == kInvalidBufferIndex)
                     {
-                        std::string msg = "Error when loading model " + mModelName + ".\nCorrupt binary mesh data!";
-                        logError(msg);
-                        return nullptr;
-                    }
-                    else if(texID != -1)
-                    {
-                        BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
-                        if(BasicMaterial::MapType::Count == falcorType)
-                        {
-                            logWarning("Texture of Type " + std::to_string(i) + " is not supported by the material system (model " + mModelName + ")");
-                            continue;
-                        }
-
-                        // Load the texture
-                        TexSignature texSig;
-                        texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
-                        texSig.pData = texData[texID].data.data();
-                        // Check if we already created a matching texture
-                        auto existingTex = textures.find(texSig);
-                        if(existingTex != textures.end())
-                        {
-                            basicMaterial.pTextures[falcorType] = existingTex->second;
-                        }
-                        else
-                        {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
-                            textures[texSig] = pTexture;
-                            basicMaterial.pTextures[falcorType] = pTexture;
-                        }
+                        logError("Model " + mModelName + " asked to generate tangents w/o texture coordinates");
                     }
+
+                    // The bitangent buffer is appended after the file's attributes and filled by decodeMesh()
+                    mesh.genTangents = true;
+                    mesh.bitangentBufferIndex = (uint32_t)buffers.size();
+                    buffers.resize(mesh.bitangentBufferIndex + 1);
+                    buffers[mesh.bitangentBufferIndex].elementSize = sizeof(glm::vec3);
+
+                    auto pBitangentLayout = VertexBufferLayout::create();
+                    mesh.pLayout->addBufferLayout(mesh.bitangentBufferIndex, pBitangentLayout);
+                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
                 }
+            }
+
+            if(version <= 5)
+            {
+                importTextures(texData, numTextures, mStream, mModelName);
+            }
 
-                // Create material and check if it already exists
-                auto pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
+            // Array of Submesh. Skip the materials for now, their textures are created with the meshes.
+            mesh.submeshes.resize(numSubmeshes);
+            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            {
+                SubmeshData& submeshData = mesh.submeshes[submesh];
+                submeshData.materialOffset = mStream.getOffset();
+                mStream.skip(materialSize);
 
                 int32_t numTriangles;
                 mStream >> numTriangles;
@@ -910,62 +1002,84 @@ namespace Falcor
                     return nullptr;
                 }
 
-                // create the index buffer
-                uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
-                uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
+                submeshData.numIndices = numTriangles * 3;
+                submeshData.pIndices = (const uint32_t*)mStream.getPointer(submeshData.numIndices * sizeof(uint32_t));
+                if(submeshData.pIndices == nullptr)
+                {
+                    std::string Msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+                    logError(Msg);
+                    return nullptr;
+                }
+            }
 
-                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
+            if(mesh.positionBufferIndex == kInvalidBufferIndex && numSubmeshes > 0)
+            {
+                std::string Msg = "Error when loading model " + mModelName + ".\nMesh " + std::to_string(meshIdx) + " doesn't have positions.";
+                logError(Msg);
+                return nullptr;
+            }
+        }
 
-                // Generate tangent space data if needed
-                if(genTangentForMesh)
-                {
-                    if(texCoordBufferIndex != kInvalidBufferIndex)
-                    {
-                        logError("Model " + mModelName + " asked to generate tangents w/o texture coordinates");
-                    }
-                    uint32_t texCrdCount = 0;
-                    glm::vec2* texCrd = nullptr;
-                    if(texCoordBufferIndex != kInvalidBufferIndex)
-                    {
-                        texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                        texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
-                    }
+        const size_t instancesOffset = mStream.getOffset();
+        CpuTimer::TimePoint phaseEnd = CpuTimer::getCurrentTimePoint();
+        stats.parseTime = CpuTimer::calcDuration(phaseStart, phaseEnd);
 
-                    ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
+        // Decode
+        phaseStart = phaseEnd;
+        decodeModelData(meshes, texData, (flags & Model::ParallelImport) ? &ThreadPool::getGlobalPool() : nullptr);
+        phaseEnd = CpuTimer::getCurrentTimePoint();
+        stats.decodeTime = CpuTimer::calcDuration(phaseStart, phaseEnd);
 
-                    if (posFormat == ResourceFormat::RGB32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec3>(indices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
-                    else if (posFormat == ResourceFormat::RGBA32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec4>(indices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
+        // Create the resources. This is done on the calling thread, in file order.
+        phaseStart = phaseEnd;
+        auto pModel = Model::create();
 
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
-                }
-                
+        // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
+        // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes Falcor IDs. This is what the next 2 variables are for.
+        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
 
-                // Calculate the bounding-box
-                glm::vec3 max, min;
-                for(uint32_t i = 0; i < numIndices; i++)
-                {
-                    uint32_t vertexID = indices[i];
-                    uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
+        // This importer loads mesh/submesh data before instance data, so the meshes are cached here.
+        std::vector<Mesh::SharedPtr> falcorMeshCache;
+
+        TextureCache textures;
+        bool loadTexAsSrgb = (flags & Model::AssumeLinearSpaceTextures) ? false : true;
+
+        for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+        {
+            const MeshData& mesh = meshes[meshIdx];
 
-                    float* pPosition = (float*)pVertex;
+            Vao::BufferVec pVBs(mesh.buffers.size());
+            for(size_t i = 0; i < mesh.buffers.size(); ++i)
+            {
+                const BufferData& buffer = mesh.buffers[i];
+                if(buffer.shouldSkip == false)
+                {
+                    pVBs[i] = Buffer::create(buffer.elementSize * mesh.numVertices, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffer.pData);
+                }
+            }
 
-                    glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
-                    min = glm::min(min, xyz);
-                    max = glm::max(max, xyz);
+            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            for(const SubmeshData& submesh : mesh.submeshes)
+            {
+                // create the material
+                Material::SharedPtr pMaterial;
+                mStream.setOffset(submesh.materialOffset);
+                if(readSubmeshMaterial(mStream, version, numTextureSlots, texData, textures, loadTexAsSrgb, mModelName, pMaterial) == false)
+                {
+                    return nullptr;
                 }
+                pMaterial = checkForExistingMaterial(pMaterial);
 
-                BoundingBox box = BoundingBox::fromMinMax(min, max);
+                // create the index buffer straight from the file data
+                auto pIB = Buffer::create(submesh.numIndices * sizeof(uint32_t), Buffer::BindFlags::Index, Buffer::CpuAccess::None, submesh.pIndices);
 
                 // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                auto pMesh = Mesh::create(pVBs, mesh.numVertices, pIB, submesh.numIndices, mesh.pLayout, Vao::Topology::TriangleList, pMaterial, submesh.box, false);
+                if(flags & Model::KeepCpuGeometry)
+                {
+                    const BufferData& positions = mesh.buffers[mesh.positionBufferIndex];
+                    pMesh->setCpuGeometry(positions.pData, positions.elementSize, submesh.pIndices);
+                }
 
                 if (version >= 6)
                 {
@@ -981,27 +1095,249 @@ namespace Falcor
 
         if(version >= 6)
         {
-            for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
+            mStream.setOffset(instancesOffset);
+            readInstances(mStream, numInstances, meshToSubmeshesID, falcorMeshCache, pModel.get());
+        }
+
+        stats.createTime = CpuTimer::calcDuration(phaseStart, CpuTimer::getCurrentTimePoint());
+        return pModel;
+    }
+
+    Model::SharedPtr BinaryModelImporter::createChunkedModel(uint32_t flags, LoadStats& stats)
+    {
+        CpuTimer::TimePoint phaseStart = CpuTimer::getCurrentTimePoint();
+        const uint32_t version = 9;
+        const int numTextureSlots = TextureType_Max;
+
+        int32_t numTextures = 0;
+        int32_t numMeshes = 0;
+        int32_t numInstances = 0;
+        int32_t numChunks = 0;
+        uint64_t chunkTableOffset = 0;
+        mStream >> numTextures >> numMeshes >> numInstances >> numChunks >> chunkTableOffset;
+
+        if(numTextures < 0 || numMeshes < 0 || numInstances < 0 || numChunks < 0 || mStream.isFail())
+        {
+            std::string msg = "Error when loading model " + mModelName + ".\nFile is corrupted.";
+            logError(msg);
+            return nullptr;
+        }
+
+        // Read the chunk table. Every texture and mesh has its own chunk, so they can be located without parsing the ones before them.
+        struct Chunk
+        {
+            uint64_t offset = 0;
+            bool valid = false;
+        };
+        std::vector<Chunk> textureChunks(numTextures);
+        std::vector<Chunk> meshChunks(numMeshes);
+        Chunk instancesChunk;
+
+        mStream.setOffset(chunkTableOffset);
+        for(int32_t i = 0; i < numChunks; i++)
+        {
+            int32_t type, index;
+            uint64_t offset, size;
+            mStream >> type >> index >> offset >> size;
+            if(mStream.isFail() || mStream.getPointerAt(offset, size) == nullptr)
             {
-                int32_t meshIdx = 0;
-                int32_t enabled = 1;
-                glm::mat4 transformation;
+                std::string msg = "Error when loading model " + mModelName + ".\nCorrupted chunk table.";
+                logError(msg);
+                return nullptr;
+            }
 
-                mStream >> meshIdx >> enabled >> transformation;
-                //m_Stream >> inst.name >> inst.metadata;
-                readString(mStream);   // Name
-                readString(mStream);   // Meta-data
+            Chunk* pChunk = nullptr;
+            switch(type)
+            {
+            case ChunkType_Texture:
+                pChunk = (index >= 0 && index < numTextures) ? &textureChunks[index] : nullptr;
+                break;
+            case ChunkType_Mesh:
+                pChunk = (index >= 0 && index < numMeshes) ? &meshChunks[index] : nullptr;
+                break;
+            case ChunkType_Instances:
+                pChunk = &instancesChunk;
+                break;
+            default:
+                // Unknown chunks are skipped, so that newer revisions can add data
+                continue;
+            }
 
-                if(enabled)
+            if(pChunk)
+            {
+                pChunk->offset = offset;
+                pChunk->valid = true;
+            }
+        }
+
+        // Textures
+        std::vector<TextureData> texData(numTextures);
+        for(int32_t i = 0; i < numTextures; i++)
+        {
+            if(textureChunks[i].valid == false)
+            {
+                std::string msg = "Error when loading model " + mModelName + ".\nTexture " + std::to_string(i) + " is missing.";
+                logError(msg);
+                return nullptr;
+            }
+
+            mStream.setOffset(textureChunks[i].offset);
+            texData[i].name = readString(mStream);
+            if(loadBinaryTextureData(mStream, mModelName, texData[i]) == false)
+            {
+                return nullptr;
+            }
+        }
+
+        CpuTimer::TimePoint phaseEnd = CpuTimer::getCurrentTimePoint();
+        stats.parseTime = CpuTimer::calcDuration(phaseStart, phaseEnd);
+
+        // The vertex data is stored de-interleaved, with baked bitangents and bounding boxes. Only the textures need decoding.
+        phaseStart = phaseEnd;
+        std::vector<MeshData> noMeshes;
+        decodeModelData(noMeshes, texData, (flags & Model::ParallelImport) ? &ThreadPool::getGlobalPool() : nullptr);
+        phaseEnd = CpuTimer::getCurrentTimePoint();
+        stats.decodeTime = CpuTimer::calcDuration(phaseStart, phaseEnd);
+
+        phaseStart = phaseEnd;
+        auto pModel = Model::create();
+        bool shouldGenerateTangents = (flags & Model::GenerateTangentSpace) != 0;
+        bool loadTexAsSrgb = (flags & Model::AssumeLinearSpaceTextures) ? false : true;
+        TextureCache textures;
+
+        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
+        std::vector<Mesh::SharedPtr> falcorMeshCache;
+
+        // Meshes. The attribute and index streams are used in place.
+        for(int32_t meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+        {
+            if(meshChunks[meshIdx].valid == false)
+            {
+                std::string msg = "Error when loading model " + mModelName + ".\nMesh " + std::to_string(meshIdx) + " is missing.";
+                logError(msg);
+                return nullptr;
+            }
+            mStream.setOffset(meshChunks[meshIdx].offset);
+
+            int32_t numAttribs = 0;
+            int32_t numVertices = 0;
+            int32_t numSubmeshes = 0;
+            mStream >> numAttribs >> numVertices >> numSubmeshes;
+
+            if(numAttribs < 0 || numVertices < 0 || numSubmeshes < 0)
+            {
+                std::string Msg = "Error when loading model " + mModelName + ".\nCorrupted data.!";
+                logError(Msg);
+                return nullptr;
+            }
+
+            Vao::BufferVec pVBs;
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+            const uint8_t* pPositions = nullptr;
+            uint32_t positionStride = 0;
+            bool hasNormals = false;
+            bool hasBitangents = false;
+
+            for(int32_t i = 0; i < numAttribs; i++)
+            {
+                int32_t type, format, length;
+                uint64_t offset;
+                mStream >> type >> format >> length >> offset;
+
+                if(type < 0 || type >= AttribType_Max || format < 0 || format >= AttribFormat::AttribFormat_Max || length < 1 || length > 4)
                 {
-                    for(uint32_t i : meshToSubmeshesID[meshIdx])
-                    {
-                        pModel->addMeshInstance(falcorMeshCache[i], transformation);
-                    }
+                    std::string msg = "Error when loading model " + mModelName + ".\nCorrupted data.!";
+                    logError(msg);
+                    return nullptr;
+                }
+
+                uint32_t shaderLocation = getShaderLocation(AttribType(type));
+                if(shaderLocation == kUnusedShaderElement)
+                {
+                    continue;
+                }
+
+                ResourceFormat falcorFormat = getFalcorFormat(AttribFormat(format), length);
+                size_t streamSize = (size_t)getFormatBytesPerBlock(falcorFormat) * numVertices;
+                const uint8_t* pStreamData = mStream.getPointerAt(offset, streamSize);
+                if(pStreamData == nullptr)
+                {
+                    std::string msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+                    logError(msg);
+                    return nullptr;
+                }
+
+                if(shaderLocation == VERTEX_POSITION_LOC && (falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float))
+                {
+                    pPositions = pStreamData;
+                    positionStride = getFormatBytesPerBlock(falcorFormat);
+                }
+                hasNormals = hasNormals || (shaderLocation == VERTEX_NORMAL_LOC);
+                hasBitangents = hasBitangents || (shaderLocation == VERTEX_BITANGENT_LOC);
+
+                VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+                pBufferLayout->addElement(getSemanticName(AttribType(type)), 0, falcorFormat, 1, shaderLocation);
+                pLayout->addBufferLayout((uint32_t)pVBs.size(), pBufferLayout);
+                pVBs.push_back(Buffer::create(streamSize, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, pStreamData));
+            }
+
+            // The exporter bakes bitangents for every mesh with normals, so there's nothing to generate
+            if(shouldGenerateTangents && (hasBitangents == false))
+            {
+                logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain " + (hasNormals ? "bitangents" : "normals coordinates") + "\n");
+            }
+
+            for(int32_t submesh = 0; submesh < numSubmeshes; submesh++)
+            {
+                Material::SharedPtr pMaterial;
+                if(readSubmeshMaterial(mStream, version, numTextureSlots, texData, textures, loadTexAsSrgb, mModelName, pMaterial) == false)
+                {
+                    return nullptr;
+                }
+                pMaterial = checkForExistingMaterial(pMaterial);
+
+                glm::vec3 aabbMin, aabbMax;
+                int32_t numTriangles;
+                uint64_t indexOffset;
+                mStream >> aabbMin >> aabbMax >> numTriangles >> indexOffset;
+
+                uint32_t numIndices = numTriangles * 3;
+                size_t ibSize = numIndices * sizeof(uint32_t);
+                const uint8_t* pIndices = mStream.getPointerAt(indexOffset, ibSize);
+                if(numTriangles < 0 || pIndices == nullptr)
+                {
+                    std::string Msg = "Error when loading model " + mModelName + ".\nCorrupted index data!";
+                    logError(Msg);
+                    return nullptr;
+                }
+
+                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, pIndices);
+                BoundingBox box = BoundingBox::fromMinMax(aabbMin, aabbMax);
+                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                if((flags & Model::KeepCpuGeometry) && pPositions)
+                {
+                    pMesh->setCpuGeometry(pPositions, positionStride, (const uint32_t*)pIndices);
                 }
+
+                falcorMeshCache.push_back(pMesh);
+                meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
             }
         }
-        
+
+        if(instancesChunk.valid)
+        {
+            mStream.setOffset(instancesChunk.offset);
+            readInstances(mStream, numInstances, meshToSubmeshesID, falcorMeshCache, pModel.get());
+        }
+
+        if(mStream.isFail())
+        {
+            std::string msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+            logError(msg);
+            return nullptr;
+        }
+
+        stats.createTime = CpuTimer::calcDuration(phaseStart, CpuTimer::getCurrentTimePoint());
         return pModel;
     }
 }
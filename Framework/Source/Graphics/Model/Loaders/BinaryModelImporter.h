@@ -27,7 +27,8 @@
 ***************************************************************************/
 #pragma once
 #include <string>
-#include "Utils/BinaryFileStream.h"
+#include "Utils/BinaryMemoryStream.h"
+#include "Utils/MemoryMappedFile.h"
 #include "glm/vec3.hpp"
 #include "../Model.h"
 #include "Graphics/Model/Loaders/ModelImporter.h"
@@ -39,19 +40,32 @@ namespace Falcor
     class BinaryModelImporter : public ModelImporter
     {
     public:
+        /** Time spent in each of the loading phases, in milliseconds
+        */
+        struct LoadStats
+        {
+            float parseTime = 0;    ///< Reading the headers and locating the vertex, index and texel data in the file
+            float decodeTime = 0;   ///< De-interleaving, tangent generation, bounding boxes and texel conversion. Runs on the thread pool when Model::ParallelImport is set.
+            float createTime = 0;   ///< Creating the GPU resources, materials and meshes
+            float totalTime = 0;
+        };
+
         /** create a new model from internal binary format
             \param[in] filename Model's filename. Loader will look for it in the data directories.
             \param[in] flags Flags controlling model creation
+            \param[out] pStats Optional. If not null, receives the per-phase load times.
             returns nullptr if loading failed, otherwise a new Model object
         */
-        static Model::SharedPtr createFromFile(const std::string& filename, uint32_t flags);
+        static Model::SharedPtr createFromFile(const std::string& filename, uint32_t flags, LoadStats* pStats = nullptr);
 
     private:
         BinaryModelImporter(const std::string& fullpath);
-        Model::SharedPtr createModel(uint32_t flags);
+        Model::SharedPtr createModel(uint32_t flags, LoadStats& stats);
+        Model::SharedPtr createChunkedModel(uint32_t flags, LoadStats& stats);
 
         std::string mModelName;
-        BinaryFileStream mStream;
+        MemoryMappedFile::UniquePtr mpFile;
+        BinaryMemoryStream mStream;
 
         struct TangentSpace
         {
@@ -30,7 +30,7 @@
 //------------------------------------------------------------------------
 /*
 
-Binary scene file format v8
+Binary scene file format v9
 ---------------------------
 
 - The basic units of data are 32-bit little-endian ints and floats.
@@ -50,6 +50,25 @@ File
 ?       n*?     array   v6  Instance            (numInstances)
 ?
 
+File_v9
+0       2       string8 v6  formatID            ("BinScene")
+2       1       int     v6  formatVersion       (9)
+3       1       int     v6  numTextures
+4       1       int     v6  numMeshes
+5       1       int     v6  numInstances
+6       1       int     v9  numChunks
+7       2       uint64  v9  chunkTableOffset    (bytes from the beginning of the file)
+9       ?       bytes   v9  chunk data          (located through the chunk table)
+?       n*6     array   v9  Chunk               (numChunks, at chunkTableOffset)
+?
+
+Chunk
+0       1       int     v9  type                (see ChunkType)
+1       1       int     v9  index               (texture or mesh index, 0 for the instances chunk)
+2       2       uint64  v9  offset              (bytes from the beginning of the file)
+4       2       uint64  v9  size                (bytes)
+6
+
 File_v5
 0       2       string8 v1  formatID            ("BinMesh ")
 2       1       int     v1  formatVersion       (1 .. 5)
@@ -78,6 +97,36 @@ Mesh
 ?       n*?     array   v6  Submesh             (numSubmeshes)
 ?
 
+Mesh_v9
+0       1       int     v9  numAttribs
+1       1       int     v9  numVertices
+2       1       int     v9  numSubmeshes
+3       n*5     array   v9  AttribStream        (numAttribs)
+?       n*29    array   v9  Submesh_v9          (numSubmeshes)
+?       ?       bytes   v9  stream data         (vertex attribute and index streams, each starting at a 16-byte aligned file offset)
+?
+
+AttribStream
+0       1       int     v9  Type                (see MeshBase::AttribType. Meshes with normals always have a bitangent stream)
+1       1       int     v9  format              (see MeshBase::AttribFormat)
+2       1       int     v9  length
+3       2       uint64  v9  offset              (bytes from the beginning of the file, 16-byte aligned. The stream holds numVertices tightly packed elements)
+5
+
+Submesh_v9
+0       3       float   v9  ambient             (ignored)
+3       4       float   v9  diffuse
+7       3       float   v9  specular
+10      1       float   v9  glossiness
+11      1       float   v9  displacementCoef
+12      1       float   v9  displacementBias
+13      7       int     v9  textures            (one index per TextureType, -1 if none)
+20      3       float   v9  aabbMin             (bounding box of the vertices referenced by the submesh)
+23      3       float   v9  aabbMax
+26      1       int     v9  numTriangles
+27      2       uint64  v9  indexOffset         (bytes from the beginning of the file, 16-byte aligned. numTriangles * 3 32-bit indices)
+29
+
 AttribSpec
 0       1       int     v1  Type                (see MeshBase::AttribType)
 1       1       int     v1  format              (see MeshBase::AttribFormat)
@@ -143,6 +192,18 @@ enum AttribFormat
     AttribFormat_Max
 };
 
+enum ChunkType
+{
+    ChunkType_Texture = 0,      // A Texture. Chunk index is the texture index.
+    ChunkType_Mesh,             // A Mesh_v9. Chunk index is the mesh index.
+    ChunkType_Instances,        // Array of Instance (numInstances)
+
+    ChunkType_Max
+};
+
+// Alignment of the attribute and index streams in v9 files
+static const uint32_t kBinSceneStreamAlignment = 16;
+
 enum TextureType
 {
     TextureType_Diffuse = 0,    // Diffuse color map.
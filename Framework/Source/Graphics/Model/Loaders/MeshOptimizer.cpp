@@ -0,0 +1,435 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    // Forsyth's cache model and scoring constants
+    static const uint32_t kForsythCacheSize = 32;
+    static const uint32_t kForsythMaxValence = 32;
+    static const float kLastTriangleScore = 0.75f;
+    static const float kCacheDecayPower = 1.5f;
+    static const float kValenceBoostScale = 2.0f;
+    static const float kValenceBoostPower = 0.5f;
+
+    static const uint32_t kNotInCache = (uint32_t)-1;
+
+    // A FIFO cache of vertex timestamps. A vertex is cached if it was added in the last cacheSize insertions.
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32_t vertexCount, uint32_t cacheSize) : mTimestamps(vertexCount, 0), mTime(cacheSize + 1), mCacheSize(cacheSize) {}
+
+        // Access a vertex. Returns true on a miss.
+        bool access(uint32_t vertex)
+        {
+            if (mTime - mTimestamps[vertex] > mCacheSize)
+            {
+                mTimestamps[vertex] = mTime++;
+                return true;
+            }
+            return false;
+        }
+
+        void flush() { mTime += mCacheSize + 1; }
+
+    private:
+        std::vector<uint32_t> mTimestamps;
+        uint32_t mTime;
+        uint32_t mCacheSize;
+    };
+
+    VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        assert(indexCount % 3 == 0);
+        VertexCacheStats stats;
+        stats.triangleCount = indexCount / 3;
+
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<bool> referenced(vertexCount, false);
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            const uint32_t vertex = pIndices[i];
+            assert(vertex < vertexCount);
+            stats.transformCount += cache.access(vertex) ? 1 : 0;
+            if (referenced[vertex] == false)
+            {
+                referenced[vertex] = true;
+                stats.vertexCount++;
+            }
+        }
+        return stats;
+    }
+
+    // Score of a vertex, based on its position in the LRU cache and the number of triangles which still use it
+    class ForsythScores
+    {
+    public:
+        ForsythScores()
+        {
+            for (uint32_t i = 0; i < kForsythCacheSize; i++)
+            {
+                // The vertices of the last triangle get a fixed score, so that the next triangle doesn't simply reuse its edge
+                mCacheScores[i] = (i < 3) ? kLastTriangleScore : powf(1.0f - (float)(i - 3) / (float)(kForsythCacheSize - 3), kCacheDecayPower);
+            }
+            mValenceScores[0] = 0;
+            for (uint32_t i = 1; i < kForsythMaxValence; i++)
+            {
+                // Vertices with few triangles left are boosted, so that they are finished and don't have to be transformed again later
+                mValenceScores[i] = kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+            }
+        }
+
+        float get(uint32_t cachePosition, uint32_t liveTriangles) const
+        {
+            if (liveTriangles == 0)
+            {
+                return -1.0f;
+            }
+            float score = (cachePosition < kForsythCacheSize) ? mCacheScores[cachePosition] : 0.0f;
+            return score + mValenceScores[std::min(liveTriangles, kForsythMaxValence - 1)];
+        }
+
+    private:
+        float mCacheScores[kForsythCacheSize];
+        float mValenceScores[kForsythMaxValence];
+    };
+
+    void optimizeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t* pResult)
+    {
+        assert(indexCount % 3 == 0);
+        const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // pResult can alias the input, so work on a copy
+        std::vector<uint32_t> indices(pIndices, pIndices + indexCount);
+
+        // The triangles of every vertex. liveTriangles[v] counts the ones which weren't emitted yet, and they are kept at the front of the vertex range.
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (uint32_t index : indices)
+        {
+            assert(index < vertexCount);
+            liveTriangles[index]++;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    adjacency[fill[indices[t * 3 + k]]++] = t;
+                }
+            }
+        }
+
+        static const ForsythScores kScores;
+        std::vector<uint32_t> cachePositions(vertexCount, kNotInCache);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            vertexScores[v] = kScores.get(kNotInCache, liveTriangles[v]);
+        }
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        uint32_t bestTriangle = 0;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+            if (triangleScores[t] > triangleScores[bestTriangle])
+            {
+                bestTriangle = t;
+            }
+        }
+
+        // The LRU cache holds up to 3 extra entries while a triangle is added. Those vertices drop out of the cache.
+        uint32_t cache[kForsythCacheSize + 3];
+        uint32_t cacheSize = 0;
+        uint32_t nextCandidate = 0;
+
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            if (bestTriangle == kNotInCache)
+            {
+                // No triangle touches the cache. Continue with the first one which wasn't emitted yet.
+                while (emitted[nextCandidate])
+                {
+                    nextCandidate++;
+                }
+                bestTriangle = nextCandidate;
+            }
+
+            const uint32_t* pTriangle = &indices[bestTriangle * 3];
+            memcpy(pResult + emittedCount * 3, pTriangle, 3 * sizeof(uint32_t));
+            emitted[bestTriangle] = true;
+
+            // Remove the triangle from the live lists of its vertices
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = pTriangle[k];
+                uint32_t* pBegin = &adjacency[adjacencyOffsets[v]];
+                uint32_t* pEnd = pBegin + liveTriangles[v];
+                uint32_t* pFound = std::find(pBegin, pEnd, bestTriangle);
+                if (pFound != pEnd)
+                {
+                    std::swap(*pFound, *(pEnd - 1));
+                    liveTriangles[v]--;
+                }
+            }
+
+            // Move the triangle's vertices to the front of the cache
+            uint32_t newCache[kForsythCacheSize + 3];
+            uint32_t newCacheSize = 0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (std::find(newCache, newCache + newCacheSize, pTriangle[k]) == newCache + newCacheSize)
+                {
+                    newCache[newCacheSize++] = pTriangle[k];
+                }
+            }
+            for (uint32_t i = 0; i < cacheSize; i++)
+            {
+                const uint32_t v = cache[i];
+                if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2])
+                {
+                    newCache[newCacheSize++] = v;
+                }
+            }
+
+            // Rescore the vertices which moved, including the ones which dropped out, and the triangles using them
+            for (uint32_t i = 0; i < newCacheSize; i++)
+            {
+                const uint32_t v = newCache[i];
+                cachePositions[v] = (i < kForsythCacheSize) ? i : kNotInCache;
+                const float score = kScores.get(cachePositions[v], liveTriangles[v]);
+                const float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+
+                for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + liveTriangles[v]; a++)
+                {
+                    triangleScores[adjacency[a]] += delta;
+                }
+            }
+
+            cacheSize = std::min(newCacheSize, kForsythCacheSize);
+            memcpy(cache, newCache, cacheSize * sizeof(uint32_t));
+
+            // The next triangle is the best one touching the cache
+            float bestScore = -1.0f;
+            bestTriangle = kNotInCache;
+            for (uint32_t i = 0; i < cacheSize; i++)
+            {
+                const uint32_t v = cache[i];
+                for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + liveTriangles[v]; a++)
+                {
+                    const uint32_t t = adjacency[a];
+                    if (triangleScores[t] > bestScore)
+                    {
+                        bestScore = triangleScores[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+        }
+    }
+
+    void optimizeOverdraw(const uint32_t* pIndices, size_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t* pResult, float threshold)
+    {
+        assert(indexCount % 3 == 0);
+        const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        std::vector<uint32_t> indices(pIndices, pIndices + indexCount);
+        auto getPosition = [pPositions, positionStride](uint32_t vertex)
+        {
+            return *(const glm::vec3*)((const uint8_t*)pPositions + (size_t)vertex * positionStride);
+        };
+
+        // Hard boundaries, where the cache order starts from a cold cache: all 3 vertices of the triangle miss
+        std::vector<uint32_t> hardClusters;
+        std::vector<uint32_t> triangleMisses(triangleCount);
+        {
+            FifoCache cache(vertexCount, kDefaultVertexCacheSize);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                uint32_t misses = 0;
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+                }
+                triangleMisses[t] = misses;
+                if (t == 0 || misses == 3)
+                {
+                    hardClusters.push_back(t);
+                }
+            }
+        }
+        hardClusters.push_back(triangleCount);
+
+        // Soft boundaries. A cluster ends once the miss ratio it reached since its start, with a cold cache, is within the threshold of the hard cluster's ratio.
+        std::vector<uint32_t> clusters;
+        FifoCache cache(vertexCount, kDefaultVertexCacheSize);
+        for (size_t h = 0; h + 1 < hardClusters.size(); h++)
+        {
+            const uint32_t begin = hardClusters[h];
+            const uint32_t end = hardClusters[h + 1];
+            uint32_t hardMisses = 0;
+            for (uint32_t t = begin; t < end; t++)
+            {
+                hardMisses += triangleMisses[t];
+            }
+            const float hardAcmr = (float)hardMisses / (float)(end - begin);
+
+            cache.flush();
+            clusters.push_back(begin);
+            uint32_t clusterStart = begin;
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = begin; t < end; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    clusterMisses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+                }
+
+                const float clusterAcmr = (float)clusterMisses / (float)(t - clusterStart + 1);
+                if (t + 1 < end && clusterAcmr <= hardAcmr * threshold)
+                {
+                    clusterStart = t + 1;
+                    clusterMisses = 0;
+                    clusters.push_back(clusterStart);
+                    cache.flush();
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+        const uint32_t clusterCount = (uint32_t)clusters.size() - 1;
+
+        // Area-weighted centroid and normal of the mesh and of every cluster
+        struct Cluster
+        {
+            glm::vec3 centroid;
+            glm::vec3 normal;
+            float sortKey;
+        };
+        std::vector<Cluster> clusterData(clusterCount);
+        glm::vec3 meshCentroid(0);
+        float meshArea = 0;
+        for (uint32_t c = 0; c < clusterCount; c++)
+        {
+            Cluster& cluster = clusterData[c];
+            cluster.centroid = glm::vec3(0);
+            cluster.normal = glm::vec3(0);
+            float clusterArea = 0;
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const glm::vec3 p0 = getPosition(indices[t * 3]);
+                const glm::vec3 p1 = getPosition(indices[t * 3 + 1]);
+                const glm::vec3 p2 = getPosition(indices[t * 3 + 2]);
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float area = glm::length(normal);
+                cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+                cluster.normal += normal;
+                clusterArea += area;
+            }
+            meshCentroid += cluster.centroid;
+            meshArea += clusterArea;
+            cluster.centroid = (clusterArea > 0) ? cluster.centroid / clusterArea : getPosition(indices[clusters[c] * 3]);
+        }
+        meshCentroid = (meshArea > 0) ? meshCentroid / meshArea : glm::vec3(0);
+
+        std::vector<uint32_t> order(clusterCount);
+        for (uint32_t c = 0; c < clusterCount; c++)
+        {
+            Cluster& cluster = clusterData[c];
+            const float normalLength = glm::length(cluster.normal);
+            cluster.sortKey = (normalLength > 0) ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&clusterData](uint32_t a, uint32_t b) { return clusterData[a].sortKey > clusterData[b].sortKey; });
+
+        uint32_t* pDst = pResult;
+        for (uint32_t c : order)
+        {
+            const size_t count = (size_t)(clusters[c + 1] - clusters[c]) * 3;
+            memcpy(pDst, &indices[clusters[c] * 3], count * sizeof(uint32_t));
+            pDst += count;
+        }
+    }
+
+    uint32_t optimizeVertexFetch(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t* pRemap)
+    {
+        std::fill(pRemap, pRemap + vertexCount, kNotInCache);
+        uint32_t nextVertex = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            uint32_t& index = pIndices[i];
+            assert(index < vertexCount);
+            if (pRemap[index] == kNotInCache)
+            {
+                pRemap[index] = nextVertex++;
+            }
+            index = pRemap[index];
+        }
+
+        const uint32_t referencedCount = nextVertex;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (pRemap[v] == kNotInCache)
+            {
+                pRemap[v] = nextVertex++;
+            }
+        }
+        return referencedCount;
+    }
+
+    void remapVertexStream(const uint32_t* pRemap, uint32_t vertexCount, uint32_t stride, void* pData)
+    {
+        std::vector<uint8_t> source((const uint8_t*)pData, (const uint8_t*)pData + (size_t)vertexCount * stride);
+        uint8_t* pDst = (uint8_t*)pData;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            memcpy(pDst + (size_t)pRemap[v] * stride, &source[(size_t)v * stride], stride);
+        }
+    }
+}
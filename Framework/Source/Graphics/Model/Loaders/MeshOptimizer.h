@@ -0,0 +1,109 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+
+namespace Falcor
+{
+    /** Default FIFO cache size used by analyzeVertexCache() and optimizeOverdraw()
+    */
+    static const uint32_t kDefaultVertexCacheSize = 16;
+
+    /** Post-transform vertex cache statistics of a triangle list. Statistics of several meshes can be summed.
+    */
+    struct VertexCacheStats
+    {
+        uint64_t triangleCount = 0;
+        uint64_t vertexCount = 0;       ///< Number of distinct vertices referenced by the triangles
+        uint64_t transformCount = 0;    ///< Number of vertex shader invocations, i.e. cache misses
+
+        /** Average cache miss ratio, the number of transformed vertices per triangle. Ranges from 3 down to about 0.5 for large regular meshes.
+        */
+        float getAcmr() const { return triangleCount ? (float)transformCount / (float)triangleCount : 0.0f; }
+
+        /** Average transform to vertex ratio, the number of times each vertex is transformed. 1 is optimal.
+        */
+        float getAtvr() const { return vertexCount ? (float)transformCount / (float)vertexCount : 0.0f; }
+
+        VertexCacheStats& operator+=(const VertexCacheStats& other)
+        {
+            triangleCount += other.triangleCount;
+            vertexCount += other.vertexCount;
+            transformCount += other.transformCount;
+            return *this;
+        }
+    };
+
+    /** Simulate a FIFO post-transform cache on a triangle list
+        \param[in] pIndices Triangle list indices
+        \param[in] indexCount Number of indices. Must be a multiple of 3.
+        \param[in] vertexCount Number of vertices. All the indices must be smaller.
+        \param[in] cacheSize Number of cache entries
+    */
+    VertexCacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultVertexCacheSize);
+
+    /** Reorder triangles for post-transform cache locality, using Forsyth's linear-speed algorithm with a 32 entry LRU cache model.
+        Only the order of the triangles changes. The vertices of each triangle keep their order, so the winding is preserved.
+        \param[in] pIndices Triangle list indices
+        \param[in] indexCount Number of indices. Must be a multiple of 3.
+        \param[in] vertexCount Number of vertices. All the indices must be smaller.
+        \param[out] pResult Receives indexCount reordered indices. Can be the same as pIndices.
+    */
+    void optimizeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t* pResult);
+
+    /** Reorder clusters of triangles to reduce overdraw, following Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+        The input should be ordered with optimizeVertexCache(). It is split into clusters wherever the cache is cold, and where a cluster can be cut while keeping its miss ratio within threshold times the original.
+        The clusters are then sorted front-to-back, by how far their centroid lies outside the mesh centroid along the cluster normal. Convex parts of the mesh are drawn before the parts they occlude, for most view directions.
+        \param[in] pIndices Triangle list indices, in vertex cache order
+        \param[in] indexCount Number of indices. Must be a multiple of 3.
+        \param[in] pPositions First vertex position. Only xyz is used, so positions can be 3 or 4 floats.
+        \param[in] positionStride Distance in bytes between positions
+        \param[in] vertexCount Number of vertices. All the indices must be smaller.
+        \param[out] pResult Receives indexCount reordered indices. Can be the same as pIndices.
+        \param[in] threshold How much the cache miss ratio may grow in exchange for smaller clusters. 1.05 is a good default.
+    */
+    void optimizeOverdraw(const uint32_t* pIndices, size_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t* pResult, float threshold = 1.05f);
+
+    /** Renumber the vertices in the order the triangles first reference them, so that vertex fetches walk through memory sequentially.
+        Vertices which aren't referenced are moved to the end, so the vertex count doesn't change.
+        \param[in,out] pIndices Triangle list indices. Rewritten to use the new vertex numbers.
+        \param[in] indexCount Number of indices
+        \param[in] vertexCount Number of vertices. All the indices must be smaller.
+        \param[out] pRemap Array of vertexCount entries. Receives the new index of each old vertex.
+        \return The number of referenced vertices
+    */
+    uint32_t optimizeVertexFetch(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t* pRemap);
+
+    /** Reorder a vertex attribute stream using the remap table from optimizeVertexFetch()
+        \param[in] pRemap The new index of each old vertex
+        \param[in] vertexCount Number of vertices
+        \param[in] stride Size of a vertex in bytes
+        \param[in,out] pData The stream. Reordered in place.
+    */
+    void remapVertexStream(const uint32_t* pRemap, uint32_t vertexCount, uint32_t stride, void* pData);
+}
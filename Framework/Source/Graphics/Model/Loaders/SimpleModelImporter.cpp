@@ -44,7 +44,7 @@ namespace Falcor
 
     Model::SharedPtr SimpleModelImporter::create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData,
                                                   uint32_t idxBufSz, const uint32_t *idxBufData, Texture::SharedPtr diffuseTexture,
-                                                  Vao::Topology geomTopology )
+                                                  Vao::Topology geomTopology, uint32_t flags )
     {
         // Since SimpleModelImporter is all static, create an instance here to help track materials
         SimpleModelImporter modelImporter;
@@ -121,6 +121,11 @@ namespace Falcor
 
         // create a mesh containing this index & vertex data.
         Mesh::SharedPtr pMesh = Mesh::create({ pBuffer }, numVertices, pIB, numIndicies, pLayout, geomTopology, pSimpleMaterial, box, false);
+
+        if(flags & Model::KeepCpuGeometry)
+        {
+            pMesh->setCpuGeometry(((const uint8_t*)vboData) + positionOffset, vertexStride, idxBufData);
+        }
         pModel->addMeshInstance(pMesh, glm::mat4()); // Add this mesh to the model
 
         // Do internal computations on model properties
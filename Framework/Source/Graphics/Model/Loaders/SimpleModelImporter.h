@@ -77,11 +77,13 @@ namespace Falcor
             std::vector<VertexAttrib> attribs;
         };
 
-        // Create a model made up of a number of triangles, layed out (in the index buffer) as GL_TRIANGLES
+        // Create a model made up of a number of triangles, layed out (in the index buffer) as GL_TRIANGLES.
+        // Pass Model::KeepCpuGeometry in flags to keep a CPU copy of the positions and indices
         static Model::SharedPtr create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData, 
                                         uint32_t idxBufSz, const uint32_t *idxData, 
                                         Texture::SharedPtr diffuseTexture = nullptr,
-                                        Vao::Topology geomTopology = Vao::Topology::TriangleList );
+                                        Vao::Topology geomTopology = Vao::Topology::TriangleList,
+                                        uint32_t flags = 0 );
 
     private:
         static ResourceFormat    getResourceFormat( AttribFormat format, uint32_t components );
@@ -0,0 +1,380 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TangentSpaceGenerator.h"
+#include "Utils/ThreadPool.h"
+#include <immintrin.h>
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+    // Triangles and vertices are processed in groups of 4, one per SSE lane. This is the number of groups in a parallelFor() chunk.
+    static const uint32_t kGroupsPerChunk = 1024;
+
+    struct Vec3x4
+    {
+        __m128 x, y, z;
+    };
+
+    static inline Vec3x4 load3x4(const float* pX, const float* pY, const float* pZ)
+    {
+        return{ _mm_load_ps(pX), _mm_load_ps(pY), _mm_load_ps(pZ) };
+    }
+
+    static inline void store3x4(const Vec3x4& v, float* pX, float* pY, float* pZ)
+    {
+        _mm_store_ps(pX, v.x);
+        _mm_store_ps(pY, v.y);
+        _mm_store_ps(pZ, v.z);
+    }
+
+    static inline Vec3x4 sub3x4(const Vec3x4& a, const Vec3x4& b)
+    {
+        return{ _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+    }
+
+    static inline Vec3x4 scale3x4(const Vec3x4& a, __m128 s)
+    {
+        return{ _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+    }
+
+    static inline __m128 dot3x4(const Vec3x4& a, const Vec3x4& b)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+    }
+
+    static inline Vec3x4 cross3x4(const Vec3x4& a, const Vec3x4& b)
+    {
+        return{ _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+                _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+                _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)) };
+    }
+
+    static inline Vec3x4 normalize3x4(const Vec3x4& a)
+    {
+        __m128 length = _mm_sqrt_ps(dot3x4(a, a));
+        return{ _mm_div_ps(a.x, length), _mm_div_ps(a.y, length), _mm_div_ps(a.z, length) };
+    }
+
+    // Project v into the plane with the normal n
+    static inline Vec3x4 project3x4(const Vec3x4& v, const Vec3x4& n)
+    {
+        return sub3x4(v, scale3x4(n, dot3x4(v, n)));
+    }
+
+    static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    static inline Vec3x4 select3x4(__m128 mask, const Vec3x4& a, const Vec3x4& b)
+    {
+        return{ select4(mask, a.x, b.x), select4(mask, a.y, b.y), select4(mask, a.z, b.z) };
+    }
+
+    // Lanes where the value is infinite or NaN
+    static inline __m128 isSpecial4(__m128 v)
+    {
+        __m128 zeroed = _mm_mul_ps(v, _mm_setzero_ps());
+        return _mm_cmpunord_ps(zeroed, zeroed);
+    }
+
+    struct FaceFrames
+    {
+        float* pTangentX;
+        float* pTangentY;
+        float* pTangentZ;
+        float* pBitangentX;
+        float* pBitangentY;
+        float* pBitangentZ;
+    };
+
+    static void computeFaceFrames(const TangentSpaceVertices& vertices, const uint32_t* pIndices, uint32_t triangleCount, uint32_t firstGroup, uint32_t lastGroup, const FaceFrames& faces)
+    {
+        const __m128 kZero = _mm_setzero_ps();
+        const __m128 kSignMask = _mm_set1_ps(-0.0f);
+
+        for(uint32_t group = firstGroup; group < lastGroup; group++)
+        {
+            // Gather the corners of 4 triangles. The last group repeats the last triangle in the unused lanes.
+            alignas(16) float pos[3][3][4];
+            alignas(16) float normal[3][4];
+            alignas(16) float uv[3][2][4] = {};
+            for(uint32_t lane = 0; lane < 4; lane++)
+            {
+                const uint32_t triangle = min(group * 4 + lane, triangleCount - 1);
+                for(uint32_t corner = 0; corner < 3; corner++)
+                {
+                    const uint32_t index = pIndices[triangle * 3 + corner];
+                    assert(index < vertices.count);
+                    pos[corner][0][lane] = vertices.pPosX[index];
+                    pos[corner][1][lane] = vertices.pPosY[index];
+                    pos[corner][2][lane] = vertices.pPosZ[index];
+                    if(vertices.pTexCrdU)
+                    {
+                        uv[corner][0][lane] = vertices.pTexCrdU[index];
+                        uv[corner][1][lane] = vertices.pTexCrdV[index];
+                    }
+                }
+
+                const uint32_t index = pIndices[triangle * 3];
+                normal[0][lane] = vertices.pNormalX[index];
+                normal[1][lane] = vertices.pNormalY[index];
+                normal[2][lane] = vertices.pNormalZ[index];
+            }
+
+            const Vec3x4 p0 = load3x4(pos[0][0], pos[0][1], pos[0][2]);
+            const Vec3x4 e1 = sub3x4(load3x4(pos[1][0], pos[1][1], pos[1][2]), p0);
+            const Vec3x4 e2 = sub3x4(load3x4(pos[2][0], pos[2][1], pos[2][2]), p0);
+
+            // Texture coordinate deltas. V is flipped.
+            const __m128 u0 = _mm_load_ps(uv[0][0]);
+            const __m128 v0 = _mm_load_ps(uv[0][1]);
+            const __m128 sx = _mm_sub_ps(_mm_load_ps(uv[1][0]), u0);
+            const __m128 sy = _mm_xor_ps(_mm_sub_ps(_mm_load_ps(uv[1][1]), v0), kSignMask);
+            const __m128 tx = _mm_sub_ps(_mm_load_ps(uv[2][0]), u0);
+            const __m128 ty = _mm_xor_ps(_mm_sub_ps(_mm_load_ps(uv[2][1]), v0), kSignMask);
+
+            // The tangent points along the positive U axis in model space, the bitangent along the positive V axis
+            const __m128 det = _mm_sub_ps(_mm_mul_ps(tx, sy), _mm_mul_ps(ty, sx));
+            const __m128 dirCorrection = select4(_mm_cmplt_ps(det, kZero), _mm_set1_ps(-1.0f), _mm_set1_ps(1.0f));
+
+            Vec3x4 tangent = scale3x4(sub3x4(scale3x4(e2, sy), scale3x4(e1, ty)), dirCorrection);
+            Vec3x4 bitangent = scale3x4(sub3x4(scale3x4(e2, sx), scale3x4(e1, tx)), dirCorrection);
+
+            // When the corners share a position in UV space, build the frame from the normal of the first corner
+            const __m128 sIsZero = _mm_and_ps(_mm_cmpeq_ps(sx, kZero), _mm_cmpeq_ps(sy, kZero));
+            const __m128 tIsZero = _mm_and_ps(_mm_cmpeq_ps(tx, kZero), _mm_cmpeq_ps(ty, kZero));
+            const __m128 useFallback = _mm_or_ps(sIsZero, tIsZero);
+            if(_mm_movemask_ps(useFallback))
+            {
+                const Vec3x4 n = load3x4(normal[0], normal[1], normal[2]);
+                const __m128 useXZ = _mm_cmpgt_ps(_mm_andnot_ps(kSignMask, n.x), _mm_andnot_ps(kSignMask, n.y));
+                const __m128 nz2 = _mm_mul_ps(n.z, n.z);
+                const __m128 length = _mm_sqrt_ps(select4(useXZ, _mm_add_ps(_mm_mul_ps(n.x, n.x), nz2), _mm_add_ps(_mm_mul_ps(n.y, n.y), nz2)));
+
+                Vec3x4 fallbackBitangent;
+                fallbackBitangent.x = _mm_div_ps(select4(useXZ, n.z, kZero), length);
+                fallbackBitangent.y = _mm_div_ps(select4(useXZ, kZero, n.z), length);
+                fallbackBitangent.z = _mm_div_ps(_mm_xor_ps(select4(useXZ, n.x, n.y), kSignMask), length);
+                const Vec3x4 fallbackTangent = cross3x4(fallbackBitangent, n);
+
+                tangent = select3x4(useFallback, fallbackTangent, tangent);
+                bitangent = select3x4(useFallback, fallbackBitangent, bitangent);
+            }
+
+            const size_t first = (size_t)group * 4;
+            store3x4(tangent, faces.pTangentX + first, faces.pTangentY + first, faces.pTangentZ + first);
+            store3x4(bitangent, faces.pBitangentX + first, faces.pBitangentY + first, faces.pBitangentZ + first);
+        }
+    }
+
+    /** Vertex to face adjacency in compressed form. The faces of vertex v are pFaces[pOffsets[v]] to pFaces[pOffsets[v + 1] - 1], in triangle order.
+    */
+    struct VertexFaces
+    {
+        const uint32_t* pOffsets;
+        const uint32_t* pFaces;
+    };
+
+    static void buildVertexFaces(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& offsets, std::vector<uint32_t>& faces)
+    {
+        // Count the references, turn the counts into offsets, then fill the lists in index order
+        offsets.assign((size_t)vertexCount + 1, 0);
+        for(size_t i = 0; i < indexCount; i++)
+        {
+            offsets[pIndices[i] + 1]++;
+        }
+        for(uint32_t v = 0; v < vertexCount; v++)
+        {
+            offsets[v + 1] += offsets[v];
+        }
+
+        faces.resize(indexCount);
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < indexCount; i++)
+        {
+            faces[cursors[pIndices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    /** Sum the frames of the faces referencing the vertex groups [firstGroup, lastGroup), then turn the sums into bitangents.
+        Each vertex adds its faces in triangle order, so the result doesn't depend on how the vertices are partitioned.
+    */
+    static void computeVertexFrames(const TangentSpaceVertices& vertices, const FaceFrames& faces, const VertexFaces& adjacency, uint32_t firstGroup, uint32_t lastGroup, glm::vec3* pBitangents)
+    {
+        for(uint32_t group = firstGroup; group < lastGroup; group++)
+        {
+            const uint32_t first = group * 4;
+            const uint32_t laneCount = min(vertices.count - first, 4u);
+
+            alignas(16) float normal[3][4] = {};
+            alignas(16) float tangentSum[3][4] = {};
+            alignas(16) float bitangentSum[3][4] = {};
+            for(uint32_t lane = 0; lane < laneCount; lane++)
+            {
+                const uint32_t v = first + lane;
+                normal[0][lane] = vertices.pNormalX[v];
+                normal[1][lane] = vertices.pNormalY[v];
+                normal[2][lane] = vertices.pNormalZ[v];
+
+                for(uint32_t i = adjacency.pOffsets[v]; i < adjacency.pOffsets[v + 1]; i++)
+                {
+                    const uint32_t face = adjacency.pFaces[i];
+                    tangentSum[0][lane] += faces.pTangentX[face];
+                    tangentSum[1][lane] += faces.pTangentY[face];
+                    tangentSum[2][lane] += faces.pTangentZ[face];
+                    bitangentSum[0][lane] += faces.pBitangentX[face];
+                    bitangentSum[1][lane] += faces.pBitangentY[face];
+                    bitangentSum[2][lane] += faces.pBitangentZ[face];
+                }
+            }
+
+            // Project the tangent and bitangent into the plane of the vertex normal and make them orthogonal
+            const Vec3x4 n = load3x4(normal[0], normal[1], normal[2]);
+            const Vec3x4 tangent = load3x4(tangentSum[0], tangentSum[1], tangentSum[2]);
+            const Vec3x4 bitangent = load3x4(bitangentSum[0], bitangentSum[1], bitangentSum[2]);
+            const Vec3x4 localTangent = normalize3x4(project3x4(tangent, n));
+            Vec3x4 localBitangent = normalize3x4(project3x4(bitangent, n));
+            localBitangent = normalize3x4(project3x4(localBitangent, localTangent));
+
+            // Reconstruct the bitangent from the normal and tangent when it's infinite or NaN
+            const __m128 isInvalid = _mm_or_ps(_mm_or_ps(isSpecial4(localBitangent.x), isSpecial4(localBitangent.y)), isSpecial4(localBitangent.z));
+            if(_mm_movemask_ps(isInvalid))
+            {
+                localBitangent = select3x4(isInvalid, normalize3x4(cross3x4(localTangent, n)), localBitangent);
+            }
+
+            alignas(16) float result[3][4];
+            store3x4(localBitangent, result[0], result[1], result[2]);
+            for(uint32_t lane = 0; lane < laneCount; lane++)
+            {
+                // Vertices which aren't referenced by any face keep their value
+                const uint32_t v = first + lane;
+                if(adjacency.pOffsets[v + 1] != adjacency.pOffsets[v])
+                {
+                    pBitangents[v] = glm::vec3(result[0][lane], result[1][lane], result[2][lane]);
+                }
+            }
+        }
+    }
+
+    TangentSpaceVertices createTangentSpaceVertices(const void* pPositions, uint32_t positionStride, const void* pNormals, uint32_t normalStride, const void* pTexCrd, uint32_t texCrdStride, uint32_t vertexCount, std::vector<float>& storage)
+    {
+        const uint32_t arrayCount = pTexCrd ? 8 : 6;
+        storage.resize((size_t)arrayCount * vertexCount);
+        float* pArrays[8] = {};
+        for(uint32_t i = 0; i < arrayCount; i++)
+        {
+            pArrays[i] = storage.data() + (size_t)i * vertexCount;
+        }
+
+        for(uint32_t v = 0; v < vertexCount; v++)
+        {
+            const float* pPosition = (const float*)((const uint8_t*)pPositions + (size_t)positionStride * v);
+            const float* pNormal = (const float*)((const uint8_t*)pNormals + (size_t)normalStride * v);
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                pArrays[c][v] = pPosition[c];
+                pArrays[3 + c][v] = pNormal[c];
+            }
+
+            if(pTexCrd)
+            {
+                const float* pUV = (const float*)((const uint8_t*)pTexCrd + (size_t)texCrdStride * v);
+                pArrays[6][v] = pUV[0];
+                pArrays[7][v] = pUV[1];
+            }
+        }
+
+        TangentSpaceVertices vertices;
+        vertices.pPosX = pArrays[0];
+        vertices.pPosY = pArrays[1];
+        vertices.pPosZ = pArrays[2];
+        vertices.pNormalX = pArrays[3];
+        vertices.pNormalY = pArrays[4];
+        vertices.pNormalZ = pArrays[5];
+        vertices.pTexCrdU = pArrays[6];
+        vertices.pTexCrdV = pArrays[7];
+        vertices.count = vertexCount;
+        return vertices;
+    }
+
+    void generateTangentSpace(const TangentSpaceVertices& vertices, const uint32_t* pIndices, size_t indexCount, glm::vec3* pBitangents, ThreadPool* pThreadPool)
+    {
+        assert(indexCount % 3 == 0);
+        const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+        if(triangleCount == 0 || vertices.count == 0)
+        {
+            return;
+        }
+
+        // Per-face frames, padded to a multiple of 4
+        const uint32_t triangleGroupCount = (triangleCount + 3) / 4;
+        const size_t faceArraySize = (size_t)triangleGroupCount * 4;
+        std::unique_ptr<__m128[]> pStorage(new __m128[faceArraySize * 6 / 4]);
+
+        FaceFrames faces;
+        float* pData = (float*)pStorage.get();
+        faces.pTangentX = pData;
+        faces.pTangentY = pData + faceArraySize;
+        faces.pTangentZ = pData + faceArraySize * 2;
+        faces.pBitangentX = pData + faceArraySize * 3;
+        faces.pBitangentY = pData + faceArraySize * 4;
+        faces.pBitangentZ = pData + faceArraySize * 5;
+
+        // The adjacency lets every vertex gather its own faces, so the vertex pass is linear in the index count for any thread count
+        std::vector<uint32_t> adjacencyOffsets;
+        std::vector<uint32_t> adjacencyFaces;
+        buildVertexFaces(pIndices, indexCount, vertices.count, adjacencyOffsets, adjacencyFaces);
+        const VertexFaces adjacency = { adjacencyOffsets.data(), adjacencyFaces.data() };
+        const uint32_t vertexGroupCount = (vertices.count + 3) / 4;
+
+        auto faceFunc = [&](uint32_t begin, uint32_t end)
+        {
+            computeFaceFrames(vertices, pIndices, triangleCount, begin, end, faces);
+        };
+
+        auto vertexFunc = [&](uint32_t begin, uint32_t end)
+        {
+            computeVertexFrames(vertices, faces, adjacency, begin, end, pBitangents);
+        };
+
+        if(pThreadPool)
+        {
+            pThreadPool->parallelFor(triangleGroupCount, kGroupsPerChunk, faceFunc);
+            pThreadPool->parallelFor(vertexGroupCount, kGroupsPerChunk, vertexFunc);
+        }
+        else
+        {
+            faceFunc(0, triangleGroupCount);
+            vertexFunc(0, vertexGroupCount);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    class ThreadPool;
+
+    /** Vertex attributes used by generateTangentSpace(), in structure-of-arrays layout
+    */
+    struct TangentSpaceVertices
+    {
+        const float* pPosX = nullptr;
+        const float* pPosY = nullptr;
+        const float* pPosZ = nullptr;
+        const float* pNormalX = nullptr;
+        const float* pNormalY = nullptr;
+        const float* pNormalZ = nullptr;
+        const float* pTexCrdU = nullptr;    ///< Optional. Without texture coordinates every face uses a frame built from the normal.
+        const float* pTexCrdV = nullptr;
+        uint32_t count = 0;
+    };
+
+    /** Copy interleaved vertex attributes into structure-of-arrays layout
+        \param[in] pPositions First position. Only xyz is used, so positions can be 3 or 4 components.
+        \param[in] pTexCrd First texture coordinate. Can be nullptr.
+        \param[out] storage Receives the arrays. The returned struct points into it.
+    */
+    TangentSpaceVertices createTangentSpaceVertices(const void* pPositions, uint32_t positionStride, const void* pNormals, uint32_t normalStride, const void* pTexCrd, uint32_t texCrdStride, uint32_t vertexCount, std::vector<float>& storage);
+
+    /** Generate per-vertex bitangents for a triangle list.
+        Face frames are computed 4 triangles at a time with SSE. The frames of all the faces sharing a vertex are summed, projected into the plane of the vertex normal and orthogonalized.
+        The face frames are partitioned by triangles, the sums by vertex chunks using a vertex to face adjacency table. Every vertex adds its faces in triangle order, so the result is bit-identical for any thread count.
+        \param[in] vertices The vertex attributes
+        \param[in] pIndices Triangle list indices
+        \param[in] indexCount Number of indices. Must be a multiple of 3.
+        \param[out] pBitangents Array of vertices.count bitangents. Vertices which aren't referenced by any triangle are not written.
+        \param[in] pThreadPool Optional. If not null, the work is split across the pool.
+    */
+    void generateTangentSpace(const TangentSpaceVertices& vertices, const uint32_t* pIndices, size_t indexCount, glm::vec3* pBitangents, ThreadPool* pThreadPool = nullptr);
+}
@@ -92,6 +92,29 @@ namespace Falcor
         mpVao = Vao::create(vertexBuffers, pLayout, pIndexBuffer, ResourceFormat::R32Uint, topology);
     }
 
+    void Mesh::setCpuGeometry(const void* pPositions, uint32_t positionStride, const uint32_t* pIndices)
+    {
+        mCpuPositions.resize(mVertexCount);
+        const uint8_t* pSrc = (const uint8_t*)pPositions;
+        for (uint32_t i = 0; i < mVertexCount; i++)
+        {
+            const float* pPosition = (const float*)(pSrc + (size_t)i * positionStride);
+            mCpuPositions[i] = glm::vec3(pPosition[0], pPosition[1], pPosition[2]);
+        }
+
+        mCpuIndices.assign(pIndices, pIndices + mIndexCount);
+        mpTriangleBvh = nullptr;
+    }
+
+    const TriangleBvh* Mesh::getTriangleBvh() const
+    {
+        if (mpTriangleBvh == nullptr && hasCpuGeometry() && mpVao->getPrimitiveTopology() == Vao::Topology::TriangleList)
+        {
+            mpTriangleBvh = TriangleBvh::create(mCpuPositions.data(), (uint32_t)mCpuPositions.size(), mCpuIndices.data(), (uint32_t)mCpuIndices.size());
+        }
+        return mpTriangleBvh.get();
+    }
+
     void Mesh::resetGlobalIdCounter()
     {
         sMeshCounter = 0;
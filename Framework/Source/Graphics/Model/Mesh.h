@@ -35,6 +35,7 @@
 #include "utils/AABB.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
+#include "Utils/Math/TriangleBvh.h"
 
 namespace Falcor
 {
@@ -116,6 +117,30 @@ namespace Falcor
         */
         const uint32_t getId() const { return mId; }
 
+        /** Keep a CPU copy of the vertex positions and the indices. Importers call this when the model is loaded with Model::KeepCpuGeometry.
+            \param[in] pPositions Pointer to the first vertex position. Positions are 3 floats.
+            \param[in] positionStride Distance in bytes between consecutive positions
+            \param[in] pIndices The mesh indices. Must hold getIndexCount() elements.
+        */
+        void setCpuGeometry(const void* pPositions, uint32_t positionStride, const uint32_t* pIndices);
+
+        /** Check if the mesh has a CPU copy of its geometry
+        */
+        bool hasCpuGeometry() const { return mCpuPositions.empty() == false; }
+
+        /** Get the CPU copy of the vertex positions. Empty if the mesh has no CPU geometry.
+        */
+        const std::vector<glm::vec3>& getCpuPositions() const { return mCpuPositions; }
+
+        /** Get the CPU copy of the indices. Empty if the mesh has no CPU geometry.
+        */
+        const std::vector<uint32_t>& getCpuIndices() const { return mCpuIndices; }
+
+        /** Get an object-space triangle BVH of the mesh, for CPU ray queries. The BVH is built from the CPU geometry on first use. This call is not thread-safe.
+            \return The BVH, or nullptr if the mesh has no CPU geometry or isn't a triangle list
+        */
+        const TriangleBvh* getTriangleBvh() const;
+
         /** Reset all global id counter of model, mesh and material
         */
         static void resetGlobalIdCounter();
@@ -148,5 +173,9 @@ namespace Falcor
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
+
+        std::vector<glm::vec3> mCpuPositions;
+        std::vector<uint32_t> mCpuIndices;
+        mutable TriangleBvh::UniquePtr mpTriangleBvh;
     };
 }
\ No newline at end of file
@@ -90,14 +90,14 @@ namespace Falcor
         return SharedPtr(new Model());
     }
 
-    void Model::exportToBinaryFile(const std::string& filename)
+    void Model::exportToBinaryFile(const std::string& filename, uint32_t exportFlags)
     {
         if(hasSuffix(filename, ".bin", false) == false)
         {
             logWarning("Exporting model to binary file, but extension is not '.bin'. This will cause error when loading the file");
         }
 
-        BinaryModelExporter::exportToFile(filename, this);
+        BinaryModelExporter::exportToFile(filename, this, exportFlags);
     }
 
     void Model::calculateModelProperties()
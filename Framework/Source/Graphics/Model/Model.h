@@ -64,6 +64,9 @@ namespace Falcor
             FindDegeneratePrimitives    = 2,    ///< Replace degenerate triangles/lines with lines/points. This can create a meshes with topology that wasn't present in the original model.
             AssumeLinearSpaceTextures   = 4,    ///< By default, textures representing colors (diffuse/specular) are interpreted as sRGB data. Use this flag to force linear space for color textures.
             DontMergeMeshes             = 8,   ///< Preserve the original list of meshes in the scene, don't merge meshes with the same material
+            ParallelImport              = 16,   ///< Use the global thread pool while loading. The binary importer decodes meshes and textures in parallel, all importers generate tangent space in parallel. Only GPU resource creation is serialized.
+            KeepCpuGeometry             = 32,   ///< Keep a CPU copy of the mesh positions and indices. Required for CPU picking, see Mesh::getTriangleBvh().
+            OptimizeMeshes              = 64,   ///< Reorder triangles for the post-transform vertex cache and overdraw, and vertices for fetch locality. Applies to the formats loaded through Assimp. Binary files keep the order they were exported with, see BinaryModelExporter::OptimizeMeshes.
         };
 
         /** create a new model from file
@@ -77,8 +80,10 @@ namespace Falcor
         ~Model();
 
         /** Export the model to a binary file
+            \param[in] filename The file name. Should have a '.bin' extension.
+            \param[in] exportFlags Combination of BinaryModelExporter::ExportFlags
         */
-        void exportToBinaryFile(const std::string& filename);
+        void exportToBinaryFile(const std::string& filename, uint32_t exportFlags = 0);
 
         /** Get the model radius
         */
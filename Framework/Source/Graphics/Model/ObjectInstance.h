@@ -203,6 +203,16 @@ namespace Falcor
             return mBoundingBox;
         }
 
+        /** Gets the transform version. The version is incremented every time the transform matrix is recalculated, either because the base transform was changed or because the object was moved through the IMovableObject interface.
+            Can be used to detect changes without comparing matrices.
+            \return Transform version
+        */
+        uint32_t getTransformVersion() const
+        {
+            updateInstanceProperties();
+            return mTransformVersion;
+        }
+
         /** IMovableObject interface
         */
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
@@ -234,6 +244,7 @@ namespace Falcor
 
                 mFinalTransformMatrix = mMovable.matrix * mBase.matrix;
                 mBoundingBox = mpObject->getBoundingBox().transform(mFinalTransformMatrix);
+                mTransformVersion++;
             }
         }
 
@@ -308,5 +319,6 @@ namespace Falcor
 
         mutable glm::mat4 mFinalTransformMatrix;
         mutable BoundingBox mBoundingBox;
+        mutable uint32_t mTransformVersion = 0;
     };
 }
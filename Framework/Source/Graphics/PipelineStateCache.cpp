@@ -0,0 +1,1043 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Graphics/PipelineStateCache.h"
+#include "Graphics/GraphicsProgram.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/BinaryMemoryStream.h"
+#include "Utils/HashUtils.h"
+#include "Utils/OS.h"
+
+namespace Falcor
+{
+    static const char kFileMagic[8] = { 'F', 'a', 'l', 'c', 'o', 'r', 'P', 'S' };
+    static const uint32_t kFileVersion = 1;
+    static const uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+
+    // The descriptor file is a header followed by recordCount records. Each record is its size followed by the key and the serialized descriptor.
+    struct DescriptorFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordCount;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static const ShaderType kRecordedStages[] = { ShaderType::Vertex, ShaderType::Pixel, ShaderType::Geometry, ShaderType::Hull, ShaderType::Domain };
+
+    class DescriptorWriter
+    {
+    public:
+        template<typename T>
+        void write(T value)
+        {
+            const uint8_t* pBytes = (const uint8_t*)&value;
+            mData.insert(mData.end(), pBytes, pBytes + sizeof(T));
+        }
+
+        void writeString(const std::string& str)
+        {
+            write((uint32_t)str.size());
+            mData.insert(mData.end(), str.begin(), str.end());
+        }
+
+        uint64_t getHash() const { return hashBytes(mData.data(), mData.size(), kHashSeed); }
+
+        std::vector<uint8_t> mData;
+    };
+
+    template<typename T>
+    static T readValue(BinaryMemoryStream& stream)
+    {
+        T value = T();
+        stream >> value;
+        return value;
+    }
+
+    static std::string readString(BinaryMemoryStream& stream)
+    {
+        uint32_t size = readValue<uint32_t>(stream);
+        const uint8_t* pData = stream.getPointer(size);
+        return pData ? std::string((const char*)pData, size) : std::string();
+    }
+
+    // Serialization of the descriptor parts. The state objects are hashed through the same functions, so the key and the file can't disagree on what a state contains.
+    static void writeProgram(DescriptorWriter& writer, const Program* pProgram)
+    {
+        writer.write((uint8_t)pProgram->isCreatedFromFile());
+        for(ShaderType type : kRecordedStages)
+        {
+            writer.writeString(pProgram->getShaderString(type));
+        }
+
+        const Program::DefineList& defines = pProgram->getActiveDefinesList();
+        writer.write((uint32_t)defines.size());
+        for(const auto& define : defines)
+        {
+            writer.writeString(define.first);
+            writer.writeString(define.second);
+        }
+    }
+
+    static void writeRootSignature(DescriptorWriter& writer, const RootSignature* pRootSig)
+    {
+        writer.write((uint8_t)(pRootSig != nullptr));
+        if(pRootSig == nullptr)
+        {
+            return;
+        }
+
+        writer.write((uint32_t)pRootSig->getRootConstantCount());
+        for(size_t i = 0; i < pRootSig->getRootConstantCount(); i++)
+        {
+            const RootSignature::ConstantDesc& constant = pRootSig->getRootConstantDesc(i);
+            writer.write(constant.regIndex);
+            writer.write(constant.regSpace);
+            writer.write((uint32_t)constant.visibility);
+            writer.write(constant.dwordCount);
+        }
+
+        writer.write((uint32_t)pRootSig->getRootDescriptorCount());
+        for(size_t i = 0; i < pRootSig->getRootDescriptorCount(); i++)
+        {
+            const RootSignature::DescriptorDesc& descriptor = pRootSig->getRootDescriptor(i);
+            writer.write(descriptor.regIndex);
+            writer.write(descriptor.regSpace);
+            writer.write((uint32_t)descriptor.visibility);
+            writer.write((uint32_t)descriptor.type);
+        }
+
+        writer.write((uint32_t)pRootSig->getDescriptorTableCount());
+        for(size_t i = 0; i < pRootSig->getDescriptorTableCount(); i++)
+        {
+            const RootSignature::DescriptorTable& table = pRootSig->getDescriptorTable(i);
+            writer.write((uint32_t)table.getVisibility());
+            writer.write((uint32_t)table.getRangeCount());
+            for(size_t r = 0; r < table.getRangeCount(); r++)
+            {
+                const RootSignature::DescriptorTable::Range& range = table.getRange(r);
+                writer.write((uint32_t)range.type);
+                writer.write(range.firstRegIndex);
+                writer.write(range.descCount);
+                writer.write(range.regSpace);
+                writer.write(range.offsetFromTableStart);
+            }
+        }
+    }
+
+    static void writeVertexLayout(DescriptorWriter& writer, const VertexLayout* pLayout)
+    {
+        writer.write((uint8_t)(pLayout != nullptr));
+        if(pLayout == nullptr)
+        {
+            return;
+        }
+
+        writer.write((uint32_t)pLayout->getBufferCount());
+        for(size_t b = 0; b < pLayout->getBufferCount(); b++)
+        {
+            const VertexBufferLayout* pBuffer = pLayout->getBufferLayout(b).get();
+            writer.write((uint8_t)(pBuffer != nullptr));
+            if(pBuffer == nullptr)
+            {
+                continue;
+            }
+
+            writer.write((uint32_t)pBuffer->getInputClass());
+            writer.write(pBuffer->getInstanceStepRate());
+            writer.write(pBuffer->getElementCount());
+            for(uint32_t e = 0; e < pBuffer->getElementCount(); e++)
+            {
+                writer.writeString(pBuffer->getElementName(e));
+                writer.write(pBuffer->getElementOffset(e));
+                writer.write((uint32_t)pBuffer->getElementFormat(e));
+                writer.write(pBuffer->getElementArraySize(e));
+                writer.write(pBuffer->getElementShaderLocation(e));
+            }
+        }
+    }
+
+    static void writeFboDesc(DescriptorWriter& writer, const Fbo::Desc& fboDesc)
+    {
+        writer.write(Fbo::getMaxColorTargetCount());
+        for(uint32_t rt = 0; rt < Fbo::getMaxColorTargetCount(); rt++)
+        {
+            writer.write((uint32_t)fboDesc.getColorTargetFormat(rt));
+            writer.write((uint8_t)fboDesc.isColorTargetUav(rt));
+        }
+        writer.write((uint32_t)fboDesc.getDepthStencilFormat());
+        writer.write((uint8_t)fboDesc.isDepthStencilUav());
+        writer.write(fboDesc.getSampleCount());
+    }
+
+    static void writeBlendState(DescriptorWriter& writer, const BlendState* pBlendState)
+    {
+        writer.write((uint8_t)pBlendState->isIndependentBlendEnabled());
+        writer.write((uint8_t)pBlendState->isAlphaToCoverageEnabled());
+        const glm::vec4& factor = pBlendState->getBlendFactor();
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(factor[c]);
+        }
+
+        writer.write((uint32_t)pBlendState->getRtCount());
+        for(uint32_t rt = 0; rt < (uint32_t)pBlendState->getRtCount(); rt++)
+        {
+            const BlendState::Desc::RenderTargetDesc& rtDesc = pBlendState->getRtDesc(rt);
+            writer.write((uint8_t)rtDesc.blendEnabled);
+            writer.write((uint32_t)rtDesc.rgbBlendOp);
+            writer.write((uint32_t)rtDesc.alphaBlendOp);
+            writer.write((uint32_t)rtDesc.srcRgbFunc);
+            writer.write((uint32_t)rtDesc.dstRgbFunc);
+            writer.write((uint32_t)rtDesc.srcAlphaFunc);
+            writer.write((uint32_t)rtDesc.dstAlphaFunc);
+            writer.write((uint8_t)rtDesc.writeMask.writeRed);
+            writer.write((uint8_t)rtDesc.writeMask.writeGreen);
+            writer.write((uint8_t)rtDesc.writeMask.writeBlue);
+            writer.write((uint8_t)rtDesc.writeMask.writeAlpha);
+        }
+    }
+
+    static void writeRasterizerState(DescriptorWriter& writer, const RasterizerState* pRastState)
+    {
+        writer.write((uint32_t)pRastState->getCullMode());
+        writer.write((uint32_t)pRastState->getFillMode());
+        writer.write((uint8_t)pRastState->isFrontCounterCW());
+        writer.write(pRastState->getDepthBias());
+        writer.write(pRastState->getSlopeScaledDepthBias());
+        writer.write((uint8_t)pRastState->isDepthClampEnabled());
+        writer.write((uint8_t)pRastState->isLineAntiAliasingEnabled());
+        writer.write((uint8_t)pRastState->isScissorTestEnabled());
+        writer.write((uint8_t)pRastState->isConservativeRasterizationEnabled());
+        writer.write(pRastState->getForcedSampleCount());
+    }
+
+    static void writeDepthStencilState(DescriptorWriter& writer, const DepthStencilState* pDsState)
+    {
+        writer.write((uint8_t)pDsState->isDepthTestEnabled());
+        writer.write((uint8_t)pDsState->isDepthWriteEnabled());
+        writer.write((uint32_t)pDsState->getDepthFunc());
+        writer.write((uint8_t)pDsState->isStencilTestEnabled());
+        writer.write(pDsState->getStencilReadMask());
+        writer.write(pDsState->getStencilWriteMask());
+        writer.write(pDsState->getStencilRef());
+        for(DepthStencilState::Face face : { DepthStencilState::Face::Front, DepthStencilState::Face::Back })
+        {
+            const DepthStencilState::StencilDesc& stencil = pDsState->getStencilDesc(face);
+            writer.write((uint32_t)stencil.func);
+            writer.write((uint32_t)stencil.stencilFailOp);
+            writer.write((uint32_t)stencil.depthFailOp);
+            writer.write((uint32_t)stencil.depthStencilPassOp);
+        }
+    }
+
+    static GraphicsProgram::SharedPtr readProgram(BinaryMemoryStream& stream)
+    {
+        bool createdFromFile = readValue<uint8_t>(stream) != 0;
+        std::string shaders[arraysize(kRecordedStages)];
+        for(auto& shader : shaders)
+        {
+            shader = readString(stream);
+        }
+
+        Program::DefineList defines;
+        uint32_t defineCount = readValue<uint32_t>(stream);
+        for(uint32_t i = 0; i < defineCount && stream.isGood(); i++)
+        {
+            std::string name = readString(stream);
+            std::string value = readString(stream);
+            defines.add(name, value);
+        }
+
+        if(stream.isFail())
+        {
+            return nullptr;
+        }
+
+        if(createdFromFile)
+        {
+            return GraphicsProgram::createFromFile(shaders[0], shaders[1], shaders[2], shaders[3], shaders[4], defines);
+        }
+        return GraphicsProgram::createFromString(shaders[0], shaders[1], shaders[2], shaders[3], shaders[4], defines);
+    }
+
+    static bool readRootSignature(BinaryMemoryStream& stream, RootSignature::SharedPtr& pRootSig)
+    {
+        pRootSig = nullptr;
+        if(readValue<uint8_t>(stream) == 0)
+        {
+            return stream.isGood();
+        }
+
+        RootSignature::Desc desc;
+        uint32_t constantCount = readValue<uint32_t>(stream);
+        for(uint32_t i = 0; i < constantCount && stream.isGood(); i++)
+        {
+            uint32_t regIndex = readValue<uint32_t>(stream);
+            uint32_t regSpace = readValue<uint32_t>(stream);
+            ShaderVisibility visibility = (ShaderVisibility)readValue<uint32_t>(stream);
+            uint32_t dwordCount = readValue<uint32_t>(stream);
+            desc.addConstant(regIndex, dwordCount, visibility, regSpace);
+        }
+
+        uint32_t descriptorCount = readValue<uint32_t>(stream);
+        for(uint32_t i = 0; i < descriptorCount && stream.isGood(); i++)
+        {
+            uint32_t regIndex = readValue<uint32_t>(stream);
+            uint32_t regSpace = readValue<uint32_t>(stream);
+            ShaderVisibility visibility = (ShaderVisibility)readValue<uint32_t>(stream);
+            RootSignature::DescType type = (RootSignature::DescType)readValue<uint32_t>(stream);
+            desc.addDescriptor(regIndex, type, visibility, regSpace);
+        }
+
+        uint32_t tableCount = readValue<uint32_t>(stream);
+        for(uint32_t i = 0; i < tableCount && stream.isGood(); i++)
+        {
+            RootSignature::DescriptorTable table((ShaderVisibility)readValue<uint32_t>(stream));
+            uint32_t rangeCount = readValue<uint32_t>(stream);
+            for(uint32_t r = 0; r < rangeCount && stream.isGood(); r++)
+            {
+                RootSignature::DescType type = (RootSignature::DescType)readValue<uint32_t>(stream);
+                uint32_t firstRegIndex = readValue<uint32_t>(stream);
+                uint32_t descCount = readValue<uint32_t>(stream);
+                uint32_t regSpace = readValue<uint32_t>(stream);
+                uint32_t offset = readValue<uint32_t>(stream);
+                table.addRange(type, firstRegIndex, descCount, regSpace, offset);
+            }
+            desc.addDescriptorTable(table);
+        }
+
+        if(stream.isFail())
+        {
+            return false;
+        }
+        pRootSig = RootSignature::create(desc);
+        return pRootSig != nullptr;
+    }
+
+    static bool readVertexLayout(BinaryMemoryStream& stream, VertexLayout::SharedPtr& pLayout)
+    {
+        pLayout = nullptr;
+        if(readValue<uint8_t>(stream) == 0)
+        {
+            return stream.isGood();
+        }
+
+        pLayout = VertexLayout::create();
+        uint32_t bufferCount = readValue<uint32_t>(stream);
+        for(uint32_t b = 0; b < bufferCount && stream.isGood(); b++)
+        {
+            if(readValue<uint8_t>(stream) == 0)
+            {
+                continue;
+            }
+
+            VertexBufferLayout::SharedPtr pBuffer = VertexBufferLayout::create();
+            VertexBufferLayout::InputClass inputClass = (VertexBufferLayout::InputClass)readValue<uint32_t>(stream);
+            uint32_t stepRate = readValue<uint32_t>(stream);
+            pBuffer->setInputClass(inputClass, stepRate);
+
+            uint32_t elementCount = readValue<uint32_t>(stream);
+            for(uint32_t e = 0; e < elementCount && stream.isGood(); e++)
+            {
+                std::string name = readString(stream);
+                uint32_t offset = readValue<uint32_t>(stream);
+                ResourceFormat format = (ResourceFormat)readValue<uint32_t>(stream);
+                uint32_t arraySize = readValue<uint32_t>(stream);
+                uint32_t shaderLocation = readValue<uint32_t>(stream);
+                pBuffer->addElement(name, offset, format, arraySize, shaderLocation);
+            }
+            pLayout->addBufferLayout(b, pBuffer);
+        }
+        return stream.isGood();
+    }
+
+    static bool readFboDesc(BinaryMemoryStream& stream, Fbo::Desc& fboDesc)
+    {
+        uint32_t rtCount = readValue<uint32_t>(stream);
+        if(rtCount > Fbo::getMaxColorTargetCount())
+        {
+            return false;
+        }
+
+        for(uint32_t rt = 0; rt < rtCount; rt++)
+        {
+            ResourceFormat format = (ResourceFormat)readValue<uint32_t>(stream);
+            bool allowUav = readValue<uint8_t>(stream) != 0;
+            fboDesc.setColorTarget(rt, format, allowUav);
+        }
+        ResourceFormat depthFormat = (ResourceFormat)readValue<uint32_t>(stream);
+        bool depthUav = readValue<uint8_t>(stream) != 0;
+        fboDesc.setDepthStencilTarget(depthFormat, depthUav);
+        fboDesc.setSampleCount(readValue<uint32_t>(stream));
+        return stream.isGood();
+    }
+
+    static BlendState::SharedPtr readBlendState(BinaryMemoryStream& stream, size_t expectedRtCount)
+    {
+        BlendState::Desc desc;
+        desc.setIndependentBlend(readValue<uint8_t>(stream) != 0);
+        desc.setAlphaToCoverage(readValue<uint8_t>(stream) != 0);
+        glm::vec4 factor;
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            factor[c] = readValue<float>(stream);
+        }
+        desc.setBlendFactor(factor);
+
+        // The descriptor has a fixed number of render-targets
+        uint32_t rtCount = readValue<uint32_t>(stream);
+        if(rtCount != expectedRtCount)
+        {
+            return nullptr;
+        }
+
+        for(uint32_t rt = 0; rt < rtCount; rt++)
+        {
+            bool blendEnabled = readValue<uint8_t>(stream) != 0;
+            BlendState::BlendOp rgbOp = (BlendState::BlendOp)readValue<uint32_t>(stream);
+            BlendState::BlendOp alphaOp = (BlendState::BlendOp)readValue<uint32_t>(stream);
+            BlendState::BlendFunc srcRgb = (BlendState::BlendFunc)readValue<uint32_t>(stream);
+            BlendState::BlendFunc dstRgb = (BlendState::BlendFunc)readValue<uint32_t>(stream);
+            BlendState::BlendFunc srcAlpha = (BlendState::BlendFunc)readValue<uint32_t>(stream);
+            BlendState::BlendFunc dstAlpha = (BlendState::BlendFunc)readValue<uint32_t>(stream);
+            bool writeRed = readValue<uint8_t>(stream) != 0;
+            bool writeGreen = readValue<uint8_t>(stream) != 0;
+            bool writeBlue = readValue<uint8_t>(stream) != 0;
+            bool writeAlpha = readValue<uint8_t>(stream) != 0;
+            desc.setRtBlend(rt, blendEnabled);
+            desc.setRtParams(rt, rgbOp, alphaOp, srcRgb, dstRgb, srcAlpha, dstAlpha);
+            desc.setRenderTargetWriteMask(rt, writeRed, writeGreen, writeBlue, writeAlpha);
+        }
+        return stream.isGood() ? BlendState::create(desc) : nullptr;
+    }
+
+    static RasterizerState::SharedPtr readRasterizerState(BinaryMemoryStream& stream)
+    {
+        RasterizerState::Desc desc;
+        desc.setCullMode((RasterizerState::CullMode)readValue<uint32_t>(stream));
+        desc.setFillMode((RasterizerState::FillMode)readValue<uint32_t>(stream));
+        desc.setFrontCounterCW(readValue<uint8_t>(stream) != 0);
+        int32_t depthBias = readValue<int32_t>(stream);
+        float slopeScaledBias = readValue<float>(stream);
+        desc.setDepthBias(depthBias, slopeScaledBias);
+        desc.setDepthClamp(readValue<uint8_t>(stream) != 0);
+        desc.setLineAntiAliasing(readValue<uint8_t>(stream) != 0);
+        desc.setScissorTest(readValue<uint8_t>(stream) != 0);
+        desc.setConservativeRasterization(readValue<uint8_t>(stream) != 0);
+        desc.setForcedSampleCount(readValue<uint32_t>(stream));
+        return stream.isGood() ? RasterizerState::create(desc) : nullptr;
+    }
+
+    static DepthStencilState::SharedPtr readDepthStencilState(BinaryMemoryStream& stream)
+    {
+        DepthStencilState::Desc desc;
+        desc.setDepthTest(readValue<uint8_t>(stream) != 0);
+        desc.setDepthWriteMask(readValue<uint8_t>(stream) != 0);
+        desc.setDepthFunc((DepthStencilState::Func)readValue<uint32_t>(stream));
+        desc.setStencilTest(readValue<uint8_t>(stream) != 0);
+        desc.setStencilReadMask(readValue<uint8_t>(stream));
+        desc.setStencilWriteMask(readValue<uint8_t>(stream));
+        desc.setStencilRef(readValue<uint8_t>(stream));
+        for(DepthStencilState::Face face : { DepthStencilState::Face::Front, DepthStencilState::Face::Back })
+        {
+            DepthStencilState::Func func = (DepthStencilState::Func)readValue<uint32_t>(stream);
+            DepthStencilState::StencilOp stencilFail = (DepthStencilState::StencilOp)readValue<uint32_t>(stream);
+            DepthStencilState::StencilOp depthFail = (DepthStencilState::StencilOp)readValue<uint32_t>(stream);
+            DepthStencilState::StencilOp pass = (DepthStencilState::StencilOp)readValue<uint32_t>(stream);
+            desc.setStencilFunc(face, func);
+            desc.setStencilOp(face, stencilFail, depthFail, pass);
+        }
+        return stream.isGood() ? DepthStencilState::create(desc) : nullptr;
+    }
+
+    // Hash functions of the objects which are memoized by getObjectHash()
+    static uint64_t hashProgramVersion(const ProgramVersion* pVersion)
+    {
+        uint64_t h = kHashSeed;
+        for(uint32_t i = 0; i < (uint32_t)ShaderType::Count; i++)
+        {
+            const Shader* pShader = pVersion->getShader((ShaderType)i);
+            if(pShader == nullptr)
+            {
+                h = hashCombine(h, 0);
+                continue;
+            }
+#ifdef FALCOR_D3D
+            ID3DBlobPtr pBlob = pShader->getCodeBlob();
+            h = hashBytes(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), h);
+#else
+            // The bytecode isn't accessible, use the identity of the shader
+            h = hashCombine(h, (uint64_t)pShader);
+#endif
+        }
+        return h;
+    }
+
+    static void writeRootSignatureWithSamplers(DescriptorWriter& writer, const RootSignature* pRootSig)
+    {
+        writeRootSignature(writer, pRootSig);
+        if(pRootSig == nullptr)
+        {
+            return;
+        }
+
+        // Static samplers aren't serialized, but they are part of the root signature
+        writer.write((uint32_t)pRootSig->getStaticSamplersCount());
+        for(size_t i = 0; i < pRootSig->getStaticSamplersCount(); i++)
+        {
+            const RootSignature::SamplerDesc& samplerDesc = pRootSig->getStaticSamplerDesc(i);
+            writer.write(samplerDesc.regIndex);
+            writer.write(samplerDesc.regSpace);
+            writer.write((uint32_t)samplerDesc.visibility);
+            writer.write((uint32_t)samplerDesc.borderColor);
+
+            const Sampler* pSampler = samplerDesc.pSampler.get();
+            writer.write((uint32_t)pSampler->getMagFilter());
+            writer.write((uint32_t)pSampler->getMinFilter());
+            writer.write((uint32_t)pSampler->getMipFilter());
+            writer.write(pSampler->getMaxAnisotropy());
+            writer.write(pSampler->getMinLod());
+            writer.write(pSampler->getMaxLod());
+            writer.write(pSampler->getLodBias());
+            writer.write((uint32_t)pSampler->getComparisonMode());
+            writer.write((uint32_t)pSampler->getAddressModeU());
+            writer.write((uint32_t)pSampler->getAddressModeV());
+            writer.write((uint32_t)pSampler->getAddressModeW());
+            writer.write(pSampler->getBorderColor());
+        }
+    }
+
+    static uint64_t hashRootSignature(const RootSignature* pRootSig)
+    {
+        DescriptorWriter writer;
+        writeRootSignatureWithSamplers(writer, pRootSig);
+        return writer.getHash();
+    }
+
+    static uint64_t hashVertexLayout(const VertexLayout* pLayout)
+    {
+        DescriptorWriter writer;
+        writeVertexLayout(writer, pLayout);
+        return writer.getHash();
+    }
+
+    static uint64_t hashBlendState(const BlendState* pBlendState)
+    {
+        DescriptorWriter writer;
+        writeBlendState(writer, pBlendState);
+        return writer.getHash();
+    }
+
+    static uint64_t hashRasterizerState(const RasterizerState* pRastState)
+    {
+        DescriptorWriter writer;
+        writeRasterizerState(writer, pRastState);
+        return writer.getHash();
+    }
+
+    static uint64_t hashDepthStencilState(const DepthStencilState* pDsState)
+    {
+        DescriptorWriter writer;
+        writeDepthStencilState(writer, pDsState);
+        return writer.getHash();
+    }
+
+    // Content comparisons used to confirm a key match. Objects are usually shared between the states, so comparing the pointers is enough most of the time.
+    static bool isSameShader(const Shader* pFirst, const Shader* pSecond)
+    {
+        if(pFirst == pSecond)
+        {
+            return true;
+        }
+        if(pFirst == nullptr || pSecond == nullptr)
+        {
+            return false;
+        }
+#ifdef FALCOR_D3D
+        ID3DBlobPtr pFirstBlob = pFirst->getCodeBlob();
+        ID3DBlobPtr pSecondBlob = pSecond->getCodeBlob();
+        return pFirstBlob->GetBufferSize() == pSecondBlob->GetBufferSize() && memcmp(pFirstBlob->GetBufferPointer(), pSecondBlob->GetBufferPointer(), pFirstBlob->GetBufferSize()) == 0;
+#else
+        return false;
+#endif
+    }
+
+    static bool isSameProgramVersion(const ProgramVersion* pFirst, const ProgramVersion* pSecond)
+    {
+        if(pFirst == pSecond)
+        {
+            return true;
+        }
+        if(pFirst == nullptr || pSecond == nullptr)
+        {
+            return false;
+        }
+        for(uint32_t i = 0; i < (uint32_t)ShaderType::Count; i++)
+        {
+            if(isSameShader(pFirst->getShader((ShaderType)i), pSecond->getShader((ShaderType)i)) == false)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    static bool isSameObject(const T* pFirst, const T* pSecond, void(*writeFunc)(DescriptorWriter&, const T*))
+    {
+        if(pFirst == pSecond)
+        {
+            return true;
+        }
+        if(pFirst == nullptr || pSecond == nullptr)
+        {
+            return false;
+        }
+        DescriptorWriter first;
+        DescriptorWriter second;
+        writeFunc(first, pFirst);
+        writeFunc(second, pSecond);
+        return first.mData == second.mData;
+    }
+
+    static bool isSameFboDesc(const Fbo::Desc& first, const Fbo::Desc& second)
+    {
+        DescriptorWriter firstWriter;
+        DescriptorWriter secondWriter;
+        writeFboDesc(firstWriter, first);
+        writeFboDesc(secondWriter, second);
+        return firstWriter.mData == secondWriter.mData;
+    }
+
+    PipelineStateCache::UniquePtr PipelineStateCache::create(uint32_t capacity)
+    {
+        return UniquePtr(new PipelineStateCache(capacity));
+    }
+
+    PipelineStateCache& PipelineStateCache::getGlobalCache()
+    {
+        static PipelineStateCache sCache(kDefaultCapacity);
+        return sCache;
+    }
+
+    template<typename T, typename HashFunc>
+    uint64_t PipelineStateCache::getObjectHash(const std::shared_ptr<T>& pObject, HashFunc hashFunc)
+    {
+        if(pObject == nullptr)
+        {
+            return 0;
+        }
+
+        // A live object can't share its address with another object, so an entry which didn't expire belongs to this object
+        auto it = mObjectHashes.find(pObject.get());
+        if(it != mObjectHashes.end() && it->second.pObject.expired() == false)
+        {
+            return it->second.hash;
+        }
+
+        const uint64_t hash = hashFunc(pObject.get());
+        ObjectHash& entry = mObjectHashes[pObject.get()];
+        entry.pObject = pObject;
+        entry.hash = hash;
+
+        // Drop the entries of released objects once in a while
+        if(mObjectHashes.size() > mObjectHashPruneSize)
+        {
+            for(auto pruneIt = mObjectHashes.begin(); pruneIt != mObjectHashes.end();)
+            {
+                pruneIt = pruneIt->second.pObject.expired() ? mObjectHashes.erase(pruneIt) : std::next(pruneIt);
+            }
+            mObjectHashPruneSize = std::max<size_t>(256, mObjectHashes.size() * 2);
+        }
+        return hash;
+    }
+
+    void PipelineStateCache::initDefaultStates()
+    {
+        if(mpDefaultBlendState == nullptr)
+        {
+            mpDefaultBlendState = BlendState::create(BlendState::Desc());
+            mpDefaultRasterizerState = RasterizerState::create(RasterizerState::Desc());
+            mpDefaultDepthStencilState = DepthStencilState::create(DepthStencilState::Desc());
+        }
+    }
+
+    PipelineStateCache::Key PipelineStateCache::computeKey(const GraphicsStateObject::Desc& desc)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return computeKeyInternal(desc);
+    }
+
+    PipelineStateCache::Key PipelineStateCache::computeKeyInternal(const GraphicsStateObject::Desc& desc)
+    {
+        initDefaultStates();
+        uint64_t h = kHashSeed;
+        h = hashCombine(h, getObjectHash(desc.getProgramVersion(), hashProgramVersion));
+        h = hashCombine(h, getObjectHash(desc.getRootSignature(), hashRootSignature));
+        h = hashCombine(h, getObjectHash(desc.getVertexLayout(), hashVertexLayout));
+        h = hashCombine(h, getObjectHash(desc.getBlendState() ? desc.getBlendState() : mpDefaultBlendState, hashBlendState));
+        h = hashCombine(h, getObjectHash(desc.getRasterizerState() ? desc.getRasterizerState() : mpDefaultRasterizerState, hashRasterizerState));
+        h = hashCombine(h, getObjectHash(desc.getDepthStencilState() ? desc.getDepthStencilState() : mpDefaultDepthStencilState, hashDepthStencilState));
+
+        const Fbo::Desc& fboDesc = desc.getFboDesc();
+        for(uint32_t rt = 0; rt < Fbo::getMaxColorTargetCount(); rt++)
+        {
+            h = hashCombine(h, ((uint64_t)fboDesc.getColorTargetFormat(rt) << 1) | (uint64_t)fboDesc.isColorTargetUav(rt));
+        }
+        h = hashCombine(h, ((uint64_t)fboDesc.getDepthStencilFormat() << 1) | (uint64_t)fboDesc.isDepthStencilUav());
+        h = hashCombine(h, fboDesc.getSampleCount());
+
+        h = hashCombine(h, desc.getSampleMask());
+        h = hashCombine(h, (uint64_t)desc.getPrimitiveType());
+        h = hashCombine(h, (uint64_t)desc.getSinglePassStereoEnabled());
+        return h;
+    }
+
+    bool PipelineStateCache::isSameDesc(const GraphicsStateObject::Desc& first, const GraphicsStateObject::Desc& second) const
+    {
+        // Missing states are replaced with the defaults, like in computeKeyInternal()
+        const BlendState* pFirstBlend = first.getBlendState() ? first.getBlendState().get() : mpDefaultBlendState.get();
+        const BlendState* pSecondBlend = second.getBlendState() ? second.getBlendState().get() : mpDefaultBlendState.get();
+        const RasterizerState* pFirstRast = first.getRasterizerState() ? first.getRasterizerState().get() : mpDefaultRasterizerState.get();
+        const RasterizerState* pSecondRast = second.getRasterizerState() ? second.getRasterizerState().get() : mpDefaultRasterizerState.get();
+        const DepthStencilState* pFirstDs = first.getDepthStencilState() ? first.getDepthStencilState().get() : mpDefaultDepthStencilState.get();
+        const DepthStencilState* pSecondDs = second.getDepthStencilState() ? second.getDepthStencilState().get() : mpDefaultDepthStencilState.get();
+
+        return first.getSampleMask() == second.getSampleMask() &&
+            first.getPrimitiveType() == second.getPrimitiveType() &&
+            first.getSinglePassStereoEnabled() == second.getSinglePassStereoEnabled() &&
+            isSameFboDesc(first.getFboDesc(), second.getFboDesc()) &&
+            isSameProgramVersion(first.getProgramVersion().get(), second.getProgramVersion().get()) &&
+            isSameObject(first.getRootSignature().get(), second.getRootSignature().get(), writeRootSignatureWithSamplers) &&
+            isSameObject(first.getVertexLayout().get(), second.getVertexLayout().get(), writeVertexLayout) &&
+            isSameObject(pFirstBlend, pSecondBlend, writeBlendState) &&
+            isSameObject(pFirstRast, pSecondRast, writeRasterizerState) &&
+            isSameObject(pFirstDs, pSecondDs, writeDepthStencilState);
+    }
+
+    PipelineStateCache::EntryList::iterator PipelineStateCache::findEntry(Key key, const GraphicsStateObject::Desc& desc)
+    {
+        auto it = mEntryMap.find(key);
+        if(it == mEntryMap.end())
+        {
+            return mEntries.end();
+        }
+
+        // Different descriptors can have the same key, make sure the GSO was created from an equivalent one
+        if(isSameDesc(it->second->pGso->getDesc(), desc) == false)
+        {
+            mStats.collisions++;
+            return mEntries.end();
+        }
+        return it->second;
+    }
+
+    GraphicsStateObject::SharedPtr PipelineStateCache::getGso(const GraphicsStateObject::Desc& desc, const Program* pProgram)
+    {
+        Key key;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            key = computeKeyInternal(desc);
+            auto it = findEntry(key, desc);
+            if(it != mEntries.end())
+            {
+                mEntries.splice(mEntries.begin(), mEntries, it);
+                mStats.hits++;
+                return it->pGso;
+            }
+            mStats.misses++;
+        }
+
+        // Creating a GSO is slow, don't block other threads while doing it
+        GraphicsStateObject::SharedPtr pGso = GraphicsStateObject::create(desc);
+        if(pGso == nullptr)
+        {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(pProgram)
+        {
+            recordDescriptor(key, desc, pProgram);
+        }
+        return insert(key, pGso);
+    }
+
+    GraphicsStateObject::SharedPtr PipelineStateCache::insert(Key key, const GraphicsStateObject::SharedPtr& pGso)
+    {
+        // Another thread might have created the same GSO in the meantime. Keep the one which is already in use.
+        auto it = mEntryMap.find(key);
+        if(it != mEntryMap.end())
+        {
+            if(isSameDesc(it->second->pGso->getDesc(), pGso->getDesc()))
+            {
+                mEntries.splice(mEntries.begin(), mEntries, it->second);
+                return it->second->pGso;
+            }
+
+            // A different descriptor with the same key, the most recent one replaces it
+            mEntries.erase(it->second);
+            mEntryMap.erase(it);
+        }
+
+        mEntries.push_front({ key, pGso });
+        mEntryMap[key] = mEntries.begin();
+        evict();
+        return pGso;
+    }
+
+    void PipelineStateCache::evict()
+    {
+        while(mEntries.size() > mCapacity)
+        {
+            mEntryMap.erase(mEntries.back().key);
+            mEntries.pop_back();
+            mStats.evictions++;
+        }
+    }
+
+    void PipelineStateCache::recordDescriptor(Key key, const GraphicsStateObject::Desc& desc, const Program* pProgram)
+    {
+        if(mDescriptors.find(key) != mDescriptors.end())
+        {
+            return;
+        }
+
+        // Static samplers can't be recreated from the file
+        const RootSignature* pRootSig = desc.getRootSignature().get();
+        if(pRootSig && pRootSig->getStaticSamplersCount())
+        {
+            return;
+        }
+
+        DescriptorWriter writer;
+        writer.write(key);
+        writeProgram(writer, pProgram);
+        writeRootSignature(writer, pRootSig);
+        writeVertexLayout(writer, desc.getVertexLayout().get());
+        writeFboDesc(writer, desc.getFboDesc());
+        writeBlendState(writer, desc.getBlendState() ? desc.getBlendState().get() : mpDefaultBlendState.get());
+        writeRasterizerState(writer, desc.getRasterizerState() ? desc.getRasterizerState().get() : mpDefaultRasterizerState.get());
+        writeDepthStencilState(writer, desc.getDepthStencilState() ? desc.getDepthStencilState().get() : mpDefaultDepthStencilState.get());
+        writer.write(desc.getSampleMask());
+        writer.write((uint32_t)desc.getPrimitiveType());
+        writer.write((uint8_t)desc.getSinglePassStereoEnabled());
+        mDescriptors[key] = std::move(writer.mData);
+    }
+
+    void PipelineStateCache::setCapacity(uint32_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCapacity = capacity;
+        evict();
+    }
+
+    uint32_t PipelineStateCache::getSize() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return (uint32_t)mEntries.size();
+    }
+
+    void PipelineStateCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+        mEntryMap.clear();
+        mObjectHashes.clear();
+        mObjectHashPruneSize = 256;
+        mDescriptors.clear();
+        mpDefaultBlendState = nullptr;
+        mpDefaultRasterizerState = nullptr;
+        mpDefaultDepthStencilState = nullptr;
+    }
+
+    PipelineStateCache::Stats PipelineStateCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    void PipelineStateCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = Stats();
+    }
+
+    bool PipelineStateCache::saveDescriptors(const std::string& filename) const
+    {
+        std::vector<uint8_t> data;
+        DescriptorFileHeader header;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for(const auto& record : mDescriptors)
+            {
+                const uint32_t size = (uint32_t)record.second.size();
+                const uint8_t* pSize = (const uint8_t*)&size;
+                data.insert(data.end(), pSize, pSize + sizeof(size));
+                data.insert(data.end(), record.second.begin(), record.second.end());
+            }
+            header.recordCount = (uint32_t)mDescriptors.size();
+        }
+
+        memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        header.version = kFileVersion;
+        header.dataSize = data.size();
+        header.dataHash = hashBytes(data.data(), data.size(), kHashSeed);
+
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+        stream.write(&header, sizeof(header));
+        stream.write(data.data(), data.size());
+        if(stream.isGood() == false)
+        {
+            logWarning("Can't write the pipeline state descriptors to '" + filename + "'");
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t PipelineStateCache::prebuild(const std::string& filename)
+    {
+        if(doesFileExist(filename) == false)
+        {
+            logWarning("Pipeline state descriptor file '" + filename + "' doesn't exist");
+            return 0;
+        }
+
+        std::vector<uint8_t> data;
+        DescriptorFileHeader header;
+        bool valid = false;
+        {
+            BinaryFileStream stream(filename, BinaryFileStream::Mode::Read);
+            stream.read(&header, sizeof(header));
+            if(stream.isGood() && memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) == 0 && header.version == kFileVersion && header.dataSize == stream.getRemainingStreamSize())
+            {
+                data.resize((size_t)header.dataSize);
+                stream.read(data.data(), data.size());
+                valid = stream.isGood() && hashBytes(data.data(), data.size(), kHashSeed) == header.dataHash;
+            }
+        }
+
+        if(valid == false)
+        {
+            logWarning("Invalid pipeline state descriptor file '" + filename + "'");
+            return 0;
+        }
+
+        BinaryMemoryStream fileStream(data.data(), data.size());
+        uint32_t created = 0;
+        uint32_t skipped = 0;
+        for(uint32_t i = 0; i < header.recordCount; i++)
+        {
+            uint32_t size = readValue<uint32_t>(fileStream);
+            const uint8_t* pRecord = fileStream.getPointer(size);
+            if(pRecord == nullptr)
+            {
+                break;
+            }
+
+            BinaryMemoryStream stream(pRecord, size);
+            Key recordedKey = readValue<Key>(stream);
+
+            // The GSO only references the program version, the program itself can be released after the lookup
+            GraphicsProgram::SharedPtr pProgram = readProgram(stream);
+            ProgramVersion::SharedConstPtr pVersion = pProgram ? pProgram->getActiveVersion() : nullptr;
+            RootSignature::SharedPtr pRootSig;
+            VertexLayout::SharedPtr pLayout;
+            Fbo::Desc fboDesc;
+            bool ok = pVersion && readRootSignature(stream, pRootSig) && readVertexLayout(stream, pLayout) && readFboDesc(stream, fboDesc);
+
+            BlendState::SharedPtr pBlendState;
+            RasterizerState::SharedPtr pRastState;
+            DepthStencilState::SharedPtr pDsState;
+            if(ok)
+            {
+                size_t rtCount;
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    initDefaultStates();
+                    rtCount = mpDefaultBlendState->getRtCount();
+                }
+                pBlendState = readBlendState(stream, rtCount);
+                pRastState = readRasterizerState(stream);
+                pDsState = readDepthStencilState(stream);
+                ok = pBlendState && pRastState && pDsState;
+            }
+
+            uint32_t sampleMask = readValue<uint32_t>(stream);
+            GraphicsStateObject::PrimitiveType primType = (GraphicsStateObject::PrimitiveType)readValue<uint32_t>(stream);
+            bool sps = readValue<uint8_t>(stream) != 0;
+            if(ok == false || stream.isFail())
+            {
+                skipped++;
+                continue;
+            }
+
+            GraphicsStateObject::Desc desc;
+            desc.setProgramVersion(pVersion).setRootSignature(pRootSig).setVertexLayout(pLayout).setFboFormats(fboDesc);
+            desc.setBlendState(pBlendState).setRasterizerState(pRastState).setDepthStencilState(pDsState);
+            desc.setSampleMask(sampleMask).setPrimitiveType(primType).setSinglePassStereoEnable(sps);
+
+            // A different key means that something changed since the file was written, most likely a shader
+            const Key key = computeKey(desc);
+            if(key != recordedKey)
+            {
+                skipped++;
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if(findEntry(key, desc) != mEntries.end())
+                {
+                    continue;
+                }
+            }
+
+            GraphicsStateObject::SharedPtr pGso = GraphicsStateObject::create(desc);
+            if(pGso == nullptr)
+            {
+                skipped++;
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            insert(key, pGso);
+            mDescriptors[key] = std::vector<uint8_t>(pRecord, pRecord + size);
+            mStats.prebuilt++;
+            created++;
+        }
+
+        if(skipped)
+        {
+            logWarning("Skipped " + std::to_string(skipped) + " stale or invalid pipeline state descriptors in '" + filename + "'");
+        }
+        return created;
+    }
+}
@@ -0,0 +1,155 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "API/GraphicsStateObject.h"
+
+namespace Falcor
+{
+    class Program;
+
+    /** Cache of graphics state objects, shared by all the GraphicsState objects.
+        GSOs are looked up by a hash of the content of their descriptor - the program bytecode, the root signature layout, the render-target formats, the vertex layout, the blend, rasterizer and depth-stencil states, the sample mask and the primitive type.
+        A key match is confirmed by comparing the descriptor with the one the GSO was created from. The states are compared by pointer first and by content only when the pointers differ.
+        Equivalent states share a GSO, no matter which objects describe them or in which order they were set. The hash of every state object is computed once and remembered while the object is alive, so vertex layouts shouldn't be modified after they were used.
+        The cache holds a limited number of GSOs and evicts the least recently used one when it's full.
+        The descriptors of the created GSOs can be saved to a file. prebuild() creates the GSOs from that file, so an application can create its pipelines at startup instead of on first use.
+    */
+    class PipelineStateCache
+    {
+    public:
+        using UniquePtr = std::unique_ptr<PipelineStateCache>;
+        using Key = uint64_t;
+
+        static const uint32_t kDefaultCapacity = 1024;
+
+        struct Stats
+        {
+            uint64_t hits = 0;          ///< Lookups which found a GSO
+            uint64_t misses = 0;        ///< Lookups which created a GSO
+            uint64_t evictions = 0;     ///< GSOs evicted to stay within the capacity
+            uint64_t prebuilt = 0;      ///< GSOs created by prebuild()
+            uint64_t collisions = 0;    ///< Lookups which matched the key of a different descriptor
+        };
+
+        /** Create a new cache
+            \param[in] capacity Maximum number of GSOs the cache holds
+        */
+        static UniquePtr create(uint32_t capacity = kDefaultCapacity);
+
+        /** Get the cache used by GraphicsState
+        */
+        static PipelineStateCache& getGlobalCache();
+
+        /** Get the GSO for a descriptor. On a miss, the GSO is created and inserted into the cache.
+            \param[in] desc GSO descriptor
+            \param[in] pProgram The program the descriptor's program version was created from. Used to record the descriptor for saveDescriptors(), can be nullptr.
+            \return The GSO, or nullptr if it couldn't be created
+        */
+        GraphicsStateObject::SharedPtr getGso(const GraphicsStateObject::Desc& desc, const Program* pProgram = nullptr);
+
+        /** Compute the key of a descriptor. Missing blend, rasterizer and depth-stencil states hash like the default states, since GraphicsStateObject::create() uses those.
+        */
+        Key computeKey(const GraphicsStateObject::Desc& desc);
+
+        /** Set the maximum number of GSOs. Evicts GSOs if the cache holds more.
+        */
+        void setCapacity(uint32_t capacity);
+        uint32_t getCapacity() const { return mCapacity; }
+
+        /** Get the number of GSOs in the cache
+        */
+        uint32_t getSize() const;
+
+        /** Release all the GSOs and the recorded descriptors. GSOs which are still referenced elsewhere stay alive.
+        */
+        void clear();
+
+        /** Write the descriptors of the GSOs created through the cache to a file. Descriptors which were created without a program, or whose root signature has static samplers, aren't recorded.
+            \return false if the file can't be written
+        */
+        bool saveDescriptors(const std::string& filename) const;
+
+        /** Create the GSOs for the descriptors in a file written by saveDescriptors(). The programs are compiled, which is fast when the shader cache is warm.
+            Descriptors which no longer produce the same key, for example because a shader changed, are skipped.
+            \return The number of GSOs created
+        */
+        uint32_t prebuild(const std::string& filename);
+
+        /** Get the statistics since the cache was created or resetStats() was called
+        */
+        Stats getStats() const;
+        void resetStats();
+
+    private:
+        PipelineStateCache(uint32_t capacity) : mCapacity(capacity) {}
+
+        struct Entry
+        {
+            Key key;
+            GraphicsStateObject::SharedPtr pGso;
+        };
+        using EntryList = std::list<Entry>;
+
+        // The hash of a state object, valid as long as the object is alive
+        struct ObjectHash
+        {
+            std::weak_ptr<const void> pObject;
+            uint64_t hash;
+        };
+
+        template<typename T, typename HashFunc>
+        uint64_t getObjectHash(const std::shared_ptr<T>& pObject, HashFunc hashFunc);
+        void initDefaultStates();
+        Key computeKeyInternal(const GraphicsStateObject::Desc& desc);
+        bool isSameDesc(const GraphicsStateObject::Desc& first, const GraphicsStateObject::Desc& second) const;
+        EntryList::iterator findEntry(Key key, const GraphicsStateObject::Desc& desc);
+        GraphicsStateObject::SharedPtr insert(Key key, const GraphicsStateObject::SharedPtr& pGso);
+        void evict();
+        void recordDescriptor(Key key, const GraphicsStateObject::Desc& desc, const Program* pProgram);
+
+        uint32_t mCapacity;
+        EntryList mEntries;                                     // Most recently used first
+        std::unordered_map<Key, EntryList::iterator> mEntryMap;
+        std::unordered_map<const void*, ObjectHash> mObjectHashes;
+        size_t mObjectHashPruneSize = 256;
+        std::unordered_map<Key, std::vector<uint8_t>> mDescriptors;
+        Stats mStats;
+        mutable std::mutex mMutex;
+
+        // Used to hash missing states
+        BlendState::SharedPtr mpDefaultBlendState;
+        RasterizerState::SharedPtr mpDefaultRasterizerState;
+        DepthStencilState::SharedPtr mpDefaultDepthStencilState;
+    };
+}
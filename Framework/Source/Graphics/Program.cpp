@@ -39,11 +39,127 @@
 #include "Utils/ShaderUtils.h"
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include "Utils/ThreadPool.h"
 
 namespace Falcor
 {
     std::vector<Program*> Program::sPrograms;
 
+    // Process-wide table of interned strings
+    class DefineStringTable
+    {
+    public:
+        uint32_t getId(const std::string& str)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto& it = mIds.find(str);
+            if(it != mIds.end())
+            {
+                return it->second;
+            }
+
+            uint32_t id = (uint32_t)mStrings.size();
+            const auto& inserted = mIds.emplace(str, id).first;
+            mStrings.push_back(&inserted->first);
+            return id;
+        }
+
+        std::string getString(uint32_t id)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return *mStrings[id];
+        }
+
+    private:
+        std::mutex mMutex;
+        std::unordered_map<std::string, uint32_t> mIds;
+        std::vector<const std::string*> mStrings;   // Points to the keys of mIds, which don't move
+    };
+
+    static DefineStringTable& getDefineNameTable()
+    {
+        static DefineStringTable sTable;
+        return sTable;
+    }
+
+    static DefineStringTable& getDefineValueTable()
+    {
+        static DefineStringTable sTable;
+        return sTable;
+    }
+
+    static size_t hashDefine(const Program::DefineSet::Define& define)
+    {
+        // SplitMix64 finalizer
+        uint64_t h = ((uint64_t)define.nameId << 32) | define.valueId;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return (size_t)(h ^ (h >> 31));
+    }
+
+    Program::DefineSet::Define Program::DefineSet::intern(const std::string& name, const std::string& value)
+    {
+        Define define;
+        define.nameId = getDefineNameTable().getId(name);
+        define.valueId = getDefineValueTable().getId(value);
+        return define;
+    }
+
+    Program::DefineSet::DefineSet(const DefineList& defineList)
+    {
+        for(const auto& define : defineList)
+        {
+            add(intern(define.first, define.second));
+        }
+    }
+
+    bool Program::DefineSet::add(const Define& define)
+    {
+        auto it = std::lower_bound(mDefines.begin(), mDefines.end(), define, [](const Define& a, const Define& b) { return a.nameId < b.nameId; });
+        if(it != mDefines.end() && it->nameId == define.nameId)
+        {
+            if(it->valueId == define.valueId)
+            {
+                return false;
+            }
+            mHash -= hashDefine(*it);
+            *it = define;
+        }
+        else
+        {
+            mDefines.insert(it, define);
+        }
+        mHash += hashDefine(define);
+        return true;
+    }
+
+    bool Program::DefineSet::remove(const Define& define)
+    {
+        auto it = std::lower_bound(mDefines.begin(), mDefines.end(), define, [](const Define& a, const Define& b) { return a.nameId < b.nameId; });
+        if(it == mDefines.end() || it->nameId != define.nameId)
+        {
+            return false;
+        }
+        mHash -= hashDefine(*it);
+        mDefines.erase(it);
+        return true;
+    }
+
+    Program::DefineList Program::DefineSet::getDefineList() const
+    {
+        DefineList defineList;
+        for(const auto& define : mDefines)
+        {
+            defineList.add(getDefineNameTable().getString(define.nameId), getDefineValueTable().getString(define.valueId));
+        }
+        return defineList;
+    }
+
     Program::Program()
     {
         sPrograms.push_back(this);
@@ -84,183 +200,308 @@ namespace Falcor
         mShaderStrings[(uint32_t)ShaderType::Hull] = HS;
         mShaderStrings[(uint32_t)ShaderType::Domain] = DS;
         mCreatedFromFile = createdFromFile;
-        mDefineList = programDefines;
+        replaceAllDefines(programDefines);
     }
 
     void Program::init(const std::string& cs, const DefineList& programDefines, bool createdFromFile)
     {
         mShaderStrings[(uint32_t)ShaderType::Compute] = cs;
         mCreatedFromFile = createdFromFile;
-        mDefineList = programDefines;
+        replaceAllDefines(programDefines);
     }
 
     void Program::addDefine(const std::string& name, const std::string& value)
     {
-        // Make sure that it doesn't exist already
-        if(mDefineList.find(name) != mDefineList.end())
+        addDefine(DefineSet::intern(name, value));
+    }
+
+    void Program::addDefine(const DefineSet::Define& define)
+    {
+        if(mDefineSet.add(define))
         {
-            if(mDefineList[name] == value)
-            {
-                // Same define
-                return;
-            }
+            mLinkRequired = true;
+            mDefineListDirty = true;
         }
-        mLinkRequired = true;
-        mDefineList[name] = value;
     }
 
     void Program::removeDefine(const std::string& name)
     {
-        if(mDefineList.find(name) != mDefineList.end())
+        removeDefine(DefineSet::intern(name));
+    }
+
+    void Program::removeDefine(const DefineSet::Define& define)
+    {
+        if(mDefineSet.remove(define))
         {
             mLinkRequired = true;
-            mDefineList.erase(name);
+            mDefineListDirty = true;
         }
     }
 
-    bool Program::checkIfFilesChanged()
+    void Program::clearDefines()
+    {
+        mDefineSet.clear();
+        mLinkRequired = true;
+        mDefineListDirty = true;
+    }
+
+    void Program::replaceAllDefines(const DefineList& dl)
     {
-        if(mpActiveProgram == nullptr)
+        mDefineSet = DefineSet(dl);
+        mLinkRequired = true;
+        mDefineListDirty = true;
+    }
+
+    const Program::DefineList& Program::getActiveDefinesList() const
+    {
+        if(mDefineListDirty)
         {
-            // We never linked, so nothing really changed
-            return false;
+            mDefineList = mDefineSet.getDefineList();
+            mDefineListDirty = false;
         }
+        return mDefineList;
+    }
 
-        for(uint32_t i = 0; i < arraysize(mShaderStrings); i++)
+    struct Program::VersionTask
+    {
+        std::atomic<bool> started{ false };
+        std::atomic<bool> ready{ false };   // Set once the fields below are written
+        ProgramVersion::SharedConstPtr pVersion;
+        std::string log;
+        string_time_map fileTimes;          // The shader files and their includes, with their modification times
+        bool errorReported = false;         // Only accessed from the thread which owns the program
+
+        std::function<void()> compile;
+        std::mutex mutex;
+        std::condition_variable readyCondition;
+
+        // Compile on the calling thread, unless another thread already started
+        void run()
         {
-            const Shader* pShader = mpActiveProgram->getShader(ShaderType(i));
-            if(pShader)
+            if(started.exchange(true) == false)
             {
-                if(mCreatedFromFile)
+                compile();
                 {
-                    std::string fullpath;
-                    findFileInDataDirectories(mShaderStrings[i], fullpath);
-                    if(mFileTimeMap[fullpath] != getFileModifiedTime(fullpath))
-                    {
-                        return true;
-                    }
-                }
-
-                // Loop over the shader's included files
-                for(const auto& include : pShader->getIncludeList())
-                {
-                    if(mFileTimeMap[include] != getFileModifiedTime(include))
-                    {
-                        return true;
-                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ready.store(true, std::memory_order_release);
                 }
+                readyCondition.notify_all();
             }
         }
-        return false;
-    }
 
-    ProgramVersion::SharedConstPtr Program::getActiveVersion() const
+        // A task which is still queued is compiled right away, instead of waiting for the jobs ahead of it
+        void wait()
+        {
+            run();
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCondition.wait(lock, [this]() { return ready.load(std::memory_order_acquire); });
+        }
+    };
+
+    bool Program::checkIfFilesChanged()
     {
-        if(mLinkRequired)
+        for(const auto& version : mProgramVersions)
         {
-            const auto& it = mProgramVersions.find(mDefineList);
-            ProgramVersion::SharedConstPtr pVersion = nullptr;
-            if(it == mProgramVersions.end())
+            const VersionTask& task = *version.second;
+            if(task.ready.load(std::memory_order_acquire) == false)
             {
-                if(link() == false)
-                {
-                    return false;
-                }
-                else
-                {
-                    mProgramVersions[mDefineList] = mpActiveProgram;
-                }
+                // Still compiling
+                continue;
             }
-            else
+
+            if(task.pVersion == nullptr)
             {
-                mpActiveProgram = mProgramVersions[mDefineList];
+                // Versions which failed to compile are always rebuilt
+                return true;
             }
-        }
 
-        return mpActiveProgram;
+            for(const auto& file : task.fileTimes)
+            {
+                if(file.second != getFileModifiedTime(file.first))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
     }
 
-    bool Program::link() const
+    Program::VersionTaskPtr Program::startCompilation(const DefineSet& defineSet, bool async) const
     {
-        mFileTimeMap.clear();
+        VersionTaskPtr pTask = std::make_shared<VersionTask>();
+        mProgramVersions[defineSet] = pTask;
 
-        while(1)
+        // The task works on copies, so that the program can be modified or destroyed while it runs
+        const DefineList defines = defineSet.getDefineList();
+        const std::vector<std::string> shaderStrings(mShaderStrings, mShaderStrings + kShaderCount);
+        const bool createdFromFile = mCreatedFromFile;
+        const std::string desc = getProgramDescString();
+
+        // The function is owned by the task, so it holds a plain pointer to avoid a reference cycle
+        pTask->compile = [pTask = pTask.get(), defines, shaderStrings, createdFromFile, desc]()
         {
             Shader::SharedPtr pShaders[kShaderCount];
+            std::string logs[kShaderCount];
 
-            // create the shaders
-            for(uint32_t i = 0; i < kShaderCount; i++)
+            // Compile the stages in parallel. Compilation never runs on the global pool, so it can't stall the frame-critical loops.
+            ThreadPool::getBackgroundPool().parallelFor(kShaderCount, 1, [&](uint32_t begin, uint32_t end)
             {
-                if(mShaderStrings[i].size())
+                for(uint32_t i = begin; i < end; i++)
                 {
-                    if(mCreatedFromFile)
+                    if(shaderStrings[i].size())
                     {
-                        pShaders[i] = createShaderFromFile(mShaderStrings[i], ShaderType(i), mDefineList);
-                        if(pShaders[i])
-                        {
-                            std::string fullpath;
-                            findFileInDataDirectories(mShaderStrings[i], fullpath);
-                            mFileTimeMap[fullpath] = getFileModifiedTime(fullpath);
-                        }
+                        pShaders[i] = createdFromFile ? compileShaderFromFile(shaderStrings[i], ShaderType(i), defines, logs[i]) : compileShaderFromString(shaderStrings[i], ShaderType(i), defines, logs[i]);
                     }
-                    else
+                }
+            });
+
+            for(uint32_t i = 0; i < kShaderCount; i++)
+            {
+                if(createdFromFile && shaderStrings[i].size())
+                {
+                    std::string fullpath;
+                    if(findFileInDataDirectories(shaderStrings[i], fullpath))
                     {
-                        pShaders[i] = createShaderFromString(mShaderStrings[i], ShaderType(i), mDefineList);
+                        pTask->fileTimes[fullpath] = getFileModifiedTime(fullpath);
                     }
+                }
 
-                    if(pShaders[i])
+                if(pShaders[i])
+                {
+                    for(const auto& include : pShaders[i]->getIncludeList())
                     {
-                        for(const auto& include : pShaders[i]->getIncludeList())
-                        {
-                            mFileTimeMap[include] = getFileModifiedTime(include);
-                        }
+                        pTask->fileTimes[include] = getFileModifiedTime(include);
                     }
                 }
+                pTask->log += logs[i];
             }
 
             // create the program
-            std::string log;
-            ProgramVersion::SharedConstPtr pProgram;
-            if (pShaders[(uint32_t)ShaderType::Compute])
+            if(pTask->log.empty())
             {
-                pProgram = ProgramVersion::create(pShaders[(uint32_t)ShaderType::Compute], log, getProgramDescString());
+                if(pShaders[(uint32_t)ShaderType::Compute])
+                {
+                    pTask->pVersion = ProgramVersion::create(pShaders[(uint32_t)ShaderType::Compute], pTask->log, desc);
+                }
+                else
+                {
+                    pTask->pVersion = ProgramVersion::create(pShaders[(uint32_t)ShaderType::Vertex],
+                        pShaders[(uint32_t)ShaderType::Pixel],
+                        pShaders[(uint32_t)ShaderType::Geometry],
+                        pShaders[(uint32_t)ShaderType::Hull],
+                        pShaders[(uint32_t)ShaderType::Domain],
+                        pTask->log,
+                        desc);
+                }
             }
-            else
+        };
+
+        if(async)
+        {
+            ThreadPool::getBackgroundPool().submit([pTask]() { pTask->run(); });
+        }
+        else
+        {
+            pTask->run();
+        }
+        return pTask;
+    }
+
+    ProgramVersion::SharedConstPtr Program::getActiveVersion() const
+    {
+        while(mLinkRequired)
+        {
+            const auto& it = mProgramVersions.find(mDefineSet);
+            VersionTaskPtr pTask = (it == mProgramVersions.end()) ? startCompilation(mDefineSet, false) : it->second;
+            pTask->wait();
+
+            if(pTask->pVersion)
             {
-                pProgram = ProgramVersion::create(pShaders[(uint32_t)ShaderType::Vertex],
-                    pShaders[(uint32_t)ShaderType::Pixel],
-                    pShaders[(uint32_t)ShaderType::Geometry],
-                    pShaders[(uint32_t)ShaderType::Hull],
-                    pShaders[(uint32_t)ShaderType::Domain],
-                    log,
-                    getProgramDescString());
+                mpActiveProgram = pTask->pVersion;
+                mLinkRequired = false;
             }
-
-            if(pProgram == nullptr)
+            else
             {
                 std::string error = std::string("Program Linkage failed.\n\n");
                 error += getProgramDescString() + "\n";
-                error += log;
+                error += pTask->log;
 
+                // Compile again on retry, or on the next call
+                mProgramVersions.erase(mDefineSet);
                 if(msgBox(error, MsgBoxType::RetryCancel) == MsgBoxButton::Cancel)
                 {
                     logError(error);
-                    return false;
+                    return nullptr;
                 }
             }
-            else
+        }
+
+        return mpActiveProgram;
+    }
+
+    ProgramVersion::SharedConstPtr Program::getActiveVersionAsync(AsyncFallback fallback) const
+    {
+        if(mLinkRequired == false || fallback == AsyncFallback::Wait)
+        {
+            return getActiveVersion();
+        }
+
+        const auto& it = mProgramVersions.find(mDefineSet);
+        VersionTaskPtr pTask = (it == mProgramVersions.end()) ? startCompilation(mDefineSet, true) : it->second;
+        if(pTask->ready.load(std::memory_order_acquire))
+        {
+            if(pTask->pVersion)
             {
-                mpActiveProgram = pProgram;
-                return true;
+                mpActiveProgram = pTask->pVersion;
+                mLinkRequired = false;
+                return mpActiveProgram;
+            }
+            else if(pTask->errorReported == false)
+            {
+                logError(std::string("Program Linkage failed.\n\n") + getProgramDescString() + "\n" + pTask->log);
+                pTask->errorReported = true;
             }
         }
+
+        // Never blocks. Until the first version is compiled there is nothing to fall back to.
+        return (fallback == AsyncFallback::PreviousVersion) ? mpActiveProgram : nullptr;
+    }
+
+    bool Program::isActiveVersionReady() const
+    {
+        if(mLinkRequired == false)
+        {
+            return mpActiveProgram != nullptr;
+        }
+
+        const auto& it = mProgramVersions.find(mDefineSet);
+        return (it != mProgramVersions.end()) && it->second->ready.load(std::memory_order_acquire) && it->second->pVersion;
+    }
+
+    void Program::precompile(const std::vector<DefineList>& defineLists) const
+    {
+        for(const auto& defineList : defineLists)
+        {
+            DefineSet defineSet(defineList);
+            if(mProgramVersions.find(defineSet) == mProgramVersions.end())
+            {
+                startCompilation(defineSet, true);
+            }
+        }
+    }
+
+    void Program::waitForCompilation() const
+    {
+        for(const auto& version : mProgramVersions)
+        {
+            version.second->wait();
+        }
     }
 
     void Program::reset()
     {
-        mpActiveProgram = nullptr;
+        // The active version is kept, so that it can be used while the new versions are compiled
         mProgramVersions.clear();
-        mFileTimeMap.clear();
         mLinkRequired = true;
     }
 
@@ -270,7 +511,14 @@ namespace Falcor
         {
             if(pProgram->checkIfFilesChanged())
             {
+                // Recompile all the versions which were used, in parallel
+                std::vector<DefineList> defineLists;
+                for(const auto& version : pProgram->mProgramVersions)
+                {
+                    defineLists.push_back(version.first.getDefineList());
+                }
                 pProgram->reset();
+                pProgram->precompile(defineLists);
             }
         }
     }
@@ -28,6 +28,7 @@
 #pragma once
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "API/ProgramVersion.h"
 
@@ -52,12 +53,88 @@ namespace Falcor
             void remove(const std::string& name) {(*this).erase(name); }
         };
 
+        /** Compact form of a define list, used to look up program versions.
+            Define names and values are interned into process-wide IDs, so adding, removing, comparing and hashing sets doesn't touch strings. The hash is updated incrementally.
+        */
+        class DefineSet
+        {
+        public:
+            /** An interned define
+            */
+            struct Define
+            {
+                uint32_t nameId = 0;
+                uint32_t valueId = 0;
+                bool operator==(const Define& other) const { return nameId == other.nameId && valueId == other.valueId; }
+            };
+
+            /** Intern a define. Interning is thread-safe. Store the result to avoid the string lookups when toggling defines frequently.
+            */
+            static Define intern(const std::string& name, const std::string& value = "");
+
+            DefineSet() = default;
+            explicit DefineSet(const DefineList& defineList);
+
+            /** Add a define, or replace the value of a define with the same name
+                \return true if the set changed
+            */
+            bool add(const Define& define);
+
+            /** Remove the define with the same name as 'define'. The value is ignored.
+                \return true if the set changed
+            */
+            bool remove(const Define& define);
+
+            void clear() { mDefines.clear(); mHash = 0; }
+            size_t getHash() const { return mHash; }
+            bool operator==(const DefineSet& other) const { return mHash == other.mHash && mDefines == other.mDefines; }
+
+            /** Convert the set back to strings
+            */
+            DefineList getDefineList() const;
+
+            struct Hasher
+            {
+                size_t operator()(const DefineSet& set) const { return set.getHash(); }
+            };
+        private:
+            std::vector<Define> mDefines;   // Sorted by name ID
+            size_t mHash = 0;               // Sum of the hashes of the defines, so that it doesn't depend on the order
+        };
+
+        /** What getActiveVersionAsync() returns while the version for the current defines is being compiled
+        */
+        enum class AsyncFallback
+        {
+            Wait,               ///< Block until the version is ready
+            PreviousVersion,    ///< Return the previously active version, or nullptr if there is none. Never blocks.
+            None,               ///< Return nullptr. The caller should skip the work which requires the program.
+        };
+
         virtual ~Program() = 0;
 
-        /** Get the API handle of the active program
+        /** Get the API handle of the active program. If the version for the current defines isn't compiled, the call blocks until it is. The shader stages are compiled in parallel.
         */
         ProgramVersion::SharedConstPtr getActiveVersion() const;
 
+        /** Get the version for the current defines without compiling on the calling thread. Missing versions are compiled on the background thread pool.
+            Versions which fail to compile are logged, and treated as not ready.
+            \param[in] fallback What to return if the version isn't ready
+        */
+        ProgramVersion::SharedConstPtr getActiveVersionAsync(AsyncFallback fallback = AsyncFallback::PreviousVersion) const;
+
+        /** Check if the version for the current defines is compiled and can be returned without blocking
+        */
+        bool isActiveVersionReady() const;
+
+        /** Compile versions for a list of define sets on the background thread pool. The call returns immediately. Versions which were already compiled or requested are skipped.
+        */
+        void precompile(const std::vector<DefineList>& defineLists) const;
+
+        /** Block until all the versions requested by precompile() or getActiveVersionAsync() are compiled
+        */
+        void waitForCompilation() const;
+
         /** Adds a macro definition to the program. If the macro already exists, its will be replaced.
 
             \param[in] name The name of define. Must be valid
@@ -65,26 +142,42 @@ namespace Falcor
         */
         void addDefine(const std::string& name, const std::string& value = "");
 
+        /** Adds an interned macro definition to the program. This doesn't allocate memory, and should be used for defines which change per draw.
+        */
+        void addDefine(const DefineSet::Define& define);
+
         /** Remove a macro definition from the program. If the definition doesn't exist, the function call will be silently ignored.
             \param[in] name The name of define. Must be valid
         */
         void removeDefine(const std::string& name);
 
+        /** Remove an interned macro definition from the program. The define's value is ignored.
+        */
+        void removeDefine(const DefineSet::Define& define);
+
         /** Clear the macro definition list
         */
-        void clearDefines() { mDefineList.clear(); }
+        void clearDefines();
     
         /** Get the macro definition string of the active program version
         */
-        const DefineList& getActiveDefinesList() const { return mDefineList; }
+        const DefineList& getActiveDefinesList() const;
+
+        /** Check if the shader strings are file names or source code
+        */
+        bool isCreatedFromFile() const { return mCreatedFromFile; }
 
-        /** Reload and relink all programs.
+        /** Get the file name or the source code of a shader stage, depending on isCreatedFromFile(). Returns an empty string if the stage is unused.
+        */
+        const std::string& getShaderString(ShaderType type) const { return mShaderStrings[(uint32_t)type]; }
+
+        /** Reload and relink all programs. All the versions of programs whose files changed are recompiled in parallel.
         */
         static void reloadAllPrograms();
 
         /** update define list
         */
-        void replaceAllDefines(const DefineList& dl) { mDefineList = dl; }
+        void replaceAllDefines(const DefineList& dl);
     protected:
         static const uint32_t kShaderCount = (uint32_t)ShaderType::Count;
 
@@ -92,14 +185,19 @@ namespace Falcor
         void init(const std::string& vs, const std::string& fs, const std::string& gs, const std::string& hs, const std::string& ds, const DefineList& programDefines, bool createdFromFile);
         void init(const std::string& cs, const DefineList& programDefines, bool createdFromFile);
 
-        bool link() const;
         std::string mShaderStrings[kShaderCount]; // Either a filename or a string, depending on the value of mCreatedFromFile
 
-        DefineList mDefineList;
+        DefineSet mDefineSet;
+        mutable DefineList mDefineList;     // Created from mDefineSet when needed
+        mutable bool mDefineListDirty = false;
+
+        // A version which is compiled, or being compiled, on the thread pool. Defined in Program.cpp.
+        struct VersionTask;
+        using VersionTaskPtr = std::shared_ptr<VersionTask>;
 
         // We are doing lazy compilation, so these are mutable
         mutable bool mLinkRequired = true;
-        mutable std::map<const DefineList, ProgramVersion::SharedConstPtr> mProgramVersions;
+        mutable std::unordered_map<DefineSet, VersionTaskPtr, DefineSet::Hasher> mProgramVersions;
         mutable ProgramVersion::SharedConstPtr mpActiveProgram = nullptr;
 
         std::string getProgramDescString() const;
@@ -107,8 +205,8 @@ namespace Falcor
 
         bool mCreatedFromFile = false;
         using string_time_map = std::unordered_map<std::string, time_t>;
-        mutable string_time_map mFileTimeMap;
 
+        VersionTaskPtr startCompilation(const DefineSet& defineSet, bool async) const;
         bool checkIfFilesChanged();
         void reset();
     };
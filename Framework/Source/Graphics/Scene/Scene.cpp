@@ -51,6 +51,9 @@ namespace Falcor
 
     Scene::Scene() : mId(sSceneCounter++)
     {
+        mpInstanceTable = SceneInstanceTable::create();
+        mpInstanceBvh = Bvh::create();
+
         // Reset all global id counters recursively
         Model::resetGlobalIdCounter();
         Light::resetGlobalIdCounter();
@@ -137,11 +140,13 @@ namespace Falcor
 
         // Delete entire vector of instances
         mModels.erase(mModels.begin() + modelID);
+        mInstanceTableDirty = true;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
+        mInstanceTableDirty = true;
     }
 
     uint32_t Scene::getModelInstanceCount(uint32_t modelID) const
@@ -171,10 +176,13 @@ namespace Falcor
         }
 
         mModels[modelID].push_back(ModelInstance::create(pModel, translation, rotation, scaling, instanceName));
+        mInstanceTableDirty = true;
     }
 
     void Scene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
+        mInstanceTableDirty = true;
+
         // Checking for existing instance list for model
         for (uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
         {
@@ -197,6 +205,7 @@ namespace Falcor
         auto& instances = mModels[modelID];
 
         instances.erase(instances.begin() + instanceID);
+        mInstanceTableDirty = true;
 
         // If no instances are left, delete the vector
         if (instances.empty())
@@ -205,6 +214,40 @@ namespace Falcor
         }
     }
 
+    const SceneInstanceTable& Scene::getInstanceTable(ThreadPool* pThreadPool)
+    {
+        if (mInstanceTableDirty)
+        {
+            mpInstanceTable->rebuild(this);
+            mInstanceTableDirty = false;
+            mInstanceBvhDirty = true;
+        }
+
+        mpInstanceTable->update(this, pThreadPool);
+        mInstanceBvhRefitNeeded = mInstanceBvhRefitNeeded || (mpInstanceTable->getUpdatedEntryCount() > 0);
+        return *mpInstanceTable;
+    }
+
+    const Bvh& Scene::getInstanceBvh(bool updateTable)
+    {
+        const SceneInstanceTable& table = (updateTable || mInstanceTableDirty) ? getInstanceTable() : *mpInstanceTable;
+
+        if (mInstanceBvhDirty)
+        {
+            mpInstanceBvh->build(table.getWorldBoundingBoxes());
+            mInstanceBvhDirty = false;
+            mInstanceBvhRefitNeeded = false;
+        }
+        else if (mInstanceBvhRefitNeeded)
+        {
+            // Instances were moved by paths or the editor, keep the topology and update the bounds
+            mpInstanceBvh->refit(table.getWorldBoundingBoxes());
+            mInstanceBvhRefitNeeded = false;
+        }
+
+        return *mpInstanceBvh;
+    }
+
     const Scene::UserVariable& Scene::getUserVariable(const std::string& name)
     {
         const auto& a = mUserVars.find(name);
@@ -307,6 +350,7 @@ namespace Falcor
 #define merge(name_) name_.insert(name_.end(), pFrom->name_.begin(), pFrom->name_.end());
 
         merge(mModels);
+        mInstanceTableDirty = true;
         merge(mpLights);
         merge(mpPaths);
         merge(mpMaterials);
@@ -37,6 +37,8 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Material/MaterialHistory.h"
+#include "Graphics/Scene/SceneInstanceTable.h"
+#include "Utils/Math/Bvh.h"
 
 namespace Falcor
 {
@@ -121,6 +123,21 @@ namespace Falcor
         const ModelInstance::SharedPtr& getModelInstance(uint32_t modelID, uint32_t instanceID) const { return mModels[modelID][instanceID]; };
         void deleteModelInstance(uint32_t modelID, uint32_t instanceID);
 
+        /** Get the packed instance table of the scene. The table layout is rebuilt if models or instances were added or removed since the last call, and the world transforms of instances which were moved are refreshed.
+            \param[in] pThreadPool Optional thread pool used to refresh the world transforms in parallel
+        */
+        const SceneInstanceTable& getInstanceTable(ThreadPool* pThreadPool = nullptr);
+
+        /** Get a bounding volume hierarchy over the world-space bounding boxes of the instance table entries. Primitive IDs are instance table entry indices.
+            The hierarchy is rebuilt when the instance table layout changes, and refitted when instances were moved.
+            \param[in] updateTable Whether to update the instance table first. Pass false if getInstanceTable() was already called this frame, so the table isn't updated twice.
+        */
+        const Bvh& getInstanceBvh(bool updateTable = true);
+
+        /** Force a rebuild of the instance table. Call this if the meshes or mesh instances of a model were changed after it was added to the scene.
+        */
+        void invalidateInstanceTable() { mInstanceTableDirty = true; }
+
         // Light sources
         uint32_t addLight(const Light::SharedPtr& pLight);
         void deleteLight(uint32_t lightID);
@@ -208,6 +225,13 @@ namespace Falcor
         std::vector<Camera::SharedPtr> mCameras;
         std::vector<ObjectPath::SharedPtr> mpPaths;
 
+        SceneInstanceTable::UniquePtr mpInstanceTable;
+        bool mInstanceTableDirty = true;
+
+        Bvh::UniquePtr mpInstanceBvh;
+        bool mInstanceBvhDirty = true;
+        bool mInstanceBvhRefitNeeded = false;
+
         MaterialHistory::SharedPtr mpMaterialHistory;
 
         glm::vec3 mAmbientIntensity;
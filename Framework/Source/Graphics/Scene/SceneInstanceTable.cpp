@@ -0,0 +1,257 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneInstanceTable.h"
+#include "Scene.h"
+#include "Utils/ThreadPool.h"
+#include <atomic>
+
+namespace Falcor
+{
+    SceneInstanceTable::UniquePtr SceneInstanceTable::create()
+    {
+        return UniquePtr(new SceneInstanceTable());
+    }
+
+    void SceneInstanceTable::resize(uint32_t entryCount)
+    {
+        mWorldMatrices.resize(entryCount);
+        mVisible.resize(entryCount);
+        mMeshInstanceIDs.resize(entryCount);
+        mMeshRangeIDs.resize(entryCount);
+        mMeshIDs.resize(entryCount);
+        mMaterialIDs.resize(entryCount);
+
+        mWorldBoxes.centerX.resize(entryCount);
+        mWorldBoxes.centerY.resize(entryCount);
+        mWorldBoxes.centerZ.resize(entryCount);
+        mWorldBoxes.extentX.resize(entryCount);
+        mWorldBoxes.extentY.resize(entryCount);
+        mWorldBoxes.extentZ.resize(entryCount);
+    }
+
+    void SceneInstanceTable::rebuild(const Scene* pScene)
+    {
+        mModelInstanceRanges.clear();
+        mMeshRanges.clear();
+        mMeshInstances.matrices.clear();
+        mMeshInstances.boxes.clear();
+        mMeshInstances.versions.clear();
+        mMeshInstances.visible.clear();
+        mModelChanged.assign(pScene->getModelCount(), 0);
+
+        // Count the entries first so that the arrays are allocated once
+        uint32_t entryCount = 0;
+        std::vector<uint32_t> firstMeshInstances(pScene->getModelCount());
+        uint32_t totalMeshInstanceCount = 0;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            uint32_t meshInstanceCount = 0;
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                meshInstanceCount += pModel->getMeshInstanceCount(meshID);
+            }
+            entryCount += meshInstanceCount * pScene->getModelInstanceCount(modelID);
+            firstMeshInstances[modelID] = totalMeshInstanceCount;
+            totalMeshInstanceCount += meshInstanceCount;
+        }
+        resize(entryCount);
+        mMeshInstances.matrices.reserve(totalMeshInstanceCount);
+        mMeshInstances.boxes.reserve(totalMeshInstanceCount);
+        mMeshInstances.versions.reserve(totalMeshInstanceCount);
+        mMeshInstances.visible.reserve(totalMeshInstanceCount);
+
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                {
+                    const auto& pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID);
+                    mMeshInstances.matrices.push_back(pMeshInstance->getTransformMatrix());
+                    mMeshInstances.boxes.push_back(pMeshInstance->getBoundingBox());
+                    mMeshInstances.versions.push_back(pMeshInstance->getTransformVersion());
+                    mMeshInstances.visible.push_back(pMeshInstance->isVisible() ? 1 : 0);
+                }
+            }
+        }
+
+        uint32_t entry = 0;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                ModelInstanceRange modelRange;
+                modelRange.modelID = modelID;
+                modelRange.instanceID = instanceID;
+                modelRange.firstMeshRange = (uint32_t)mMeshRanges.size();
+                modelRange.meshRangeCount = pModel->getMeshCount();
+                modelRange.visible = pScene->getModelInstance(modelID, instanceID)->isVisible();
+                modelRange.transformVersion = kInvalidVersion;
+                mModelInstanceRanges.push_back(modelRange);
+
+                uint32_t meshInstance = firstMeshInstances[modelID];
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    const Mesh* pMesh = pModel->getMesh(meshID).get();
+
+                    MeshRange meshRange;
+                    meshRange.meshID = meshID;
+                    meshRange.firstEntry = entry;
+                    meshRange.entryCount = pModel->getMeshInstanceCount(meshID);
+                    meshRange.hasBones = pMesh->hasBones();
+                    meshRange.modelInstanceRange = (uint32_t)mModelInstanceRanges.size() - 1;
+                    meshRange.firstMeshInstance = meshInstance;
+                    mMeshRanges.push_back(meshRange);
+
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < meshRange.entryCount; meshInstanceID++)
+                    {
+                        mVisible[entry] = mMeshInstances.visible[meshInstance++];
+                        mMeshInstanceIDs[entry] = meshInstanceID;
+                        mMeshRangeIDs[entry] = (uint32_t)mMeshRanges.size() - 1;
+                        mMeshIDs[entry] = pMesh->getId();
+                        mMaterialIDs[entry] = pMesh->getMaterial() ? pMesh->getMaterial()->getId() : -1;
+                        entry++;
+                    }
+                }
+            }
+        }
+        assert(entry == entryCount);
+    }
+
+    void SceneInstanceTable::update(const Scene* pScene, ThreadPool* pThreadPool)
+    {
+        refreshMeshInstances(pScene);
+
+        const uint32_t rangeCount = (uint32_t)mModelInstanceRanges.size();
+        if (pThreadPool)
+        {
+            // Every model instance owns a disjoint set of entries, so the ranges can be updated independently
+            std::atomic<uint32_t> updatedCount(0);
+            pThreadPool->parallelFor(rangeCount, 64, [&](uint32_t begin, uint32_t end)
+            {
+                updatedCount += updateModelInstanceRanges(pScene, begin, end);
+            });
+            mUpdatedEntryCount = updatedCount;
+        }
+        else
+        {
+            mUpdatedEntryCount = updateModelInstanceRanges(pScene, 0, rangeCount);
+        }
+    }
+
+    uint32_t SceneInstanceTable::updateModelInstanceRanges(const Scene* pScene, uint32_t first, uint32_t last)
+    {
+        uint32_t updatedCount = 0;
+        for (uint32_t i = first; i < last; i++)
+        {
+            ModelInstanceRange& modelRange = mModelInstanceRanges[i];
+            const auto& pModelInstance = pScene->getModelInstance(modelRange.modelID, modelRange.instanceID);
+            modelRange.visible = pModelInstance->isVisible();
+
+            // The mesh instance visibility can change without touching the transforms
+            for (uint32_t m = 0; m < modelRange.meshRangeCount; m++)
+            {
+                const MeshRange& meshRange = mMeshRanges[modelRange.firstMeshRange + m];
+                for (uint32_t j = 0; j < meshRange.entryCount; j++)
+                {
+                    mVisible[meshRange.firstEntry + j] = mMeshInstances.visible[meshRange.firstMeshInstance + j];
+                }
+            }
+
+            // Only entries of instances which were moved since the last update need to be transformed
+            const uint32_t version = pModelInstance->getTransformVersion();
+            if (version != modelRange.transformVersion || mModelChanged[modelRange.modelID])
+            {
+                updatedCount += updateEntries(modelRange, pModelInstance->getTransformMatrix());
+                modelRange.transformVersion = version;
+            }
+        }
+        return updatedCount;
+    }
+
+    void SceneInstanceTable::refreshMeshInstances(const Scene* pScene)
+    {
+        // The mesh instances can be hidden or moved inside the model without touching the model instances
+        uint32_t meshInstance = 0;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            bool changed = false;
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t j = 0; j < pModel->getMeshInstanceCount(meshID); j++, meshInstance++)
+                {
+                    const auto& pMeshInstance = pModel->getMeshInstance(meshID, j);
+                    mMeshInstances.visible[meshInstance] = pMeshInstance->isVisible() ? 1 : 0;
+
+                    const uint32_t version = pMeshInstance->getTransformVersion();
+                    if (version != mMeshInstances.versions[meshInstance])
+                    {
+                        mMeshInstances.matrices[meshInstance] = pMeshInstance->getTransformMatrix();
+                        mMeshInstances.boxes[meshInstance] = pMeshInstance->getBoundingBox();
+                        mMeshInstances.versions[meshInstance] = version;
+                        changed = true;
+                    }
+                }
+            }
+            mModelChanged[modelID] = changed ? 1 : 0;
+        }
+    }
+
+    uint32_t SceneInstanceTable::updateEntries(const ModelInstanceRange& modelRange, const glm::mat4& modelMat)
+    {
+        uint32_t updatedCount = 0;
+        for (uint32_t i = 0; i < modelRange.meshRangeCount; i++)
+        {
+            const MeshRange& meshRange = mMeshRanges[modelRange.firstMeshRange + i];
+            const uint32_t lastEntry = meshRange.firstEntry + meshRange.entryCount;
+            for (uint32_t entry = meshRange.firstEntry; entry < lastEntry; entry++)
+            {
+                const uint32_t meshInstance = meshRange.firstMeshInstance + (entry - meshRange.firstEntry);
+
+                // Skinned meshes are transformed by the bones
+                mWorldMatrices[entry] = meshRange.hasBones ? glm::mat4() : modelMat * mMeshInstances.matrices[meshInstance];
+
+                BoundingBox box = mMeshInstances.boxes[meshInstance].transform(modelMat);
+                mWorldBoxes.centerX[entry] = box.center.x;
+                mWorldBoxes.centerY[entry] = box.center.y;
+                mWorldBoxes.centerZ[entry] = box.center.z;
+                mWorldBoxes.extentX[entry] = box.extent.x;
+                mWorldBoxes.extentY[entry] = box.extent.y;
+                mWorldBoxes.extentZ[entry] = box.extent.z;
+            }
+            updatedCount += meshRange.entryCount;
+        }
+        return updatedCount;
+    }
+}
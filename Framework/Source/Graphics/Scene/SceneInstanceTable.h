@@ -0,0 +1,195 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Model;
+    class ThreadPool;
+
+    /** Packed, structure-of-arrays view of all the mesh instances in a scene.
+        Entries are stored in render order (model -> model instance -> mesh -> mesh instance), so renderers can iterate the arrays linearly instead of walking the nested instance lists.
+        The table is owned by the Scene. Use Scene::getInstanceTable() to get an up-to-date table.
+    */
+    class SceneInstanceTable
+    {
+    public:
+        using UniquePtr = std::unique_ptr<SceneInstanceTable>;
+
+        /** A contiguous range of entries which are instances of the same mesh inside a single model instance
+        */
+        struct MeshRange
+        {
+            uint32_t meshID;        ///< Mesh ID inside the model
+            uint32_t firstEntry;    ///< Index of the first entry in the table
+            uint32_t entryCount;    ///< Number of entries in the range
+            bool hasBones;          ///< Whether the mesh is skinned. The world matrix of skinned entries is identity, the bones contain the transform.
+            uint32_t modelInstanceRange;    ///< Index of the model instance range the mesh range belongs to
+            uint32_t firstMeshInstance;     ///< Index of the first mesh instance in the table's per-model mesh instance arrays. Shared by all the instances of the model.
+        };
+
+        /** A contiguous range of mesh ranges belonging to a single model instance
+        */
+        struct ModelInstanceRange
+        {
+            uint32_t modelID;           ///< Model ID in the scene
+            uint32_t instanceID;        ///< Instance ID of the model
+            uint32_t firstMeshRange;    ///< Index of the first mesh range
+            uint32_t meshRangeCount;    ///< Number of mesh ranges
+            bool visible;               ///< Visibility of the model instance
+            uint32_t transformVersion;  ///< Transform version of the model instance the entries were last updated with
+        };
+
+        static UniquePtr create();
+
+        /** Rebuild the table layout. Should be called when models or instances were added or removed from the scene.
+        */
+        void rebuild(const Scene* pScene);
+
+        /** Refresh the visibility of the model and mesh instances, and the world matrices and world-space bounding boxes of entries whose model instance or mesh instance was moved since the last update
+            \param[in] pThreadPool Optional thread pool. If set, the model instances are processed in parallel. The mesh instances are shared by the model instances, so they are read once per model on the calling thread first.
+        */
+        void update(const Scene* pScene, ThreadPool* pThreadPool = nullptr);
+
+        /** Get the number of entries whose world matrix and bounding box were recomputed by the last update() call. For static scenes this is zero, except for the first frame after a rebuild.
+        */
+        uint32_t getUpdatedEntryCount() const { return mUpdatedEntryCount; }
+
+        /** Get the total number of mesh instance entries
+        */
+        uint32_t getEntryCount() const { return (uint32_t)mWorldMatrices.size(); }
+
+        /** Get the number of model instance ranges
+        */
+        uint32_t getModelInstanceRangeCount() const { return (uint32_t)mModelInstanceRanges.size(); }
+
+        /** Get a model instance range
+        */
+        const ModelInstanceRange& getModelInstanceRange(uint32_t rangeID) const { return mModelInstanceRanges[rangeID]; }
+
+        /** Get the number of mesh ranges
+        */
+        uint32_t getMeshRangeCount() const { return (uint32_t)mMeshRanges.size(); }
+
+        /** Get a mesh range
+        */
+        const MeshRange& getMeshRange(uint32_t rangeID) const { return mMeshRanges[rangeID]; }
+
+        /** Get the world matrix of an entry (model instance transform * mesh instance transform)
+        */
+        const glm::mat4& getWorldMatrix(uint32_t entry) const { return mWorldMatrices[entry]; }
+
+        /** Get the world-space bounding box of an entry
+        */
+        BoundingBox getWorldBoundingBox(uint32_t entry) const
+        {
+            BoundingBox box;
+            box.center = glm::vec3(mWorldBoxes.centerX[entry], mWorldBoxes.centerY[entry], mWorldBoxes.centerZ[entry]);
+            box.extent = glm::vec3(mWorldBoxes.extentX[entry], mWorldBoxes.extentY[entry], mWorldBoxes.extentZ[entry]);
+            return box;
+        }
+
+        /** Get the world-space bounding boxes of all the entries, in structure-of-arrays form
+        */
+        BoundingBoxArrays getWorldBoundingBoxes() const
+        {
+            BoundingBoxArrays boxes;
+            boxes.pCenterX = mWorldBoxes.centerX.data();
+            boxes.pCenterY = mWorldBoxes.centerY.data();
+            boxes.pCenterZ = mWorldBoxes.centerZ.data();
+            boxes.pExtentX = mWorldBoxes.extentX.data();
+            boxes.pExtentY = mWorldBoxes.extentY.data();
+            boxes.pExtentZ = mWorldBoxes.extentZ.data();
+            boxes.count = getEntryCount();
+            return boxes;
+        }
+
+        /** Check if the mesh instance of an entry is visible. This doesn't take the model instance visibility into account.
+        */
+        bool isVisible(uint32_t entry) const { return mVisible[entry] != 0; }
+
+        /** Get the instance ID of the entry's mesh instance inside its model
+        */
+        uint32_t getMeshInstanceID(uint32_t entry) const { return mMeshInstanceIDs[entry]; }
+
+        /** Get the index of the mesh range an entry belongs to
+        */
+        uint32_t getMeshRangeID(uint32_t entry) const { return mMeshRangeIDs[entry]; }
+
+        /** Get the global mesh ID of an entry
+        */
+        uint32_t getMeshID(uint32_t entry) const { return mMeshIDs[entry]; }
+
+        /** Get the global material ID of an entry
+        */
+        int32_t getMaterialID(uint32_t entry) const { return mMaterialIDs[entry]; }
+
+    private:
+        SceneInstanceTable() = default;
+
+        void resize(uint32_t entryCount);
+        uint32_t updateEntries(const ModelInstanceRange& modelRange, const glm::mat4& modelMat);
+        uint32_t updateModelInstanceRanges(const Scene* pScene, uint32_t first, uint32_t last);
+        void refreshMeshInstances(const Scene* pScene);
+
+        static const uint32_t kInvalidVersion = (uint32_t)-1;
+        uint32_t mUpdatedEntryCount = 0;
+
+        std::vector<ModelInstanceRange> mModelInstanceRanges;
+        std::vector<MeshRange> mMeshRanges;
+
+        // Per mesh instance data, stored once per model. Read on a single thread at the start of update(), since the mesh instances are shared by the model instances.
+        struct
+        {
+            std::vector<glm::mat4> matrices;    // Mesh instance transform
+            std::vector<BoundingBox> boxes;     // Mesh instance bounding box, in model space
+            std::vector<uint32_t> versions;     // Transform version the matrix and box were read with
+            std::vector<uint8_t> visible;
+        } mMeshInstances;
+        std::vector<uint8_t> mModelChanged;     // Per model, whether a mesh instance moved in the current update
+
+        // Per entry data
+        std::vector<glm::mat4> mWorldMatrices;
+        std::vector<uint8_t> mVisible;
+        std::vector<uint32_t> mMeshInstanceIDs;
+        std::vector<uint32_t> mMeshRangeIDs;
+        std::vector<uint32_t> mMeshIDs;
+        std::vector<int32_t> mMaterialIDs;
+
+        struct
+        {
+            std::vector<float> centerX, centerY, centerZ;
+            std::vector<float> extentX, extentY, extentZ;
+        } mWorldBoxes;
+    };
+}
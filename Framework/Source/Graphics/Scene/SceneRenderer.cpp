@@ -37,19 +37,23 @@
 #include "API/Device.h"
 #include "glm/matrix.hpp"
 #include "Graphics/Material/MaterialSystem.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Math/RadixSort.h"
 
 namespace Falcor
 {
-    size_t SceneRenderer::sBonesOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sCameraDataOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sWorldMatOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
+    ProgramReflection::VariableHandle SceneRenderer::sCameraDataHandle;
+    ProgramReflection::VariableHandle SceneRenderer::sWorldMatHandle;
+    ProgramReflection::VariableHandle SceneRenderer::sMeshIdHandle;
+    ProgramReflection::VariableHandle SceneRenderer::sDrawIDHandle;
 
     const char* SceneRenderer::kPerMaterialCbName = "InternalPerMaterialCB";
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
     const char* SceneRenderer::kPerMeshCbName = "InternalPerMeshCB";
 
+    // Toggled per model, so it's interned once instead of on every change
+    static const Program::DefineSet::Define kVertexBlendingDefine = Program::DefineSet::intern("_VERTEX_BLENDING");
+
     SceneRenderer::UniquePtr SceneRenderer::create(const Scene::SharedPtr& pScene)
     {
         return UniquePtr(new SceneRenderer(pScene));
@@ -60,28 +64,20 @@ namespace Falcor
         setCameraControllerType(CameraControllerType::SixDof);
     }
 
-    void SceneRenderer::updateVariableOffsets(const ProgramReflection* pReflector)
+    void SceneRenderer::updateVariableHandles(const ProgramReflection* pReflector)
     {
-        if(sWorldMatOffset == ConstantBuffer::kInvalidOffset)
+        const auto pPerMeshCbData = pReflector->getBufferDesc(kPerMeshCbName, ProgramReflection::BufferReflection::Type::Constant);
+        if (pPerMeshCbData != nullptr && pPerMeshCbData->getLayoutHash() != sWorldMatHandle.layoutHash)
         {
-            const auto pPerMeshCbData = pReflector->getBufferDesc(kPerMeshCbName, ProgramReflection::BufferReflection::Type::Constant);
-
-            if (pPerMeshCbData != nullptr)
-            {
-                sWorldMatOffset = pPerMeshCbData->getVariableData("gWorldMat[0]")->location;
-                sMeshIdOffset = pPerMeshCbData->getVariableData("gMeshId")->location;
-                sDrawIDOffset = pPerMeshCbData->getVariableData("gDrawId[0]")->location;
-            }
+            sWorldMatHandle = pPerMeshCbData->getVariableHandle("gWorldMat", true);
+            sMeshIdHandle = pPerMeshCbData->getVariableHandle("gMeshId");
+            sDrawIDHandle = pPerMeshCbData->getVariableHandle("gDrawId", true);
         }
 
-        if (sCameraDataOffset == ConstantBuffer::kInvalidOffset)
+        const auto pPerFrameCbData = pReflector->getBufferDesc(kPerFrameCbName, ProgramReflection::BufferReflection::Type::Constant);
+        if (pPerFrameCbData != nullptr && pPerFrameCbData->getLayoutHash() != sCameraDataHandle.layoutHash)
         {
-            const auto pPerFrameCbData = pReflector->getBufferDesc(kPerFrameCbName, ProgramReflection::BufferReflection::Type::Constant);
-
-            if (pPerFrameCbData != nullptr)
-            {
-                sCameraDataOffset = pPerFrameCbData->getVariableData("gCam.viewMat")->location;
-            }
+            sCameraDataHandle = pPerFrameCbData->getVariableHandle("gCam.viewMat");
         }
     }
 
@@ -93,7 +89,7 @@ namespace Falcor
             ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerFrameCbName).get();
             if (pCB)
             {
-                currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+                currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataHandle);
             }
         }
     }
@@ -106,12 +102,7 @@ namespace Falcor
             ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerMeshCbName).get();
             if(pCB)
             {
-                if (sBonesOffset == ConstantBuffer::kInvalidOffset)
-                {
-                    sBonesOffset = pCB->getVariableOffset("gWorldMat[0]");
-                }
-
-                pCB->setVariableArray(sBonesOffset, currentData.pModel->getBonesMatrices(), currentData.pModel->getBonesCount());
+                pCB->setVariableArray(sWorldMatHandle, currentData.pModel->getBonesMatrices(), currentData.pModel->getBonesCount());
             }
         }
         return true;
@@ -132,18 +123,12 @@ namespace Falcor
         ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerMeshCbName).get();
         if(pCB)
         {
-            const Mesh* pMesh = pMeshInstance->getObject().get();
-
-            glm::mat4 worldMat;
-            if (pMesh->hasBones() == false)
-            {
-                worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
-            }
-
-            pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+            // The instance table already holds the concatenated matrix (identity for skinned meshes)
+            const glm::mat4& worldMat = currentData.pInstanceTable->getWorldMatrix(currentData.instanceEntry);
+            pCB->setVariable(sWorldMatHandle[drawInstanceID], worldMat);
 
             // Set mesh id
-            pCB->setVariable(sMeshIdOffset, pMesh->getId());
+            pCB->setVariable(sMeshIdHandle, currentData.pInstanceTable->getMeshID(currentData.instanceEntry));
         }
 
         return true;
@@ -156,7 +141,17 @@ namespace Falcor
         ConstantBuffer* pCB = pGraphicsVars->getConstantBuffer(kPerMaterialCbName).get();
         if (pCB)
         {
-            currentData.pMaterial->setIntoProgramVars(pGraphicsVars, pCB, "gMaterial");
+            const ProgramReflection::SharedConstPtr& pReflector = pGraphicsVars->getReflection();
+            if (pReflector != mpMaterialReflector || pCB->isHandleCompatible(mMaterialLocations.data) == false)
+            {
+                mpMaterialReflector = pReflector;
+                mMaterialLocations = Material::getBindLocations(pGraphicsVars, pCB, "gMaterial");
+            }
+
+            if (mMaterialLocations.isValid())
+            {
+                currentData.pMaterial->setIntoProgramVars(pGraphicsVars, pCB, mMaterialLocations);
+            }
         }
 
         return true;
@@ -174,6 +169,7 @@ namespace Falcor
             }
             setPerMaterialData(pContext, currentData);
             mpLastMaterial = pMesh->getMaterial().get();
+            mDrawStats.materialBinds++;
 
             if(mCompileMaterialWithProgram)
             {
@@ -185,6 +181,7 @@ namespace Falcor
 
         // Draw
         pContext->drawIndexedInstanced(pMesh->getIndexCount(), instanceCount, 0, 0, 0);
+        mDrawStats.drawCalls++;
         postFlushDraw(pContext, currentData);
     }
 
@@ -193,40 +190,47 @@ namespace Falcor
 
     }
 
-    void SceneRenderer::renderMeshInstances(RenderContext* pContext, uint32_t meshID, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData)
+    void SceneRenderer::renderMeshInstances(RenderContext* pContext, uint32_t meshRangeID, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData)
     {
         const Model* pModel = currentData.pModel;
-        const Mesh* pMesh = pModel->getMesh(meshID).get();
+        const SceneInstanceTable* pTable = currentData.pInstanceTable;
+        const SceneInstanceTable::MeshRange& meshRange = pTable->getMeshRange(meshRangeID);
+        const Mesh* pMesh = pModel->getMesh(meshRange.meshID).get();
 
         if (setPerMeshData(pContext, currentData))
         {
             // Bind VAO and set topology
             pContext->getGraphicsState()->setVao(pMesh->getVao());
+            mDrawStats.vaoBinds++;
 
             uint32_t activeInstances = 0;
 
-            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
-            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            // With parallel traversal the visible entries were already gathered, otherwise filter them here
+            const uint32_t* pDrawList = mUseDrawLists ? mDrawListEntries.data() + meshRange.firstEntry : nullptr;
+            const uint32_t drawCount = mUseDrawLists ? mDrawListCounts[meshRangeID] : meshRange.entryCount;
+            for (uint32_t i = 0; i < drawCount; i++)
             {
-                auto& meshInstance = pModel->getMeshInstance(meshID, instanceID);
-                BoundingBox box = meshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+                const uint32_t entry = pDrawList ? pDrawList[i] : meshRange.firstEntry + i;
+                if (pDrawList == nullptr && pTable->isVisible(entry) == false)
+                {
+                    continue;
+                }
 
-                if ((mCullEnabled == false) || (pCamera->isObjectCulled(box) == false))
+                if (pDrawList || (mCullEnabled == false) || (isEntryCulled(entry) == false))
                 {
-                    if (meshInstance->isVisible())
+                    currentData.instanceEntry = entry;
+                    const auto& pMeshInstance = pModel->getMeshInstance(meshRange.meshID, pTable->getMeshInstanceID(entry));
+                    if (setPerMeshInstanceData(pContext, pModelInstance, pMeshInstance, activeInstances, currentData))
                     {
-                        if (setPerMeshInstanceData(pContext, pModelInstance, meshInstance, activeInstances, currentData))
+                        currentData.drawID++;
+                        activeInstances++;
+
+                        if (activeInstances == mMaxInstanceCount)
                         {
-                            currentData.drawID++;
-                            activeInstances++;
-
-                            if (activeInstances == mMaxInstanceCount)
-                            {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                flushDraw(pContext, pMesh, activeInstances, currentData);
-                                activeInstances = 0;
-                            }
+                            // DISABLED_FOR_D3D12
+                            //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
+                            flushDraw(pContext, pMesh, activeInstances, currentData);
+                            activeInstances = 0;
                         }
                     }
                 }
@@ -238,9 +242,9 @@ namespace Falcor
         }
     }
 
-    void SceneRenderer::renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData)
+    void SceneRenderer::renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, const SceneInstanceTable::ModelInstanceRange& modelRange, Camera* pCamera, CurrentWorkingData& currentData)
     {
-        const Model* pModel = pModelInstance->getObject().get();
+        const Model* pModel = currentData.pModel;
 
         if (setPerModelData(pContext, currentData))
         {
@@ -248,21 +252,26 @@ namespace Falcor
             // Bind the program
             if(pModel->hasBones())
             {
-                pProgram->addDefine("_VERTEX_BLENDING");
+                pProgram->addDefine(kVertexBlendingDefine);
+                mDrawStats.variantChanges++;
             }
 
             mpLastMaterial = nullptr;
 
-            // Loop over the meshes
-            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            // Skinned models are skipped until their variant finished compiling in the background, drawing them with the previous version would ignore the bones
+            if ((pModel->hasBones() == false) || pProgram->getActiveVersionAsync(Program::AsyncFallback::None))
             {
-                renderMeshInstances(pContext, meshID, pModelInstance, pCamera, currentData);
+                // Loop over the meshes
+                for (uint32_t i = 0; i < modelRange.meshRangeCount; i++)
+                {
+                    renderMeshInstances(pContext, modelRange.firstMeshRange + i, pModelInstance, pCamera, currentData);
+                }
             }
 
             // Restore the program state
             if(pModel->hasBones())
             {
-                pProgram->removeDefine("_VERTEX_BLENDING");
+                pProgram->removeDefine(kVertexBlendingDefine);
             }
         }
 
@@ -293,9 +302,273 @@ namespace Falcor
         }
     }
 
+    void SceneRenderer::cullParallel(const Camera* pCamera, const SceneInstanceTable* pTable)
+    {
+        const BoundingBoxArrays boxes = pTable->getWorldBoundingBoxes();
+        uint32_t* pCulledMask = mCulledMask.data();
+
+        // Chunks cover whole mask words, so threads never write to the same word
+        const uint32_t wordCount = (uint32_t)mCulledMask.size();
+        mpThreadPool->parallelFor(wordCount, 128, [&](uint32_t beginWord, uint32_t endWord)
+        {
+            const uint32_t first = beginWord * 32;
+            BoundingBoxArrays chunk;
+            chunk.pCenterX = boxes.pCenterX + first;
+            chunk.pCenterY = boxes.pCenterY + first;
+            chunk.pCenterZ = boxes.pCenterZ + first;
+            chunk.pExtentX = boxes.pExtentX + first;
+            chunk.pExtentY = boxes.pExtentY + first;
+            chunk.pExtentZ = boxes.pExtentZ + first;
+            chunk.count = min(endWord * 32, boxes.count) - first;
+            pCamera->cullBoundingBoxes(chunk, pCulledMask + beginWord);
+        });
+    }
+
+    void SceneRenderer::buildDrawListsParallel(const SceneInstanceTable* pTable)
+    {
+        const uint32_t meshRangeCount = pTable->getMeshRangeCount();
+        mDrawListEntries.resize(pTable->getEntryCount());
+        mDrawListCounts.resize(meshRangeCount);
+
+        // Every mesh range writes its visible entries into its own slice of the list, so the result doesn't depend on the scheduling
+        mpThreadPool->parallelFor(meshRangeCount, 256, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t meshRangeID = begin; meshRangeID < end; meshRangeID++)
+            {
+                const SceneInstanceTable::MeshRange& meshRange = pTable->getMeshRange(meshRangeID);
+                uint32_t* pDrawList = mDrawListEntries.data() + meshRange.firstEntry;
+                uint32_t count = 0;
+
+                const uint32_t lastEntry = meshRange.firstEntry + meshRange.entryCount;
+                for (uint32_t entry = meshRange.firstEntry; entry < lastEntry; entry++)
+                {
+                    if (pTable->isVisible(entry) && ((mCullEnabled == false) || (isEntryCulled(entry) == false)))
+                    {
+                        pDrawList[count++] = entry;
+                    }
+                }
+                mDrawListCounts[meshRangeID] = count;
+            }
+        });
+    }
+
+    // Sort key layout, from the most to the least significant bits
+    static const uint32_t kKeyVariantBits = 4;
+    static const uint32_t kKeyMaterialBits = 20;
+    static const uint32_t kKeyVaoBits = 20;
+    static const uint32_t kKeyDepthBits = 8;
+    static const uint32_t kKeyModelRangeBits = 12;
+    static_assert(kKeyVariantBits + kKeyMaterialBits + kKeyVaoBits + kKeyDepthBits + kKeyModelRangeBits == 64, "Sort key must use 64 bits");
+
+    // Values which don't fit would alias other keys. The caller checks the flag and falls back to unsorted submission.
+    static uint64_t packKeyField(uint64_t key, uint32_t value, uint32_t bitCount, bool& overflow)
+    {
+        overflow = overflow || (value >= (1u << bitCount));
+        return (key << bitCount) | (value & ((1u << bitCount) - 1));
+    }
+
+    bool SceneRenderer::buildSortedDrawList(const SceneInstanceTable* pTable, const Camera* pCamera)
+    {
+        mSortedDraws.clear();
+        mSortKeys.clear();
+        mSortValues.clear();
+
+        if (pTable->getModelInstanceRangeCount() > (1u << kKeyModelRangeBits))
+        {
+            return false;
+        }
+        bool overflow = false;
+
+        const glm::vec3 cameraPos = pCamera->getPosition();
+        const float depthScale = float((1 << kKeyDepthBits) - 1) / pCamera->getFarPlane();
+        const BoundingBoxArrays boxes = pTable->getWorldBoundingBoxes();
+
+        for (uint32_t modelRangeID = 0; modelRangeID < pTable->getModelInstanceRangeCount(); modelRangeID++)
+        {
+            const auto& modelRange = pTable->getModelInstanceRange(modelRangeID);
+            if (modelRange.visible == false)
+            {
+                continue;
+            }
+
+            const Model* pModel = mpScene->getModel(modelRange.modelID).get();
+            const uint32_t variant = pModel->hasBones() ? 1 : 0;
+
+            for (uint32_t i = 0; i < modelRange.meshRangeCount; i++)
+            {
+                const uint32_t meshRangeID = modelRange.firstMeshRange + i;
+                const SceneInstanceTable::MeshRange& meshRange = pTable->getMeshRange(meshRangeID);
+
+                auto addDraw = [&](uint32_t entry)
+                {
+                    // Coarse front-to-back order for draws which share the same state
+                    glm::vec3 center(boxes.pCenterX[entry], boxes.pCenterY[entry], boxes.pCenterZ[entry]);
+                    uint32_t depth = (uint32_t)clamp(glm::length(center - cameraPos) * depthScale, 0.0f, float((1 << kKeyDepthBits) - 1));
+
+                    uint64_t key = variant;
+                    key = packKeyField(key, (uint32_t)(pTable->getMaterialID(entry) + 1), kKeyMaterialBits, overflow);
+                    key = packKeyField(key, pTable->getMeshID(entry), kKeyVaoBits, overflow);
+                    key = packKeyField(key, depth, kKeyDepthBits, overflow);
+                    key = packKeyField(key, modelRangeID, kKeyModelRangeBits, overflow);
+
+                    mSortKeys.push_back(key);
+                    mSortValues.push_back((uint32_t)mSortedDraws.size());
+                    mSortedDraws.push_back({ entry, meshRangeID, modelRangeID });
+                };
+
+                if (mUseDrawLists)
+                {
+                    const uint32_t* pDrawList = mDrawListEntries.data() + meshRange.firstEntry;
+                    for (uint32_t j = 0; j < mDrawListCounts[meshRangeID]; j++)
+                    {
+                        addDraw(pDrawList[j]);
+                    }
+                }
+                else
+                {
+                    const uint32_t lastEntry = meshRange.firstEntry + meshRange.entryCount;
+                    for (uint32_t entry = meshRange.firstEntry; entry < lastEntry; entry++)
+                    {
+                        if (pTable->isVisible(entry) && ((mCullEnabled == false) || (isEntryCulled(entry) == false)))
+                        {
+                            addDraw(entry);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (overflow)
+        {
+            return false;
+        }
+
+        // The sort is stable, so draws with equal keys keep the scene order
+        radixSort(mSortKeys, mSortValues, mSortTempKeys, mSortTempValues);
+        return true;
+    }
+
+    void SceneRenderer::renderSortedDraws(RenderContext* pContext, CurrentWorkingData& currentData)
+    {
+        const SceneInstanceTable* pTable = currentData.pInstanceTable;
+        Program* pProgram = currentData.pGsoCache->getProgram().get();
+
+        static const uint32_t kInvalidRange = (uint32_t)-1;
+        uint32_t currentModelRange = kInvalidRange;
+        uint32_t currentMeshRange = kInvalidRange;
+        Scene::ModelInstance::SharedPtr pInstance;
+        const Mesh* pMesh = nullptr;
+        const Vao* pBoundVao = nullptr;
+        bool modelAccepted = false;
+        bool meshAccepted = false;
+        bool vertexBlending = false;
+        uint32_t activeInstances = 0;
+
+        mpLastMaterial = nullptr;
+
+        for (uint32_t i = 0; i < (uint32_t)mSortValues.size(); i++)
+        {
+            const SortedDraw& draw = mSortedDraws[mSortValues[i]];
+
+            // Instances of different model instances can't share a draw call, since the per-model-instance hooks may change the state
+            if (draw.modelRangeID != currentModelRange)
+            {
+                if (activeInstances != 0)
+                {
+                    flushDraw(pContext, pMesh, activeInstances, currentData);
+                    activeInstances = 0;
+                }
+
+                const auto& modelRange = pTable->getModelInstanceRange(draw.modelRangeID);
+                pInstance = mpScene->getModelInstance(modelRange.modelID, modelRange.instanceID);
+                currentData.pModel = pInstance->getObject().get();
+                currentModelRange = draw.modelRangeID;
+                currentMeshRange = kInvalidRange;
+
+                modelAccepted = setPerModelInstanceData(pContext, pInstance, modelRange.instanceID, currentData) && setPerModelData(pContext, currentData);
+
+                if (modelAccepted && (currentData.pModel->hasBones() != vertexBlending))
+                {
+                    vertexBlending = currentData.pModel->hasBones();
+                    if (vertexBlending)
+                    {
+                        pProgram->addDefine(kVertexBlendingDefine);
+                    }
+                    else
+                    {
+                        pProgram->removeDefine(kVertexBlendingDefine);
+                    }
+                    mpLastMaterial = nullptr;
+                    mDrawStats.variantChanges++;
+                }
+
+                // Same as the unsorted path, skinned models wait for their variant
+                if (modelAccepted && vertexBlending && (pProgram->getActiveVersionAsync(Program::AsyncFallback::None) == nullptr))
+                {
+                    modelAccepted = false;
+                }
+            }
+
+            if (modelAccepted == false)
+            {
+                continue;
+            }
+
+            if (draw.meshRangeID != currentMeshRange)
+            {
+                if (activeInstances != 0)
+                {
+                    flushDraw(pContext, pMesh, activeInstances, currentData);
+                    activeInstances = 0;
+                }
+
+                currentMeshRange = draw.meshRangeID;
+                pMesh = currentData.pModel->getMesh(pTable->getMeshRange(draw.meshRangeID).meshID).get();
+                meshAccepted = setPerMeshData(pContext, currentData);
+
+                if (meshAccepted && (pMesh->getVao().get() != pBoundVao))
+                {
+                    pContext->getGraphicsState()->setVao(pMesh->getVao());
+                    pBoundVao = pMesh->getVao().get();
+                    mDrawStats.vaoBinds++;
+                }
+            }
+
+            if (meshAccepted == false)
+            {
+                continue;
+            }
+
+            currentData.instanceEntry = draw.entry;
+            const auto& pMeshInstance = currentData.pModel->getMeshInstance(pTable->getMeshRange(draw.meshRangeID).meshID, pTable->getMeshInstanceID(draw.entry));
+            if (setPerMeshInstanceData(pContext, pInstance, pMeshInstance, activeInstances, currentData))
+            {
+                currentData.drawID++;
+                activeInstances++;
+
+                if (activeInstances == mMaxInstanceCount)
+                {
+                    flushDraw(pContext, pMesh, activeInstances, currentData);
+                    activeInstances = 0;
+                }
+            }
+        }
+
+        if (activeInstances != 0)
+        {
+            flushDraw(pContext, pMesh, activeInstances, currentData);
+        }
+
+        // Restore the program state
+        if (vertexBlending)
+        {
+            pProgram->removeDefine(kVertexBlendingDefine);
+        }
+    }
+
     void SceneRenderer::renderScene(RenderContext* pContext, Camera* pCamera)
     {
-        updateVariableOffsets(pContext->getGraphicsVars()->getReflection().get());
+        updateVariableHandles(pContext->getGraphicsVars()->getReflection().get());
 
         CurrentWorkingData currentData;
         currentData.pGsoCache = pContext->getGraphicsState().get();
@@ -303,23 +576,70 @@ namespace Falcor
         currentData.pMaterial = nullptr;
         currentData.pModel = nullptr;
         currentData.drawID = 0;
+        currentData.pInstanceTable = &mpScene->getInstanceTable(mpThreadPool);
+        const Bvh* pBvh = (mCullEnabled && mHierarchicalCullEnabled) ? &mpScene->getInstanceBvh(false) : nullptr;
+        currentData.instanceEntry = 0;
 
         setupVR();
         setPerFrameData(pContext, currentData);
 
-        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        // The camera updates its cached matrices and planes lazily. Make sure they're current before the worker threads read them.
+        pCamera->getData();
+
+        const SceneInstanceTable* pTable = currentData.pInstanceTable;
+
+        // Cull all the instances before emitting draws
+        if (mCullEnabled)
+        {
+            mCulledMask.resize((pTable->getEntryCount() + 31) / 32);
+            if (pBvh)
+            {
+                pBvh->cullFrustum(pCamera, pTable->getWorldBoundingBoxes(), mCulledMask.data());
+            }
+            else if (mpThreadPool)
+            {
+                cullParallel(pCamera, pTable);
+            }
+            else
+            {
+                pCamera->cullBoundingBoxes(pTable->getWorldBoundingBoxes(), mCulledMask.data());
+            }
+        }
+
+        mUseDrawLists = (mpThreadPool != nullptr);
+        if (mUseDrawLists)
         {
-            currentData.pModel = mpScene->getModel(modelID).get();
+            buildDrawListsParallel(pTable);
+        }
 
-            for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+        mDrawStats = DrawStats();
+        mDrawStats.updatedEntries = pTable->getUpdatedEntryCount();
+        if (mDrawSortEnabled)
+        {
+            if (buildSortedDrawList(pTable, pCamera))
             {
-                auto& pInstance = mpScene->getModelInstance(modelID, instanceID);
-                if (pInstance->isVisible())
+                renderSortedDraws(pContext, currentData);
+                return;
+            }
+
+            if (mSortKeyOverflowReported == false)
+            {
+                logWarning("SceneRenderer: the scene has too many model instances, meshes or materials for the draw sort key. Draws are submitted unsorted.");
+                mSortKeyOverflowReported = true;
+            }
+        }
+
+        for (uint32_t rangeID = 0; rangeID < pTable->getModelInstanceRangeCount(); rangeID++)
+        {
+            const auto& modelRange = pTable->getModelInstanceRange(rangeID);
+            if (modelRange.visible)
+            {
+                const auto& pInstance = mpScene->getModelInstance(modelRange.modelID, modelRange.instanceID);
+                currentData.pModel = pInstance->getObject().get();
+
+                if (setPerModelInstanceData(pContext, pInstance, modelRange.instanceID, currentData))
                 {
-                    if (setPerModelInstanceData(pContext, pInstance, instanceID, currentData))
-                    {
-                        renderModelInstance(pContext, pInstance, pCamera, currentData);
-                    }
+                    renderModelInstance(pContext, pInstance, modelRange, pCamera, currentData);
                 }
             }
         }
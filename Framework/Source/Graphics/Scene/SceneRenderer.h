@@ -42,6 +42,7 @@ namespace Falcor
     class Material;
     class Mesh;
     class Camera;
+    class ThreadPool;
 
     class SceneRenderer
     {
@@ -80,6 +81,38 @@ namespace Falcor
         */
         void setObjectCullState(bool enable) { mCullEnabled = enable; }
 
+        /** Enable/disable hierarchical culling. When enabled, the scene's instance BVH is used to reject or accept entire groups of mesh instances. Otherwise every instance is tested against the frustum.
+            Hierarchical culling pays off for scenes with many, mostly static, instances. The BVH is traversed on the calling thread, also with parallel traversal.
+        */
+        void setHierarchicalCullState(bool enable) { mHierarchicalCullEnabled = enable; }
+
+        /** Enable parallel scene traversal. World transform updates, flat culling and generation of the per-mesh draw lists are split across the pool's threads, then the calling thread writes the per-instance constants and submits the draws.
+            Draws are submitted in the same order and with the same batching as the serial path.
+            \param[in] pThreadPool The pool to use, or nullptr to traverse the scene on the calling thread (the default)
+        */
+        void setThreadPool(ThreadPool* pThreadPool) { mpThreadPool = pThreadPool; }
+
+        /** Enable/disable sorted submission. When enabled, the visible mesh instances are sorted by a 64-bit key packing (program variant, material, VAO, depth bucket) before the draws are submitted, which reduces state changes in heavily instanced scenes.
+            Draw order is no longer model->instance->mesh, and instances of different model instances are not batched into the same draw call.
+            Scenes with more than 4096 model instances, or mesh or material IDs which don't fit into 20 bits, are submitted unsorted.
+        */
+        void setDrawSortState(bool enable) { mDrawSortEnabled = enable; }
+
+        /** Statistics of the last renderScene() call
+        */
+        struct DrawStats
+        {
+            uint32_t drawCalls = 0;         ///< Number of draw calls
+            uint32_t materialBinds = 0;     ///< Number of times a material was bound
+            uint32_t vaoBinds = 0;          ///< Number of times a VAO was bound
+            uint32_t variantChanges = 0;    ///< Number of times the program defines were changed
+            uint32_t updatedEntries = 0;    ///< Number of instance table entries whose world matrix and bounding box were recomputed. Zero for static scenes.
+        };
+
+        /** Get the statistics of the last renderScene() call. Use it to compare the state changes with and without draw sorting.
+        */
+        const DrawStats& getDrawStats() const { return mDrawStats; }
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -114,6 +147,9 @@ namespace Falcor
             const Material* pMaterial;
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
+
+            const SceneInstanceTable* pInstanceTable;
+            uint32_t instanceEntry; // Index of the current mesh instance in pInstanceTable
         };
 
         SceneRenderer(const Scene::SharedPtr& pScene);
@@ -123,13 +159,13 @@ namespace Falcor
         static const char* kPerFrameCbName;
         static const char* kPerMeshCbName;
 
-        static size_t sBonesOffset;
-        static size_t sCameraDataOffset;
-        static size_t sWorldMatOffset;
-        static size_t sMeshIdOffset;
-        static size_t sDrawIDOffset;
+        static ProgramReflection::VariableHandle sCameraDataHandle;
+        static ProgramReflection::VariableHandle sWorldMatHandle;
+        static ProgramReflection::VariableHandle sMeshIdHandle;
+        static ProgramReflection::VariableHandle sDrawIDHandle;
 
-        static void updateVariableOffsets(const ProgramReflection* pReflector);
+        // Resolves the handles again if the layout of the internal constant buffers changed
+        static void updateVariableHandles(const ProgramReflection* pReflector);
 
         virtual void setPerFrameData(RenderContext* pContext, const CurrentWorkingData& currentData);
         virtual bool setPerModelData(RenderContext* pContext, const CurrentWorkingData& currentData);
@@ -139,18 +175,51 @@ namespace Falcor
         virtual bool setPerMaterialData(RenderContext* pContext, const CurrentWorkingData& currentData);
         virtual void postFlushDraw(RenderContext* pContext, const CurrentWorkingData& currentData);
 
-        void renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
-        void renderMeshInstances(RenderContext* pContext, uint32_t modelID, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
+        void renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, const SceneInstanceTable::ModelInstanceRange& modelRange, Camera* pCamera, CurrentWorkingData& currentData);
+        void renderMeshInstances(RenderContext* pContext, uint32_t meshRangeID, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
         void flushDraw(RenderContext* pContext, const Mesh* pMesh, uint32_t instanceCount, CurrentWorkingData& currentData);
 
         void setupVR();
+        void cullParallel(const Camera* pCamera, const SceneInstanceTable* pTable);
+        void buildDrawListsParallel(const SceneInstanceTable* pTable);
+        bool buildSortedDrawList(const SceneInstanceTable* pTable, const Camera* pCamera);  // Returns false if the IDs don't fit into the sort key
+        void renderSortedDraws(RenderContext* pContext, CurrentWorkingData& currentData);
 
         CameraControllerType mCamControllerType = CameraControllerType::SixDof;
         CameraController::SharedPtr mpCameraController;
 
         uint32_t mMaxInstanceCount = 64;
+        bool isEntryCulled(uint32_t entry) const { return ((mCulledMask[entry >> 5] >> (entry & 31)) & 1) != 0; }
+
         const Material* mpLastMaterial = nullptr;
+        ProgramReflection::SharedConstPtr mpMaterialReflector;    // The reflection mMaterialLocations were resolved from
+        Material::BindLocations mMaterialLocations;
+        std::vector<uint32_t> mCulledMask;  // Bit per instance table entry, filled by Camera::cullBoundingBoxes()
         bool mCullEnabled = true;
+        bool mHierarchicalCullEnabled = true;
+
+        // Parallel traversal. For every mesh range, the draw list holds the entries which passed culling, stored at the range's first entry index.
+        ThreadPool* mpThreadPool = nullptr;
+        bool mUseDrawLists = false;
+        std::vector<uint32_t> mDrawListEntries;
+        std::vector<uint32_t> mDrawListCounts;
+
+        // Sorted submission. The sort values index into mSortedDraws.
+        struct SortedDraw
+        {
+            uint32_t entry;
+            uint32_t meshRangeID;
+            uint32_t modelRangeID;
+        };
+        bool mDrawSortEnabled = false;
+        bool mSortKeyOverflowReported = false;
+        std::vector<SortedDraw> mSortedDraws;
+        std::vector<uint64_t> mSortKeys;
+        std::vector<uint32_t> mSortValues;
+        std::vector<uint64_t> mSortTempKeys;
+        std::vector<uint32_t> mSortTempValues;
+
+        DrawStats mDrawStats;
         bool mUnloadTexturesOnMaterialChange = false;
         RenderMode mRenderMode = RenderMode::Mono;
         bool mCompileMaterialWithProgram = true;
@@ -54,7 +54,7 @@ namespace Falcor
         for(uint32_t i = 0; i < pScene->getLightCount(); i++)
         {
             auto pLight = pScene->getLight(i);
-            pLight->setIntoConstantBuffer(pBuffer, pLight->getName());
+            pLight->setIntoConstantBuffer(pBuffer);
         }
         pBuffer->setVariable("gAmbient", pScene->getAmbientIntensity());
     }
@@ -0,0 +1,401 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SoftwareRTContext.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/Math/TriangleBvh.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    // Packets per thread-pool chunk when tracing ray streams
+    static const uint32_t kPacketsPerChunk = 64;
+    static const uint32_t kTileSize = 8;
+
+    // Transform the rays of a packet by an affine matrix. The direction isn't normalized, so the hit distances don't change.
+    static void transformPacket(const RayPacket4& src, const glm::mat4& m, RayPacket4& dst)
+    {
+        const __m128 ox = _mm_load_ps(src.originX), oy = _mm_load_ps(src.originY), oz = _mm_load_ps(src.originZ);
+        const __m128 dx = _mm_load_ps(src.directionX), dy = _mm_load_ps(src.directionY), dz = _mm_load_ps(src.directionZ);
+        float* pOrigins[] = { dst.originX, dst.originY, dst.originZ };
+        float* pDirections[] = { dst.directionX, dst.directionY, dst.directionZ };
+
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            const __m128 m0 = _mm_set1_ps(m[0][row]), m1 = _mm_set1_ps(m[1][row]), m2 = _mm_set1_ps(m[2][row]);
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, dx), _mm_mul_ps(m1, dy)), _mm_mul_ps(m2, dz));
+            const __m128 o = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, ox), _mm_mul_ps(m1, oy)), _mm_mul_ps(m2, oz)), _mm_set1_ps(m[3][row]));
+            _mm_store_ps(pOrigins[row], o);
+            _mm_store_ps(pDirections[row], d);
+        }
+        _mm_store_ps(dst.tMax, _mm_load_ps(src.tMax));
+        dst.activeMask = src.activeMask;
+    }
+
+    SoftwareRTContext::SharedPtr SoftwareRTContext::create()
+    {
+        return SharedPtr(new SoftwareRTContext());
+    }
+
+    SoftwareRTContext::SoftwareRTContext()
+    {
+        mpTopLevelBvh = Bvh::create();
+    }
+
+    void SoftwareRTContext::newScene()
+    {
+        mObjects.clear();
+        mInstances.clear();
+        mRebuildHierarchy = true;
+        mTransformsDirty = false;
+        updateTransforms();
+    }
+
+    void SoftwareRTContext::newScene(const Scene::SharedPtr& pScene)
+    {
+        newScene();
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const Scene::ModelInstance::SharedPtr& pInstance = pScene->getModelInstance(modelID, instanceID);
+                addObject(pInstance->getObject(), *pInstance);
+            }
+        }
+        updateTransforms();
+    }
+
+    SoftwareRTContext::ObjectHandle SoftwareRTContext::addObject(const Model::SharedPtr& pModel, const Scene::ModelInstance& instance)
+    {
+        return addObjectInternal(pModel, instance.getTransformMatrix(), false);
+    }
+
+    SoftwareRTContext::DynamicObjectHandle SoftwareRTContext::addDynamicObject(const Model::SharedPtr& pModel)
+    {
+        return addObjectInternal(pModel, glm::mat4(), true);
+    }
+
+    SoftwareRTContext::ObjectHandle SoftwareRTContext::addObjectInternal(const Model::SharedPtr& pModel, const glm::mat4& transform, bool dynamic)
+    {
+        const ObjectHandle handle = (ObjectHandle)mObjects.size();
+
+        Object object;
+        object.pModel = pModel;
+        object.transform = transform;
+        object.firstInstance = (uint32_t)mInstances.size();
+        object.instanceCount = 0;
+        object.dynamic = dynamic;
+        object.dirty = true;
+
+        uint32_t skippedMeshes = 0;
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            // The BVHs are built here, since Mesh::getTriangleBvh() isn't thread-safe
+            const Mesh* pMesh = pModel->getMesh(meshID).get();
+            const TriangleBvh* pBvh = pMesh->hasBones() ? nullptr : pMesh->getTriangleBvh();
+            if (pBvh == nullptr)
+            {
+                skippedMeshes++;
+                continue;
+            }
+            if (pBvh->getTriangleCount() == 0)
+            {
+                continue;
+            }
+
+            for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+            {
+                Instance instance;
+                instance.pBvh = pBvh;
+                instance.meshTransform = pModel->getMeshInstance(meshID, meshInstanceID)->getTransformMatrix();
+                instance.object = handle;
+                instance.meshID = meshID;
+                instance.meshInstanceID = meshInstanceID;
+                mInstances.push_back(instance);
+                object.instanceCount++;
+            }
+        }
+
+        if (skippedMeshes)
+        {
+            logWarning("SoftwareRTContext - skipped " + std::to_string(skippedMeshes) + " meshes of '" + pModel->getName() + "'. Only static triangle meshes loaded with Model::KeepCpuGeometry are supported.");
+        }
+
+        mObjects.push_back(object);
+        mRebuildHierarchy = true;
+        mTransformsDirty = true;
+        return handle;
+    }
+
+    void SoftwareRTContext::setTransform(DynamicObjectHandle object, const glm::mat4& transform)
+    {
+        if (object >= mObjects.size() || mObjects[object].dynamic == false)
+        {
+            logWarning("SoftwareRTContext::setTransform() - the object isn't dynamic");
+            return;
+        }
+        mObjects[object].transform = transform;
+        mObjects[object].dirty = true;
+        mTransformsDirty = true;
+    }
+
+    void SoftwareRTContext::updateTransforms()
+    {
+        if (mTransformsDirty)
+        {
+            mBoxes.centerX.resize(mInstances.size());
+            mBoxes.centerY.resize(mInstances.size());
+            mBoxes.centerZ.resize(mInstances.size());
+            mBoxes.extentX.resize(mInstances.size());
+            mBoxes.extentY.resize(mInstances.size());
+            mBoxes.extentZ.resize(mInstances.size());
+
+            for (Object& object : mObjects)
+            {
+                if (object.dirty == false)
+                {
+                    continue;
+                }
+
+                for (uint32_t i = object.firstInstance; i < object.firstInstance + object.instanceCount; i++)
+                {
+                    Instance& instance = mInstances[i];
+                    const glm::mat4 objectToWorld = object.transform * instance.meshTransform;
+                    instance.worldToObject = glm::inverse(objectToWorld);
+
+                    // World bounds of the transformed object-space bounds
+                    const Bvh::Node& root = instance.pBvh->getBvh().getNodes()[0];
+                    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+                    for (uint32_t corner = 0; corner < 8; corner++)
+                    {
+                        glm::vec3 p((corner & 1) ? root.boundsMax.x : root.boundsMin.x, (corner & 2) ? root.boundsMax.y : root.boundsMin.y, (corner & 4) ? root.boundsMax.z : root.boundsMin.z);
+                        p = glm::vec3(objectToWorld * glm::vec4(p, 1.0f));
+                        boundsMin = glm::min(boundsMin, p);
+                        boundsMax = glm::max(boundsMax, p);
+                    }
+
+                    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+                    const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+                    mBoxes.centerX[i] = center.x;
+                    mBoxes.centerY[i] = center.y;
+                    mBoxes.centerZ[i] = center.z;
+                    mBoxes.extentX[i] = extent.x;
+                    mBoxes.extentY[i] = extent.y;
+                    mBoxes.extentZ[i] = extent.z;
+                }
+                object.dirty = false;
+            }
+        }
+
+        if (mRebuildHierarchy)
+        {
+            mpTopLevelBvh->build(getBoxes(), 1);
+        }
+        else if (mTransformsDirty)
+        {
+            mpTopLevelBvh->refit(getBoxes());
+        }
+        mRebuildHierarchy = false;
+        mTransformsDirty = false;
+    }
+
+    BoundingBoxArrays SoftwareRTContext::getBoxes() const
+    {
+        BoundingBoxArrays boxes;
+        boxes.pCenterX = mBoxes.centerX.data();
+        boxes.pCenterY = mBoxes.centerY.data();
+        boxes.pCenterZ = mBoxes.centerZ.data();
+        boxes.pExtentX = mBoxes.extentX.data();
+        boxes.pExtentY = mBoxes.extentY.data();
+        boxes.pExtentZ = mBoxes.extentZ.data();
+        boxes.count = (uint32_t)mInstances.size();
+        return boxes;
+    }
+
+    uint64_t SoftwareRTContext::getTriangleCount() const
+    {
+        uint64_t count = 0;
+        for (const Instance& instance : mInstances)
+        {
+            count += instance.pBvh->getTriangleCount();
+        }
+        return count;
+    }
+
+    uint32_t SoftwareRTContext::tracePacket(RayPacket4& packet, PacketHits& hits, bool anyHit) const
+    {
+        assert(mRebuildHierarchy == false && mTransformsDirty == false);
+        uint32_t hitMask = 0;
+
+        traversePacket(*mpTopLevelBvh, packet, [&](uint32_t instanceID, RayPacket4& worldPacket)
+        {
+            const Instance& instance = mInstances[instanceID];
+            RayPacket4 objectPacket;
+            transformPacket(worldPacket, instance.worldToObject, objectPacket);
+
+            TriangleBvh::PacketHit triangleHits;
+            const uint32_t mask = instance.pBvh->intersectPacket(objectPacket, triangleHits, anyHit);
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1 << lane))
+                {
+                    worldPacket.tMax[lane] = objectPacket.tMax[lane];
+                    hits.instance[lane] = instanceID;
+                    hits.triangleID[lane] = triangleHits.triangleID[lane];
+                    hits.barycentrics[lane] = triangleHits.barycentrics[lane];
+                }
+            }
+            worldPacket.activeMask = objectPacket.activeMask;
+            hitMask |= mask;
+        });
+
+        return hitMask;
+    }
+
+    SoftwareRTContext::Hit SoftwareRTContext::getHit(const RayPacket4& packet, const PacketHits& hits, uint32_t lane) const
+    {
+        const Instance& instance = mInstances[hits.instance[lane]];
+        Hit hit;
+        hit.object = instance.object;
+        hit.meshID = instance.meshID;
+        hit.meshInstanceID = instance.meshInstanceID;
+        hit.triangleID = hits.triangleID[lane];
+        hit.t = packet.tMax[lane];
+        hit.barycentrics = hits.barycentrics[lane];
+        return hit;
+    }
+
+    void SoftwareRTContext::traceClosestHit(const Ray* pRays, uint32_t rayCount, Hit* pHits) const
+    {
+        const uint32_t packetCount = (rayCount + 3) / 4;
+        ThreadPool::getGlobalPool().parallelFor(packetCount, kPacketsPerChunk, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t packetID = begin; packetID < end; packetID++)
+            {
+                const uint32_t first = packetID * 4;
+                const uint32_t laneCount = std::min(4u, rayCount - first);
+
+                RayPacket4 packet;
+                packet.clear();
+                for (uint32_t lane = 0; lane < laneCount; lane++)
+                {
+                    packet.setRay(lane, pRays[first + lane].origin, pRays[first + lane].direction, pRays[first + lane].tMax);
+                }
+
+                PacketHits hits;
+                const uint32_t hitMask = tracePacket(packet, hits, false);
+                for (uint32_t lane = 0; lane < laneCount; lane++)
+                {
+                    pHits[first + lane] = (hitMask & (1 << lane)) ? getHit(packet, hits, lane) : Hit();
+                }
+            }
+        });
+    }
+
+    void SoftwareRTContext::traceAnyHit(const Ray* pRays, uint32_t rayCount, uint8_t* pOccluded) const
+    {
+        const uint32_t packetCount = (rayCount + 3) / 4;
+        ThreadPool::getGlobalPool().parallelFor(packetCount, kPacketsPerChunk, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t packetID = begin; packetID < end; packetID++)
+            {
+                const uint32_t first = packetID * 4;
+                const uint32_t laneCount = std::min(4u, rayCount - first);
+
+                RayPacket4 packet;
+                packet.clear();
+                for (uint32_t lane = 0; lane < laneCount; lane++)
+                {
+                    packet.setRay(lane, pRays[first + lane].origin, pRays[first + lane].direction, pRays[first + lane].tMax);
+                }
+
+                PacketHits hits;
+                const uint32_t hitMask = tracePacket(packet, hits, true);
+                for (uint32_t lane = 0; lane < laneCount; lane++)
+                {
+                    pOccluded[first + lane] = (hitMask & (1 << lane)) ? 1 : 0;
+                }
+            }
+        });
+    }
+
+    void SoftwareRTContext::traceCameraRays(const Camera* pCamera, uint32_t width, uint32_t height, std::vector<Hit>& hits) const
+    {
+        hits.resize(width * height);
+        const glm::mat4 invViewProj = pCamera->getInvViewProjMatrix();
+        const uint32_t tilesX = (width + kTileSize - 1) / kTileSize;
+        const uint32_t tilesY = (height + kTileSize - 1) / kTileSize;
+
+        ThreadPool::getGlobalPool().parallelFor(tilesX * tilesY, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t tile = begin; tile < end; tile++)
+            {
+                const uint32_t tileX = (tile % tilesX) * kTileSize;
+                const uint32_t tileY = (tile / tilesX) * kTileSize;
+                for (uint32_t quadY = tileY; quadY < std::min(tileY + kTileSize, height); quadY += 2)
+                {
+                    for (uint32_t quadX = tileX; quadX < std::min(tileX + kTileSize, width); quadX += 2)
+                    {
+                        RayPacket4 packet;
+                        packet.clear();
+                        for (uint32_t lane = 0; lane < 4; lane++)
+                        {
+                            const uint32_t x = quadX + (lane & 1);
+                            const uint32_t y = quadY + (lane >> 1);
+                            if (x >= width || y >= height)
+                            {
+                                continue;
+                            }
+
+                            // Depth goes from 0 at the near plane to 1 at the far plane
+                            const glm::vec2 ndc(((float)x + 0.5f) / (float)width * 2.0f - 1.0f, 1.0f - ((float)y + 0.5f) / (float)height * 2.0f);
+                            glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+                            glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+                            const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+                            const glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+                            packet.setRay(lane, origin, target - origin, 1.0f);
+                        }
+
+                        PacketHits packetHits;
+                        const uint32_t hitMask = tracePacket(packet, packetHits, false);
+                        for (uint32_t lane = 0; lane < 4; lane++)
+                        {
+                            const uint32_t x = quadX + (lane & 1);
+                            const uint32_t y = quadY + (lane >> 1);
+                            if (x < width && y < height)
+                            {
+                                hits[y * width + x] = (hitMask & (1 << lane)) ? getHit(packet, packetHits, lane) : Hit();
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
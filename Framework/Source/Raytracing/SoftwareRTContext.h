@@ -0,0 +1,183 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cfloat>
+#include <memory>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Graphics/Scene/Scene.h"
+#include "Utils/Math/Bvh.h"
+#include "Utils/Math/RayPacket.h"
+
+namespace Falcor
+{
+    class Camera;
+    class TriangleBvh;
+
+    /** CPU ray tracing backend. It has the scene entry points of RT::RTContext, but runs without OptiX or a GPU.
+        Every mesh is intersected through its object-space TriangleBvh. A second hierarchy over the world-space bounds of the mesh instances forms the top level.
+        Rays are traced in packets of four with SSE, and ray streams are split across the global thread pool.
+        Meshes need a CPU copy of their geometry, so load the models with Model::KeepCpuGeometry. Skinned meshes and meshes which aren't triangle lists are skipped.
+    */
+    class SoftwareRTContext
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SoftwareRTContext>;
+        using ObjectHandle = uint32_t;
+        using DynamicObjectHandle = uint32_t;
+
+        static const uint32_t kInvalidHandle = (uint32_t)-1;
+
+        struct Ray
+        {
+            glm::vec3 origin;
+            glm::vec3 direction;    ///< Doesn't need to be normalized. Distances are in multiples of the direction length.
+            float tMax = FLT_MAX;
+        };
+
+        struct Hit
+        {
+            ObjectHandle object = kInvalidHandle;   ///< The handle returned when the object was added
+            uint32_t meshID = 0;                    ///< Index of the mesh in the object's model
+            uint32_t meshInstanceID = 0;            ///< Instance of the mesh in the model
+            uint32_t triangleID = 0;                ///< Index of the triangle in the mesh
+            float t = 0;                            ///< Hit distance
+            glm::vec2 barycentrics;                 ///< Weights of the triangle's second and third vertex. The first vertex weight is 1 - x - y.
+
+            bool isValid() const { return object != kInvalidHandle; }
+        };
+
+        static SharedPtr create();
+
+        /** Remove all the objects
+        */
+        void newScene();
+
+        /** Replace the objects with the model instances of a scene, and update the hierarchy. Only the geometry is imported.
+        */
+        void newScene(const Scene::SharedPtr& pScene);
+
+        /** Add a static object. Call updateTransforms() before tracing.
+            \return The object handle, reported in the hits
+        */
+        ObjectHandle addObject(const Model::SharedPtr& pModel, const Scene::ModelInstance& instance);
+
+        /** Add an object whose transform can change. It starts with the identity transform. Call updateTransforms() before tracing.
+            \return The object handle, reported in the hits
+        */
+        DynamicObjectHandle addDynamicObject(const Model::SharedPtr& pModel);
+
+        /** Set the object-to-world transform of a dynamic object. The transform must be affine. Takes effect on the next updateTransforms().
+        */
+        void setTransform(DynamicObjectHandle object, const glm::mat4& transform);
+
+        /** Apply the transform changes and update the top-level hierarchy. Adding objects rebuilds it, moving objects only refits it.
+        */
+        void updateTransforms();
+
+        /** Find the closest hit of every ray. Rays are traced in packets of four consecutive rays, so coherent rays should be next to each other.
+            \param[in] pRays The rays
+            \param[in] rayCount Number of rays
+            \param[out] pHits The hits, one per ray. Rays which didn't hit anything get an invalid hit.
+        */
+        void traceClosestHit(const Ray* pRays, uint32_t rayCount, Hit* pHits) const;
+
+        /** Check which rays hit anything. Traversal stops at the first hit, which is faster than traceClosestHit() for shadow and visibility rays.
+            \param[out] pOccluded One value per ray, 1 if the ray hit something
+        */
+        void traceAnyHit(const Ray* pRays, uint32_t rayCount, uint8_t* pOccluded) const;
+
+        /** Trace the primary rays of a camera. The image is split into 8x8 pixel tiles which are traced in parallel, with a packet per 2x2 pixel quad.
+            Rays go from the near plane to the far plane, and hit distances are fractions of that segment.
+            \param[out] hits The closest hits, in row-major pixel order
+        */
+        void traceCameraRays(const Camera* pCamera, uint32_t width, uint32_t height, std::vector<Hit>& hits) const;
+
+        /** Get the number of objects
+        */
+        uint32_t getObjectCount() const { return (uint32_t)mObjects.size(); }
+
+        /** Get the number of mesh instances in the top-level hierarchy
+        */
+        uint32_t getInstanceCount() const { return (uint32_t)mInstances.size(); }
+
+        /** Get the number of triangles in the scene, counting every instance
+        */
+        uint64_t getTriangleCount() const;
+
+    private:
+        SoftwareRTContext();
+
+        struct Object
+        {
+            Model::SharedPtr pModel;
+            glm::mat4 transform;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            bool dynamic;
+            bool dirty;
+        };
+
+        // A mesh instance of an object. The leaves of the top-level hierarchy.
+        struct Instance
+        {
+            const TriangleBvh* pBvh;
+            glm::mat4 meshTransform;    // Transform of the mesh instance inside the model
+            glm::mat4 worldToObject;
+            ObjectHandle object;
+            uint32_t meshID;
+            uint32_t meshInstanceID;
+        };
+
+        struct PacketHits
+        {
+            uint32_t instance[4];
+            uint32_t triangleID[4];
+            glm::vec2 barycentrics[4];
+        };
+
+        ObjectHandle addObjectInternal(const Model::SharedPtr& pModel, const glm::mat4& transform, bool dynamic);
+        uint32_t tracePacket(RayPacket4& packet, PacketHits& hits, bool anyHit) const;
+        Hit getHit(const RayPacket4& packet, const PacketHits& hits, uint32_t lane) const;
+        BoundingBoxArrays getBoxes() const;
+
+        std::vector<Object> mObjects;
+        std::vector<Instance> mInstances;
+        Bvh::UniquePtr mpTopLevelBvh;
+        bool mRebuildHierarchy = false;
+        bool mTransformsDirty = false;
+
+        struct
+        {
+            std::vector<float> centerX, centerY, centerZ;
+            std::vector<float> extentX, extentY, extentZ;
+        } mBoxes;
+    };
+}
@@ -31,8 +31,10 @@
 #include <fstream>
 #include "API/Window.h"
 #include "Graphics/Program.h"
+#include "Graphics/PipelineStateCache.h"
 #include "Utils/OS.h"
 #include "API/FBO.h"
+#include "API/VariablesBuffer.h"
 #include "VR\OpenVR\VRSystem.h"
 
 namespace Falcor
@@ -196,6 +198,8 @@ namespace Falcor
         mpWindow->msgLoop();
 
         onShutdown();
+        // The cached GSOs must be released while the device is alive
+        PipelineStateCache::getGlobalCache().clear();
         Logger::shutdown();
     }
 
@@ -282,8 +286,8 @@ namespace Falcor
 			return;
 		}
 
-        GraphicsState::beginNewFrame();
         ComputeState::beginNewFrame();
+        VariablesBuffer::beginNewFrame();
 
 		mFrameRate.newFrame();
         {
@@ -400,6 +404,8 @@ namespace Falcor
         {
             std::string profileMsg;
             Profiler::endFrame(profileMsg);
+            const auto& uploadStats = VariablesBuffer::getLastFrameUploadStats();
+            profileMsg += "Variables buffers: " + std::to_string(uploadStats.bytesWritten) + " bytes written, " + std::to_string(uploadStats.bytesUploaded) + " bytes uploaded in " + std::to_string(uploadStats.uploadCount) + " copies, " + std::to_string(uploadStats.bytesCarriedOver) + " bytes carried over\n";
             renderText(profileMsg, glm::vec2(10, 300));
         }
 #endif
@@ -430,7 +436,12 @@ namespace Falcor
         mVideoCapture.pVideoCapture = VideoEncoder::create(desc);
 
         assert(mVideoCapture.pVideoCapture);
-        mVideoCapture.pFrame = new uint8_t[desc.width*desc.height * 4];
+
+        // The frames are read back asynchronously and encoded on a worker thread. Stall rather than drop frames, the captured video should be complete.
+        AsyncFrameCapture::Desc captureDesc;
+        captureDesc.policy = FrameCaptureQueue::OverflowPolicy::Stall;
+        VideoEncoder* pEncoder = mVideoCapture.pVideoCapture.get();
+        mVideoCapture.pFrameCapture = AsyncFrameCapture::create(mpDefaultFBO->getColorTexture(0).get(), captureDesc, [pEncoder](const uint8_t* pData) { pEncoder->appendFrame(pData); });
 
         mVideoCapture.timeDelta = 1 / (float)desc.fps;
 
@@ -452,19 +463,21 @@ namespace Falcor
     {
         if(mVideoCapture.pVideoCapture)
         {
+            // Encode the frames which are still in flight before closing the file
+            mVideoCapture.pFrameCapture->flush(mpRenderContext.get());
+            mVideoCapture.pFrameCapture = nullptr;
             mVideoCapture.pVideoCapture->endCapture();
             mShowUI = true;
         }
         mVideoCapture.pUI = nullptr;
         mVideoCapture.pVideoCapture = nullptr;
-        safe_delete_array(mVideoCapture.pFrame);
     }
 
     void Sample::captureVideoFrame()
     {
         if(mVideoCapture.pVideoCapture)
         {
-            mVideoCapture.pVideoCapture->appendFrame(mpRenderContext->readTextureSubresource(mpDefaultFBO->getColorTexture(0).get(), 0).data());
+            mVideoCapture.pFrameCapture->captureFrame(mpRenderContext.get(), mpDefaultFBO->getColorTexture(0).get());
 
             if(mVideoCapture.pUI->useTimeRange())
             {
@@ -36,6 +36,7 @@
 #include "utils/TextRenderer.h"
 #include "API/RenderContext.h"
 #include "Utils/Video/VideoEncoderUI.h"
+#include "Utils/Video/AsyncFrameCapture.h"
 #include "API/Device.h"
 #include "ArgList.h"
 
@@ -192,7 +193,7 @@ namespace Falcor
         {
             VideoEncoderUI::UniquePtr pUI;
             VideoEncoder::UniquePtr pVideoCapture;
-            uint8_t* pFrame = nullptr;
+            AsyncFrameCapture::UniquePtr pFrameCapture;     // Reads back the frames and encodes them on a worker thread
             float timeDelta;
         };
 
@@ -99,4 +99,17 @@ namespace Falcor
             return BoundingBox::fromMinMax( min(bb0.getMinPos(), bb1.getMinPos()), max(bb0.getMaxPos(), bb1.getMaxPos()) );
         }
     };
+
+    /** Structure-of-arrays view of a list of bounding boxes. Used for batched operations.
+    */
+    struct BoundingBoxArrays
+    {
+        const float* pCenterX = nullptr;
+        const float* pCenterY = nullptr;
+        const float* pCenterZ = nullptr;
+        const float* pExtentX = nullptr;
+        const float* pExtentY = nullptr;
+        const float* pExtentZ = nullptr;
+        uint32_t count = 0;
+    };
 }
\ No newline at end of file
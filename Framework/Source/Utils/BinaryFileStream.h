@@ -89,6 +89,11 @@ namespace Falcor
 			return (uint32_t)(length - currentPos); 
 		}
 
+        /** Get/set the position of the write pointer, in bytes from the beginning of the file
+        */
+        uint64_t getWritePosition() { return (uint64_t)mStream.tellp(); }
+        void setWritePosition(uint64_t position) { mStream.seekp(position); }
+
         bool isGood() { return mStream.good(); }
         bool isBad()  { return mStream.bad(); }
         bool isFail() { return mStream.fail(); }
@@ -0,0 +1,125 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstring>
+
+namespace Falcor
+{
+    /** Read-only binary stream over a block of memory, usually a MemoryMappedFile. Provides the same read interface as BinaryFileStream.
+        In addition to copying reads, getPointer() returns the data in place, so large blocks can be consumed without copying them.
+        Reading past the end of the block puts the stream in a failed state and returns zeros.
+    */
+    class BinaryMemoryStream
+    {
+    public:
+        BinaryMemoryStream() {};
+        BinaryMemoryStream(const uint8_t* pData, size_t size) { open(pData, size); }
+
+        void open(const uint8_t* pData, size_t size)
+        {
+            mpData = pData;
+            mSize = size;
+            mOffset = 0;
+            mFailed = false;
+        }
+
+        void skip(size_t count)
+        {
+            getPointer(count);
+        }
+
+        /** Get a pointer to the next count bytes and advance the stream
+            \return A pointer into the memory block, or nullptr if there are less than count bytes left
+        */
+        const uint8_t* getPointer(size_t count)
+        {
+            if (mFailed || count > mSize - mOffset)
+            {
+                mFailed = true;
+                return nullptr;
+            }
+            const uint8_t* pData = mpData + mOffset;
+            mOffset += count;
+            return pData;
+        }
+
+        size_t getRemainingStreamSize() const { return mSize - mOffset; }
+        size_t getOffset() const { return mOffset; }
+
+        /** Move the read position. Offsets past the end of the block put the stream in a failed state.
+        */
+        void setOffset(uint64_t offset)
+        {
+            if (offset > mSize)
+            {
+                mFailed = true;
+                return;
+            }
+            mOffset = (size_t)offset;
+        }
+
+        /** Get a pointer to count bytes at an absolute offset without moving the read position
+            \return A pointer into the memory block, or nullptr if the range is outside the block
+        */
+        const uint8_t* getPointerAt(uint64_t offset, uint64_t count) const
+        {
+            if (offset > mSize || count > mSize - offset)
+            {
+                return nullptr;
+            }
+            return mpData + offset;
+        }
+
+        bool isGood() const { return mFailed == false; }
+        bool isFail() const { return mFailed; }
+        bool isEof() const { return mOffset == mSize; }
+
+        BinaryMemoryStream& read(void* pData, size_t count)
+        {
+            const uint8_t* pSrc = getPointer(count);
+            if (pSrc)
+            {
+                std::memcpy(pData, pSrc, count);
+            }
+            else
+            {
+                std::memset(pData, 0, count);
+            }
+            return *this;
+        }
+
+        template<typename T>
+        BinaryMemoryStream& operator>>(T& val) { return read(&val, sizeof(T)); }
+
+    private:
+        const uint8_t* mpData = nullptr;
+        size_t mSize = 0;
+        size_t mOffset = 0;
+        bool mFailed = false;
+    };
+}
@@ -0,0 +1,388 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Bvh.h"
+#include "Graphics/Camera/Camera.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Falcor
+{
+    static const uint32_t kBinCount = 12;
+
+    static glm::vec3 getBoxMin(const BoundingBoxArrays& boxes, uint32_t i)
+    {
+        return glm::vec3(boxes.pCenterX[i] - boxes.pExtentX[i], boxes.pCenterY[i] - boxes.pExtentY[i], boxes.pCenterZ[i] - boxes.pExtentZ[i]);
+    }
+
+    static glm::vec3 getBoxMax(const BoundingBoxArrays& boxes, uint32_t i)
+    {
+        return glm::vec3(boxes.pCenterX[i] + boxes.pExtentX[i], boxes.pCenterY[i] + boxes.pExtentY[i], boxes.pCenterZ[i] + boxes.pExtentZ[i]);
+    }
+
+    static float getSurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    static bool intersectSlabs(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEntry)
+    {
+        glm::vec3 t0 = (boundsMin - origin) * invDir;
+        glm::vec3 t1 = (boundsMax - origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        tEntry = max(max(tNear.x, tNear.y), max(tNear.z, 0.0f));
+        float tExit = min(min(tFar.x, tFar.y), min(tFar.z, tMax));
+        return tEntry <= tExit;
+    }
+
+    Bvh::UniquePtr Bvh::create()
+    {
+        return UniquePtr(new Bvh());
+    }
+
+    void Bvh::computeNodeBounds(Node& node, const BoundingBoxArrays& boxes) const
+    {
+        node.boundsMin = glm::vec3(FLT_MAX);
+        node.boundsMax = glm::vec3(-FLT_MAX);
+        for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+        {
+            node.boundsMin = glm::min(node.boundsMin, getBoxMin(boxes, mPrimitives[i]));
+            node.boundsMax = glm::max(node.boundsMax, getBoxMax(boxes, mPrimitives[i]));
+        }
+    }
+
+    void Bvh::build(const BoundingBoxArrays& boxes, uint32_t maxLeafSize)
+    {
+        mNodes.clear();
+        mPrimitives.resize(boxes.count);
+        if (boxes.count == 0)
+        {
+            return;
+        }
+
+        std::vector<glm::vec3> centroids(boxes.count);
+        for (uint32_t i = 0; i < boxes.count; i++)
+        {
+            mPrimitives[i] = i;
+            centroids[i] = glm::vec3(boxes.pCenterX[i], boxes.pCenterY[i], boxes.pCenterZ[i]);
+        }
+
+        // A binary tree with N leaves has 2N-1 nodes
+        mNodes.reserve(2 * ((boxes.count + maxLeafSize - 1) / maxLeafSize));
+
+        Node root;
+        root.firstPrimitive = 0;
+        root.primitiveCount = boxes.count;
+        root.leftChild = kInvalidNode;
+        mNodes.push_back(root);
+
+        std::vector<uint32_t> stack;
+        stack.push_back(0);
+        while (stack.empty() == false)
+        {
+            uint32_t nodeID = stack.back();
+            stack.pop_back();
+
+            computeNodeBounds(mNodes[nodeID], boxes);
+            if (splitNode(nodeID, centroids, boxes, maxLeafSize))
+            {
+                stack.push_back(mNodes[nodeID].leftChild);
+                stack.push_back(mNodes[nodeID].leftChild + 1);
+            }
+        }
+    }
+
+    bool Bvh::splitNode(uint32_t nodeID, const std::vector<glm::vec3>& centroids, const BoundingBoxArrays& boxes, uint32_t maxLeafSize)
+    {
+        const Node node = mNodes[nodeID];
+        if (node.primitiveCount <= maxLeafSize)
+        {
+            return false;
+        }
+
+        // Find the axis with the largest centroid extent
+        glm::vec3 centroidMin(FLT_MAX);
+        glm::vec3 centroidMax(-FLT_MAX);
+        for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+        {
+            centroidMin = glm::min(centroidMin, centroids[mPrimitives[i]]);
+            centroidMax = glm::max(centroidMax, centroids[mPrimitives[i]]);
+        }
+
+        glm::vec3 centroidExtent = centroidMax - centroidMin;
+        uint32_t axis = 0;
+        if (centroidExtent.y > centroidExtent[axis]) axis = 1;
+        if (centroidExtent.z > centroidExtent[axis]) axis = 2;
+
+        auto first = mPrimitives.begin() + node.firstPrimitive;
+        auto last = first + node.primitiveCount;
+        auto middle = first + node.primitiveCount / 2;
+
+        if (centroidExtent[axis] <= 0)
+        {
+            // All centroids are at the same position, split in the middle of the list
+        }
+        else
+        {
+            // Bin the primitives
+            struct Bin
+            {
+                glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+                glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+                uint32_t count = 0;
+            } bins[kBinCount];
+
+            const float binScale = (float)kBinCount / centroidExtent[axis];
+            auto getBin = [&](uint32_t primitive)
+            {
+                uint32_t bin = (uint32_t)((centroids[primitive][axis] - centroidMin[axis]) * binScale);
+                return min(bin, kBinCount - 1);
+            };
+
+            for (auto it = first; it != last; it++)
+            {
+                Bin& bin = bins[getBin(*it)];
+                bin.boundsMin = glm::min(bin.boundsMin, getBoxMin(boxes, *it));
+                bin.boundsMax = glm::max(bin.boundsMax, getBoxMax(boxes, *it));
+                bin.count++;
+            }
+
+            // Sweep from the right to get the area and count of every right side
+            float rightArea[kBinCount];
+            uint32_t rightCount[kBinCount];
+            glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+            uint32_t count = 0;
+            for (uint32_t i = kBinCount - 1; i > 0; i--)
+            {
+                boundsMin = glm::min(boundsMin, bins[i].boundsMin);
+                boundsMax = glm::max(boundsMax, bins[i].boundsMax);
+                count += bins[i].count;
+                rightArea[i] = getSurfaceArea(boundsMin, boundsMax);
+                rightCount[i] = count;
+            }
+
+            // Sweep from the left and evaluate the SAH cost of splitting before every bin
+            uint32_t bestSplit = 0;
+            float bestCost = FLT_MAX;
+            boundsMin = glm::vec3(FLT_MAX);
+            boundsMax = glm::vec3(-FLT_MAX);
+            count = 0;
+            for (uint32_t i = 1; i < kBinCount; i++)
+            {
+                boundsMin = glm::min(boundsMin, bins[i - 1].boundsMin);
+                boundsMax = glm::max(boundsMax, bins[i - 1].boundsMax);
+                count += bins[i - 1].count;
+                if (count == 0 || rightCount[i] == 0)
+                {
+                    continue;
+                }
+
+                float cost = count * getSurfaceArea(boundsMin, boundsMax) + rightCount[i] * rightArea[i];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = i;
+                }
+            }
+
+            if (bestSplit != 0)
+            {
+                middle = std::partition(first, last, [&](uint32_t primitive) { return getBin(primitive) < bestSplit; });
+            }
+            else
+            {
+                // Every primitive landed in the same bin. Fall back to a median split.
+                std::nth_element(first, middle, last, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+            }
+        }
+
+        Node left;
+        left.firstPrimitive = node.firstPrimitive;
+        left.primitiveCount = (uint32_t)(middle - first);
+        left.leftChild = kInvalidNode;
+
+        Node right;
+        right.firstPrimitive = left.firstPrimitive + left.primitiveCount;
+        right.primitiveCount = node.primitiveCount - left.primitiveCount;
+        right.leftChild = kInvalidNode;
+
+        mNodes[nodeID].leftChild = (uint32_t)mNodes.size();
+        mNodes.push_back(left);
+        mNodes.push_back(right);
+        return true;
+    }
+
+    void Bvh::refit(const BoundingBoxArrays& boxes)
+    {
+        assert(boxes.count == mPrimitives.size());
+
+        // Children are always stored after their parent, so a reverse walk visits them first
+        for (size_t i = mNodes.size(); i > 0; i--)
+        {
+            Node& node = mNodes[i - 1];
+            if (node.isLeaf())
+            {
+                computeNodeBounds(node, boxes);
+            }
+            else
+            {
+                const Node& left = mNodes[node.leftChild];
+                const Node& right = mNodes[node.leftChild + 1];
+                node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+                node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+            }
+        }
+    }
+
+    void Bvh::cullFrustum(const Camera* pCamera, const BoundingBoxArrays& boxes, uint32_t* pCulledMask) const
+    {
+        const uint32_t wordCount = (boxes.count + 31) / 32;
+        std::fill(pCulledMask, pCulledMask + wordCount, 0xFFFFFFFF);
+        if (mNodes.empty())
+        {
+            return;
+        }
+
+        auto setVisible = [pCulledMask](uint32_t primitive) { pCulledMask[primitive >> 5] &= ~(1u << (primitive & 31)); };
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.back()];
+            stack.pop_back();
+            Camera::FrustumTest result = pCamera->testBoundingBox(BoundingBox::fromMinMax(node.boundsMin, node.boundsMax));
+
+            if (result == Camera::FrustumTest::Outside)
+            {
+                continue;
+            }
+
+            if (result == Camera::FrustumTest::Inside)
+            {
+                // The entire subtree is visible
+                for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+                {
+                    setVisible(mPrimitives[i]);
+                }
+            }
+            else if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+                {
+                    const uint32_t primitive = mPrimitives[i];
+                    BoundingBox box;
+                    box.center = glm::vec3(boxes.pCenterX[primitive], boxes.pCenterY[primitive], boxes.pCenterZ[primitive]);
+                    box.extent = glm::vec3(boxes.pExtentX[primitive], boxes.pExtentY[primitive], boxes.pExtentZ[primitive]);
+                    if (pCamera->isObjectCulled(box) == false)
+                    {
+                        setVisible(primitive);
+                    }
+                }
+            }
+            else
+            {
+                stack.push_back(node.leftChild);
+                stack.push_back(node.leftChild + 1);
+            }
+        }
+    }
+
+    float Bvh::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, const BoundingBoxArrays& boxes, const RayCallback& callback) const
+    {
+        if (mNodes.empty())
+        {
+            return tMax;
+        }
+
+        const glm::vec3 invDir = 1.0f / direction;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            float tEntry;
+        };
+        std::vector<StackEntry> stack;
+        stack.reserve(64);
+
+        float tEntry;
+        if (intersectSlabs(mNodes[0].boundsMin, mNodes[0].boundsMax, origin, invDir, tMax, tEntry))
+        {
+            stack.push_back({ 0, tEntry });
+        }
+
+        while (stack.empty() == false)
+        {
+            const StackEntry entry = stack.back();
+            stack.pop_back();
+            if (entry.tEntry > tMax)
+            {
+                continue;
+            }
+
+            const Node& node = mNodes[entry.node];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+                {
+                    const uint32_t primitive = mPrimitives[i];
+                    if (intersectSlabs(getBoxMin(boxes, primitive), getBoxMax(boxes, primitive), origin, invDir, tMax, tEntry))
+                    {
+                        tMax = callback(primitive, tMax);
+                    }
+                }
+            }
+            else
+            {
+                float tLeft, tRight;
+                const Node& left = mNodes[node.leftChild];
+                const Node& right = mNodes[node.leftChild + 1];
+                bool hitLeft = intersectSlabs(left.boundsMin, left.boundsMax, origin, invDir, tMax, tLeft);
+                bool hitRight = intersectSlabs(right.boundsMin, right.boundsMax, origin, invDir, tMax, tRight);
+
+                // Push the far child first so the near one is visited first
+                if (hitLeft && hitRight && tLeft < tRight)
+                {
+                    stack.push_back({ node.leftChild + 1, tRight });
+                    stack.push_back({ node.leftChild, tLeft });
+                }
+                else
+                {
+                    if (hitLeft) stack.push_back({ node.leftChild, tLeft });
+                    if (hitRight) stack.push_back({ node.leftChild + 1, tRight });
+                }
+            }
+        }
+
+        return tMax;
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include "glm/vec3.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** Bounding volume hierarchy over a list of axis-aligned bounding boxes.
+        The hierarchy is built using the binned surface-area-heuristic. When the boxes move but the list doesn't change, call refit() to update the node bounds without rebuilding the tree.
+    */
+    class Bvh
+    {
+    public:
+        using UniquePtr = std::unique_ptr<Bvh>;
+        using UniqueConstPtr = std::unique_ptr<const Bvh>;
+
+        static const uint32_t kInvalidNode = (uint32_t)-1;
+
+        struct Node
+        {
+            glm::vec3 boundsMin;
+            uint32_t firstPrimitive;    ///< Index of the first primitive of the subtree in the primitive order. Every subtree covers a contiguous range.
+            glm::vec3 boundsMax;
+            uint32_t primitiveCount;    ///< Number of primitives in the subtree
+            uint32_t leftChild;         ///< kInvalidNode for leaves. The right child is always leftChild + 1.
+
+            bool isLeaf() const { return leftChild == kInvalidNode; }
+        };
+
+        /** Called for every primitive whose bounding box is hit by a ray.
+            \param[in] primitiveID Index of the primitive in the list the BVH was built with
+            \param[in] tMax The closest hit distance found so far
+            \return The new closest hit distance. Return tMax if the primitive wasn't hit.
+        */
+        using RayCallback = std::function<float(uint32_t primitiveID, float tMax)>;
+
+        static UniquePtr create();
+
+        /** Build the hierarchy
+            \param[in] boxes The primitive bounding boxes
+            \param[in] maxLeafSize Maximum number of primitives in a leaf
+        */
+        void build(const BoundingBoxArrays& boxes, uint32_t maxLeafSize = 4);
+
+        /** Update the node bounds after the primitive boxes changed. The number of boxes must match the one the hierarchy was built with.
+        */
+        void refit(const BoundingBoxArrays& boxes);
+
+        /** Hierarchical frustum culling. Subtrees outside of the frustum are skipped, subtrees completely inside the frustum are accepted without testing their primitives.
+            \param[in] pCamera The camera to cull against
+            \param[in] boxes The primitive bounding boxes. Must be the same boxes the hierarchy was built or refitted with.
+            \param[out] pCulledMask Bitmask with a bit per primitive. Bit i is set if primitive i should be culled. Must hold at least (boxes.count + 31) / 32 words.
+        */
+        void cullFrustum(const Camera* pCamera, const BoundingBoxArrays& boxes, uint32_t* pCulledMask) const;
+
+        /** Traverse the hierarchy with a ray, nearest nodes first.
+            \param[in] origin Ray origin
+            \param[in] direction Ray direction. Doesn't need to be normalized, distances are expressed in multiples of the direction length.
+            \param[in] tMax Maximum hit distance
+            \param[in] boxes The primitive bounding boxes
+            \param[in] callback Called for every primitive whose bounding box is hit closer than the current closest hit
+            \return The closest hit distance returned by the callback, or tMax if nothing was hit
+        */
+        float intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, const BoundingBoxArrays& boxes, const RayCallback& callback) const;
+
+        /** Get the number of primitives the hierarchy was built with
+        */
+        uint32_t getPrimitiveCount() const { return (uint32_t)mPrimitives.size(); }
+
+        /** Get the nodes. Node 0 is the root.
+        */
+        const std::vector<Node>& getNodes() const { return mNodes; }
+
+        /** Get the primitive order. Leaves reference ranges of this array.
+        */
+        const std::vector<uint32_t>& getPrimitiveOrder() const { return mPrimitives; }
+
+    private:
+        Bvh() = default;
+
+        void computeNodeBounds(Node& node, const BoundingBoxArrays& boxes) const;
+        bool splitNode(uint32_t nodeID, const std::vector<glm::vec3>& centroids, const BoundingBoxArrays& boxes, uint32_t maxLeafSize);
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mPrimitives;
+    };
+}
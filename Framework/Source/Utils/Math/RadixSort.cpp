@@ -0,0 +1,100 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "RadixSort.h"
+
+namespace Falcor
+{
+    void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& tempKeys, std::vector<uint32_t>& tempValues)
+    {
+        assert(keys.size() == values.size());
+        const size_t count = keys.size();
+        if (count < 2)
+        {
+            return;
+        }
+
+        tempKeys.resize(count);
+        tempValues.resize(count);
+
+        // Build the histograms of all the passes in a single read of the keys
+        static const uint32_t kPassCount = 8;
+        std::vector<size_t> histograms(kPassCount * 256, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t key = keys[i];
+            for (uint32_t pass = 0; pass < kPassCount; pass++)
+            {
+                histograms[pass * 256 + ((key >> (pass * 8)) & 0xFF)]++;
+            }
+        }
+
+        uint64_t* pSrcKeys = keys.data();
+        uint32_t* pSrcValues = values.data();
+        uint64_t* pDstKeys = tempKeys.data();
+        uint32_t* pDstValues = tempValues.data();
+
+        for (uint32_t pass = 0; pass < kPassCount; pass++)
+        {
+            size_t* pHistogram = &histograms[pass * 256];
+            const uint32_t shift = pass * 8;
+
+            // All the keys have the same digit, the pass wouldn't change the order
+            if (pHistogram[(pSrcKeys[0] >> shift) & 0xFF] == count)
+            {
+                continue;
+            }
+
+            // Convert the counts to offsets
+            size_t offset = 0;
+            for (uint32_t digit = 0; digit < 256; digit++)
+            {
+                size_t digitCount = pHistogram[digit];
+                pHistogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                size_t dst = pHistogram[(pSrcKeys[i] >> shift) & 0xFF]++;
+                pDstKeys[dst] = pSrcKeys[i];
+                pDstValues[dst] = pSrcValues[i];
+            }
+
+            std::swap(pSrcKeys, pDstKeys);
+            std::swap(pSrcValues, pDstValues);
+        }
+
+        // Make sure the result ends up in the caller's vectors
+        if (pSrcKeys != keys.data())
+        {
+            keys.swap(tempKeys);
+            values.swap(tempValues);
+        }
+    }
+}
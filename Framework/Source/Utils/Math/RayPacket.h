@@ -0,0 +1,244 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <immintrin.h>
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "Utils/Math/Bvh.h"
+
+namespace Falcor
+{
+    /** Four rays in SoA layout, traced together with SSE.
+        Lanes which are not traced must be cleared from the active mask. Their data is still read, so keep it finite.
+    */
+    struct alignas(16) RayPacket4
+    {
+        float originX[4];
+        float originY[4];
+        float originZ[4];
+        float directionX[4];    ///< Directions don't need to be normalized. Distances are in multiples of the direction length.
+        float directionY[4];
+        float directionZ[4];
+        float tMax[4];          ///< Maximum hit distance. Closest-hit queries shrink it to the distance of the hit.
+        uint32_t activeMask = 0;///< Bit i is set if lane i is traced. Any-hit queries clear the bits of the lanes which hit.
+
+        /** Reset all the lanes to an inactive, finite ray
+        */
+        void clear()
+        {
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                setRay(i, glm::vec3(0), glm::vec3(1), 0);
+            }
+            activeMask = 0;
+        }
+
+        /** Set a lane and mark it as active
+        */
+        void setRay(uint32_t lane, const glm::vec3& origin, const glm::vec3& direction, float maxT)
+        {
+            originX[lane] = origin.x;
+            originY[lane] = origin.y;
+            originZ[lane] = origin.z;
+            directionX[lane] = direction.x;
+            directionY[lane] = direction.y;
+            directionZ[lane] = direction.z;
+            tMax[lane] = maxT;
+            activeMask |= 1 << lane;
+        }
+    };
+
+    /** The origins, directions and inverse directions of a packet, loaded into registers once per traversal
+    */
+    struct RayPacket4Registers
+    {
+        __m128 originX, originY, originZ;
+        __m128 directionX, directionY, directionZ;
+        __m128 invDirX, invDirY, invDirZ;
+
+        explicit RayPacket4Registers(const RayPacket4& packet)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            originX = _mm_load_ps(packet.originX);
+            originY = _mm_load_ps(packet.originY);
+            originZ = _mm_load_ps(packet.originZ);
+            directionX = _mm_load_ps(packet.directionX);
+            directionY = _mm_load_ps(packet.directionY);
+            directionZ = _mm_load_ps(packet.directionZ);
+            invDirX = _mm_div_ps(one, directionX);
+            invDirY = _mm_div_ps(one, directionY);
+            invDirZ = _mm_div_ps(one, directionZ);
+        }
+    };
+
+    /** Slab test of the four rays against a box
+        \param[out] tEntry Distance at which every ray enters the box
+        \return Lane mask of the rays which enter the box before tMax
+    */
+    inline uint32_t intersectBox4(const RayPacket4Registers& rays, const glm::vec3& boundsMin, const glm::vec3& boundsMax, __m128 tMax, __m128& tEntry)
+    {
+        const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), rays.originX), rays.invDirX);
+        const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.x), rays.originX), rays.invDirX);
+        const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), rays.originY), rays.invDirY);
+        const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.y), rays.originY), rays.invDirY);
+        const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), rays.originZ), rays.invDirZ);
+        const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.z), rays.originZ), rays.invDirZ);
+
+        __m128 tNear = _mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y));
+        tNear = _mm_max_ps(tNear, _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+        __m128 tFar = _mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y));
+        tFar = _mm_min_ps(tFar, _mm_min_ps(_mm_max_ps(t0z, t1z), tMax));
+
+        tEntry = tNear;
+        return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+    }
+
+    /** Traverse a hierarchy with a packet, nearest nodes first. A node is visited if any active ray enters its box.
+        \param[in] bvh The hierarchy
+        \param[in,out] packet The rays
+        \param[in] leafFunc Called as leafFunc(primitiveID, packet) for the primitives of the visited leaves. It updates the packet's tMax and active mask.
+    */
+    template<typename LeafFunc>
+    void traversePacket(const Bvh& bvh, RayPacket4& packet, LeafFunc leafFunc)
+    {
+        const std::vector<Bvh::Node>& nodes = bvh.getNodes();
+        if (nodes.empty() || packet.activeMask == 0)
+        {
+            return;
+        }
+
+        const uint32_t* pPrimitives = bvh.getPrimitiveOrder().data();
+        const RayPacket4Registers rays(packet);
+
+        // The largest hit distance of the active lanes. A node whose entry is farther can't produce a closer hit for any of them.
+        auto getMaxDistance = [&packet]()
+        {
+            float maxT = 0;
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (packet.activeMask & (1 << lane)) maxT = std::max(maxT, packet.tMax[lane]);
+            }
+            return maxT;
+        };
+
+        auto getMinEntry = [](__m128 tEntry, uint32_t mask)
+        {
+            alignas(16) float entries[4];
+            _mm_store_ps(entries, tEntry);
+            float minT = FLT_MAX;
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1 << lane)) minT = std::min(minT, entries[lane]);
+            }
+            return minT;
+        };
+
+        struct StackEntry
+        {
+            uint32_t node;
+            float tEntry;
+        };
+        static const uint32_t kLocalStackSize = 64;
+        StackEntry localStack[kLocalStackSize];
+        std::vector<StackEntry> overflowStack;
+        uint32_t stackSize = 0;
+        auto push = [&](uint32_t node, float tEntry)
+        {
+            if (stackSize < kLocalStackSize) localStack[stackSize] = { node, tEntry };
+            else overflowStack.push_back({ node, tEntry });
+            stackSize++;
+        };
+
+        __m128 tMax = _mm_load_ps(packet.tMax);
+        __m128 tEntry;
+        uint32_t mask = intersectBox4(rays, nodes[0].boundsMin, nodes[0].boundsMax, tMax, tEntry) & packet.activeMask;
+        if (mask)
+        {
+            push(0, getMinEntry(tEntry, mask));
+        }
+
+        float maxDistance = getMaxDistance();
+        while (stackSize)
+        {
+            stackSize--;
+            StackEntry entry;
+            if (stackSize < kLocalStackSize)
+            {
+                entry = localStack[stackSize];
+            }
+            else
+            {
+                entry = overflowStack.back();
+                overflowStack.pop_back();
+            }
+
+            if (entry.tEntry > maxDistance)
+            {
+                continue;
+            }
+
+            const Bvh::Node& node = nodes[entry.node];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+                {
+                    leafFunc(pPrimitives[i], packet);
+                    if (packet.activeMask == 0)
+                    {
+                        return;
+                    }
+                }
+                tMax = _mm_load_ps(packet.tMax);
+                maxDistance = getMaxDistance();
+                continue;
+            }
+
+            __m128 tLeft, tRight;
+            const Bvh::Node& left = nodes[node.leftChild];
+            const Bvh::Node& right = nodes[node.leftChild + 1];
+            const uint32_t leftMask = intersectBox4(rays, left.boundsMin, left.boundsMax, tMax, tLeft) & packet.activeMask;
+            const uint32_t rightMask = intersectBox4(rays, right.boundsMin, right.boundsMax, tMax, tRight) & packet.activeMask;
+            const float leftEntry = getMinEntry(tLeft, leftMask);
+            const float rightEntry = getMinEntry(tRight, rightMask);
+
+            // Push the far child first so the near one is visited first
+            if (leftMask && rightMask && leftEntry < rightEntry)
+            {
+                push(node.leftChild + 1, rightEntry);
+                push(node.leftChild, leftEntry);
+            }
+            else
+            {
+                if (leftMask) push(node.leftChild, leftEntry);
+                if (rightMask) push(node.leftChild + 1, rightEntry);
+            }
+        }
+    }
+}
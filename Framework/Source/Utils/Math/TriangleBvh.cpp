@@ -0,0 +1,227 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TriangleBvh.h"
+#include "glm/geometric.hpp"
+#include <cmath>
+
+namespace Falcor
+{
+    // Möller-Trumbore. Returns false for rays parallel to the triangle plane.
+    static bool intersectTriangle(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2, const glm::vec3& origin, const glm::vec3& direction, float& t, glm::vec2& barycentrics)
+    {
+        glm::vec3 p = glm::cross(direction, edge2);
+        float det = glm::dot(edge1, p);
+        if (det == 0.0f)
+        {
+            return false;
+        }
+
+        float invDet = 1.0f / det;
+        glm::vec3 s = origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f)
+        {
+            return false;
+        }
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+        {
+            return false;
+        }
+
+        t = glm::dot(edge2, q) * invDet;
+        barycentrics = glm::vec2(u, v);
+        return std::isfinite(t);
+    }
+
+    // Möller-Trumbore for four rays against one triangle. Rays parallel to the triangle produce NaNs, which fail the comparisons.
+    static uint32_t intersectTriangle4(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2, const RayPacket4Registers& rays, __m128 tMax, __m128& t, __m128& u, __m128& v)
+    {
+        const __m128 e1x = _mm_set1_ps(edge1.x), e1y = _mm_set1_ps(edge1.y), e1z = _mm_set1_ps(edge1.z);
+        const __m128 e2x = _mm_set1_ps(edge2.x), e2y = _mm_set1_ps(edge2.y), e2z = _mm_set1_ps(edge2.z);
+
+        // p = cross(direction, edge2)
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(rays.directionY, e2z), _mm_mul_ps(rays.directionZ, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(rays.directionZ, e2x), _mm_mul_ps(rays.directionX, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(rays.directionX, e2y), _mm_mul_ps(rays.directionY, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // s = origin - v0
+        const __m128 sx = _mm_sub_ps(rays.originX, _mm_set1_ps(v0.x));
+        const __m128 sy = _mm_sub_ps(rays.originY, _mm_set1_ps(v0.y));
+        const __m128 sz = _mm_sub_ps(rays.originZ, _mm_set1_ps(v0.z));
+        u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+        // q = cross(s, edge1)
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rays.directionX, qx), _mm_mul_ps(rays.directionY, qy)), _mm_mul_ps(rays.directionZ, qz)), invDet);
+        t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(t, tMax));
+        return (uint32_t)_mm_movemask_ps(hit);
+    }
+
+    TriangleBvh::UniquePtr TriangleBvh::create(const glm::vec3* pPositions, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount)
+    {
+        assert(indexCount % 3 == 0);
+        const uint32_t triangleCount = indexCount / 3;
+
+        UniquePtr pBvh = UniquePtr(new TriangleBvh());
+        pBvh->mTriangles.resize(triangleCount);
+        pBvh->mBoxes.centerX.resize(triangleCount);
+        pBvh->mBoxes.centerY.resize(triangleCount);
+        pBvh->mBoxes.centerZ.resize(triangleCount);
+        pBvh->mBoxes.extentX.resize(triangleCount);
+        pBvh->mBoxes.extentY.resize(triangleCount);
+        pBvh->mBoxes.extentZ.resize(triangleCount);
+
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            const uint32_t* pTriIndices = pIndices + i * 3;
+            if (pTriIndices[0] >= vertexCount || pTriIndices[1] >= vertexCount || pTriIndices[2] >= vertexCount)
+            {
+                logError("TriangleBvh::create() - triangle " + std::to_string(i) + " references a vertex outside of the vertex array");
+                return nullptr;
+            }
+
+            const glm::vec3& v0 = pPositions[pTriIndices[0]];
+            const glm::vec3& v1 = pPositions[pTriIndices[1]];
+            const glm::vec3& v2 = pPositions[pTriIndices[2]];
+
+            Triangle& tri = pBvh->mTriangles[i];
+            tri.v0 = v0;
+            tri.edge1 = v1 - v0;
+            tri.edge2 = v2 - v0;
+
+            glm::vec3 boxMin = glm::min(glm::min(v0, v1), v2);
+            glm::vec3 boxMax = glm::max(glm::max(v0, v1), v2);
+            glm::vec3 center = (boxMin + boxMax) * 0.5f;
+            glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+            pBvh->mBoxes.centerX[i] = center.x;
+            pBvh->mBoxes.centerY[i] = center.y;
+            pBvh->mBoxes.centerZ[i] = center.z;
+            pBvh->mBoxes.extentX[i] = extent.x;
+            pBvh->mBoxes.extentY[i] = extent.y;
+            pBvh->mBoxes.extentZ[i] = extent.z;
+        }
+
+        pBvh->mpBvh = Bvh::create();
+        pBvh->mpBvh->build(pBvh->getBoxes());
+        return pBvh;
+    }
+
+    BoundingBoxArrays TriangleBvh::getBoxes() const
+    {
+        BoundingBoxArrays boxes;
+        boxes.pCenterX = mBoxes.centerX.data();
+        boxes.pCenterY = mBoxes.centerY.data();
+        boxes.pCenterZ = mBoxes.centerZ.data();
+        boxes.pExtentX = mBoxes.extentX.data();
+        boxes.pExtentY = mBoxes.extentY.data();
+        boxes.pExtentZ = mBoxes.extentZ.data();
+        boxes.count = (uint32_t)mTriangles.size();
+        return boxes;
+    }
+
+    bool TriangleBvh::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, Hit& hit) const
+    {
+        Hit closest;
+        mpBvh->intersectRay(origin, direction, tMax, getBoxes(), [&](uint32_t triangleID, float tClosest)
+        {
+            const Triangle& tri = mTriangles[triangleID];
+            float t;
+            glm::vec2 barycentrics;
+            if (intersectTriangle(tri.v0, tri.edge1, tri.edge2, origin, direction, t, barycentrics) && t >= 0.0f && t < tClosest)
+            {
+                closest.triangleID = triangleID;
+                closest.t = t;
+                closest.barycentrics = barycentrics;
+                return t;
+            }
+            return tClosest;
+        });
+
+        if (closest.isValid())
+        {
+            hit = closest;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t TriangleBvh::intersectPacket(RayPacket4& packet, PacketHit& hit, bool anyHit) const
+    {
+        const RayPacket4Registers rays(packet);
+        uint32_t hitMask = 0;
+
+        traversePacket(*mpBvh, packet, [&](uint32_t triangleID, RayPacket4& tracedPacket)
+        {
+            const Triangle& tri = mTriangles[triangleID];
+            __m128 t, u, v;
+            const uint32_t mask = intersectTriangle4(tri.v0, tri.edge1, tri.edge2, rays, _mm_load_ps(tracedPacket.tMax), t, u, v) & tracedPacket.activeMask;
+            if (mask == 0)
+            {
+                return;
+            }
+
+            alignas(16) float tLanes[4], uLanes[4], vLanes[4];
+            _mm_store_ps(tLanes, t);
+            _mm_store_ps(uLanes, u);
+            _mm_store_ps(vLanes, v);
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1 << lane))
+                {
+                    tracedPacket.tMax[lane] = tLanes[lane];
+                    hit.triangleID[lane] = triangleID;
+                    hit.barycentrics[lane] = glm::vec2(uLanes[lane], vLanes[lane]);
+                }
+            }
+
+            hitMask |= mask;
+            if (anyHit)
+            {
+                tracedPacket.activeMask &= ~mask;
+            }
+        });
+
+        return hitMask;
+    }
+}
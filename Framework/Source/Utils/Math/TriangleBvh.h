@@ -0,0 +1,122 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "Utils/Math/Bvh.h"
+#include "Utils/Math/RayPacket.h"
+
+namespace Falcor
+{
+    /** Bounding volume hierarchy over the triangles of an indexed triangle list, for CPU ray queries.
+        The triangle vertices are copied into the structure, so the source buffers can be released after creation.
+    */
+    class TriangleBvh
+    {
+    public:
+        using UniquePtr = std::unique_ptr<TriangleBvh>;
+        using UniqueConstPtr = std::unique_ptr<const TriangleBvh>;
+
+        static const uint32_t kInvalidTriangle = (uint32_t)-1;
+
+        /** Result of a ray query
+        */
+        struct Hit
+        {
+            uint32_t triangleID = kInvalidTriangle; ///< Index of the triangle in the index buffer the BVH was created from (indices 3*triangleID to 3*triangleID+2)
+            float t = 0;                            ///< Hit distance, in multiples of the ray direction length
+            glm::vec2 barycentrics;                 ///< Weights of the triangle's second and third vertex. The first vertex weight is 1 - x - y.
+
+            bool isValid() const { return triangleID != kInvalidTriangle; }
+        };
+
+        /** Result of a packet query. The hit distances are written to the packet's tMax. Only the lanes which hit are written.
+        */
+        struct PacketHit
+        {
+            uint32_t triangleID[4];
+            glm::vec2 barycentrics[4];
+        };
+
+        /** Create the hierarchy
+            \param[in] pPositions Vertex positions
+            \param[in] vertexCount Number of vertices
+            \param[in] pIndices Triangle list indices
+            \param[in] indexCount Number of indices. Must be a multiple of 3.
+            \return A new object, or nullptr if the indices reference vertices outside of the vertex array
+        */
+        static UniquePtr create(const glm::vec3* pPositions, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount);
+
+        /** Find the closest triangle hit by a ray. Triangles are double-sided.
+            \param[in] origin Ray origin
+            \param[in] direction Ray direction. Doesn't need to be normalized.
+            \param[in] tMax Maximum hit distance
+            \param[out] hit The closest hit. Left untouched if nothing was hit.
+            \return Whether a triangle closer than tMax was hit
+        */
+        bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, Hit& hit) const;
+
+        /** Intersect a packet of four rays with SSE. Triangles are double-sided.
+            \param[in,out] packet The rays. For closest-hit queries, the tMax of the lanes which hit is set to the hit distance. For any-hit queries, the lanes which hit are removed from the active mask.
+            \param[out] hit The triangles hit by the lanes which hit. Other lanes are left untouched.
+            \param[in] anyHit Stop a lane at its first hit instead of searching for the closest one
+            \return Lane mask of the rays which hit a triangle
+        */
+        uint32_t intersectPacket(RayPacket4& packet, PacketHit& hit, bool anyHit) const;
+
+        /** Get the number of triangles
+        */
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+
+        /** Get the underlying hierarchy. Primitive IDs are triangle IDs.
+        */
+        const Bvh& getBvh() const { return *mpBvh; }
+
+    private:
+        TriangleBvh() = default;
+
+        struct Triangle
+        {
+            glm::vec3 v0;
+            glm::vec3 edge1;    // v1 - v0
+            glm::vec3 edge2;    // v2 - v0
+        };
+
+        Bvh::UniquePtr mpBvh;
+        std::vector<Triangle> mTriangles;
+
+        struct
+        {
+            std::vector<float> centerX, centerY, centerZ;
+            std::vector<float> extentX, extentY, extentZ;
+        } mBoxes;
+        BoundingBoxArrays getBoxes() const;
+    };
+}
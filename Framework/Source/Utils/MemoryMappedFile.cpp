@@ -0,0 +1,93 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MemoryMappedFile.h"
+#include <windows.h>
+
+namespace Falcor
+{
+    MemoryMappedFile::UniquePtr MemoryMappedFile::create(const std::string& filename)
+    {
+        UniquePtr pFile = UniquePtr(new MemoryMappedFile());
+
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            logError("MemoryMappedFile: can't open file " + filename);
+            return nullptr;
+        }
+        pFile->mFileHandle = hFile;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(hFile, &size) == FALSE)
+        {
+            logError("MemoryMappedFile: can't query the size of file " + filename);
+            return nullptr;
+        }
+        pFile->mSize = (size_t)size.QuadPart;
+
+        // Empty files can't be mapped. Return a valid object with no data.
+        if (pFile->mSize == 0)
+        {
+            return pFile;
+        }
+
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping == nullptr)
+        {
+            logError("MemoryMappedFile: can't create a mapping for file " + filename);
+            return nullptr;
+        }
+        pFile->mMappingHandle = hMapping;
+
+        pFile->mpData = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (pFile->mpData == nullptr)
+        {
+            logError("MemoryMappedFile: can't map a view of file " + filename);
+            return nullptr;
+        }
+
+        return pFile;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (mpData)
+        {
+            UnmapViewOfFile(mpData);
+        }
+        if (mMappingHandle)
+        {
+            CloseHandle(mMappingHandle);
+        }
+        if (mFileHandle)
+        {
+            CloseHandle(mFileHandle);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+
+namespace Falcor
+{
+    /** A read-only view of a file mapped into the address space of the process.
+        Pages are loaded by the OS on first access, so opening even very large files is cheap.
+    */
+    class MemoryMappedFile
+    {
+    public:
+        using UniquePtr = std::unique_ptr<MemoryMappedFile>;
+
+        /** Map a file for reading
+            \param[in] filename Full path of the file
+            \return A new object, or nullptr if the file couldn't be opened or mapped
+        */
+        static UniquePtr create(const std::string& filename);
+        ~MemoryMappedFile();
+
+        /** Get a pointer to the beginning of the file. Valid for the lifetime of the object.
+        */
+        const uint8_t* getData() const { return mpData; }
+
+        /** Get the size of the file in bytes
+        */
+        size_t getSize() const { return mSize; }
+
+    private:
+        MemoryMappedFile() = default;
+        MemoryMappedFile(const MemoryMappedFile&) = delete;
+        MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+        void* mFileHandle = nullptr;
+        void* mMappingHandle = nullptr;
+        const uint8_t* mpData = nullptr;
+        size_t mSize = 0;
+    };
+}
@@ -193,6 +193,10 @@ namespace Falcor
     */
     void enumerateFiles(std::string searchString, std::vector<std::string>& filenames);
     
+    /** Get the ID of the current process
+    */
+    uint32_t getProcessId();
+
     /** Return current thread handle
     */
     std::thread::native_handle_type getCurrentThread();
@@ -29,6 +29,8 @@
 #include "Framework.h"
 #include "Utils/Picking/Picking.h"
 #include "Graphics/FboHelper.h"
+#include "Utils/Math/FalcorMath.h"
+#include <cfloat>
 
 namespace Falcor
 {
@@ -37,8 +39,28 @@ namespace Falcor
         return UniquePtr(new Picking(pScene, fboWidth, fboHeight));
     }
 
+    static bool hasGizmos(const Gizmo::Gizmos& gizmos)
+    {
+        for (const auto& pGizmo : gizmos)
+        {
+            if (pGizmo) return true;
+        }
+        return false;
+    }
+
     bool Picking::pick(RenderContext* pContext, const glm::vec2& mousePos, const Camera::SharedPtr& pCamera)
     {
+        if (mCpuPickingEnabled && hasGizmos(mSceneGizmos) == false)
+        {
+            const glm::vec3 direction = mousePosToWorldRay(mousePos, pCamera->getViewMatrix(), pCamera->getProjMatrix());
+            CpuPickStatus status = pickCpu(pCamera->getPosition(), direction);
+            if (status != CpuPickStatus::Unsupported)
+            {
+                return status == CpuPickStatus::Hit;
+            }
+        }
+
+        // Fall back to rendering the scene
         calculateScissor(mousePos);
         renderScene(pContext, pCamera.get());
         readPickResults(pContext);
@@ -125,6 +147,69 @@ namespace Falcor
         pContext->setGraphicsState(pPrevGraphicsState);
     }
 
+    Picking::CpuPickStatus Picking::pickCpu(const glm::vec3& origin, const glm::vec3& direction)
+    {
+        mPickResult = Instance();
+
+        const SceneInstanceTable& table = mpScene->getInstanceTable();
+        const Bvh& instanceBvh = mpScene->getInstanceBvh(false);
+
+        bool unsupported = false;
+        uint32_t hitEntry = 0;
+        TriangleBvh::Hit hit;
+
+        // Instances are visited nearest first, and only instances whose bounds are closer than the current hit are tested
+        instanceBvh.intersectRay(origin, direction, FLT_MAX, table.getWorldBoundingBoxes(), [&](uint32_t entry, float tMax)
+        {
+            const SceneInstanceTable::MeshRange& meshRange = table.getMeshRange(table.getMeshRangeID(entry));
+            const SceneInstanceTable::ModelInstanceRange& modelRange = table.getModelInstanceRange(meshRange.modelInstanceRange);
+            if (modelRange.visible == false || table.isVisible(entry) == false)
+            {
+                return tMax;
+            }
+
+            // Skinned meshes are transformed by the bones, so the object-space BVH can't be used
+            const Mesh* pMesh = mpScene->getModel(modelRange.modelID)->getMesh(meshRange.meshID).get();
+            const TriangleBvh* pTriangleBvh = meshRange.hasBones ? nullptr : pMesh->getTriangleBvh();
+            if (pTriangleBvh == nullptr)
+            {
+                unsupported = true;
+                return tMax;
+            }
+
+            // Transform the ray into object space. The direction isn't normalized, so the hit distance doesn't change.
+            const glm::mat4 invWorld = glm::inverse(table.getWorldMatrix(entry));
+            const glm::vec3 objOrigin = glm::vec3(invWorld * glm::vec4(origin, 1.0f));
+            const glm::vec3 objDirection = glm::vec3(invWorld * glm::vec4(direction, 0.0f));
+            if (pTriangleBvh->intersectRay(objOrigin, objDirection, tMax, hit))
+            {
+                hitEntry = entry;
+                return hit.t;
+            }
+            return tMax;
+        });
+
+        // Meshes which can't be intersected on the CPU might be in front of the hit
+        if (unsupported)
+        {
+            return CpuPickStatus::Unsupported;
+        }
+
+        if (hit.isValid() == false)
+        {
+            return CpuPickStatus::Miss;
+        }
+
+        const SceneInstanceTable::MeshRange& meshRange = table.getMeshRange(table.getMeshRangeID(hitEntry));
+        const SceneInstanceTable::ModelInstanceRange& modelRange = table.getModelInstanceRange(meshRange.modelInstanceRange);
+        const Model* pModel = mpScene->getModel(modelRange.modelID).get();
+        mPickResult.pModelInstance = mpScene->getModelInstance(modelRange.modelID, modelRange.instanceID);
+        mPickResult.pMeshInstance = pModel->getMeshInstance(meshRange.meshID, table.getMeshInstanceID(hitEntry));
+        mPickResult.triangleID = hit.triangleID;
+        mPickResult.barycentrics = hit.barycentrics;
+        return CpuPickStatus::Hit;
+    }
+
     void Picking::readPickResults(RenderContext* pContext)
     {
         std::vector<uint8_t> textureData = pContext->readTextureSubresource(mpFBO->getColorTexture(0).get(), 0);
@@ -149,11 +234,11 @@ namespace Falcor
         {
             // Set camera for regular shader
             ConstantBuffer* pCB = mpProgramVars->getConstantBuffer(kPerFrameCbName).get();
-            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataHandle);
 
             // Set camera for rotate gizmo shader
             pCB = mpRotGizmoProgramVars->getConstantBuffer(kPerFrameCbName).get();
-            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataHandle);
         }
     }
 
@@ -188,7 +273,7 @@ namespace Falcor
     bool Picking::setPerMeshInstanceData(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance, uint32_t drawInstanceID, const CurrentWorkingData& currentData)
     {
         ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerMeshCbName).get();
-        pCB->setBlob(&currentData.drawID, sDrawIDOffset + drawInstanceID * sizeof(uint32_t), sizeof(uint32_t));
+        pCB->setVariable(sDrawIDHandle[drawInstanceID], currentData.drawID);
 
         mDrawIDToInstance[currentData.drawID] = Instance(pModelInstance, pMeshInstance);
 
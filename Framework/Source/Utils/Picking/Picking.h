@@ -30,6 +30,7 @@
 #include "Graphics/Scene/SceneRenderer.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Scene/Editor/Gizmo.h"
+#include "Utils/Math/TriangleBvh.h"
 #include <unordered_set>
 
 namespace Falcor
@@ -49,6 +50,7 @@ namespace Falcor
         static UniquePtr create(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight);
 
         /** Performs a picking operation on the scene and stores the result.
+            If CPU picking is enabled, the mouse ray is first intersected with the scene's instance BVH and the meshes' triangle BVHs. If the ray hits a mesh which can't be intersected on the CPU, the scene is rendered into the picking FBO instead.
             \param[in] mousePos Mouse position in the range [0,1] with (0,0) being the top left corner. Same coordinate space as in MouseEvent.
             \param[in] pContext Render context to render scene with.
             \param[in] pCamera Active camera to pick from.
@@ -66,13 +68,32 @@ namespace Falcor
         */
         const Scene::ModelInstance::SharedPtr& getPickedModelInstance() const;
 
+        /** Gets the picked triangle, as an index into the mesh's index buffer (indices 3*ID to 3*ID+2).
+            \return The triangle ID, otherwise TriangleBvh::kInvalidTriangle if nothing was picked or the pick was resolved by rendering the scene.
+        */
+        uint32_t getPickedTriangle() const { return mPickResult.triangleID; }
+
+        /** Gets the barycentric coordinates of the picked point. Only valid if getPickedTriangle() returns a valid ID.
+            \return Weights of the triangle's second and third vertex. The first vertex weight is 1 - x - y.
+        */
+        const glm::vec2& getPickedBarycentrics() const { return mPickResult.barycentrics; }
+
+        /** Enable or disable CPU picking. It is enabled by default.
+            CPU picking requires models loaded with Model::KeepCpuGeometry. Skinned meshes and meshes without CPU geometry are picked by rendering the scene.
+        */
+        void setCpuPickingEnabled(bool enabled) { mCpuPickingEnabled = enabled; }
+
+        /** Check if CPU picking is enabled
+        */
+        bool isCpuPickingEnabled() const { return mCpuPickingEnabled; }
+
         /** Resize the internal FBO used for picking.
             \param[in] width Width of the FBO.
             \param[in] height Height of the FBO.
         */
         void resizeFBO(uint32_t width, uint32_t height);
 
-        // #HACK For picking the editor scene, register gizmos to conditionally set states
+        // #HACK For picking the editor scene, register gizmos to conditionally set states. Pickers with gizmos always render the scene, the CPU path doesn't replicate the gizmo states.
         void registerGizmos(const Gizmo::Gizmos& gizmos);
 
     private:
@@ -82,6 +103,14 @@ namespace Falcor
         void renderScene(RenderContext* pContext, Camera* pCamera);
         void readPickResults(RenderContext* pContext);
 
+        enum class CpuPickStatus
+        {
+            Hit,
+            Miss,
+            Unsupported,    ///< The ray hit the bounds of a mesh which can't be intersected on the CPU
+        };
+        CpuPickStatus pickCpu(const glm::vec3& origin, const glm::vec3& direction);
+
         virtual void setPerFrameData(RenderContext* pContext, const CurrentWorkingData& currentData) override;
         virtual bool setPerModelInstanceData(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, uint32_t instanceID, const CurrentWorkingData& currentData) override;
         virtual bool setPerMeshInstanceData(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance, uint32_t drawInstanceID, const CurrentWorkingData& currentData) override;
@@ -93,6 +122,8 @@ namespace Falcor
         {
             Scene::ModelInstance::SharedPtr pModelInstance;
             Model::MeshInstance::SharedPtr pMeshInstance;
+            uint32_t triangleID = TriangleBvh::kInvalidTriangle;
+            glm::vec2 barycentrics;
 
             Instance() {}
 
@@ -101,6 +132,7 @@ namespace Falcor
         };
 
         Gizmo::Gizmos mSceneGizmos;
+        bool mCpuPickingEnabled = true;
 
         std::unordered_map<uint32_t, Instance> mDrawIDToInstance;
         Instance mPickResult;
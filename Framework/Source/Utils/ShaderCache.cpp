@@ -0,0 +1,228 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ShaderCache.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/OS.h"
+#include "Utils/HashUtils.h"
+#include <atomic>
+#include <mutex>
+
+namespace Falcor
+{
+    static const char kFileMagic[8] = { 'F', 'a', 'l', 'c', 'o', 'r', 'S', 'C' };
+    static const uint32_t kFileVersion = 1;
+
+    struct CacheFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t key[2];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static std::mutex sDirectoryMutex;
+    static std::string sDirectory;
+    static bool sDirectoryInitialized = false;
+    static bool sDirectoryCreated = false;
+    static std::atomic<uint32_t> sHits(0);
+    static std::atomic<uint32_t> sMisses(0);
+    static std::atomic<uint32_t> sStores(0);
+    static std::atomic<uint32_t> sTempFileCounter(0);
+
+    std::string ShaderCache::Key::getFilename() const
+    {
+        char name[33];
+        snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)hash[0], (unsigned long long)hash[1]);
+        return std::string(name) + ".bin";
+    }
+
+    ShaderCache::Key ShaderCache::computeKey(const std::string& source, const std::string& target, uint32_t compilerFlags, uint32_t compilerVersion)
+    {
+        // Two independently seeded hashes
+        static const uint64_t kSeeds[2] = { 0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull };
+
+        Key key;
+        for(uint32_t i = 0; i < 2; i++)
+        {
+            uint64_t h = hashBytes(source.data(), source.size(), kSeeds[i]);
+            h = hashCombine(h, hashBytes(target.data(), target.size(), kSeeds[i]));
+            h = hashCombine(h, compilerFlags);
+            h = hashCombine(h, compilerVersion);
+            key.hash[i] = h;
+        }
+        return key;
+    }
+
+    static std::string getDirectoryInternal()
+    {
+        std::lock_guard<std::mutex> lock(sDirectoryMutex);
+        if(sDirectoryInitialized == false)
+        {
+#if _ENABLE_SHADER_CACHE
+            sDirectory = getExecutableDirectory() + "\\ShaderCache";
+#endif
+            sDirectoryInitialized = true;
+        }
+        return sDirectory;
+    }
+
+    void ShaderCache::setDirectory(const std::string& directory)
+    {
+        std::lock_guard<std::mutex> lock(sDirectoryMutex);
+        sDirectory = directory;
+        sDirectoryInitialized = true;
+        sDirectoryCreated = false;
+    }
+
+    std::string ShaderCache::getDirectory()
+    {
+        return getDirectoryInternal();
+    }
+
+    bool ShaderCache::load(const Key& key, std::vector<uint8_t>& data)
+    {
+        const std::string directory = getDirectoryInternal();
+        if(directory.empty())
+        {
+            return false;
+        }
+
+        const std::string filename = directory + "\\" + key.getFilename();
+        if(doesFileExist(filename) == false)
+        {
+            sMisses++;
+            return false;
+        }
+
+        bool valid = false;
+        {
+            BinaryFileStream stream(filename, BinaryFileStream::Mode::Read);
+            CacheFileHeader header;
+            stream.read(&header, sizeof(header));
+            if(stream.isGood() && memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) == 0 && header.version == kFileVersion &&
+                header.key[0] == key.hash[0] && header.key[1] == key.hash[1] && header.dataSize == stream.getRemainingStreamSize())
+            {
+                data.resize((size_t)header.dataSize);
+                stream.read(data.data(), data.size());
+                valid = stream.isGood() && hashBytes(data.data(), data.size(), header.key[0]) == header.dataHash;
+            }
+        }
+
+        if(valid == false)
+        {
+            // Truncated or corrupted. Remove it, so that the next store can replace it.
+            logWarning("Removing invalid shader cache file '" + filename + "'");
+            std::remove(filename.c_str());
+            data.clear();
+            sMisses++;
+            return false;
+        }
+
+        sHits++;
+        return true;
+    }
+
+    bool ShaderCache::store(const Key& key, const void* pData, size_t size)
+    {
+        const std::string directory = getDirectoryInternal();
+        if(directory.empty())
+        {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sDirectoryMutex);
+            if(sDirectoryCreated == false)
+            {
+                if(isDirectoryExists(directory) == false && createDirectory(directory) == false && isDirectoryExists(directory) == false)
+                {
+                    logWarning("Can't create the shader cache directory '" + directory + "'");
+                    return false;
+                }
+                sDirectoryCreated = true;
+            }
+        }
+
+        const std::string filename = directory + "\\" + key.getFilename();
+        if(doesFileExist(filename))
+        {
+            return true;
+        }
+
+        // Write into a file which is unique to this process and thread, then rename it into place
+        const std::string tempFilename = filename + "." + std::to_string(getProcessId()) + "." + std::to_string(sTempFileCounter++) + ".tmp";
+        {
+            CacheFileHeader header;
+            memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+            header.version = kFileVersion;
+            header.reserved = 0;
+            header.key[0] = key.hash[0];
+            header.key[1] = key.hash[1];
+            header.dataSize = size;
+            header.dataHash = hashBytes(pData, size, key.hash[0]);
+
+            BinaryFileStream stream(tempFilename, BinaryFileStream::Mode::Write);
+            stream.write(&header, sizeof(header));
+            stream.write(pData, size);
+            if(stream.isGood() == false)
+            {
+                stream.remove();
+                return false;
+            }
+        }
+
+        if(std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+        {
+            // Another process or thread stored the same blob first
+            std::remove(tempFilename.c_str());
+            return doesFileExist(filename);
+        }
+
+        sStores++;
+        return true;
+    }
+
+    ShaderCache::Stats ShaderCache::getStats()
+    {
+        Stats stats;
+        stats.hits = sHits;
+        stats.misses = sMisses;
+        stats.stores = sStores;
+        return stats;
+    }
+
+    void ShaderCache::resetStats()
+    {
+        sHits = 0;
+        sMisses = 0;
+        sStores = 0;
+    }
+}
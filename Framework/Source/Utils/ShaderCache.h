@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Persistent cache of compiled shaders.
+        Blobs are stored in a directory, one file per blob, and are addressed by a hash of everything that affects the compilation - the preprocessed source (which contains the defines), the target and the compiler flags.
+        Multiple processes can share the directory. Files are written to a temporary name and renamed into place, so a reader never sees a partial file, and every file is validated before it's used.
+        The cache is enabled by _ENABLE_SHADER_CACHE in FalcorConfig.h.
+    */
+    class ShaderCache
+    {
+    public:
+        /** A content hash identifying a compiled shader
+        */
+        struct Key
+        {
+            uint64_t hash[2] = { 0, 0 };
+            bool operator==(const Key& other) const { return hash[0] == other.hash[0] && hash[1] == other.hash[1]; }
+            /** Get the name of the file storing the blob
+            */
+            std::string getFilename() const;
+        };
+
+        struct Stats
+        {
+            uint32_t hits = 0;      ///< Blobs loaded from the cache
+            uint32_t misses = 0;    ///< Lookups which didn't find a valid blob
+            uint32_t stores = 0;    ///< Blobs written to the cache
+        };
+
+        /** Compute the key of a shader.
+            \param[in] source The preprocessed shader source
+            \param[in] target The compilation target, for example "ps_5_0"
+            \param[in] compilerFlags The flags passed to the compiler
+            \param[in] compilerVersion Version of the compiler, so that blobs aren't reused after a compiler update
+        */
+        static Key computeKey(const std::string& source, const std::string& target, uint32_t compilerFlags, uint32_t compilerVersion);
+
+        /** Set the cache directory. The directory is created when the first blob is stored. An empty string disables the cache.
+            By default, the cache uses a 'ShaderCache' directory next to the executable.
+        */
+        static void setDirectory(const std::string& directory);
+
+        /** Get the cache directory. Returns an empty string if the cache is disabled.
+        */
+        static std::string getDirectory();
+
+        /** Load a blob.
+            \param[in] key The key of the shader
+            \param[out] data The blob
+            \return true if a valid blob was found, otherwise false. Corrupted files are removed.
+        */
+        static bool load(const Key& key, std::vector<uint8_t>& data);
+
+        /** Store a blob. If the blob is already in the cache, the existing file is kept.
+            \return true if the blob is in the cache when the function returns
+        */
+        static bool store(const Key& key, const void* pData, size_t size);
+
+        /** Get the statistics since the start of the process or the last call to resetStats()
+        */
+        static Stats getStats();
+        static void resetStats();
+
+    private:
+        ShaderCache() = delete;
+    };
+}
@@ -32,6 +32,9 @@
 #include "Utils/StringUtils.h"
 #include <cctype>
 #include <set>
+#include <mutex>
+#include <unordered_map>
+#include <sys/stat.h>
 
 namespace Falcor
 {
@@ -253,116 +256,327 @@ namespace Falcor
         return getLinePragma(line, filename);
     }
 
-    bool ShaderPreprocessor::addIncludes(std::string& code, Shader::unordered_string_set& includeFileList)
+    // An #include directive in a source file
+    struct IncludeDirective
+    {
+        size_t start = 0;       // Offset of the directive
+        size_t end = 0;         // Offset after the closing delimiter and its line break
+        size_t line = 0;        // Line number of the directive
+        std::string lineFile;   // File name set by a preceding '#line' directive. Empty if the directive belongs to the file itself.
+        bool hasFilename = false;
+        std::string filename;
+    };
+
+    // A source file split at its #include directives
+    struct ParsedSourceFile
     {
-        auto getDirAbs = [](const std::string& path) -> std::string 
+        std::string content;
+        bool hasPragmaOnce = false;
+        std::vector<IncludeDirective> includes;
+    };
+
+    // Find the #include and #pragma once directives which are not in comments. This is a single pass over the file.
+    static void parseSourceFile(ParsedSourceFile& file)
+    {
+        static const std::string kIncludeDirective("#include");
+        static const std::string kPragmaOnce("#pragma once");
+        static const std::string kLineDirective("#line");
+
+        const std::string& code = file.content;
+        const size_t length = code.size();
+        size_t line = 1;
+        std::string lineFile;
+        bool inBlockComment = false;
+        bool inLineComment = false;
+
+        for(size_t i = 0; i < length; i++)
         {
-            auto last = path.find_last_of("/\\");
-            return path.substr(0, last);
-        };
+            const char c = code[i];
+            const char next = (i + 1 < length) ? code[i + 1] : '\0';
+            if(c == '\n')
+            {
+                line++;
+                inLineComment = false;
+            }
+            else if(inBlockComment)
+            {
+                if(c == '*' && next == '/')
+                {
+                    inBlockComment = false;
+                    i++;
+                }
+            }
+            else if(inLineComment == false)
+            {
+                if(c == '/' && next == '/')
+                {
+                    inLineComment = true;
+                    i++;
+                }
+                else if(c == '/' && next == '*')
+                {
+                    inBlockComment = true;
+                    i++;
+                }
+                else if(c == '#' && code.compare(i, kIncludeDirective.size(), kIncludeDirective) == 0)
+                {
+                    IncludeDirective directive;
+                    directive.start = i;
+                    directive.line = line;
+                    directive.lineFile = lineFile;
+                    size_t filenameEnd = getIncludedFileName(code, i, directive.filename);
+                    directive.hasFilename = (filenameEnd != npos);
+                    if(directive.hasFilename == false)
+                    {
+                        // Reported when the directive is expanded
+                        directive.end = length;
+                        file.includes.push_back(directive);
+                        return;
+                    }
+
+                    // Skip the closing delimiter and the line break
+                    directive.end = filenameEnd + 1;
+                    if(directive.end < length && code[directive.end] == '\n')
+                    {
+                        directive.end++;
+                        line++;
+                    }
+                    file.includes.push_back(directive);
+                    i = directive.end - 1;
+                }
+                else if(c == '#' && code.compare(i, kPragmaOnce.size(), kPragmaOnce) == 0)
+                {
+                    file.hasPragmaOnce = true;
+                }
+                else if(c == '#' && code.compare(i, kLineDirective.size(), kLineDirective) == 0)
+                {
+                    // Follow existing line pragmas, in the form "#line N" or "#line N \"filename\""
+                    std::string pragmaLine;
+                    getLine(code, i, pragmaLine);
+                    std::vector<std::string> tokens = splitString(pragmaLine, " \t");
+                    if(tokens.size() >= 2 && std::isdigit(tokens[1][0]))
+                    {
+                        // '#line' tells where the next line is. The line counter is incremented at the end of this line.
+                        line = atoi(tokens[1].c_str()) - 1;
+                        if(tokens.size() == 3 && tokens[2].size() >= 2)
+                        {
+                            lineFile = replaceSubstring(tokens[2].substr(1, tokens[2].size() - 2), "/", "\\");
+                        }
+                    }
+                }
+            }
+        }
+    }
 
-        // Map of a file's absolute path onto the absolute directory that contains it.
-        std::map<std::string,std::string> pathsAbsToDirsAbs;
-        pathsAbsToDirsAbs[mShaderPathAbs] = getDirAbs(mShaderPathAbs);
+    /** Process-wide cache of parsed include files.
+        Entries are immutable and are validated against the file's modification time and size on every lookup, so edited files are picked up on the next preprocessing.
+    */
+    class IncludeFileCache
+    {
+    public:
+        using FilePtr = std::shared_ptr<const ParsedSourceFile>;
 
-        // Set of all included files' absolute paths
-        std::set<std::string> includedPathsAbs;
+        static IncludeFileCache& instance()
+        {
+            static IncludeFileCache sCache;
+            return sCache;
+        }
 
-        // Loop over every found include in the file
-        const std::string includeMacro = "#include";
-        const std::string pragmaStatement = "#pragma once";
-        while(true) 
+        /** Get a parsed file. Returns nullptr if the file can't be read.
+        */
+        FilePtr getFile(const std::string& fullpath)
         {
-            size_t offset = findShaderDirective<false>(code, 0, includeMacro);
-            if(offset == npos) 
+            struct stat fileStat;
+            if(stat(fullpath.c_str(), &fileStat) != 0)
             {
-                break; //Completed
+                return nullptr;
             }
 
-            // Get absolute path to the including file.  Note that it is absolute because we only ever write absolute paths in #line directives.
-            std::string includingPathAbs;
-            size_t line;
-            getLineInformation(code, offset, line, includingPathAbs, mShaderPathAbs);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                const auto& it = mEntries.find(fullpath);
+                if(it != mEntries.end() && it->second.modifiedTime == fileStat.st_mtime && it->second.size == (uint64_t)fileStat.st_size)
+                {
+                    mStats.hits++;
+                    return it->second.pFile;
+                }
+                mStats.misses++;
+            }
 
-            // Get raw path to the include (may be relative to the including file or absolute)
-            std::string includedPathRaw;
-            size_t postFilenameOffset = getIncludedFileName(code, offset, includedPathRaw);
-            if(postFilenameOffset == npos)
+            // Read and parse outside the lock. If two threads miss on the same file, both parse it and the last one wins.
+            auto pFile = std::make_shared<ParsedSourceFile>();
+            if(readFileToString(fullpath, pFile->content) == false)
             {
-                mErrorStr += mShaderPathAbs + "(" + std::to_string(line) + "):Missing included filename";
+                return nullptr;
+            }
+
+            // Add a trailing newline as required.  TODO: emit a warning while doing this.
+            if(pFile->content.empty() == false && pFile->content.back() != '\n')
+            {
+                pFile->content += '\n';
+            }
+            parseSourceFile(*pFile);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            Entry& entry = mEntries[fullpath];
+            entry.modifiedTime = fileStat.st_mtime;
+            entry.size = (uint64_t)fileStat.st_size;
+            entry.pFile = pFile;
+            return pFile;
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mEntries.clear();
+            mStats = ShaderPreprocessor::IncludeCacheStats();
+        }
+
+        ShaderPreprocessor::IncludeCacheStats getStats()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ShaderPreprocessor::IncludeCacheStats stats = mStats;
+            stats.fileCount = (uint32_t)mEntries.size();
+            return stats;
+        }
+
+    private:
+        struct Entry
+        {
+            time_t modifiedTime = 0;
+            uint64_t size = 0;
+            FilePtr pFile;
+        };
+
+        std::mutex mMutex;
+        std::unordered_map<std::string, Entry> mEntries;
+        ShaderPreprocessor::IncludeCacheStats mStats;
+    };
+
+    ShaderPreprocessor::IncludeCacheStats ShaderPreprocessor::getIncludeCacheStats()
+    {
+        return IncludeFileCache::instance().getStats();
+    }
+
+    void ShaderPreprocessor::clearIncludeCache()
+    {
+        IncludeFileCache::instance().clear();
+    }
+
+    static std::string getDirAbs(const std::string& path)
+    {
+        auto last = path.find_last_of("/\\");
+        return path.substr(0, last);
+    }
+
+    // Maximum nesting of includes. Deeper nesting is treated as recursive includes without '#pragma once'.
+    static const uint32_t kMaxIncludeDepth = 64;
+
+    struct IncludeExpansion
+    {
+        std::string& output;
+        std::string& errorStr;
+        Shader::unordered_string_set& includeFileList;
+        std::set<std::string> includedPathsAbs;     // Files which were already expanded, used for '#pragma once'
+    };
+
+    // Append the file to the output, expanding its includes recursively
+    static bool expandIncludes(const ParsedSourceFile& file, const std::string& pathAbs, uint32_t depth, IncludeExpansion& expansion)
+    {
+        if(depth > kMaxIncludeDepth)
+        {
+            expansion.errorStr += pathAbs + ": Includes are nested too deep. Are there recursive includes without '#pragma once'?";
+            return false;
+        }
+
+        size_t offset = 0;
+
+        for(const IncludeDirective& directive : file.includes)
+        {
+            expansion.output.append(file.content, offset, directive.start - offset);
+            offset = directive.end;
+            const std::string& includingPathAbs = directive.lineFile.empty() ? pathAbs : directive.lineFile;
+
+            if(directive.hasFilename == false)
+            {
+                expansion.errorStr += includingPathAbs + "(" + std::to_string(directive.line) + "):Missing included filename";
                 return false;
             }
 
             // Resolve absolute path of included file.  Error if cannot be found.
+            const std::string& includedPathRaw = directive.filename;
             std::string includedPathAbs;
             if(doesFileExist(includedPathRaw))
             {
                 // Path was absolute.
                 includedPathAbs = includedPathRaw;
             }
-            else
+            else if(findFileInDataDirectories(includedPathRaw, includedPathAbs) == false)
             {
-                // Path is relative to including file, and may include Falcor builtins.
-
-                // Search for Falcor builtin
-                if(findFileInDataDirectories(includedPathRaw, includedPathAbs)) goto SUCCESS;
-
                 // Search relative to the including file.
                 // Note canonicalization is necessary because the relative path might contain "..\\".
-                includedPathAbs = canonicalizeFilename( pathsAbsToDirsAbs.at(includingPathAbs) + "\\" + includedPathRaw );
-                if(doesFileExist(includedPathAbs)) goto SUCCESS;
-
-                // Could not find file!
-                mErrorStr += includingPathAbs + "(" + std::to_string(line) + "):Cannot find apparent relative include file \"" + includedPathRaw + "\".";
-                return false;
-
-                SUCCESS:;
+                includedPathAbs = canonicalizeFilename(getDirAbs(includingPathAbs) + "\\" + includedPathRaw);
+                if(doesFileExist(includedPathAbs) == false)
+                {
+                    expansion.errorStr += includingPathAbs + "(" + std::to_string(directive.line) + "):Cannot find apparent relative include file \"" + includedPathRaw + "\".";
+                    return false;
+                }
             }
 
             // Add the file to the include list
-            includeFileList.insert(includedPathAbs);
-
-            // Read the included file.
-            std::string includedContent;
-            readFileToString(includedPathAbs, includedContent);
+            expansion.includeFileList.insert(includedPathAbs);
 
-            // Add a trailing newline as required.  TODO: emit a warning while doing this.
-            if(!includedContent.empty() && includedContent.back() != '\n')
+            IncludeFileCache::FilePtr pIncluded = IncludeFileCache::instance().getFile(includedPathAbs);
+            if(pIncluded == nullptr)
             {
-                includedContent += '\n';
+                expansion.errorStr += includingPathAbs + "(" + std::to_string(directive.line) + "):Can't read include file \"" + includedPathAbs + "\".";
+                return false;
             }
 
             // If the included file contains "#pragma once", and we already included it, ignore it.  TODO: need to check that the pragma is valid.
-            bool shouldInclude = true;
-            if(findShaderDirective<false>(includedContent, 0, pragmaStatement) != npos)
+            bool alreadyIncluded = (expansion.includedPathsAbs.insert(includedPathAbs).second == false);
+            if(pIncluded->hasPragmaOnce && alreadyIncluded)
             {
-                if(includedPathsAbs.find(includedPathAbs) != includedPathsAbs.end())
+                // Keep the line count of the including file
+                if(directive.end > 0 && file.content[directive.end - 1] == '\n')
                 {
-                    shouldInclude = false;
+                    expansion.output += '\n';
                 }
+                continue;
             }
 
-            std::string prologue = code.substr(0, offset);
-            std::string epilogue = code.substr(postFilenameOffset + 2);
-            if(shouldInclude)
-            {
-                includedPathsAbs.insert(includedPathAbs);
-                pathsAbsToDirsAbs[includedPathAbs] = getDirAbs(includedPathAbs);
-
-                std::string preIncludeLine = getLinePragma(1, includedPathAbs);
-                std::string replacedIncludeLine = getLinePragma(line+1, includingPathAbs);
-                code = prologue + preIncludeLine + includedContent + replacedIncludeLine + epilogue;
-            }
-            else
+            expansion.output += getLinePragma(1, includedPathAbs);
+            if(expandIncludes(*pIncluded, includedPathAbs, depth + 1, expansion) == false)
             {
-                code = prologue + epilogue;
+                return false;
             }
-
+            expansion.output += getLinePragma(directive.line + 1, includingPathAbs);
         }
 
+        expansion.output.append(file.content, offset, npos);
         return true;
     }
 
+    bool ShaderPreprocessor::addIncludes(std::string& code, Shader::unordered_string_set& includeFileList)
+    {
+        // The root is parsed in place, the included files come from the cache. Everything is written into a single output string.
+        ParsedSourceFile root;
+        root.content.swap(code);
+        parseSourceFile(root);
+        if(root.includes.empty())
+        {
+            code.swap(root.content);
+            return true;
+        }
+
+        std::string output;
+        output.reserve(root.content.size() * 2);
+        IncludeExpansion expansion = { output, mErrorStr, includeFileList };
+        bool result = expandIncludes(root, mShaderPathAbs, 0, expansion);
+        code.swap(output);
+        return result;
+    }
+
     using string_tuple = std::vector < std::string >;
     using string_tuple_vector = std::vector < string_tuple >;
 
@@ -165,6 +165,23 @@ namespace Falcor
         */
         static bool parseShader(const std::string& filename, std::string& shader, std::string& errorMsg, Shader::unordered_string_set& includeFileList, const Program::DefineList& shaderDefines = Program::DefineList());
 
+        /** Statistics of the include file cache. The cache is shared by all the shaders in the process.
+        */
+        struct IncludeCacheStats
+        {
+            uint32_t hits = 0;      ///< Lookups which were served from memory
+            uint32_t misses = 0;    ///< Lookups which had to read the file, because it wasn't cached or it changed on disk
+            uint32_t fileCount = 0; ///< Number of cached files
+        };
+
+        /** Get the include file cache statistics
+        */
+        static IncludeCacheStats getIncludeCacheStats();
+
+        /** Drop all the cached include files and reset the statistics
+        */
+        static void clearIncludeCache();
+
     private:
         ShaderPreprocessor(std::string& errorStr);
 
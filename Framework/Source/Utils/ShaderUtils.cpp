@@ -137,4 +137,62 @@ namespace Falcor
             }
         }
     }
+
+    static const Shader::SharedPtr preprocessAndCreateShader(const std::string& fullpath, const std::string& name, std::string& shader, ShaderType shaderType, const Program::DefineList& shaderDefines, std::string& log)
+    {
+        std::string errorMsg;
+        Shader::unordered_string_set includeList;
+        if(ShaderPreprocessor::parseShader(fullpath, shader, errorMsg, includeList, shaderDefines) == false)
+        {
+            log = "Error when pre-processing shader " + name + "\n" + errorMsg;
+            return nullptr;
+        }
+
+        std::string errorLog;
+        auto pShader = Shader::create(shader, shaderType, errorLog);
+        if(pShader == nullptr)
+        {
+            log = "Compilation of " + getShaderNameFromType(shaderType) + " shader " + name + " failed\n\n" + errorLog;
+            return nullptr;
+        }
+        pShader->setIncludeList(includeList);
+        return pShader;
+    }
+
+    const Shader::SharedPtr compileShaderFromFile(const std::string& filename, ShaderType shaderType, const Program::DefineList& shaderDefines, std::string& log)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            log = "Can't find shader file " + filename;
+            return nullptr;
+        }
+
+        std::string shader;
+        readFileToString(fullpath, shader);
+        return preprocessAndCreateShader(fullpath, filename, shader, shaderType, shaderDefines, log);
+    }
+
+    const Shader::SharedPtr compileShaderFromString(const std::string& shaderString, ShaderType shaderType, const Program::DefineList& shaderDefines, std::string& log)
+    {
+        std::string shader = shaderString;
+        return preprocessAndCreateShader("", "from string", shader, shaderType, shaderDefines, log);
+    }
+
+    uint32_t compileShaderVariants(const std::string& filename, ShaderType shaderType, const std::vector<Program::DefineList>& variants)
+    {
+        uint32_t compiledCount = 0;
+        for(const auto& defines : variants)
+        {
+            // Shader::create() goes through the shader cache
+            std::string log;
+            if(compileShaderFromFile(filename, shaderType, defines, log) == nullptr)
+            {
+                logError(log);
+                continue;
+            }
+            compiledCount++;
+        }
+        return compiledCount;
+    }
 }
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "Graphics/Program.h"
 
 namespace Falcor
@@ -52,4 +53,26 @@ namespace Falcor
     \return A pointer to a new object if compilation was successful, otherwise nullptr.
     */
     const Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType type, const Program::DefineList& shaderDefines = Program::DefineList());
+
+    /** create a new shader from file without any user interaction. Unlike createShaderFromFile(), this function doesn't show message boxes or log errors, so it can be called from worker threads.
+    \param[in] filename Shader filename. It will search for the shader in the common directory structure.
+    \param[in] type Shader Type
+    \param[in] shaderDefines The macro definitions to patch into the shader
+    \param[out] log In case of failure, the pre-processor or compiler errors
+    \return A pointer to a new object if compilation was successful, otherwise nullptr.
+    */
+    const Shader::SharedPtr compileShaderFromFile(const std::string& filename, ShaderType type, const Program::DefineList& shaderDefines, std::string& log);
+
+    /** create a new shader from a string without any user interaction. See compileShaderFromFile().
+    */
+    const Shader::SharedPtr compileShaderFromString(const std::string& shaderString, ShaderType type, const Program::DefineList& shaderDefines, std::string& log);
+
+    /** Compile a shader file for a list of define sets, without creating shader objects. This fills the shader cache, and is meant to be used by offline tools to pre-warm the cache before shipping it to other machines.
+    Errors are logged, no message boxes are shown.
+    \param[in] filename Shader filename. It will search for the shader in the common directory structure.
+    \param[in] type Shader Type
+    \param[in] variants The define sets to compile
+    \return The number of variants which compiled successfully
+    */
+    uint32_t compileShaderVariants(const std::string& filename, ShaderType type, const std::vector<Program::DefineList>& variants);
 }
\ No newline at end of file
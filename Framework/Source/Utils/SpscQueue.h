@@ -0,0 +1,89 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <vector>
+
+namespace Falcor
+{
+    /** Bounded single-producer, single-consumer queue.
+        One thread may call push() while another thread calls pop(). Both calls are lock-free and never block, they fail when the queue is full or empty.
+    */
+    template<typename T>
+    class SpscQueue
+    {
+    public:
+        explicit SpscQueue(uint32_t capacity) : mItems(capacity), mHead(0), mTail(0) {}
+
+        /** Add an item. Producer thread only.
+            \return false if the queue is full
+        */
+        bool push(const T& item)
+        {
+            const uint64_t tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHead.load(std::memory_order_acquire) == mItems.size())
+            {
+                return false;
+            }
+            mItems[tail % mItems.size()] = item;
+            mTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Remove the oldest item. Consumer thread only.
+            \return false if the queue is empty
+        */
+        bool pop(T& item)
+        {
+            const uint64_t head = mHead.load(std::memory_order_relaxed);
+            if (head == mTail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            item = mItems[head % mItems.size()];
+            mHead.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Check if the queue is empty. The result can be stale if it's called from a thread other than the consumer.
+        */
+        bool empty() const { return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire); }
+
+        /** Get the maximum number of items in the queue
+        */
+        uint32_t getCapacity() const { return (uint32_t)mItems.size(); }
+
+    private:
+        std::vector<T> mItems;
+
+        // Positions are monotonic, the slot is the position modulo the capacity. The padding keeps the producer and consumer positions on separate cache lines.
+        std::atomic<uint64_t> mHead;    // Written by the consumer
+        uint8_t mPadding[64];
+        std::atomic<uint64_t> mTail;    // Written by the producer
+    };
+}
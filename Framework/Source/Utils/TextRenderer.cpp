@@ -102,8 +102,8 @@ namespace Falcor
         mpProgramVars = GraphicsVars::create(pProgram->getActiveVersion()->getReflector(), true);
         // Initialize the buffer
         auto& pCB = mpProgramVars["PerFrameCB"];
-        mVarOffsets.vpTransform = mpProgramVars["PerFrameCB"]->getVariableOffset("gvpTransform");
-        mVarOffsets.fontColor = mpProgramVars["PerFrameCB"]->getVariableOffset("gFontColor");
+        mVarHandles.vpTransform = mpProgramVars["PerFrameCB"]->getVariableHandle("gvpTransform");
+        mVarHandles.fontColor = mpProgramVars["PerFrameCB"]->getVariableHandle("gFontColor");
         mpProgramVars->setTexture("gFontTex", mpFont->getTexture());
     }
 
@@ -132,8 +132,9 @@ namespace Falcor
         vpTransform[3][1] = (VP.originX + VP.height) / VP.height;
 
         // Update the program variables
-        mpProgramVars["PerFrameCB"]->setVariable(mVarOffsets.vpTransform, vpTransform);
-        mpProgramVars["PerFrameCB"]->setVariable(mVarOffsets.fontColor, mTextColor);
+        ConstantBuffer::SharedPtr pCB = mpProgramVars["PerFrameCB"];
+        pCB->setVariable(mVarHandles.vpTransform, vpTransform);
+        pCB->setVariable(mVarHandles.fontColor, mTextColor);
         pRenderContext->setGraphicsVars(mpProgramVars);
 
 
@@ -108,8 +108,8 @@ namespace Falcor
 
         struct  
         {
-            size_t vpTransform;
-            size_t fontColor;
-        } mVarOffsets;
+            ProgramReflection::VariableHandle vpTransform;
+            ProgramReflection::VariableHandle fontColor;
+        } mVarHandles;
     };
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ThreadPool.h"
+
+namespace Falcor
+{
+    // Identifies the worker thread which is running the current task. Used to keep nested submissions local.
+    static thread_local const ThreadPool* tlpCurrentPool = nullptr;
+    static thread_local uint32_t tlWorkerIndex = 0;
+
+    ThreadPool::UniquePtr ThreadPool::create(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            uint32_t hwThreads = std::thread::hardware_concurrency();
+            threadCount = (hwThreads > 1) ? hwThreads - 1 : 1;
+        }
+        return UniquePtr(new ThreadPool(threadCount));
+    }
+
+    ThreadPool& ThreadPool::getGlobalPool()
+    {
+        static ThreadPool::UniquePtr spPool = create();
+        return *spPool;
+    }
+
+    ThreadPool& ThreadPool::getBackgroundPool()
+    {
+        // Long-running jobs get their own threads so they never delay the loops running on the global pool
+        static ThreadPool::UniquePtr spPool = create(max(std::thread::hardware_concurrency() / 2, 1u));
+        return *spPool;
+    }
+
+    ThreadPool::ThreadPool(uint32_t threadCount) : mPendingTaskCount(0), mNextQueue(0)
+    {
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mQueues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mThreads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mShutdown = true;
+        }
+        mWakeCondition.notify_all();
+
+        for (auto& t : mThreads)
+        {
+            t.join();
+        }
+    }
+
+    void ThreadPool::submit(Task task)
+    {
+        // Tasks spawned by a worker go to its own queue, everything else is distributed round-robin
+        uint32_t queueIndex = (tlpCurrentPool == this) ? tlWorkerIndex : (mNextQueue++ % (uint32_t)mQueues.size());
+
+        // Count the task before it becomes visible, so the counter never underflows
+        mPendingTaskCount++;
+        {
+            std::lock_guard<std::mutex> lock(mQueues[queueIndex]->mutex);
+            mQueues[queueIndex]->tasks.push_back(std::move(task));
+        }
+
+        {
+            // Taking the lock makes sure a worker which is about to sleep sees the new count
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+        }
+        mWakeCondition.notify_one();
+    }
+
+    bool ThreadPool::popTask(uint32_t queueIndex, Task& task)
+    {
+        const uint32_t queueCount = (uint32_t)mQueues.size();
+
+        // Own queue first, newest task (LIFO)
+        {
+            WorkerQueue& queue = *mQueues[queueIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty() == false)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                mPendingTaskCount--;
+                return true;
+            }
+        }
+
+        // Steal the oldest task from the other queues (FIFO)
+        for (uint32_t i = 1; i < queueCount; i++)
+        {
+            WorkerQueue& queue = *mQueues[(queueIndex + i) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty() == false)
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                mPendingTaskCount--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::workerLoop(uint32_t workerIndex)
+    {
+        tlpCurrentPool = this;
+        tlWorkerIndex = workerIndex;
+
+        while (true)
+        {
+            Task task;
+            if (popTask(workerIndex, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mWakeCondition.wait(lock, [this]() { return mShutdown || (mPendingTaskCount > 0); });
+            if (mShutdown && (mPendingTaskCount == 0))
+            {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::runPendingTask()
+    {
+        Task task;
+        uint32_t queueIndex = (tlpCurrentPool == this) ? tlWorkerIndex : 0;
+        if (popTask(queueIndex, task))
+        {
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        grainSize = max(grainSize, 1u);
+        const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+        if (chunkCount == 1 || mThreads.empty())
+        {
+            func(0, count);
+            return;
+        }
+
+        // Chunks are claimed dynamically. The state is shared since helper tasks may start after the loop is already done.
+        struct LoopState
+        {
+            std::atomic<uint32_t> nextChunk;
+            std::atomic<uint32_t> completedChunks;
+            std::atomic<bool> failed;
+            std::exception_ptr pException;
+            std::mutex mutex;
+            std::condition_variable doneCondition;
+        };
+        auto pState = std::make_shared<LoopState>();
+        pState->nextChunk = 0;
+        pState->completedChunks = 0;
+        pState->failed = false;
+
+        auto runChunks = [pState, chunkCount, grainSize, count, &func]()
+        {
+            uint32_t chunk;
+            while ((chunk = pState->nextChunk++) < chunkCount)
+            {
+                // Once a chunk threw, the remaining chunks are only counted so the caller can return
+                if (pState->failed == false)
+                {
+                    try
+                    {
+                        uint32_t begin = chunk * grainSize;
+                        func(begin, min(begin + grainSize, count));
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(pState->mutex);
+                        if (pState->pException == nullptr)
+                        {
+                            pState->pException = std::current_exception();
+                        }
+                        pState->failed = true;
+                    }
+                }
+
+                if (++pState->completedChunks == chunkCount)
+                {
+                    std::lock_guard<std::mutex> lock(pState->mutex);
+                    pState->doneCondition.notify_all();
+                }
+            }
+        };
+
+        // Helper tasks only touch func while unclaimed chunks remain, and we don't return before every chunk completed
+        const uint32_t helperCount = min(chunkCount - 1, getThreadCount());
+        for (uint32_t i = 0; i < helperCount; i++)
+        {
+            submit(runChunks);
+        }
+
+        runChunks();
+
+        // Other threads may still be working on their last chunk. Only wait for this loop, running unrelated tasks here could stall the caller for an unbounded time.
+        // This can't deadlock: every remaining chunk was claimed by a thread which is executing it, and nested loops are finished by the threads which started them.
+        {
+            std::unique_lock<std::mutex> lock(pState->mutex);
+            pState->doneCondition.wait(lock, [&pState, chunkCount]() { return pState->completedChunks == chunkCount; });
+        }
+
+        if (pState->pException)
+        {
+            std::rethrow_exception(pState->pException);
+        }
+    }
+}
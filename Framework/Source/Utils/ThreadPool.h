@@ -0,0 +1,109 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** A pool of worker threads with per-worker task queues.
+        Workers pop tasks from the back of their own queue and steal from the front of other queues when they run dry.
+        Tasks submitted from a worker thread go to that worker's queue, so nested work stays local.
+    */
+    class ThreadPool
+    {
+    public:
+        using UniquePtr = std::unique_ptr<ThreadPool>;
+        using Task = std::function<void()>;
+
+        /** Range function used by parallelFor(). Processes the items [begin, end).
+        */
+        using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+
+        /** Create a new thread pool
+            \param[in] threadCount Number of worker threads. 0 means one less than the number of hardware threads, since the calling thread participates in parallelFor().
+        */
+        static UniquePtr create(uint32_t threadCount = 0);
+
+        /** Get the process-wide pool. It is created on first use with the default thread count.
+        */
+        static ThreadPool& getGlobalPool();
+
+        /** Get the pool for long-running background jobs, such as shader compilation. Submitting such jobs to the global pool would let them occupy the workers which frame-critical loops rely on.
+        */
+        static ThreadPool& getBackgroundPool();
+
+        ~ThreadPool();
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mThreads.size(); }
+
+        /** Queue a task for asynchronous execution. The function returns immediately.
+        */
+        void submit(Task task);
+
+        /** Split [0, count) into chunks of grainSize items and run func on them in parallel. The calling thread executes chunks as well, and the call returns once all the chunks were processed.
+            While waiting for the other threads to finish their chunks, the calling thread doesn't run unrelated tasks. If func throws, the remaining chunks are skipped and the first exception is rethrown on the calling thread.
+            Chunk boundaries only depend on count and grainSize, so writing results to per-item or per-chunk slots gives the same output for any thread count.
+        */
+        void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func);
+
+        /** Execute a single pending task on the calling thread, if one is available. This can be any task in the pool, so avoid calling it from time-critical code.
+            \return true if a task was executed
+        */
+        bool runPendingTask();
+
+    private:
+        ThreadPool(uint32_t threadCount);
+        void workerLoop(uint32_t workerIndex);
+        bool popTask(uint32_t queueIndex, Task& task);
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+        std::vector<std::thread> mThreads;
+
+        std::mutex mSleepMutex;
+        std::condition_variable mWakeCondition;
+        std::atomic<uint32_t> mPendingTaskCount;
+        std::atomic<uint32_t> mNextQueue;
+        bool mShutdown = false;
+    };
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "AsyncFrameCapture.h"
+
+namespace Falcor
+{
+    AsyncFrameCapture::UniquePtr AsyncFrameCapture::create(const Texture* pTexture, const Desc& desc, const FrameCaptureQueue::FrameFunc& frameFunc)
+    {
+        if (desc.readbackCount == 0)
+        {
+            logError("AsyncFrameCapture::create() - readback count must be larger than zero");
+            return nullptr;
+        }
+
+        UniquePtr pCapture = UniquePtr(new AsyncFrameCapture(desc));
+        pCapture->mLayout = CopyContext::getReadbackLayout(pTexture, 0);
+        if (pCapture->mLayout.depth != 1)
+        {
+            logError("AsyncFrameCapture::create() - only 2D textures are supported");
+            return nullptr;
+        }
+
+        pCapture->mReadbacks.resize(desc.readbackCount);
+        for (Readback& readback : pCapture->mReadbacks)
+        {
+            readback.pBuffer = Buffer::create(pCapture->mLayout.size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
+
+        FrameCaptureQueue::Desc queueDesc;
+        queueDesc.frameSize = (size_t)pCapture->mLayout.rowSize * pCapture->mLayout.rowCount;
+        queueDesc.frameCount = desc.queueFrameCount;
+        queueDesc.policy = desc.policy;
+        pCapture->mpQueue = FrameCaptureQueue::create(queueDesc, frameFunc);
+        if (pCapture->mpQueue == nullptr)
+        {
+            return nullptr;
+        }
+        return pCapture;
+    }
+
+    AsyncFrameCapture::~AsyncFrameCapture()
+    {
+        // The readbacks which are still in flight can't be resolved without a context, they are discarded. Call flush() to keep them.
+        if (mPendingReadbackCount)
+        {
+            logWarning("AsyncFrameCapture destroyed with " + std::to_string(mPendingReadbackCount) + " frames in flight. Call flush() before destroying the object.");
+        }
+    }
+
+    void AsyncFrameCapture::resolveOldestReadback(GpuFence* pFence, bool wait)
+    {
+        Readback& readback = mReadbacks[mOldestReadback];
+        if (wait)
+        {
+            pFence->syncCpu(readback.fenceValue);
+        }
+
+        // The Drop policy returns nullptr when the worker is behind
+        uint8_t* pFrame = mpQueue->acquireFrame();
+        if (pFrame)
+        {
+            const uint8_t* pData = (const uint8_t*)readback.pBuffer->map(Buffer::MapType::Read);
+            for (uint32_t y = 0; y < mLayout.rowCount; y++)
+            {
+                uint32_t dstRow = mDesc.flipY ? (mLayout.rowCount - 1 - y) : y;
+                memcpy(pFrame + (size_t)dstRow * mLayout.rowSize, pData + (size_t)y * mLayout.rowPitch, mLayout.rowSize);
+            }
+            readback.pBuffer->unmap();
+            mpQueue->submitFrame(pFrame);
+        }
+
+        mOldestReadback = (mOldestReadback + 1) % (uint32_t)mReadbacks.size();
+        mPendingReadbackCount--;
+    }
+
+    void AsyncFrameCapture::captureFrame(CopyContext* pContext, const Texture* pTexture)
+    {
+        assert(CopyContext::getReadbackLayout(pTexture, 0).size == mLayout.size);
+        GpuFence* pFence = pContext->getLowLevelData()->getFence().get();
+
+        // Hand over the readbacks the GPU already finished. They complete in order.
+        const uint64_t gpuValue = pFence->getGpuValue();
+        while (mPendingReadbackCount && mReadbacks[mOldestReadback].fenceValue <= gpuValue)
+        {
+            resolveOldestReadback(pFence, false);
+        }
+
+        // All the buffers are in flight, so the GPU is more than readbackCount captures behind. Wait for the oldest one.
+        if (mPendingReadbackCount == mReadbacks.size())
+        {
+            resolveOldestReadback(pFence, true);
+        }
+
+        // Record the copy and submit it, so that the fence value which marks its completion is known
+        Readback& readback = mReadbacks[(mOldestReadback + mPendingReadbackCount) % mReadbacks.size()];
+        pContext->copyTextureSubresourceToBuffer(pTexture, 0, readback.pBuffer.get());
+        pContext->flush(false);
+        readback.fenceValue = pFence->getCpuValue();
+        mPendingReadbackCount++;
+    }
+
+    void AsyncFrameCapture::flush(CopyContext* pContext)
+    {
+        GpuFence* pFence = pContext->getLowLevelData()->getFence().get();
+        while (mPendingReadbackCount)
+        {
+            resolveOldestReadback(pFence, true);
+        }
+        mpQueue->flush();
+    }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Utils/Video/FrameCaptureQueue.h"
+#include "API/CopyContext.h"
+#include "API/Buffer.h"
+#include "API/Texture.h"
+
+namespace Falcor
+{
+    /** Pipelined capture of a texture into CPU memory.
+        Every captureFrame() call records a copy into one of N readback buffers and returns. Readbacks whose fence was reached are copied into a FrameCaptureQueue buffer, which hands them to a worker thread.
+        The render thread never waits for the GPU unless all the readback buffers are in flight, and the cost per frame is a single copy of the image.
+    */
+    class AsyncFrameCapture
+    {
+    public:
+        using UniquePtr = std::unique_ptr<AsyncFrameCapture>;
+
+        struct Desc
+        {
+            uint32_t readbackCount = 3;     ///< Number of readback buffers. The GPU can be this many captures ahead of the CPU.
+            uint32_t queueFrameCount = 4;   ///< Number of frames which can wait for the worker
+            FrameCaptureQueue::OverflowPolicy policy = FrameCaptureQueue::OverflowPolicy::Stall;
+            bool flipY = false;             ///< Flip the image while copying it out of the readback buffer
+        };
+
+        /** Create a capture object
+            \param[in] pTexture Texture which will be captured. Only used for its dimensions and format, captureFrame() can be called with any texture with the same properties.
+            \param[in] desc Capture description
+            \param[in] frameFunc Called on the worker thread for every frame. The frame is tightly packed, with getRowSize() bytes per row.
+        */
+        static UniquePtr create(const Texture* pTexture, const Desc& desc, const FrameCaptureQueue::FrameFunc& frameFunc);
+
+        /** Waits for the pending frames and stops the worker
+        */
+        ~AsyncFrameCapture();
+
+        /** Capture mip 0 of a texture, and pass the readbacks which completed to the worker
+        */
+        void captureFrame(CopyContext* pContext, const Texture* pTexture);
+
+        /** Wait for all the captured frames to be read back and processed by the worker
+        */
+        void flush(CopyContext* pContext);
+
+        /** Get the size in bytes of a row in the frames passed to the worker
+        */
+        uint32_t getRowSize() const { return mLayout.rowSize; }
+
+        /** Get the worker queue statistics
+        */
+        FrameCaptureQueue::Stats getStats() const { return mpQueue->getStats(); }
+
+    private:
+        AsyncFrameCapture(const Desc& desc) : mDesc(desc) {}
+        void resolveOldestReadback(GpuFence* pFence, bool wait);
+
+        struct Readback
+        {
+            Buffer::SharedPtr pBuffer;
+            uint64_t fenceValue = 0;
+        };
+
+        Desc mDesc;
+        CopyContext::ReadbackLayout mLayout;
+        std::vector<Readback> mReadbacks;
+        uint32_t mOldestReadback = 0;       // Index of the oldest readback in flight
+        uint32_t mPendingReadbackCount = 0;
+        FrameCaptureQueue::UniquePtr mpQueue;
+    };
+}
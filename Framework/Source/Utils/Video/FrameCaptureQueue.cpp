@@ -0,0 +1,154 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "FrameCaptureQueue.h"
+#include "Utils/CpuTimer.h"
+
+namespace Falcor
+{
+    static const uint32_t kNoFrame = (uint32_t)-1;
+
+    FrameCaptureQueue::UniquePtr FrameCaptureQueue::create(const Desc& desc, const FrameFunc& frameFunc)
+    {
+        if (desc.frameSize == 0 || desc.frameCount == 0)
+        {
+            logError("FrameCaptureQueue::create() - frame size and frame count must be larger than zero");
+            return nullptr;
+        }
+        return UniquePtr(new FrameCaptureQueue(desc, frameFunc));
+    }
+
+    FrameCaptureQueue::FrameCaptureQueue(const Desc& desc, const FrameFunc& frameFunc)
+        : mDesc(desc)
+        , mFrameFunc(frameFunc)
+        , mFrames(desc.frameCount)
+        , mAcquiredFrame(kNoFrame)
+        , mFreeFrames(desc.frameCount)
+        , mReadyFrames(desc.frameCount)
+        , mProcessedFrames(0)
+    {
+        for (uint32_t i = 0; i < desc.frameCount; i++)
+        {
+            mFrames[i].resize(desc.frameSize);
+            mFreeFrames.push(i);
+        }
+        mWorker = std::thread(&FrameCaptureQueue::workerLoop, this);
+    }
+
+    FrameCaptureQueue::~FrameCaptureQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mShutdown = true;
+        }
+        mFrameReady.notify_one();
+        mWorker.join();
+    }
+
+    uint8_t* FrameCaptureQueue::acquireFrame()
+    {
+        assert(mAcquiredFrame == kNoFrame);
+        uint32_t frame;
+        if (mFreeFrames.pop(frame) == false)
+        {
+            if (mDesc.policy == OverflowPolicy::Drop)
+            {
+                mStats.droppedFrames++;
+                return nullptr;
+            }
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mFrameFreed.wait(lock, [&]() { return mFreeFrames.pop(frame); });
+            }
+            mStats.stallCount++;
+            mStats.stallTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+
+        mAcquiredFrame = frame;
+        return mFrames[frame].data();
+    }
+
+    void FrameCaptureQueue::submitFrame(uint8_t* pFrame)
+    {
+        assert(mAcquiredFrame != kNoFrame && pFrame == mFrames[mAcquiredFrame].data());
+        // The ready queue has a slot for every frame buffer, so this can't fail
+        mReadyFrames.push(mAcquiredFrame);
+        mAcquiredFrame = kNoFrame;
+        mStats.submittedFrames++;
+
+        // Taking the lock before notifying makes sure the worker either sees the frame or is already waiting
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mFrameReady.notify_one();
+    }
+
+    void FrameCaptureQueue::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mFrameFreed.wait(lock, [&]() { return mProcessedFrames.load() == mStats.submittedFrames; });
+    }
+
+    FrameCaptureQueue::Stats FrameCaptureQueue::getStats() const
+    {
+        Stats stats = mStats;
+        stats.processedFrames = mProcessedFrames.load();
+        return stats;
+    }
+
+    void FrameCaptureQueue::workerLoop()
+    {
+        while (true)
+        {
+            uint32_t frame = kNoFrame;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                // Pending frames are processed before shutting down
+                mFrameReady.wait(lock, [&]() { return mReadyFrames.pop(frame) || mShutdown; });
+                if (frame == kNoFrame)
+                {
+                    return;
+                }
+            }
+
+            // Process frames without the lock until the queue runs dry
+            do
+            {
+                mFrameFunc(mFrames[frame].data());
+                mProcessedFrames++;
+                mFreeFrames.push(frame);
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                }
+                mFrameFreed.notify_one();
+            } while (mReadyFrames.pop(frame));
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Utils/SpscQueue.h"
+
+namespace Falcor
+{
+    /** Hands captured frames from the render thread to a worker thread which processes them, usually by encoding them with a VideoEncoder.
+        The queue owns a fixed pool of frame buffers. Frame indices move between the threads through two lock-free queues, the threads only take a lock to sleep when there is nothing to do.
+    */
+    class FrameCaptureQueue
+    {
+    public:
+        using UniquePtr = std::unique_ptr<FrameCaptureQueue>;
+
+        /** Called on the worker thread for every submitted frame, in submission order
+        */
+        using FrameFunc = std::function<void(const uint8_t* pData)>;
+
+        /** What acquireFrame() does when all the frame buffers are in use
+        */
+        enum class OverflowPolicy
+        {
+            Stall,  ///< Block until the worker releases a buffer. No frames are lost.
+            Drop,   ///< Return nullptr, the caller skips the frame. The render thread never waits for the worker.
+        };
+
+        struct Desc
+        {
+            size_t frameSize = 0;                           ///< Size in bytes of a frame
+            uint32_t frameCount = 4;                        ///< Number of frame buffers. Bounds the memory usage and the latency between capture and processing.
+            OverflowPolicy policy = OverflowPolicy::Stall;
+        };
+
+        struct Stats
+        {
+            uint64_t submittedFrames = 0;   ///< Frames passed to submitFrame()
+            uint64_t processedFrames = 0;   ///< Frames the worker finished processing
+            uint64_t droppedFrames = 0;     ///< Frames dropped because of the Drop policy
+            uint64_t stallCount = 0;        ///< Number of times acquireFrame() had to wait for the worker
+            double stallTime = 0;           ///< Total time in milliseconds acquireFrame() waited for the worker
+        };
+
+        /** Create a queue and start its worker thread
+            \param[in] desc Queue description
+            \param[in] frameFunc Function which processes a frame. Called on the worker thread.
+        */
+        static UniquePtr create(const Desc& desc, const FrameFunc& frameFunc);
+
+        /** Processes the pending frames and stops the worker thread
+        */
+        ~FrameCaptureQueue();
+
+        /** Get a buffer to write the next frame into. Every buffer returned must be passed to submitFrame() before the next call. Producer thread only.
+            \return A buffer of Desc::frameSize bytes, or nullptr if the frame should be dropped
+        */
+        uint8_t* acquireFrame();
+
+        /** Hand a buffer returned by acquireFrame() to the worker. Producer thread only.
+        */
+        void submitFrame(uint8_t* pFrame);
+
+        /** Block until the worker processed all the submitted frames. Producer thread only.
+        */
+        void flush();
+
+        /** Get the queue statistics. Producer thread only.
+        */
+        Stats getStats() const;
+
+        /** Get the size of a frame buffer
+        */
+        size_t getFrameSize() const { return mDesc.frameSize; }
+
+    private:
+        FrameCaptureQueue(const Desc& desc, const FrameFunc& frameFunc);
+        void workerLoop();
+
+        Desc mDesc;
+        FrameFunc mFrameFunc;
+        std::vector<std::vector<uint8_t>> mFrames;
+        uint32_t mAcquiredFrame;
+
+        SpscQueue<uint32_t> mFreeFrames;    // Worker -> producer
+        SpscQueue<uint32_t> mReadyFrames;   // Producer -> worker
+
+        // Only used to sleep and wake up
+        std::mutex mMutex;
+        std::condition_variable mFrameReady;
+        std::condition_variable mFrameFreed;
+        bool mShutdown = false;
+
+        std::thread mWorker;
+        std::atomic<uint64_t> mProcessedFrames;
+        Stats mStats;
+    };
+}
@@ -0,0 +1,334 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "FramePlaybackQueue.h"
+
+namespace Falcor
+{
+    static const uint32_t kNoSlot = (uint32_t)-1;
+
+    FramePlaybackQueue::UniquePtr FramePlaybackQueue::create(const Desc& desc, const DecodeFunc& decodeFunc, const SeekFunc& seekFunc)
+    {
+        if (desc.frameSize == 0 || desc.aheadFrames == 0)
+        {
+            logError("FramePlaybackQueue::create() - frame size and ahead frame count must be larger than zero");
+            return nullptr;
+        }
+        return UniquePtr(new FramePlaybackQueue(desc, decodeFunc, seekFunc));
+    }
+
+    FramePlaybackQueue::FramePlaybackQueue(const Desc& desc, const DecodeFunc& decodeFunc, const SeekFunc& seekFunc)
+        : mDesc(desc)
+        , mDecodeFunc(decodeFunc)
+        , mSeekFunc(seekFunc)
+        , mFrames(desc.aheadFrames + 2)
+        , mSlotInfo(desc.aheadFrames + 2)
+        , mFreeSlots(desc.aheadFrames + 2)
+        , mReadySlots(desc.aheadFrames + 2)
+        , mCurrentSlot(kNoSlot)
+        , mPendingSlot(kNoSlot)
+        , mClipFrameCount(desc.clipFrameCount)
+        , mDecodedFrames(0)
+        , mEndedGeneration((uint32_t)-1)
+    {
+        // The consumer holds the current and the pending frame, the other slots can be decoded ahead
+        for (uint32_t i = 0; i < (uint32_t)mFrames.size(); i++)
+        {
+            mFrames[i].resize(desc.frameSize);
+            mFreeSlots.push(i);
+        }
+        mWorker = std::thread(&FramePlaybackQueue::workerLoop, this);
+    }
+
+    FramePlaybackQueue::~FramePlaybackQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mShutdown = true;
+        }
+        mWakeWorker.notify_one();
+        mWorker.join();
+    }
+
+    void FramePlaybackQueue::releaseSlot(uint32_t slot)
+    {
+        // The free queue has room for every slot, so this can't fail
+        mFreeSlots.push(slot);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mWakeWorker.notify_one();
+    }
+
+    void FramePlaybackQueue::seek(uint64_t frame)
+    {
+        // The current frame stays visible until the worker delivers the new one
+        if (mPendingSlot != kNoSlot)
+        {
+            releaseSlot(mPendingSlot);
+            mPendingSlot = kNoSlot;
+        }
+
+        mGeneration++;
+        mSeekFrame = frame;
+        mStats.seekCount++;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRequestedGeneration = mGeneration;
+            mRequestedFrame = frame;
+        }
+        mWakeWorker.notify_one();
+    }
+
+    bool FramePlaybackQueue::update(uint64_t frame, bool wait)
+    {
+        const bool currentIsFresh = (mCurrentSlot != kNoSlot) && (mSlotInfo[mCurrentSlot].generation == mGeneration);
+        if (frame < mSeekFrame || (currentIsFresh && frame < mCurrentFrame))
+        {
+            seek(frame);
+        }
+
+        uint32_t replacedFrames = 0;
+        auto drainReadySlots = [&]()
+        {
+            while (true)
+            {
+                uint32_t slot = mPendingSlot;
+                if (slot == kNoSlot && mReadySlots.pop(slot) == false)
+                {
+                    return;
+                }
+                mPendingSlot = kNoSlot;
+
+                const SlotInfo& info = mSlotInfo[slot];
+                if (info.generation != mGeneration)
+                {
+                    // Decoded before the last seek
+                    releaseSlot(slot);
+                }
+                else if (info.frame > frame)
+                {
+                    mPendingSlot = slot;
+                    return;
+                }
+                else
+                {
+                    if (mCurrentSlot != kNoSlot)
+                    {
+                        releaseSlot(mCurrentSlot);
+                    }
+                    mCurrentSlot = slot;
+                    mCurrentFrame = info.frame;
+                    replacedFrames++;
+                }
+            }
+        };
+
+        drainReadySlots();
+
+        // If playback jumped far ahead of the worker, restart decoding at the new frame instead of decoding everything in between
+        const bool hasEnded = mEndedGeneration.load() == mGeneration;
+        const bool hasFreshFrame = (mCurrentSlot != kNoSlot) && (mSlotInfo[mCurrentSlot].generation == mGeneration);
+        const uint64_t decodedFrame = hasFreshFrame ? std::max(mCurrentFrame, mSeekFrame) : mSeekFrame;
+        if (mPendingSlot == kNoSlot && hasEnded == false && frame > decodedFrame + mDesc.seekThreshold)
+        {
+            seek(frame);
+        }
+
+        while (wait)
+        {
+            // Check for the end of the clip before draining. The worker pushes its last frame before flagging the end, so the drain sees it.
+            const bool ended = mEndedGeneration.load() == mGeneration;
+            drainReadySlots();
+            const bool isFresh = (mCurrentSlot != kNoSlot) && (mSlotInfo[mCurrentSlot].generation == mGeneration);
+            if (ended || (isFresh && (mCurrentFrame == frame || mPendingSlot != kNoSlot)))
+            {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mFrameReady.wait(lock, [&]() { return mReadySlots.empty() == false || mEndedGeneration.load() == mGeneration; });
+        }
+
+        if (replacedFrames > 0)
+        {
+            mStats.displayedFrames++;
+            mStats.skippedFrames += replacedFrames - 1;
+            return true;
+        }
+        return false;
+    }
+
+    const uint8_t* FramePlaybackQueue::getCurrentFrameData() const
+    {
+        return (mCurrentSlot == kNoSlot) ? nullptr : mFrames[mCurrentSlot].data();
+    }
+
+    FramePlaybackQueue::Stats FramePlaybackQueue::getStats() const
+    {
+        Stats stats = mStats;
+        stats.decodedFrames = mDecodedFrames.load();
+        return stats;
+    }
+
+    void FramePlaybackQueue::workerLoop()
+    {
+        uint32_t generation = 0;
+        uint64_t baseFrame = 0;                     // Playback index of the first frame of the current pass over the clip
+        uint64_t targetClipFrame = 0;               // Frames before the seek target are decoded and skipped
+        uint64_t lastClipFrame = kEndOfStream;      // Last frame decoded in the current pass
+        bool slotHasFrame = false;                  // The slot holds a skipped frame, which is shown if the seek target is past the end of the clip
+        bool ended = false;
+        uint32_t slot = kNoSlot;
+
+        auto pushFrame = [&](uint64_t frame)
+        {
+            mSlotInfo[slot].frame = frame;
+            mSlotInfo[slot].generation = generation;
+            // The ready queue has room for every slot, so this can't fail
+            mReadySlots.push(slot);
+            slot = kNoSlot;
+            slotHasFrame = false;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+            }
+            mFrameReady.notify_one();
+        };
+
+        while (true)
+        {
+            bool seekRequested = false;
+            uint64_t seekFrame = 0;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWakeWorker.wait(lock, [&]()
+                {
+                    return mShutdown || mRequestedGeneration != generation || (ended == false && (slot != kNoSlot || mFreeSlots.pop(slot)));
+                });
+                if (mShutdown)
+                {
+                    return;
+                }
+                if (mRequestedGeneration != generation)
+                {
+                    generation = mRequestedGeneration;
+                    seekFrame = mRequestedFrame;
+                    seekRequested = true;
+                }
+            }
+
+            if (seekRequested)
+            {
+                const uint64_t clipFrameCount = mClipFrameCount.load();
+                if (mDesc.loop && clipFrameCount > 0)
+                {
+                    baseFrame = seekFrame - seekFrame % clipFrameCount;
+                    targetClipFrame = seekFrame % clipFrameCount;
+                }
+                else
+                {
+                    baseFrame = 0;
+                    targetClipFrame = seekFrame;
+                }
+                lastClipFrame = kEndOfStream;
+                slotHasFrame = false;
+                ended = false;
+                if (mSeekFunc(targetClipFrame) == false)
+                {
+                    logWarning("FramePlaybackQueue - seeking to clip frame " + std::to_string(targetClipFrame) + " failed");
+                    ended = true;
+                    mEndedGeneration = generation;
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                    }
+                    mFrameReady.notify_one();
+                }
+                continue;
+            }
+
+            const uint64_t clipFrame = mDecodeFunc(mFrames[slot].data());
+            if (clipFrame != kEndOfStream)
+            {
+                mDecodedFrames++;
+                lastClipFrame = clipFrame;
+                if (clipFrame < targetClipFrame)
+                {
+                    // Seeking lands on the key frame before the target. Decode into the same slot until the target is reached.
+                    slotHasFrame = true;
+                }
+                else
+                {
+                    targetClipFrame = 0;
+                    pushFrame(baseFrame + clipFrame);
+                }
+                continue;
+            }
+
+            // End of the clip. The count passed in the desc is usually an estimate from the container, so replace it.
+            if (lastClipFrame != kEndOfStream)
+            {
+                mClipFrameCount = lastClipFrame + 1;
+            }
+
+            const uint64_t clipFrameCount = mClipFrameCount.load();
+            if (mDesc.loop && clipFrameCount > 0 && lastClipFrame != kEndOfStream)
+            {
+                if (targetClipFrame > 0)
+                {
+                    // The seek target was past the end of the clip, wrap it now that the length is known
+                    const uint64_t target = baseFrame + targetClipFrame;
+                    baseFrame = target - target % clipFrameCount;
+                    targetClipFrame = target % clipFrameCount;
+                }
+                else
+                {
+                    baseFrame += clipFrameCount;
+                }
+                lastClipFrame = kEndOfStream;
+                slotHasFrame = false;
+                if (mSeekFunc(targetClipFrame))
+                {
+                    continue;
+                }
+                logWarning("FramePlaybackQueue - seeking to clip frame " + std::to_string(targetClipFrame) + " failed");
+            }
+
+            // Stop until the next seek. If the seek target was past the end of the clip, show the last frame.
+            if (slotHasFrame)
+            {
+                pushFrame(baseFrame + lastClipFrame);
+            }
+            ended = true;
+            mEndedGeneration = generation;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+            }
+            mFrameReady.notify_one();
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Utils/SpscQueue.h"
+
+namespace Falcor
+{
+    /** Streams decoded frames from a worker thread to a consumer which displays them, usually a VideoDecoder.
+        The worker stays up to Desc::aheadFrames frames ahead of the consumer. Frames are recycled through a fixed pool of buffers, so the memory usage doesn't depend on the length of the clip.
+        Frames are identified by a playback index. When looping, the index keeps growing past the end of the clip, playback frame N * clipFrameCount + i shows clip frame i.
+    */
+    class FramePlaybackQueue
+    {
+    public:
+        using UniquePtr = std::unique_ptr<FramePlaybackQueue>;
+
+        static const uint64_t kEndOfStream = (uint64_t)-1;
+
+        /** Decode the next frame of the clip into pDst. Called on the worker thread.
+            \return The index of the decoded frame in the clip, or kEndOfStream
+        */
+        using DecodeFunc = std::function<uint64_t(uint8_t* pDst)>;
+
+        /** Reposition the source so that the next decoded frame is at or before clipFrame. Frames before clipFrame are decoded and skipped by the queue. Called on the worker thread.
+            \return false if seeking failed
+        */
+        using SeekFunc = std::function<bool(uint64_t clipFrame)>;
+
+        struct Desc
+        {
+            size_t frameSize = 0;           ///< Size in bytes of a frame
+            uint32_t aheadFrames = 8;       ///< Maximum number of decoded frames waiting to be displayed. The queue allocates aheadFrames + 2 frame buffers.
+            uint64_t clipFrameCount = 0;    ///< Number of frames in the clip, or 0 if unknown. The count is corrected when the worker reaches the end of the clip.
+            bool loop = true;               ///< Restart at the first frame after the end of the clip
+            uint32_t seekThreshold = 60;    ///< Playback jumping forward by more than this many frames seeks instead of waiting for the worker to decode the frames in between
+        };
+
+        struct Stats
+        {
+            uint64_t decodedFrames = 0;     ///< Frames the worker decoded, including the frames skipped after seeking
+            uint64_t displayedFrames = 0;   ///< Frames which became the current frame
+            uint64_t skippedFrames = 0;     ///< Decoded frames which were never displayed because playback moved past them
+            uint64_t seekCount = 0;         ///< Number of seeks, including the ones issued by update()
+        };
+
+        /** Create a queue and start its worker thread. Decoding starts at playback frame 0.
+            \param[in] desc Queue description
+            \param[in] decodeFunc Function which decodes the next frame. Called on the worker thread.
+            \param[in] seekFunc Function which repositions the source. Called on the worker thread.
+        */
+        static UniquePtr create(const Desc& desc, const DecodeFunc& decodeFunc, const SeekFunc& seekFunc);
+
+        /** Stops the worker thread. Frames which were not displayed are discarded.
+        */
+        ~FramePlaybackQueue();
+
+        /** Advance playback. The newest decoded frame at or before 'frame' becomes the current frame, older frames are returned to the worker.
+            Moving backward, or forward by more than Desc::seekThreshold frames past the decoded frames, seeks. Consumer thread only.
+            \param[in] frame Playback frame index
+            \param[in] wait If true, block until the frame is decoded or the end of the clip is reached. Otherwise the current frame is kept until the worker catches up.
+            \return true if the current frame changed
+        */
+        bool update(uint64_t frame, bool wait = false);
+
+        /** Restart decoding at a playback frame. Frames decoded before the seek are discarded. Consumer thread only.
+        */
+        void seek(uint64_t frame);
+
+        /** Get the data of the current frame, or nullptr if no frame was displayed yet. The data stays valid until the next call to update(). Consumer thread only.
+        */
+        const uint8_t* getCurrentFrameData() const;
+
+        /** Get the playback index of the current frame. Consumer thread only.
+        */
+        uint64_t getCurrentFrame() const { return mCurrentFrame; }
+
+        /** Get the number of frames in the clip, or 0 if it is unknown
+        */
+        uint64_t getClipFrameCount() const { return mClipFrameCount.load(); }
+
+        /** Get the queue statistics. Consumer thread only.
+        */
+        Stats getStats() const;
+
+    private:
+        FramePlaybackQueue(const Desc& desc, const DecodeFunc& decodeFunc, const SeekFunc& seekFunc);
+        void workerLoop();
+        void releaseSlot(uint32_t slot);
+
+        // Written by the worker before the slot is pushed to the ready queue
+        struct SlotInfo
+        {
+            uint64_t frame = 0;
+            uint32_t generation = 0;
+        };
+
+        Desc mDesc;
+        DecodeFunc mDecodeFunc;
+        SeekFunc mSeekFunc;
+        std::vector<std::vector<uint8_t>> mFrames;
+        std::vector<SlotInfo> mSlotInfo;
+
+        SpscQueue<uint32_t> mFreeSlots;     // Consumer -> worker
+        SpscQueue<uint32_t> mReadySlots;    // Worker -> consumer
+
+        // Consumer state
+        uint32_t mCurrentSlot;
+        uint32_t mPendingSlot;              // Popped from the ready queue, but ahead of playback
+        uint64_t mCurrentFrame = 0;
+        uint64_t mSeekFrame = 0;            // The frame decoding (re)started at
+        uint32_t mGeneration = 0;           // Incremented by every seek. Frames from older generations are discarded.
+        Stats mStats;
+
+        // Seek requests. Protected by mMutex.
+        uint32_t mRequestedGeneration = 0;
+        uint64_t mRequestedFrame = 0;
+
+        // Only used to sleep and wake up, and for seek requests
+        std::mutex mMutex;
+        std::condition_variable mWakeWorker;
+        std::condition_variable mFrameReady;
+        bool mShutdown = false;
+
+        std::thread mWorker;
+        std::atomic<uint64_t> mClipFrameCount;
+        std::atomic<uint64_t> mDecodedFrames;
+        std::atomic<uint32_t> mEndedGeneration;     // Set by the worker when it stops at the end of a clip which doesn't loop
+    };
+}
@@ -28,7 +28,8 @@
 #include "Framework.h"
 #include "VideoDecoder.h"
 #include "Utils/OS.h"
-#include "Utils/BinaryFileStream.h"
+#include "API/Device.h"
+#include "API/RenderContext.h"
 extern "C"
 {
 #include "libavcodec/avcodec.h"
@@ -36,303 +37,225 @@ extern "C"
 #include "libswscale/swscale.h"
 }
 
-#include <cstdio>
-
 namespace Falcor
 {
-#if 0
-    float VideoDecoder::rationalToFloat(const AVRational& r)
+    static bool error(const std::string& filename, const std::string& msg)
     {
-        return ((float)r.num / (float)r.den);
+        logError("Error when opening video file " + filename + ".\n" + msg);
+        return false;
     }
 
-    VideoDecoder::UniquePtr VideoDecoder::create(const std::string& filename, uint32_t bufferedFrames, bool async)
+    VideoDecoder::UniquePtr VideoDecoder::create(const std::string& filename, const Desc& desc)
     {
-        auto pVideo = UniquePtr(new VideoDecoder());
-        if(pVideo->load(filename, bufferedFrames, async) == false)
+        if(desc.aheadFrames == 0 || desc.textureCount == 0)
         {
-            pVideo = nullptr;
+            logError("VideoDecoder::create() - ahead frame count and texture count must be larger than zero");
+            return nullptr;
         }
 
+        UniquePtr pVideo = UniquePtr(new VideoDecoder(filename, desc));
+        if(pVideo->open() == false)
+        {
+            return nullptr;
+        }
         return pVideo;
     }
 
-    VideoDecoder::VideoDecoder()
-    {
-    }
-
-    bool VideoDecoder::load(const std::string& filename, uint32_t bufferedFrames, bool async)
+    VideoDecoder::VideoDecoder(const std::string& filename, const Desc& desc) : mFilename(filename), mDesc(desc)
     {
-        mFilename = filename;
-        mVidBufferCount = bufferedFrames;
-
-        if(async)
-        {
-            mAsyncDecoding = std::make_shared<std::future<void>>(std::async(std::launch::async, &VideoDecoder::bufferFrames, this));
-        }
-        else
-            bufferFrames();
-
-        return true;
     }
 
     VideoDecoder::~VideoDecoder()
     {
-        // Flush the async operation
-        if(mAsyncDecoding)
-        {
-            mAsyncDecoding->get();
-        }
+        // Stop the decoding thread before releasing the FFmpeg objects it uses
+        mpQueue = nullptr;
 
-        av_free(mpFrame);
-
-        // Close the codec
-        avcodec_close(mpCodecCtx);
-        // Close the video file
+        sws_freeContext(mpSwsCtx);
+        av_frame_free(&mpFrame);
+        avcodec_free_context(&mpCodecCtx);
         avformat_close_input(&mpFormatCtx);
-
-        for(auto& tex : (*mFrameTextures))
-            if(tex) tex->evict(nullptr);
     }
 
-    void FlipRGBFrame(AVFrame* pFrame, int H)
+    bool VideoDecoder::open()
     {
-        uint8_t* templine = new uint8_t[pFrame->linesize[0]];
-
-        int hby2 = H / 2;
+        // Register the codecs
+        av_register_all();
 
-        for(int line = 0; line < hby2; line++)
+        if(avformat_open_input(&mpFormatCtx, mFilename.c_str(), nullptr, nullptr) != 0)
         {
-            auto* line1 = pFrame->data[0] + (line)* pFrame->linesize[0];
-            auto* line2 = pFrame->data[0] + (H - 1 - line) * pFrame->linesize[0];
-
-            memcpy(templine, line1, pFrame->linesize[0]);
-            memcpy(line1, line2, pFrame->linesize[0]);
-            memcpy(line2, templine, pFrame->linesize[0]);
+            return error(mFilename, "Can't open file");
         }
 
-        delete[] templine;
-    }
-
-    void VideoDecoder::bufferFrames()
-    {
-        if(mAsyncDecoding)
+        if(avformat_find_stream_info(mpFormatCtx, nullptr) < 0)
         {
-            setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
-            setThreadAffinity(getCurrentThread(), (1<<5)|(1<<6)|(1<<7)|(1<<8));
+            return error(mFilename, "Couldn't find stream information");
         }
 
-        if(mpFrame)
+        AVCodec* pCodec = nullptr;
+        mVideoStream = av_find_best_stream(mpFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &pCodec, 0);
+        if(mVideoStream < 0 || pCodec == nullptr)
         {
-            av_free(mpFrame);
-            mpFrame = nullptr;
+            return error(mFilename, "Can't find a video stream with a supported codec");
         }
+        AVStream* pStream = mpFormatCtx->streams[mVideoStream];
 
-        // Close the codec
-        if(mpCodecCtx)
+        mpCodecCtx = avcodec_alloc_context3(pCodec);
+        if(mpCodecCtx == nullptr || avcodec_parameters_to_context(mpCodecCtx, pStream->codecpar) < 0)
         {
-            avcodec_close(mpCodecCtx);
-            mpCodecCtx = nullptr;
+            return error(mFilename, "Couldn't create the codec context");
         }
-        // Close the video file
-        if(mpFormatCtx)
+        if(avcodec_open2(mpCodecCtx, pCodec, nullptr) < 0)
         {
-            avformat_close_input(&mpFormatCtx);
-            mpFormatCtx = nullptr;
+            return error(mFilename, "Couldn't open the codec");
         }
 
-        // Register the codecs
-        avcodec_register_all();
-        av_register_all();
-
-        if(avformat_open_input(&mpFormatCtx, mFilename.c_str(), NULL, NULL) != 0)
+        mpFrame = av_frame_alloc();
+        mWidth = mpCodecCtx->width;
+        mHeight = mpCodecCtx->height;
+        mpSwsCtx = sws_getContext(mWidth, mHeight, mpCodecCtx->pix_fmt, mWidth, mHeight, AV_PIX_FMT_RGBA, SWS_POINT, nullptr, nullptr, nullptr);
+        if(mpFrame == nullptr || mpSwsCtx == nullptr)
         {
-            printf("Cannot open file\n");
-            return;
+            return error(mFilename, "Failed to allocate the frame conversion objects");
         }
 
-        if(avformat_find_stream_info(mpFormatCtx, NULL) < 0)
+        AVRational frameRate = av_guess_frame_rate(mpFormatCtx, pStream, nullptr);
+        if(frameRate.num > 0 && frameRate.den > 0)
         {
-            printf("Couldn't find stream information.\n");
-            return;
+            mFrameRate = av_q2d(frameRate);
         }
 
-        for(uint32_t i = 0; i < mpFormatCtx->nb_streams; i++)
+        // The queue corrects the estimate when the decoder reaches the end of the clip
+        FramePlaybackQueue::Desc queueDesc;
+        queueDesc.frameSize = (size_t)mWidth * mHeight * 4;
+        queueDesc.aheadFrames = mDesc.aheadFrames;
+        queueDesc.loop = mDesc.loop;
+        queueDesc.seekThreshold = std::max(mDesc.aheadFrames, (uint32_t)(mFrameRate * 2));
+        if(pStream->nb_frames > 0)
         {
-            auto& stream = mpFormatCtx->streams[i];
-            if(stream->codec->codec_type == AVMEDIA_TYPE_VIDEO)
-            {
-                mVideoStream = i;
-                break;
-            }
+            queueDesc.clipFrameCount = pStream->nb_frames;
         }
-
-        if(mVideoStream == -1)
+        else if(pStream->duration != AV_NOPTS_VALUE)
         {
-            return;
+            queueDesc.clipFrameCount = (uint64_t)(pStream->duration * av_q2d(pStream->time_base) * mFrameRate);
         }
-
-        auto& stream = mpFormatCtx->streams[mVideoStream];
-
-        // Get a pointer to the codec context for the video stream
-        mpCodecCtxOrig = stream->codec;
-
-        mFPS = rationalToFloat(stream->avg_frame_rate);
-
-        // Find the decoder for the video stream
-        mpCodec = avcodec_find_decoder(mpCodecCtxOrig->codec_id);
-
-        if(mpCodec == NULL)
+        else if(mpFormatCtx->duration != AV_NOPTS_VALUE)
         {
-            printf("Unsupported codec!\n");
-            return; // Codec not found
+            queueDesc.clipFrameCount = (uint64_t)(mpFormatCtx->duration * mFrameRate / AV_TIME_BASE);
         }
 
-        // Copy context
-        mpCodecCtx = avcodec_alloc_context3(mpCodec);
-        if(avcodec_copy_context(mpCodecCtx, mpCodecCtxOrig) != 0)
+        for(uint32_t i = 0; i < mDesc.textureCount; i++)
         {
-            printf("Couldn't copy codec context\n");
-            return; // Error copying codec context
+            mTextures.push_back(Texture::create2D(mWidth, mHeight, ResourceFormat::RGBA8UnormSrgb, 1, 1));
         }
 
-        // Open codec
-        if(avcodec_open2(mpCodecCtx, mpCodec, nullptr) < 0)
+        mpQueue = FramePlaybackQueue::create(queueDesc, [this](uint8_t* pDst) { return decodeFrame(pDst); }, [this](uint64_t clipFrame) { return seekToFrame(clipFrame); });
+        return mpQueue != nullptr;
+    }
+
+    uint64_t VideoDecoder::decodeFrame(uint8_t* pDst)
+    {
+        if(mDecodeThreadInitialized == false)
         {
-            return; // Could not open codec
+            // Playback shouldn't compete with the render thread
+            setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
+            mDecodeThreadInitialized = true;
         }
 
-        // Allocate video frame
-        mpFrame = av_frame_alloc();
-
-
-        mFrames.clear();
-        mFrames.reserve(mVidBufferCount);
-
-        const bool async = mAsyncDecoding != nullptr;
-
-        //printf("Buffering frames...\n");
-        uint32_t frameIdx = 0;
-
-        SwsContext *sws_ctx = sws_getContext(
-            mpCodecCtx->width, mpCodecCtx->height, mpCodecCtx->pix_fmt,
-            mpCodecCtx->width, mpCodecCtx->height, PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
-
-        AVPacket packet;
-        while(av_read_frame(mpFormatCtx, &packet) >= 0 && (frameIdx < mVidBufferCount))
+        while(true)
         {
-            if(packet.stream_index == mVideoStream)
+            int r = avcodec_receive_frame(mpCodecCtx, mpFrame);
+            if(r == 0)
             {
-                int32_t isFrameDone;
-                avcodec_decode_video2(mpCodecCtx, mpFrame, &isFrameDone, &packet);
-                if(isFrameDone)
-                {
-                    // Create either a single frame, or all frames one-by-one on CPU
-                    if(async || mFrames.empty())
-                    {
-                        // Inplace construction to avoid releasing of arrays
-                        mFrames.push_back(Frame());
-                        new(&mFrames.back()) Frame(mpCodecCtx);
-                    }
-                    Frame& frame = mFrames.back();
-
-                    // Convert the image from its native format to RGB
-                    sws_scale(sws_ctx, (uint8_t const * const *)mpFrame->data, mpFrame->linesize, 0, mpCodecCtx->height, frame.mpFrameRGB->data, frame.mpFrameRGB->linesize);
-                    FlipRGBFrame(frame.mpFrameRGB, mpCodecCtx->height);
-                    if(!async)
-                        uploadToGPU(frameIdx);
-
-                    frameIdx++;
-                }
+                break;
+            }
+            else if(r == AVERROR_EOF)
+            {
+                return FramePlaybackQueue::kEndOfStream;
+            }
+            else if(r != AVERROR(EAGAIN))
+            {
+                logError("VideoDecoder - can't decode a frame from " + mFilename);
+                return FramePlaybackQueue::kEndOfStream;
             }
-            av_free_packet(&packet);
-        }
-        //printf("Done reading %d frames\n", frameIdx);
-
-        mRealFrameCount = frameIdx;
-    }
 
-    void VideoDecoder::uploadToGPU(int frameStart)
-    {
-        if(!mFrameTextures)
-            mFrameTextures = std::make_shared<TexturePool>();
-        for(size_t i=0;i<mFrames.size();++i)
-        {
-            auto& frame = mFrames[i];
-            if(frameStart + i >= mFrameTextures->size())
+            // The decoder needs more data
+            AVPacket packet = {0};
+            av_init_packet(&packet);
+            if(av_read_frame(mpFormatCtx, &packet) < 0)
             {
-                mFrameTextures->push_back(Texture::create2D(mpCodecCtx->width, mpCodecCtx->height, ResourceFormat::RGBA8UnormSrgb, 1, 1, frame.mpFrameRGB->data[0]));
-                mFrameTextures->back()->makeResident(nullptr);
+                // End of the file, drain the frames the decoder holds. Once it's drained, avcodec_receive_frame() returns AVERROR_EOF.
+                avcodec_send_packet(mpCodecCtx, nullptr);
+                continue;
             }
-            else
+            if(packet.stream_index == mVideoStream)
             {
-                (*mFrameTextures)[frameStart + i]->uploadSubresourceData(frame.mpFrameRGB->data[0], frame.mFrameSize);
+                avcodec_send_packet(mpCodecCtx, &packet);
             }
+            av_packet_unref(&packet);
         }
-        mFrames.clear();
-    }
 
-    Texture::SharedPtr VideoDecoder::getTextureForNextFrame(float curTime)
-    {
-        // Flush the async operation, upload everything to video memory
-        if(mAsyncDecoding)
+        // Convert the image from its native format to RGBA. Flipping is done by writing the rows bottom-up.
+        const int32_t rowSize = (int32_t)mWidth * 4;
+        uint8_t* dst[AV_NUM_DATA_POINTERS] = {0};
+        int32_t dstRowPitch[AV_NUM_DATA_POINTERS] = {0};
+        dst[0] = mDesc.flipY ? pDst + (size_t)(mHeight - 1) * rowSize : pDst;
+        dstRowPitch[0] = mDesc.flipY ? -rowSize : rowSize;
+        sws_scale(mpSwsCtx, mpFrame->data, mpFrame->linesize, 0, mHeight, dst, dstRowPitch);
+
+        uint64_t clipFrame = mNextClipFrame;
+        const int64_t pts = av_frame_get_best_effort_timestamp(mpFrame);
+        if(pts != AV_NOPTS_VALUE)
         {
-            mAsyncDecoding->get();
-            mAsyncDecoding.reset();
-            uploadToGPU();
+            const AVStream* pStream = mpFormatCtx->streams[mVideoStream];
+            const int64_t startTime = (pStream->start_time != AV_NOPTS_VALUE) ? pStream->start_time : 0;
+            const double frame = (pts - startTime) * av_q2d(pStream->time_base) * mFrameRate;
+            clipFrame = (frame > 0) ? (uint64_t)(frame + 0.5) : 0;
         }
-        int curFrame = ((int)floor(curTime * mFPS)) % mRealFrameCount;
-        //SetBufferToTexture(m_VidBuffers[curFrame]);
-        //printf("time, frame: %f, %d\n", curTime, curFrame);
-        return (*mFrameTextures)[curFrame];
+        mNextClipFrame = clipFrame + 1;
+        return clipFrame;
     }
 
-    float VideoDecoder::getDuration()
+    bool VideoDecoder::seekToFrame(uint64_t clipFrame)
     {
-        // Flush the async operation, upload everything to video memory
-        if(mAsyncDecoding)
+        const AVStream* pStream = mpFormatCtx->streams[mVideoStream];
+        int64_t timestamp = (int64_t)(clipFrame / mFrameRate / av_q2d(pStream->time_base));
+        if(pStream->start_time != AV_NOPTS_VALUE)
         {
-            mAsyncDecoding->get();
-            mAsyncDecoding.reset();
-            uploadToGPU();
+            timestamp += pStream->start_time;
         }
 
-        return ((float)mRealFrameCount) / mFPS;
-    }
-
-    VideoDecoder::TexturePoolPtr VideoDecoder::getTexturePool()
-    {
-        return mFrameTextures;
-    }
-
-    void VideoDecoder::setTexturePool(TexturePoolPtr& texturePool)
-    {
-        mFrameTextures = texturePool;
+        // Lands on the key frame at or before the timestamp. The queue skips the frames before the target.
+        if(av_seek_frame(mpFormatCtx, mVideoStream, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+        {
+            return false;
+        }
+        avcodec_flush_buffers(mpCodecCtx);
+        mNextClipFrame = clipFrame;
+        return true;
     }
 
-    VideoDecoder::Frame::Frame(AVCodecContext* codec)
+    Texture::SharedPtr VideoDecoder::getTextureForNextFrame(float curTime)
     {
-        mFrameSize = avpicture_get_size(PIX_FMT_RGBA, codec->width, codec->height);
+        const uint64_t frame = (curTime > 0) ? (uint64_t)(curTime * mFrameRate) : 0;
 
-        // Allocate an AVFrame structure
-        mpFrameRGB = av_frame_alloc();
-        if(mpFrameRGB == NULL)
+        // Only wait if nothing was decoded yet, so the first texture isn't empty
+        const bool wait = mpQueue->getCurrentFrameData() == nullptr;
+        if(mpQueue->update(frame, wait))
         {
-            printf("Cannot allocate frame. Possibly out of CPU memory!\n");
-            return;
+            // Upload to the next texture, the previous ones may still be in use
+            mTextureIndex = (mTextureIndex + 1) % mTextures.size();
+            gpDevice->getRenderContext()->updateTexture(mTextures[mTextureIndex].get(), mpQueue->getCurrentFrameData());
         }
-        mCpuVidBuffer = (uint8_t*)av_malloc(mFrameSize*sizeof(uint8_t));
+        return mTextures[mTextureIndex];
+    }
 
-        avpicture_fill((AVPicture *)mpFrameRGB, mCpuVidBuffer, PIX_FMT_RGBA, codec->width, codec->height);
-        //printf("frame size is %d Mbytes\n", mFrameSize / (1024 * 1024));
+    void VideoDecoder::seek(float time)
+    {
+        mpQueue->seek((time > 0) ? (uint64_t)(time * mFrameRate) : 0);
     }
 
-    VideoDecoder::Frame::~Frame()
+    float VideoDecoder::getDuration() const
     {
-        if(mCpuVidBuffer)
-            av_free(mCpuVidBuffer);
-        if(mpFrameRGB)
-            av_free(mpFrameRGB);
+        return (float)(mpQueue->getClipFrameCount() / mFrameRate);
     }
-#endif
-}
\ No newline at end of file
+}
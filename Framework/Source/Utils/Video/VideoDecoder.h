@@ -27,23 +27,19 @@
 ***************************************************************************/
 #pragma once
 #include <string>
-#include <future>
+#include <vector>
 #include "API/Texture.h"
+#include "Utils/Video/FramePlaybackQueue.h"
 
 struct AVFormatContext;
-struct AVStream;
 struct AVFrame;
-struct AVPicture;
 struct SwsContext;
 struct AVCodecContext;
-struct AVCodec;
-struct AVRational;
 
 namespace Falcor
-{        
-    /** Simple video decoder for high-framerate and high-resolution
-    playback of rendered videos. Currently decodes the first N frames
-    as textures before playing.
+{
+    /** Video decoder for high-framerate and high-resolution playback of rendered videos.
+        Frames are decoded on a worker thread which stays a few frames ahead of playback. Decoded frames and textures are recycled through fixed rings, so the memory usage doesn't depend on the length of the clip.
     */
     class VideoDecoder
     {
@@ -51,76 +47,70 @@ namespace Falcor
         using UniquePtr = std::unique_ptr<VideoDecoder>;
         using UniqueConstPtr = std::unique_ptr<const VideoDecoder>;
 
-        typedef std::vector<Texture::SharedPtr> TexturePool;
-        typedef std::shared_ptr<TexturePool> TexturePoolPtr;
+        struct Desc
+        {
+            uint32_t aheadFrames = 8;       ///< Maximum number of frames decoded ahead of playback. Each one takes a CPU buffer of width * height * 4 bytes.
+            uint32_t textureCount = 2;      ///< Number of textures the frames are uploaded to in turn. A returned texture keeps its content for textureCount - 1 more frames.
+            bool loop = true;               ///< Restart at the first frame after the end of the clip. Otherwise the last frame is held.
+            bool flipY = true;              ///< Flip the frames vertically
+        };
 
-        /** create a new videoplay object
+        /** Create a new decoder and start decoding
             \param[in] filename Input video file (with path)
-            \param[in] bufferFrames The maximum number of input frames to buffer as Texture objects. Default is 300.
+            \param[in] desc Decoder description
+            \return A new object, or nullptr if the file can't be opened or decoded
         */
-        static UniquePtr create(const std::string& filename, uint32_t bufferedFrames = 300, bool async = false);
+        static UniquePtr create(const std::string& filename, const Desc& desc = Desc());
         ~VideoDecoder();
 
-        /** Get a texture object for the frame at current time
+        /** Get a texture object for the frame at current time.
+            Only the first call waits for the decoder. If the decoder falls behind, the previous frame is returned until it catches up. Moving back in time, or far ahead, seeks.
             \param[in] curTime Time for which frame is sought
             \return Texture pointer to texture object
         */
         Texture::SharedPtr getTextureForNextFrame(float curTime);
 
-        /** Return duration of video loaded (in seconds).
-            This uses the actual number of frames. Only makes sense
-            for videos shorter than the requested frame count.
+        /** Restart decoding at a time. getTextureForNextFrame() seeks automatically when time jumps, this can be used to start decoding before the time is reached.
         */
-        float getDuration();
+        void seek(float time);
 
-        /** Returns reusable shared texture pool
+        /** Return duration of video loaded (in seconds).
+            The duration is estimated from the container until the decoder reaches the end of the clip.
         */
-        TexturePoolPtr getTexturePool();
+        float getDuration() const;
 
-        /** Sets reusable shared texture pool
+        /** Get the number of frames per second
         */
-        void setTexturePool(TexturePoolPtr& texturePool);
+        float getFrameRate() const { return (float)mFrameRate; }
 
-        bool load(const std::string& filename, uint32_t bufferedFrames, bool async);
+        uint32_t getWidth() const { return mWidth; }
+        uint32_t getHeight() const { return mHeight; }
 
     private:
-        /** Holds a single video frame on CPU
-        */
-        struct Frame
-        {
-            Frame() {}
-            Frame(AVCodecContext* codec);
-            ~Frame();
-            AVFrame*    mpFrameRGB = nullptr;
-            uint8_t*    mCpuVidBuffer = nullptr;
-            int         mFrameSize = 0;
-        };
-
-        VideoDecoder();
+        VideoDecoder(const std::string& filename, const Desc& desc);
+        bool open();
 
-        void uploadToGPU(int frameStart = 0);
+        // Called on the decoding thread
+        uint64_t decodeFrame(uint8_t* pDst);
+        bool seekToFrame(uint64_t clipFrame);
 
         std::string mFilename;
+        Desc mDesc;
 
         AVFormatContext*                        mpFormatCtx       = nullptr;
-        AVCodecContext*                         mpCodecCtxOrig    = nullptr;
         AVCodecContext*                         mpCodecCtx        = nullptr;
-        AVCodec*                                mpCodec           = nullptr;
         AVFrame*                                mpFrame           = nullptr;
-        std::vector<Frame>                      mFrames;
-
-        float                                   mFPS              = 30;
-        bool                                    mFlipY            = true;
-        unsigned                                mVideoStream      = -1;
-        uint32_t                                mVidBufferCount   = 300;
-        uint32_t                                mRealFrameCount = 0;
-
-        std::shared_ptr<std::future<void>>        mAsyncDecoding = nullptr;
-
-        TexturePoolPtr                          mFrameTextures;
-
-        // helper routines
-        void  bufferFrames();
-        float rationalToFloat(const AVRational& r);
+        SwsContext*                             mpSwsCtx          = nullptr;
+        int32_t                                 mVideoStream      = -1;
+
+        uint32_t                                mWidth            = 0;
+        uint32_t                                mHeight           = 0;
+        double                                  mFrameRate        = 30;
+        uint64_t                                mNextClipFrame    = 0;        // Used for frames without a timestamp
+        bool                                    mDecodeThreadInitialized = false;
+
+        FramePlaybackQueue::UniquePtr           mpQueue;
+        std::vector<Texture::SharedPtr>         mTextures;
+        uint32_t                                mTextureIndex     = 0;
     };
 }
\ No newline at end of file
@@ -410,6 +410,11 @@ namespace Falcor
         }
     }
 
+    uint32_t getProcessId()
+    {
+        return (uint32_t)::GetCurrentProcessId();
+    }
+
     std::thread::native_handle_type getCurrentThread()
     {
         return ::GetCurrentThread();
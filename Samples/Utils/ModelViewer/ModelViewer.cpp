@@ -79,6 +79,7 @@ void ModelViewer::loadModelFromFile(const std::string& filename)
     flags |= mGenerateTangentSpace ? Model::GenerateTangentSpace : 0;
     auto fboFormat = mpDefaultFBO->getColorTexture(0)->getFormat();
     flags |= isSrgbFormat(fboFormat) ? 0 : Model::AssumeLinearSpaceTextures;
+    flags |= mParallelImport ? Model::ParallelImport : 0;
     mpModel = Model::createFromFile(filename, flags);
 
     if(mpModel == nullptr)
@@ -131,6 +132,7 @@ void ModelViewer::onGuiRender()
     if (mpGui->beginGroup("Load Options"))
     {
         mpGui->addCheckBox("Generate Tangent Space", mGenerateTangentSpace);
+        mpGui->addCheckBox("Parallel Import", mParallelImport);
         if (mpGui->addButton("Export Model To Binary File"))
         {
             saveModel();
@@ -26,10 +26,12 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #include "ObjToBin.h"
+#include "Graphics/Model/Loaders/BinaryModelExporter.h"
 
-ObjToBin::ObjToBin(std::vector<std::string> objFiles)
+ObjToBin::ObjToBin(std::vector<std::string> objFiles, bool optimizeMeshes)
 {
     mObjFiles = objFiles;
+    mOptimizeMeshes = optimizeMeshes;
 }
 
 void ObjToBin::convertObjToBin(const std::string& objFile)
@@ -51,7 +53,16 @@ void ObjToBin::convertObjToBin(const std::string& objFile)
         if (!Falcor::doesFileExist(binFilename))
         {
             printf("    Writing %s ...\n", binFilename.c_str());
-            pModel->exportToBinaryFile(binFilename);
+            if (mOptimizeMeshes)
+            {
+                BinaryModelExporter::ExportStats stats;
+                BinaryModelExporter::exportToFile(binFilename, pModel.get(), BinaryModelExporter::OptimizeMeshes, &stats);
+                logInfo(binFilename + ": ACMR " + std::to_string(stats.original.getAcmr()) + " -> " + std::to_string(stats.exported.getAcmr()) + ", ATVR " + std::to_string(stats.original.getAtvr()) + " -> " + std::to_string(stats.exported.getAtvr()));
+            }
+            else
+            {
+                pModel->exportToBinaryFile(binFilename);
+            }
         }
         else
         {
@@ -81,16 +92,23 @@ void ObjToBin::onShutdown()
 
 int main(int argc, char* argv[])
 {
-    if (argc >= 2)
+    std::vector<std::string> objFiles;
+    bool optimizeMeshes = false;
+    for (int argi = 1; argi < argc; ++argi)
     {
-        std::vector<std::string> objFiles;
-
-        for (int argi = 1; argi < argc; ++argi)
+        if (std::string(argv[argi]) == "-optimize")
+        {
+            optimizeMeshes = true;
+        }
+        else
         {
             objFiles.push_back(std::string(argv[argi]));
         }
+    }
 
-        ObjToBin ObjToBin(objFiles);
+    if (objFiles.size())
+    {
+        ObjToBin ObjToBin(objFiles, optimizeMeshes);
         SampleConfig config;
         config.windowDesc.width = 256;
         config.windowDesc.height = 256;
@@ -99,6 +117,7 @@ int main(int argc, char* argv[])
     }
     else
     {
-        printf("Syntax: ObjToBin <list of obj files>\n");
+        printf("Syntax: ObjToBin [-optimize] <list of obj files>\n");
+        printf("    -optimize  Reorder the meshes for the vertex cache, overdraw and vertex fetch, and log the ACMR/ATVR before and after\n");
     }
 }
\ No newline at end of file
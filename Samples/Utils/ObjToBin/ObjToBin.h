@@ -36,10 +36,11 @@ public:
     void onLoad() override;
     void onShutdown() override;
 
-    ObjToBin(std::vector<std::string> objFiles);
+    ObjToBin(std::vector<std::string> objFiles, bool optimizeMeshes);
     void convertObjToBin(const std::string& objFile);
 private:
     inline void shutdown() {}
 
     std::vector<std::string> mObjFiles;
+    bool mOptimizeMeshes = false;
 };
\ No newline at end of file
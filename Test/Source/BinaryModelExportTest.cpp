@@ -0,0 +1,162 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BinaryModelExportTest.h"
+#include "Graphics/Model/Loaders/BinaryModelImporter.h"
+
+void BinaryModelExportTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+}
+
+testing_func(BinaryModelExportTest, TestRoundTrip)
+{
+    const std::string models[] = { "teapot.obj", "sphere.obj" };
+    for (const auto& name : models)
+    {
+        Model::SharedPtr pModel = Model::createFromFile(name.c_str(), Model::KeepCpuGeometry);
+        if (pModel == nullptr)
+        {
+            return test_fail("Failed to load " + name);
+        }
+
+        // A second instance of the first mesh, so that the instance transforms are exported too
+        pModel->addMeshInstance(pModel->getMesh(0), glm::translate(glm::mat4(), glm::vec3(1, 2, 3)));
+
+        std::string error = roundTrip(pModel, getExecutableDirectory() + "\\BinaryModelExportTest.bin");
+        if (error.size())
+        {
+            return test_fail(name + ": " + error);
+        }
+    }
+    return test_pass();
+}
+
+std::string BinaryModelExportTest::roundTrip(const Model::SharedPtr& pModel, const std::string& filename)
+{
+    BinaryModelExporter::exportToFile(filename, pModel.get());
+    Model::SharedPtr pLoaded = BinaryModelImporter::createFromFile(filename, Model::KeepCpuGeometry);
+    std::remove(filename.c_str());
+
+    if (pLoaded == nullptr)
+    {
+        return "Failed to load the exported file";
+    }
+    if (pLoaded->getMeshCount() != pModel->getMeshCount())
+    {
+        return "Different mesh count";
+    }
+    if (countMeshInstances(pLoaded.get()) != countMeshInstances(pModel.get()))
+    {
+        return "Different mesh instance count";
+    }
+    if (pLoaded->getMaterialCount() != pModel->getMaterialCount())
+    {
+        return "Different material count";
+    }
+
+    // The exporter groups meshes by their VAO, so the file doesn't keep the mesh order. Match every loaded mesh to the original mesh with the same geometry.
+    std::vector<bool> matched(pModel->getMeshCount(), false);
+    for (uint32_t i = 0; i < pLoaded->getMeshCount(); i++)
+    {
+        const Mesh* pLoadedMesh = pLoaded->getMesh(i).get();
+        std::string error = "Mesh " + std::to_string(i) + " doesn't match any of the exported meshes";
+        for (uint32_t j = 0; j < pModel->getMeshCount(); j++)
+        {
+            if (matched[j])
+            {
+                continue;
+            }
+
+            std::string meshError = compareMeshes(pModel->getMesh(j).get(), pLoadedMesh);
+            if (meshError.empty())
+            {
+                meshError = (pModel->getMeshInstanceCount(j) == pLoaded->getMeshInstanceCount(i)) ? "" : "Mesh " + std::to_string(i) + " has a different instance count";
+            }
+            for (uint32_t k = 0; meshError.empty() && k < pLoaded->getMeshInstanceCount(i); k++)
+            {
+                if (pModel->getMeshInstance(j, k)->getTransformMatrix() != pLoaded->getMeshInstance(i, k)->getTransformMatrix())
+                {
+                    meshError = "Mesh " + std::to_string(i) + " instance " + std::to_string(k) + " has a different transform";
+                }
+            }
+
+            if (meshError.empty())
+            {
+                matched[j] = true;
+                error.clear();
+                break;
+            }
+        }
+
+        if (error.size())
+        {
+            return error;
+        }
+    }
+    return "";
+}
+
+uint32_t BinaryModelExportTest::countMeshInstances(const Model* pModel)
+{
+    // Model::getInstanceCount() isn't updated by addMeshInstance(), so count the instances directly
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < pModel->getMeshCount(); i++)
+    {
+        count += pModel->getMeshInstanceCount(i);
+    }
+    return count;
+}
+
+std::string BinaryModelExportTest::compareMeshes(const Mesh* pExpected, const Mesh* pLoaded)
+{
+    if (pExpected->getVertexCount() != pLoaded->getVertexCount() || pExpected->getIndexCount() != pLoaded->getIndexCount())
+    {
+        return "Different vertex or index count";
+    }
+    if (pLoaded->hasCpuGeometry() == false)
+    {
+        return "The loaded mesh has no CPU geometry";
+    }
+    if (pExpected->getCpuPositions() != pLoaded->getCpuPositions())
+    {
+        return "Different vertex positions";
+    }
+    if (pExpected->getCpuIndices() != pLoaded->getCpuIndices())
+    {
+        return "Different indices";
+    }
+    return "";
+}
+
+int main()
+{
+    BinaryModelExportTest bmet;
+    bmet.init(true);
+    bmet.run();
+    return 0;
+}
@@ -0,0 +1,229 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BinaryModelLoadTest.h"
+#include "Utils/BinaryFileStream.h"
+#include "Graphics/Model/Loaders/BinaryModelSpec.h"
+#include "Utils/ThreadPool.h"
+
+void BinaryModelLoadTest::addTests()
+{
+    addTestToList<TestParallelMatchesSerial>();
+    addTestToList<TestLoadPerformance>();
+}
+
+testing_func(BinaryModelLoadTest, TestParallelMatchesSerial)
+{
+    const std::string filename = getExecutableDirectory() + "\\BinaryModelLoadTestSmall.bin";
+    writeModel(filename, 37, 33, 5, 67);
+
+    const uint32_t flags = Model::GenerateTangentSpace;
+    Model::SharedPtr pSerial = BinaryModelImporter::createFromFile(filename, flags);
+    Model::SharedPtr pParallel = BinaryModelImporter::createFromFile(filename, flags | Model::ParallelImport);
+    std::remove(filename.c_str());
+
+    if (pSerial == nullptr || pParallel == nullptr)
+    {
+        return test_fail("Failed to load the model");
+    }
+
+    std::string error = compareModels(pSerial.get(), pParallel.get());
+    if (error.size())
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+testing_func(BinaryModelLoadTest, TestLoadPerformance)
+{
+    // 128 meshes with 32K vertices and 64K triangles each, and 16 1K x 1K RGB textures
+    const std::string filename = getExecutableDirectory() + "\\BinaryModelLoadTestLarge.bin";
+    writeModel(filename, 128, 181, 16, 1024);
+
+    const uint32_t flags = Model::GenerateTangentSpace;
+    BinaryModelImporter::LoadStats serialStats, parallelStats;
+
+    // Load once to warm up the file cache
+    BinaryModelImporter::createFromFile(filename, flags);
+    Model::SharedPtr pSerial = BinaryModelImporter::createFromFile(filename, flags, &serialStats);
+    Model::SharedPtr pParallel = BinaryModelImporter::createFromFile(filename, flags | Model::ParallelImport, &parallelStats);
+    std::remove(filename.c_str());
+
+    if (pSerial == nullptr || pParallel == nullptr)
+    {
+        return test_fail("Failed to load the model");
+    }
+
+    std::string error = compareModels(pSerial.get(), pParallel.get());
+    if (error.size())
+    {
+        return test_fail(error);
+    }
+
+    std::cout << pSerial->getMeshCount() << " meshes, " << ThreadPool::getGlobalPool().getThreadCount() + 1 << " threads\n";
+    printStats("Serial", serialStats);
+    printStats("Parallel", parallelStats);
+    std::cout << "Decode speedup " << serialStats.decodeTime / parallelStats.decodeTime << "x, total speedup " << serialStats.totalTime / parallelStats.totalTime << "x\n";
+    return test_pass();
+}
+
+void BinaryModelLoadTest::writeModel(const std::string& filename, uint32_t meshCount, uint32_t gridSize, uint32_t textureCount, uint32_t textureSize)
+{
+    BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+    srand(meshCount);
+
+    stream.write("BinScene", 8);
+    stream << (int32_t)8 << (int32_t)textureCount << (int32_t)meshCount << (int32_t)meshCount;
+
+    // Textures. R8_G8_B8 texels are expanded to RGBX by the importer.
+    std::vector<uint8_t> texels((size_t)textureSize * textureSize * 3);
+    for (uint32_t t = 0; t < textureCount; t++)
+    {
+        for (auto& texel : texels)
+        {
+            texel = (uint8_t)rand();
+        }
+
+        std::string name = "Texture" + std::to_string(t);
+        stream << (int32_t)name.size();
+        stream.write(name.c_str(), name.size());
+        stream.write("BinImage", 8);
+        // Version, width, height, bytes-per-pixel, channel count, FormatID (R8_G8_B8), DataSize
+        stream << (int32_t)2 << (int32_t)textureSize << (int32_t)textureSize << (int32_t)3 << (int32_t)0 << (int32_t)0 << (int32_t)texels.size();
+        stream.write(texels.data(), texels.size());
+    }
+
+    // Meshes. Each mesh is a displaced grid with position, normal and texture coordinate attributes, split into 2 submeshes.
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoord;
+    };
+
+    const uint32_t vertexCount = gridSize * gridSize;
+    std::vector<Vertex> vertices(vertexCount);
+    std::vector<uint32_t> indices;
+    indices.reserve((gridSize - 1) * (gridSize - 1) * 6);
+    for (uint32_t y = 0; y < gridSize - 1; y++)
+    {
+        for (uint32_t x = 0; x < gridSize - 1; x++)
+        {
+            uint32_t v = y * gridSize + x;
+            uint32_t quad[6] = { v, v + 1, v + gridSize, v + 1, v + gridSize + 1, v + gridSize };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+    const uint32_t firstTriangleCount = triangleCount / 2;
+
+    for (uint32_t m = 0; m < meshCount; m++)
+    {
+        glm::vec3 offset((float)(m % 16) * gridSize, 0, (float)(m / 16) * gridSize);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            float x = (float)(v % gridSize);
+            float z = (float)(v / gridSize);
+            vertices[v].position = offset + glm::vec3(x, (float)rand() / RAND_MAX, z);
+            vertices[v].normal = glm::vec3(0, 1, 0);
+            vertices[v].texCoord = glm::vec2(x, z) / (float)(gridSize - 1);
+        }
+
+        // Mesh header and the attributes (type, format, length)
+        stream << (int32_t)3 << (int32_t)vertexCount << (int32_t)2;
+        stream << (int32_t)AttribType_Position << (int32_t)AttribFormat_F32 << (int32_t)3;
+        stream << (int32_t)AttribType_Normal << (int32_t)AttribFormat_F32 << (int32_t)3;
+        stream << (int32_t)AttribType_TexCoord << (int32_t)AttribFormat_F32 << (int32_t)2;
+        stream.write(vertices.data(), vertices.size() * sizeof(Vertex));
+
+        for (uint32_t s = 0; s < 2; s++)
+        {
+            // Material: ambient, diffuse, specular, glossiness, displacement coefficient and bias, texture IDs
+            stream << glm::vec3(0) << glm::vec4(1) << glm::vec3(0.5f) << 1.0f << 0.0f << 0.0f;
+            for (int32_t slot = 0; slot < TextureType_Glossiness + 1; slot++)
+            {
+                int32_t texID = (slot == TextureType_Diffuse && textureCount) ? (int32_t)((m + s) % textureCount) : -1;
+                stream << texID;
+            }
+
+            uint32_t firstTriangle = s ? firstTriangleCount : 0;
+            uint32_t submeshTriangles = s ? triangleCount - firstTriangleCount : firstTriangleCount;
+            stream << (int32_t)submeshTriangles;
+            stream.write(indices.data() + firstTriangle * 3, submeshTriangles * 3 * sizeof(uint32_t));
+        }
+    }
+
+    // Instances: mesh index, enabled, transform, name, meta-data
+    for (uint32_t m = 0; m < meshCount; m++)
+    {
+        stream << (int32_t)m << (int32_t)1 << glm::mat4() << (int32_t)0 << (int32_t)0;
+    }
+}
+
+std::string BinaryModelLoadTest::compareModels(const Model* pSerial, const Model* pParallel)
+{
+    if (pSerial->getMeshCount() != pParallel->getMeshCount())
+    {
+        return "Serial and parallel import created a different number of meshes";
+    }
+
+    for (uint32_t i = 0; i < pSerial->getMeshCount(); i++)
+    {
+        const Mesh* pSerialMesh = pSerial->getMesh(i).get();
+        const Mesh* pParallelMesh = pParallel->getMesh(i).get();
+        const BoundingBox& serialBox = pSerialMesh->getBoundingBox();
+        const BoundingBox& parallelBox = pParallelMesh->getBoundingBox();
+
+        if (pSerialMesh->getVertexCount() != pParallelMesh->getVertexCount() || pSerialMesh->getPrimitiveCount() != pParallelMesh->getPrimitiveCount())
+        {
+            return "Mesh " + std::to_string(i) + " has different vertex or primitive counts";
+        }
+        if (serialBox.center != parallelBox.center || serialBox.extent != parallelBox.extent)
+        {
+            return "Mesh " + std::to_string(i) + " has different bounding boxes";
+        }
+        if (pSerialMesh->getVao()->getVertexBuffersCount() != pParallelMesh->getVao()->getVertexBuffersCount())
+        {
+            return "Mesh " + std::to_string(i) + " has a different vertex layout";
+        }
+    }
+    return "";
+}
+
+void BinaryModelLoadTest::printStats(const std::string& name, const BinaryModelImporter::LoadStats& stats)
+{
+    std::cout << name << ": parse " << stats.parseTime << "ms, decode " << stats.decodeTime << "ms, create " << stats.createTime << "ms, total " << stats.totalTime << "ms\n";
+}
+
+int main()
+{
+    BinaryModelLoadTest bmlt;
+    bmlt.init(true);
+    bmlt.run();
+    return 0;
+}
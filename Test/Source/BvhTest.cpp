@@ -0,0 +1,277 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BvhTest.h"
+
+void BvhTest::addTests()
+{
+    addTestToList<TestBuild>();
+    addTestToList<TestRefit>();
+    addTestToList<TestSameCenter>();
+}
+
+testing_func(BvhTest, TestBuild)
+{
+    BoxList list;
+    generateBoxes(10007, list);
+    Bvh::UniquePtr pBvh = Bvh::create();
+
+    const uint32_t leafSizes[] = { 1, 4, 16 };
+    for (uint32_t maxLeafSize : leafSizes)
+    {
+        pBvh->build(list.getArrays(), maxLeafSize);
+        std::string error = validateTree(pBvh.get(), list, maxLeafSize);
+        if (error.size())
+        {
+            return test_fail(error);
+        }
+
+        // Outside, inside and crossing the cloud of boxes, so that all the node classifications are exercised
+        Camera::SharedPtr pCameras[] =
+        {
+            createCamera(glm::vec3(10, 20, -150), glm::vec3(0, 0, 0)),
+            createCamera(glm::vec3(0, 0, 0), glm::vec3(1, 0.2f, 0.5f)),
+            createCamera(glm::vec3(0, 0, -500), glm::vec3(0, 0, -1000)),
+        };
+        for (const auto& pCamera : pCameras)
+        {
+            uint32_t mismatches = compareWithBruteForce(pBvh.get(), pCamera.get(), list);
+            if (mismatches)
+            {
+                return test_fail("Hierarchical culling differs from per-box culling for " + std::to_string(mismatches) + " boxes");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BvhTest, TestRefit)
+{
+    BoxList list;
+    generateBoxes(5003, list);
+    Bvh::UniquePtr pBvh = Bvh::create();
+    pBvh->build(list.getArrays());
+    Camera::SharedPtr pCamera = createCamera(glm::vec3(10, 20, -150), glm::vec3(0, 0, 0));
+
+    // Move the boxes a few times without rebuilding. The tree quality degrades, the results must not.
+    srand(17);
+    for (uint32_t step = 0; step < 4; step++)
+    {
+        for (size_t i = 0; i < list.centerX.size(); i++)
+        {
+            list.centerX[i] += 40 * ((float)rand() / (float)RAND_MAX - 0.5f);
+            list.centerY[i] += 40 * ((float)rand() / (float)RAND_MAX - 0.5f);
+            list.centerZ[i] += 10 * step;
+        }
+        pBvh->refit(list.getArrays());
+
+        std::string error = validateTree(pBvh.get(), list, 4);
+        if (error.size())
+        {
+            return test_fail("After refit: " + error);
+        }
+        uint32_t mismatches = compareWithBruteForce(pBvh.get(), pCamera.get(), list);
+        if (mismatches)
+        {
+            return test_fail("After refit, hierarchical culling differs from per-box culling for " + std::to_string(mismatches) + " boxes");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BvhTest, TestSameCenter)
+{
+    // All the centroids are equal, so no split can separate them. The build has to terminate and still produce a valid tree.
+    const uint32_t boxCount = 1000;
+    BoxList list;
+    generateBoxes(boxCount, list);
+    for (uint32_t i = 0; i < boxCount; i++)
+    {
+        list.centerX[i] = 5;
+        list.centerY[i] = -3;
+        list.centerZ[i] = 20;
+    }
+
+    Bvh::UniquePtr pBvh = Bvh::create();
+    pBvh->build(list.getArrays());
+    std::string error = validateTree(pBvh.get(), list, 4);
+    if (error.size())
+    {
+        return test_fail(error);
+    }
+
+    Camera::SharedPtr pCameras[] =
+    {
+        createCamera(glm::vec3(5, -3, -50), glm::vec3(5, -3, 20)),
+        createCamera(glm::vec3(5, -3, -50), glm::vec3(5, -3, -100)),
+        createCamera(glm::vec3(0, 0, 0), glm::vec3(1, 0, 0)),
+    };
+    for (const auto& pCamera : pCameras)
+    {
+        uint32_t mismatches = compareWithBruteForce(pBvh.get(), pCamera.get(), list);
+        if (mismatches)
+        {
+            return test_fail("Hierarchical culling of boxes with the same center differs from per-box culling for " + std::to_string(mismatches) + " boxes");
+        }
+    }
+    return test_pass();
+}
+
+BoundingBoxArrays BvhTest::BoxList::getArrays() const
+{
+    BoundingBoxArrays arrays;
+    arrays.pCenterX = centerX.data();
+    arrays.pCenterY = centerY.data();
+    arrays.pCenterZ = centerZ.data();
+    arrays.pExtentX = extentX.data();
+    arrays.pExtentY = extentY.data();
+    arrays.pExtentZ = extentZ.data();
+    arrays.count = (uint32_t)centerX.size();
+    return arrays;
+}
+
+BoundingBox BvhTest::BoxList::getBox(uint32_t i) const
+{
+    BoundingBox box;
+    box.center = glm::vec3(centerX[i], centerY[i], centerZ[i]);
+    box.extent = glm::vec3(extentX[i], extentY[i], extentZ[i]);
+    return box;
+}
+
+void BvhTest::generateBoxes(uint32_t count, BoxList& list)
+{
+    list.centerX.resize(count);
+    list.centerY.resize(count);
+    list.centerZ.resize(count);
+    list.extentX.resize(count);
+    list.extentY.resize(count);
+    list.extentZ.resize(count);
+
+    srand(count);
+    auto randomFloat = [](float minVal, float maxVal) { return minVal + (maxVal - minVal) * (float)rand() / (float)RAND_MAX; };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        list.centerX[i] = randomFloat(-200, 200);
+        list.centerY[i] = randomFloat(-200, 200);
+        list.centerZ[i] = randomFloat(-200, 200);
+        list.extentX[i] = randomFloat(0.1f, 5);
+        list.extentY[i] = randomFloat(0.1f, 5);
+        list.extentZ[i] = randomFloat(0.1f, 5);
+    }
+}
+
+Camera::SharedPtr BvhTest::createCamera(const glm::vec3& position, const glm::vec3& target)
+{
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(position);
+    pCamera->setTarget(target);
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setDepthRange(0.1f, 250.0f);
+    pCamera->setFovY(glm::radians(60.0f));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    return pCamera;
+}
+
+std::string BvhTest::validateTree(const Bvh* pBvh, const BoxList& list, uint32_t maxLeafSize)
+{
+    const uint32_t count = (uint32_t)list.centerX.size();
+    const std::vector<uint32_t>& order = pBvh->getPrimitiveOrder();
+    const std::vector<Bvh::Node>& nodes = pBvh->getNodes();
+    if (pBvh->getPrimitiveCount() != count || order.size() != count || nodes.empty())
+    {
+        return "The tree doesn't hold all the primitives";
+    }
+
+    std::vector<uint32_t> references(count, 0);
+    for (uint32_t primitive : order)
+    {
+        if (primitive >= count || references[primitive]++ != 0)
+        {
+            return "Primitive " + std::to_string(primitive) + " is invalid or referenced more than once";
+        }
+    }
+
+    if (nodes[0].firstPrimitive != 0 || nodes[0].primitiveCount != count)
+    {
+        return "The root doesn't cover all the primitives";
+    }
+
+    for (size_t n = 0; n < nodes.size(); n++)
+    {
+        const Bvh::Node& node = nodes[n];
+        if (node.isLeaf())
+        {
+            if (node.primitiveCount > maxLeafSize)
+            {
+                return "Leaf " + std::to_string(n) + " holds more than " + std::to_string(maxLeafSize) + " primitives";
+            }
+        }
+        else
+        {
+            const Bvh::Node& left = nodes[node.leftChild];
+            const Bvh::Node& right = nodes[node.leftChild + 1];
+            if (left.firstPrimitive != node.firstPrimitive || right.firstPrimitive != left.firstPrimitive + left.primitiveCount || left.primitiveCount + right.primitiveCount != node.primitiveCount)
+            {
+                return "The children of node " + std::to_string(n) + " don't partition its primitives";
+            }
+        }
+
+        for (uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++)
+        {
+            BoundingBox box = list.getBox(order[i]);
+            if (glm::any(glm::lessThan(box.center - box.extent, node.boundsMin)) || glm::any(glm::greaterThan(box.center + box.extent, node.boundsMax)))
+            {
+                return "The bounds of node " + std::to_string(n) + " don't contain primitive " + std::to_string(order[i]);
+            }
+        }
+    }
+    return "";
+}
+
+uint32_t BvhTest::compareWithBruteForce(const Bvh* pBvh, const Camera* pCamera, const BoxList& list)
+{
+    const uint32_t count = (uint32_t)list.centerX.size();
+    std::vector<uint32_t> culledMask((count + 31) / 32);
+    pBvh->cullFrustum(pCamera, list.getArrays(), culledMask.data());
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bool culled = ((culledMask[i >> 5] >> (i & 31)) & 1) != 0;
+        mismatches += (culled != pCamera->isObjectCulled(list.getBox(i))) ? 1 : 0;
+    }
+    return mismatches;
+}
+
+int main()
+{
+    BvhTest bt;
+    bt.init();
+    bt.run();
+    return 0;
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CullingTest.h"
+
+void CullingTest::addTests()
+{
+    addTestToList<TestBatchMatchesScalar>();
+    addTestToList<TestBatchPerformance>();
+}
+
+testing_func(CullingTest, TestBatchMatchesScalar)
+{
+    // Use a count which isn't a multiple of the SIMD width to exercise the tail
+    const uint32_t boxCount = 10007;
+    BoxList list;
+    generateBoxes(boxCount, list);
+    Camera::SharedPtr pCamera = createCamera();
+
+    std::vector<uint32_t> culledMask((boxCount + 31) / 32);
+    pCamera->cullBoundingBoxes(list.getArrays(), culledMask.data());
+
+    for (uint32_t i = 0; i < boxCount; i++)
+    {
+        bool batchCulled = ((culledMask[i >> 5] >> (i & 31)) & 1) != 0;
+        if (batchCulled != pCamera->isObjectCulled(list.boxes[i]))
+        {
+            return test_fail("Batched culling result doesn't match Camera::isObjectCulled() for box " + std::to_string(i));
+        }
+    }
+    return test_pass();
+}
+
+testing_func(CullingTest, TestBatchPerformance)
+{
+    const uint32_t boxCounts[] = { 10000, 100000, 1000000 };
+    const uint32_t iterations = 20;
+    Camera::SharedPtr pCamera = createCamera();
+
+    for (uint32_t boxCount : boxCounts)
+    {
+        BoxList list;
+        generateBoxes(boxCount, list);
+        std::vector<uint32_t> culledMask((boxCount + 31) / 32);
+        uint32_t scalarCulled = 0;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t iter = 0; iter < iterations; iter++)
+        {
+            scalarCulled = 0;
+            for (const auto& box : list.boxes)
+            {
+                scalarCulled += pCamera->isObjectCulled(box) ? 1 : 0;
+            }
+        }
+        float scalarTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / iterations;
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t iter = 0; iter < iterations; iter++)
+        {
+            pCamera->cullBoundingBoxes(list.getArrays(), culledMask.data());
+        }
+        float batchTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / iterations;
+
+        uint32_t batchCulled = 0;
+        for (uint32_t word : culledMask)
+        {
+            batchCulled += (uint32_t)__popcnt(word);
+        }
+
+        if (batchCulled != scalarCulled)
+        {
+            return test_fail("Batched culling culled " + std::to_string(batchCulled) + " boxes, scalar culling culled " + std::to_string(scalarCulled));
+        }
+
+        std::cout << boxCount << " boxes: scalar " << scalarTime << "ms, batched " << batchTime << "ms (" << scalarTime / batchTime << "x)\n";
+    }
+
+    return test_pass();
+}
+
+BoundingBoxArrays CullingTest::BoxList::getArrays() const
+{
+    BoundingBoxArrays arrays;
+    arrays.pCenterX = centerX.data();
+    arrays.pCenterY = centerY.data();
+    arrays.pCenterZ = centerZ.data();
+    arrays.pExtentX = extentX.data();
+    arrays.pExtentY = extentY.data();
+    arrays.pExtentZ = extentZ.data();
+    arrays.count = (uint32_t)boxes.size();
+    return arrays;
+}
+
+void CullingTest::generateBoxes(uint32_t count, BoxList& list)
+{
+    list.boxes.resize(count);
+    list.centerX.resize(count);
+    list.centerY.resize(count);
+    list.centerZ.resize(count);
+    list.extentX.resize(count);
+    list.extentY.resize(count);
+    list.extentZ.resize(count);
+
+    srand(count);
+    auto randomFloat = [](float minVal, float maxVal) { return minVal + (maxVal - minVal) * (float)rand() / (float)RAND_MAX; };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        BoundingBox& box = list.boxes[i];
+        box.center = glm::vec3(randomFloat(-200, 200), randomFloat(-200, 200), randomFloat(-200, 200));
+        box.extent = glm::vec3(randomFloat(0.1f, 5), randomFloat(0.1f, 5), randomFloat(0.1f, 5));
+
+        list.centerX[i] = box.center.x;
+        list.centerY[i] = box.center.y;
+        list.centerZ[i] = box.center.z;
+        list.extentX[i] = box.extent.x;
+        list.extentY[i] = box.extent.y;
+        list.extentZ[i] = box.extent.z;
+    }
+}
+
+Camera::SharedPtr CullingTest::createCamera()
+{
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(10, 20, -150));
+    pCamera->setTarget(glm::vec3(0, 0, 0));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setDepthRange(0.1f, 250.0f);
+    pCamera->setFovY(glm::radians(60.0f));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    return pCamera;
+}
+
+int main()
+{
+    CullingTest ct;
+    ct.init();
+    ct.run();
+    return 0;
+}
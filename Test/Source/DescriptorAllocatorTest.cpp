@@ -0,0 +1,276 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "DescriptorAllocatorTest.h"
+#include <random>
+#include <queue>
+
+void DescriptorAllocatorTest::addTests()
+{
+    addTestToList<TestRangeAllocation>();
+    addTestToList<TestRangeCoalescing>();
+    addTestToList<TestTransientRing>();
+    addTestToList<TestAllocationPerformance>();
+}
+
+testing_func(DescriptorAllocatorTest, TestRangeAllocation)
+{
+    // Allocate and release random ranges, and check they never overlap and stay inside the heap
+    const uint32_t capacity = 3000;
+    DescriptorRangeAllocator allocator(capacity);
+    std::vector<bool> used(capacity, false);
+    std::vector<DescriptorRange> ranges;
+    std::mt19937 rng(0);
+
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        if (ranges.empty() || rng() % 2)
+        {
+            uint32_t count = 1 + rng() % 64;
+            DescriptorRange range = allocator.allocate(count);
+            if (range.isValid() == false)
+            {
+                continue;
+            }
+            if (range.count != count || range.offset + count > capacity)
+            {
+                return test_fail("Range is out of bounds");
+            }
+            for (uint32_t d = range.offset; d < range.offset + count; d++)
+            {
+                if (used[d])
+                {
+                    return test_fail("Ranges overlap");
+                }
+                used[d] = true;
+            }
+            ranges.push_back(range);
+        }
+        else
+        {
+            size_t index = rng() % ranges.size();
+            DescriptorRange range = ranges[index];
+            ranges[index] = ranges.back();
+            ranges.pop_back();
+            for (uint32_t d = range.offset; d < range.offset + range.count; d++)
+            {
+                used[d] = false;
+            }
+            allocator.release(range);
+        }
+    }
+
+    if (allocator.allocate(capacity + 1).isValid() || allocator.allocate(0).isValid())
+    {
+        return test_fail("Invalid sizes were allocated");
+    }
+    return test_pass();
+}
+
+testing_func(DescriptorAllocatorTest, TestRangeCoalescing)
+{
+    // Fragment the whole heap, release everything, and check the largest block is available again
+    const uint32_t capacity = 4096;
+    DescriptorRangeAllocator allocator(capacity);
+    std::vector<DescriptorRange> ranges;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        ranges.push_back(allocator.allocate(1));
+    }
+    if (allocator.allocate(1).isValid())
+    {
+        return test_fail("Allocated more descriptors than the capacity");
+    }
+
+    // Release every other descriptor first, which leaves no two free neighbors
+    for (uint32_t i = 0; i < capacity; i += 2)
+    {
+        allocator.release(ranges[i]);
+    }
+    if (allocator.allocate(2).isValid())
+    {
+        return test_fail("Allocated a range from fragmented descriptors");
+    }
+    for (uint32_t i = 1; i < capacity; i += 2)
+    {
+        allocator.release(ranges[i]);
+    }
+
+    if (allocator.getAllocatedCount() != 0)
+    {
+        return test_fail("Descriptors leaked");
+    }
+    DescriptorRange range = allocator.allocate(capacity);
+    if (range.isValid() == false || range.offset != 0)
+    {
+        return test_fail("Released blocks weren't merged");
+    }
+
+    // Capacities which aren't a power of two can be fully allocated
+    DescriptorRangeAllocator oddAllocator(1000);
+    uint32_t allocated = 0;
+    while (oddAllocator.allocate(1).isValid())
+    {
+        allocated++;
+    }
+    if (allocated != 1000)
+    {
+        return test_fail("Couldn't allocate the entire capacity");
+    }
+    return test_pass();
+}
+
+testing_func(DescriptorAllocatorTest, TestTransientRing)
+{
+    const uint32_t firstDescriptor = 100;
+    const uint32_t count = 64;
+    TransientDescriptorRing ring(firstDescriptor, count);
+    FakeFence fence;
+
+    // Three frames in flight, 20 descriptors each
+    DescriptorRange frames[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        frames[i] = ring.allocate(20);
+        if (frames[i].isValid() == false || frames[i].offset < firstDescriptor || frames[i].offset + 20 > firstDescriptor + count)
+        {
+            return test_fail("Transient range is out of bounds");
+        }
+        ring.endFrame(fence.signal());
+    }
+
+    // The ring is full until the GPU finishes the first frame. Ranges don't wrap, so the next one starts at the beginning.
+    if (ring.allocate(20).isValid())
+    {
+        return test_fail("Allocated descriptors which are still in use");
+    }
+    ring.releaseCompleted(fence.gpuValue);
+    if (ring.allocate(20).isValid())
+    {
+        return test_fail("Released a frame before the GPU completed it");
+    }
+
+    fence.completeUpTo(1);
+    ring.releaseCompleted(fence.gpuValue);
+    DescriptorRange range = ring.allocate(20);
+    if (range.isValid() == false || range.offset != frames[0].offset)
+    {
+        return test_fail("Completed frame wasn't recycled");
+    }
+    ring.endFrame(fence.signal());
+
+    // Once all the frames completed, the whole ring is free
+    fence.completeUpTo(fence.cpuValue);
+    ring.releaseCompleted(fence.gpuValue);
+    if (ring.getUsedCount() != 0)
+    {
+        return test_fail("Descriptors are still in use after all the frames completed");
+    }
+    return test_pass();
+}
+
+testing_func(DescriptorAllocatorTest, TestAllocationPerformance)
+{
+    const uint32_t capacity = 16 * 1024;
+    const uint32_t iterations = 100;
+
+    // The previous scheme: a free list queue, and a shared_ptr per descriptor
+    auto start = CpuTimer::getCurrentTimePoint();
+    {
+        std::queue<uint32_t> freeEntries;
+        for (uint32_t i = 0; i < capacity; i++)
+        {
+            freeEntries.push(i);
+        }
+        std::vector<std::shared_ptr<uint32_t>> entries(capacity);
+        for (uint32_t it = 0; it < iterations; it++)
+        {
+            for (auto& pEntry : entries)
+            {
+                pEntry = std::make_shared<uint32_t>(freeEntries.front());
+                freeEntries.pop();
+            }
+            for (auto& pEntry : entries)
+            {
+                freeEntries.push(*pEntry);
+                pEntry = nullptr;
+            }
+        }
+    }
+    double queueTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    DescriptorRangeAllocator allocator(capacity);
+    std::vector<DescriptorRange> ranges(capacity);
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t it = 0; it < iterations; it++)
+    {
+        for (auto& range : ranges)
+        {
+            range = allocator.allocate(1);
+        }
+        for (auto& range : ranges)
+        {
+            allocator.release(range);
+        }
+    }
+    double rangeTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Transient tables of 8 descriptors, 500 per frame, with 3 frames in flight
+    TransientDescriptorRing ring(0, 16 * 1024);
+    FakeFence fence;
+    const uint32_t frameCount = 1000;
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        for (uint32_t i = 0; i < 500; i++)
+        {
+            if (ring.allocate(8).isValid() == false)
+            {
+                return test_fail("Transient ring overflowed");
+            }
+        }
+        ring.endFrame(fence.signal());
+        if (fence.cpuValue > 2)
+        {
+            fence.completeUpTo(fence.cpuValue - 2);
+        }
+        ring.releaseCompleted(fence.gpuValue);
+    }
+    double ringTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << iterations * capacity << " single descriptor allocations: queue and shared_ptr " << queueTime << "ms, range allocator " << rangeTime << "ms\n";
+    std::cout << frameCount * 500 << " transient table allocations: " << ringTime << "ms\n";
+    return test_pass();
+}
+
+int main()
+{
+    DescriptorAllocatorTest dat;
+    dat.init();
+    dat.run();
+    return 0;
+}
@@ -0,0 +1,302 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "FrameCaptureQueueTest.h"
+#include <thread>
+
+void FrameCaptureQueueTest::addTests()
+{
+    addTestToList<TestSpscQueue>();
+    addTestToList<TestFramesInOrder>();
+    addTestToList<TestDropPolicy>();
+    addTestToList<TestStallPolicy>();
+    addTestToList<TestRenderThreadCost>();
+}
+
+testing_func(FrameCaptureQueueTest, TestSpscQueue)
+{
+    const uint32_t itemCount = 1000000;
+    SpscQueue<uint32_t> queue(64);
+
+    std::thread producer([&]()
+    {
+        for (uint32_t i = 0; i < itemCount; i++)
+        {
+            while (queue.push(i) == false)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    bool inOrder = true;
+    for (uint32_t i = 0; i < itemCount; i++)
+    {
+        uint32_t item;
+        while (queue.pop(item) == false)
+        {
+            std::this_thread::yield();
+        }
+        inOrder = inOrder && (item == i);
+    }
+    producer.join();
+
+    if (inOrder == false)
+    {
+        return test_fail("Items were popped out of order");
+    }
+    return queue.empty() ? test_pass() : test_fail("Queue isn't empty");
+}
+
+testing_func(FrameCaptureQueueTest, TestFramesInOrder)
+{
+    const uint32_t frameCount = 200;
+    const size_t frameSize = 64 * 1024;
+
+    uint32_t expectedFrame = 0;
+    bool valid = true;
+    FrameCaptureQueue::Desc desc;
+    desc.frameSize = frameSize;
+    desc.frameCount = 3;
+    desc.policy = FrameCaptureQueue::OverflowPolicy::Stall;
+    FrameCaptureQueue::UniquePtr pQueue = FrameCaptureQueue::create(desc, [&](const uint8_t* pData)
+    {
+        valid = valid && checkFrame(pData, frameSize, expectedFrame);
+        expectedFrame++;
+        // Let the producer run ahead from time to time
+        if ((expectedFrame % 16) == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        uint8_t* pFrame = pQueue->acquireFrame();
+        if (pFrame == nullptr)
+        {
+            return test_fail("The Stall policy returned a null frame");
+        }
+        fillFrame(pFrame, frameSize, i);
+        pQueue->submitFrame(pFrame);
+    }
+    pQueue->flush();
+
+    FrameCaptureQueue::Stats stats = pQueue->getStats();
+    if (stats.processedFrames != frameCount || stats.droppedFrames != 0 || expectedFrame != frameCount)
+    {
+        return test_fail("Frames were lost");
+    }
+    return valid ? test_pass() : test_fail("Frames were corrupted or reordered");
+}
+
+testing_func(FrameCaptureQueueTest, TestDropPolicy)
+{
+    const size_t frameSize = 1024;
+    std::mutex blockMutex;
+    std::unique_lock<std::mutex> block(blockMutex);
+
+    std::vector<uint32_t> processed;
+    FrameCaptureQueue::Desc desc;
+    desc.frameSize = frameSize;
+    desc.frameCount = 2;
+    desc.policy = FrameCaptureQueue::OverflowPolicy::Drop;
+    FrameCaptureQueue::UniquePtr pQueue = FrameCaptureQueue::create(desc, [&](const uint8_t* pData)
+    {
+        // Blocks until the test releases the worker
+        std::lock_guard<std::mutex> lock(blockMutex);
+        processed.push_back(*(const uint32_t*)pData);
+    });
+
+    // The worker is stuck on the first frame, so only the two buffers can be filled
+    uint32_t acceptedCount = 0;
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        uint8_t* pFrame = pQueue->acquireFrame();
+        if (pFrame)
+        {
+            fillFrame(pFrame, frameSize, i);
+            pQueue->submitFrame(pFrame);
+            acceptedCount++;
+        }
+    }
+
+    block.unlock();
+    pQueue->flush();
+
+    FrameCaptureQueue::Stats stats = pQueue->getStats();
+    if (acceptedCount != 2 || stats.droppedFrames != 8 || stats.stallCount != 0)
+    {
+        return test_fail("Expected 2 accepted and 8 dropped frames, got " + std::to_string(acceptedCount) + " and " + std::to_string(stats.droppedFrames));
+    }
+    if (processed.size() != 2 || processed[0] != 0 || processed[1] != 1)
+    {
+        return test_fail("The accepted frames weren't processed in order");
+    }
+    return test_pass();
+}
+
+testing_func(FrameCaptureQueueTest, TestStallPolicy)
+{
+    const uint32_t frameCount = 20;
+    const size_t frameSize = 1024;
+
+    uint32_t processedCount = 0;
+    FrameCaptureQueue::Desc desc;
+    desc.frameSize = frameSize;
+    desc.frameCount = 2;
+    desc.policy = FrameCaptureQueue::OverflowPolicy::Stall;
+    FrameCaptureQueue::UniquePtr pQueue = FrameCaptureQueue::create(desc, [&](const uint8_t* pData)
+    {
+        // A worker which is slower than the producer
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        processedCount++;
+    });
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        uint8_t* pFrame = pQueue->acquireFrame();
+        fillFrame(pFrame, frameSize, i);
+        pQueue->submitFrame(pFrame);
+    }
+
+    // Destroying the queue processes the pending frames
+    FrameCaptureQueue::Stats stats = pQueue->getStats();
+    pQueue = nullptr;
+
+    if (stats.stallCount == 0 || stats.droppedFrames != 0)
+    {
+        return test_fail("The producer didn't wait for the worker");
+    }
+    return (processedCount == frameCount) ? test_pass() : test_fail("Pending frames weren't processed on destruction");
+}
+
+testing_func(FrameCaptureQueueTest, TestRenderThreadCost)
+{
+    // A 4K RGBA frame
+    const size_t frameSize = 3840 * 2160 * 4;
+    const uint32_t frameCount = 30;
+    const auto renderTime = std::chrono::milliseconds(16);
+    std::vector<uint8_t> renderedFrame(frameSize);
+    fillFrame(renderedFrame.data(), frameSize, 0);
+
+    // Inline: the render thread copies the frame out and encodes it
+    std::vector<uint8_t> readback(frameSize);
+    uint32_t inlineChecksum = 0;
+    float inlineTime = 0;
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        std::this_thread::sleep_for(renderTime);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        memcpy(readback.data(), renderedFrame.data(), frameSize);
+        inlineChecksum += encodeFrame(readback.data(), frameSize);
+        inlineTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    // Queued: the render thread only copies the frame, the worker encodes it while the next frame renders
+    uint32_t queuedChecksum = 0;
+    FrameCaptureQueue::Desc desc;
+    desc.frameSize = frameSize;
+    desc.frameCount = 3;
+    desc.policy = FrameCaptureQueue::OverflowPolicy::Stall;
+    FrameCaptureQueue::UniquePtr pQueue = FrameCaptureQueue::create(desc, [&](const uint8_t* pData)
+    {
+        queuedChecksum += encodeFrame(pData, frameSize);
+    });
+
+    float queuedTime = 0;
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        std::this_thread::sleep_for(renderTime);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        uint8_t* pFrame = pQueue->acquireFrame();
+        memcpy(pFrame, renderedFrame.data(), frameSize);
+        pQueue->submitFrame(pFrame);
+        queuedTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+    pQueue->flush();
+
+    if (queuedChecksum != inlineChecksum)
+    {
+        return test_fail("The worker produced different results");
+    }
+
+    FrameCaptureQueue::Stats stats = pQueue->getStats();
+    std::cout << "4K frame, render thread capture cost: inline encode " << inlineTime / frameCount << "ms, queued " << queuedTime / frameCount << "ms (" << inlineTime / queuedTime << "x), " << stats.stallCount << " stalls\n";
+    return test_pass();
+}
+
+void FrameCaptureQueueTest::fillFrame(uint8_t* pData, size_t size, uint32_t frameID)
+{
+    uint32_t* pWords = (uint32_t*)pData;
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+    {
+        pWords[i] = frameID + (uint32_t)i * 2654435761u;
+    }
+    // The first word is the frame ID
+    pWords[0] = frameID;
+}
+
+bool FrameCaptureQueueTest::checkFrame(const uint8_t* pData, size_t size, uint32_t frameID)
+{
+    const uint32_t* pWords = (const uint32_t*)pData;
+    if (pWords[0] != frameID)
+    {
+        return false;
+    }
+    for (size_t i = 1; i < size / sizeof(uint32_t); i++)
+    {
+        if (pWords[i] != frameID + (uint32_t)i * 2654435761u)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t FrameCaptureQueueTest::encodeFrame(const uint8_t* pData, size_t size)
+{
+    // A few passes over the data, roughly the memory traffic of a flip, a color conversion and an encode
+    uint32_t checksum = 0;
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        const uint32_t* pWords = (const uint32_t*)pData;
+        for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+        {
+            checksum += (pWords[i] ^ pass) * 16777619u;
+        }
+    }
+    return checksum;
+}
+
+int main()
+{
+    FrameCaptureQueueTest fcqt;
+    fcqt.init();
+    fcqt.run();
+    return 0;
+}
@@ -0,0 +1,280 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "FramePlaybackQueueTest.h"
+#include <thread>
+
+void FramePlaybackQueueTest::addTests()
+{
+    addTestToList<TestSequentialPlayback>();
+    addTestToList<TestSeek>();
+    addTestToList<TestEndOfClip>();
+    addTestToList<TestBoundedMemory>();
+    addTestToList<TestSlowDecoder>();
+}
+
+testing_func(FramePlaybackQueueTest, TestSequentialPlayback)
+{
+    // The clip length isn't passed in, the queue finds it out at the end of the first pass
+    SyntheticClip clip;
+    clip.frameCount = 100;
+    FramePlaybackQueue::Desc desc;
+    desc.frameSize = 4096;
+    desc.aheadFrames = 4;
+    desc.loop = true;
+    FramePlaybackQueue::UniquePtr pQueue = createQueue(clip, desc);
+
+    for (uint64_t frame = 0; frame < 250; frame++)
+    {
+        if (pQueue->update(frame, true) == false)
+        {
+            return test_fail("Frame " + std::to_string(frame) + " didn't change the current frame");
+        }
+        if (pQueue->getCurrentFrame() != frame || checkFrame(pQueue.get(), desc.frameSize, frame % clip.frameCount) == false)
+        {
+            return test_fail("Wrong data for frame " + std::to_string(frame));
+        }
+    }
+
+    if (pQueue->getClipFrameCount() != clip.frameCount)
+    {
+        return test_fail("The clip length wasn't found");
+    }
+    FramePlaybackQueue::Stats stats = pQueue->getStats();
+    return (stats.seekCount == 0 && stats.skippedFrames == 0) ? test_pass() : test_fail("Sequential playback seeked or skipped frames");
+}
+
+testing_func(FramePlaybackQueueTest, TestSeek)
+{
+    SyntheticClip clip;
+    clip.frameCount = 100;
+    FramePlaybackQueue::Desc desc;
+    desc.frameSize = 4096;
+    desc.aheadFrames = 4;
+    desc.clipFrameCount = clip.frameCount;
+    desc.seekThreshold = 20;
+    FramePlaybackQueue::UniquePtr pQueue = createQueue(clip, desc);
+
+    for (uint64_t frame = 0; frame <= 30; frame++)
+    {
+        pQueue->update(frame, true);
+    }
+
+    // Backward
+    pQueue->update(5, true);
+    if (pQueue->getCurrentFrame() != 5 || checkFrame(pQueue.get(), desc.frameSize, 5) == false)
+    {
+        return test_fail("Seeking backward failed");
+    }
+
+    // Forward, within the threshold. The queue decodes the frames in between.
+    pQueue->update(20, true);
+    if (pQueue->getStats().seekCount != 1 || checkFrame(pQueue.get(), desc.frameSize, 20) == false)
+    {
+        return test_fail("A short jump forward seeked");
+    }
+
+    // Forward, past the threshold. The target isn't a key frame, the frames after the key frame are decoded and skipped.
+    const uint64_t decodedFrames = pQueue->getStats().decodedFrames;
+    pQueue->update(87, true);
+    if (pQueue->getStats().seekCount != 2 || checkFrame(pQueue.get(), desc.frameSize, 87) == false)
+    {
+        return test_fail("Seeking forward failed");
+    }
+    if (pQueue->getStats().decodedFrames - decodedFrames > 2 * (desc.aheadFrames + 2) + clip.keyFrameInterval)
+    {
+        return test_fail("Seeking forward decoded the frames in between");
+    }
+
+    // A later loop, through an explicit seek
+    pQueue->seek(1013);
+    pQueue->update(1013, true);
+    if (pQueue->getCurrentFrame() != 1013 || checkFrame(pQueue.get(), desc.frameSize, 13) == false)
+    {
+        return test_fail("Seeking into a later loop failed");
+    }
+    pQueue->update(1014, true);
+    return checkFrame(pQueue.get(), desc.frameSize, 14) ? test_pass() : test_fail("Playback didn't continue after seeking");
+}
+
+testing_func(FramePlaybackQueueTest, TestEndOfClip)
+{
+    SyntheticClip clip;
+    clip.frameCount = 50;
+    FramePlaybackQueue::Desc desc;
+    desc.frameSize = 4096;
+    desc.aheadFrames = 4;
+    desc.loop = false;
+    FramePlaybackQueue::UniquePtr pQueue = createQueue(clip, desc);
+
+    // Playing past the end holds the last frame
+    for (uint64_t frame = 0; frame < 60; frame++)
+    {
+        pQueue->update(frame, true);
+    }
+    if (pQueue->getCurrentFrame() != 49 || checkFrame(pQueue.get(), desc.frameSize, 49) == false)
+    {
+        return test_fail("The last frame isn't held at the end of the clip");
+    }
+
+    // Seeking past the end shows the last frame as well
+    pQueue->seek(10);
+    pQueue->update(10, true);
+    pQueue->seek(500);
+    pQueue->update(500, true);
+    if (pQueue->getCurrentFrame() != 49 || checkFrame(pQueue.get(), desc.frameSize, 49) == false)
+    {
+        return test_fail("Seeking past the end doesn't show the last frame");
+    }
+
+    // Back to the start after the end was reached
+    pQueue->update(3, true);
+    return checkFrame(pQueue.get(), desc.frameSize, 3) ? test_pass() : test_fail("Seeking back after the end failed");
+}
+
+testing_func(FramePlaybackQueueTest, TestBoundedMemory)
+{
+    // A 4K RGBA clip, 20 seconds at 30 FPS
+    const size_t frameSize = 3840 * 2160 * 4;
+    SyntheticClip clip;
+    clip.frameCount = 600;
+    FramePlaybackQueue::Desc desc;
+    desc.frameSize = frameSize;
+    desc.aheadFrames = 4;
+    FramePlaybackQueue::UniquePtr pQueue = createQueue(clip, desc);
+
+    // The worker fills the pool and stops, no matter how long the consumer takes
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const uint64_t decodedFrames = pQueue->getStats().decodedFrames;
+    if (decodedFrames > desc.aheadFrames + 2)
+    {
+        return test_fail("The worker decoded " + std::to_string(decodedFrames) + " frames ahead");
+    }
+
+    pQueue->update(0, true);
+    if (checkFrame(pQueue.get(), frameSize, 0) == false)
+    {
+        return test_fail("Wrong data for the first frame");
+    }
+
+    const float mb = 1024 * 1024;
+    std::cout << "4K clip of " << clip.frameCount << " frames: pre-decoding uses " << frameSize * clip.frameCount / mb << "MB, streaming uses " << frameSize * (desc.aheadFrames + 2) / mb << "MB\n";
+    return test_pass();
+}
+
+testing_func(FramePlaybackQueueTest, TestSlowDecoder)
+{
+    // Playback runs faster than decoding without waiting. The current frame lags and playback seeks forward once the lag passes the threshold, but the current frame always holds the data it claims to.
+    SyntheticClip clip;
+    clip.frameCount = 100;
+    clip.decodeTimeMs = 3;
+    FramePlaybackQueue::Desc desc;
+    desc.frameSize = 4096;
+    desc.aheadFrames = 4;
+    desc.clipFrameCount = clip.frameCount;
+    desc.seekThreshold = 20;
+    FramePlaybackQueue::UniquePtr pQueue = createQueue(clip, desc);
+
+    uint64_t lastFrame = 0;
+    for (uint64_t frame = 0; frame < 200; frame++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pQueue->update(frame);
+        if (pQueue->getCurrentFrameData() == nullptr)
+        {
+            continue;
+        }
+        const uint64_t current = pQueue->getCurrentFrame();
+        if (current > frame || current < lastFrame || checkFrame(pQueue.get(), desc.frameSize, current % clip.frameCount) == false)
+        {
+            return test_fail("Frame " + std::to_string(current) + " is wrong at playback frame " + std::to_string(frame));
+        }
+        lastFrame = current;
+    }
+
+    return (pQueue->getStats().seekCount > 0) ? test_pass() : test_fail("Playback didn't seek to catch up");
+}
+
+uint64_t FramePlaybackQueueTest::SyntheticClip::decode(uint8_t* pDst, size_t frameSize)
+{
+    if (position >= frameCount)
+    {
+        return FramePlaybackQueue::kEndOfStream;
+    }
+    if (decodeTimeMs > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(decodeTimeMs));
+    }
+
+    uint32_t* pWords = (uint32_t*)pDst;
+    for (size_t i = 0; i < frameSize / sizeof(uint32_t); i++)
+    {
+        pWords[i] = (uint32_t)position + (uint32_t)i * 2654435761u;
+    }
+    return position++;
+}
+
+bool FramePlaybackQueueTest::SyntheticClip::seek(uint64_t clipFrame)
+{
+    // Past the end, land on the last key frame
+    clipFrame = std::min(clipFrame, frameCount - 1);
+    position = clipFrame - clipFrame % keyFrameInterval;
+    return true;
+}
+
+FramePlaybackQueue::UniquePtr FramePlaybackQueueTest::createQueue(SyntheticClip& clip, FramePlaybackQueue::Desc desc)
+{
+    const size_t frameSize = desc.frameSize;
+    auto decodeFunc = [&clip, frameSize](uint8_t* pDst) { return clip.decode(pDst, frameSize); };
+    auto seekFunc = [&clip](uint64_t clipFrame) { return clip.seek(clipFrame); };
+    return FramePlaybackQueue::create(desc, decodeFunc, seekFunc);
+}
+
+bool FramePlaybackQueueTest::checkFrame(const FramePlaybackQueue* pQueue, size_t frameSize, uint64_t clipFrame)
+{
+    const uint32_t* pWords = (const uint32_t*)pQueue->getCurrentFrameData();
+    if (pWords == nullptr)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < frameSize / sizeof(uint32_t); i++)
+    {
+        if (pWords[i] != (uint32_t)clipFrame + (uint32_t)i * 2654435761u)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    FramePlaybackQueueTest fpqt;
+    fpqt.init();
+    fpqt.run();
+    return 0;
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "Utils/Video/FramePlaybackQueue.h"
+
+class FramePlaybackQueueTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestSequentialPlayback);
+    register_testing_func(TestSeek);
+    register_testing_func(TestEndOfClip);
+    register_testing_func(TestBoundedMemory);
+    register_testing_func(TestSlowDecoder);
+
+    /** A synthetic clip with key frames. Seeking lands on the key frame before the target, like a real decoder.
+    */
+    struct SyntheticClip
+    {
+        uint64_t frameCount = 0;
+        uint64_t keyFrameInterval = 10;
+        uint64_t position = 0;
+        uint32_t decodeTimeMs = 0;
+
+        uint64_t decode(uint8_t* pDst, size_t frameSize);
+        bool seek(uint64_t clipFrame);
+    };
+
+    static FramePlaybackQueue::UniquePtr createQueue(SyntheticClip& clip, FramePlaybackQueue::Desc desc);
+
+    /** Check that the current frame of the queue holds the data of the expected clip frame
+    */
+    static bool checkFrame(const FramePlaybackQueue* pQueue, size_t frameSize, uint64_t clipFrame);
+};
@@ -0,0 +1,250 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshOptimizerTest.h"
+#include <algorithm>
+#include <array>
+
+void MeshOptimizerTest::addTests()
+{
+    addTestToList<TestVertexCacheOrder>();
+    addTestToList<TestOverdrawOrder>();
+    addTestToList<TestVertexFetchOrder>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(MeshOptimizerTest, TestVertexCacheOrder)
+{
+    Sphere sphere;
+    createShuffledSphere(64, 128, sphere);
+    const uint32_t vertexCount = (uint32_t)sphere.positions.size();
+
+    std::vector<uint32_t> optimized(sphere.indices.size());
+    optimizeVertexCache(sphere.indices.data(), sphere.indices.size(), vertexCount, optimized.data());
+    if (isTrianglePermutation(sphere.indices, optimized) == false)
+    {
+        return test_fail("The optimized triangles don't match the original ones");
+    }
+
+    VertexCacheStats before = analyzeVertexCache(sphere.indices.data(), sphere.indices.size(), vertexCount);
+    VertexCacheStats after = analyzeVertexCache(optimized.data(), optimized.size(), vertexCount);
+    if (before.vertexCount != after.vertexCount || before.triangleCount != after.triangleCount)
+    {
+        return test_fail("The optimized mesh references different vertices");
+    }
+
+    // A regular mesh should come close to the optimum of 0.5 misses per triangle
+    if (after.getAcmr() > 0.8f || after.getAcmr() >= before.getAcmr())
+    {
+        return test_fail("ACMR " + std::to_string(after.getAcmr()) + " after optimization, " + std::to_string(before.getAcmr()) + " before");
+    }
+
+    // Optimizing in place gives the same result
+    std::vector<uint32_t> inPlace = sphere.indices;
+    optimizeVertexCache(inPlace.data(), inPlace.size(), vertexCount, inPlace.data());
+    if (inPlace != optimized)
+    {
+        return test_fail("In-place optimization gave a different result");
+    }
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestOverdrawOrder)
+{
+    Sphere sphere;
+    createShuffledSphere(64, 128, sphere);
+    const uint32_t vertexCount = (uint32_t)sphere.positions.size();
+    const float threshold = 1.05f;
+
+    std::vector<uint32_t> cacheOrder(sphere.indices.size());
+    optimizeVertexCache(sphere.indices.data(), sphere.indices.size(), vertexCount, cacheOrder.data());
+    std::vector<uint32_t> overdrawOrder(cacheOrder.size());
+    optimizeOverdraw(cacheOrder.data(), cacheOrder.size(), sphere.positions.data(), sizeof(glm::vec3), vertexCount, overdrawOrder.data(), threshold);
+
+    if (isTrianglePermutation(sphere.indices, overdrawOrder) == false)
+    {
+        return test_fail("The reordered triangles don't match the original ones");
+    }
+    if (overdrawOrder == cacheOrder)
+    {
+        return test_fail("The clusters weren't reordered");
+    }
+
+    // Cutting the clusters costs cache efficiency, but only up to about the threshold
+    VertexCacheStats cacheStats = analyzeVertexCache(cacheOrder.data(), cacheOrder.size(), vertexCount);
+    VertexCacheStats overdrawStats = analyzeVertexCache(overdrawOrder.data(), overdrawOrder.size(), vertexCount);
+    if (overdrawStats.getAcmr() > cacheStats.getAcmr() * threshold * 1.1f)
+    {
+        return test_fail("ACMR grew from " + std::to_string(cacheStats.getAcmr()) + " to " + std::to_string(overdrawStats.getAcmr()));
+    }
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestVertexFetchOrder)
+{
+    Sphere sphere;
+    createShuffledSphere(16, 32, sphere);
+
+    // Add vertices which aren't referenced
+    sphere.positions.insert(sphere.positions.begin(), glm::vec3(10, 0, 0));
+    sphere.positions.push_back(glm::vec3(20, 0, 0));
+    for (uint32_t& index : sphere.indices)
+    {
+        index++;
+    }
+    const uint32_t vertexCount = (uint32_t)sphere.positions.size();
+
+    std::vector<uint32_t> indices = sphere.indices;
+    std::vector<uint32_t> remap(vertexCount);
+    uint32_t referencedCount = optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap.data());
+    if (referencedCount != vertexCount - 2)
+    {
+        return test_fail("Wrong number of referenced vertices");
+    }
+
+    std::vector<glm::vec3> positions = sphere.positions;
+    remapVertexStream(remap.data(), vertexCount, sizeof(glm::vec3), positions.data());
+
+    // Every index refers to the same position, and new vertices are introduced in order
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (positions[indices[i]] != sphere.positions[sphere.indices[i]])
+        {
+            return test_fail("Remapped index " + std::to_string(i) + " refers to a different position");
+        }
+        if (indices[i] > nextVertex)
+        {
+            return test_fail("Vertices aren't numbered in the order of their first use");
+        }
+        nextVertex = std::max(nextVertex, indices[i] + 1);
+    }
+
+    // The unreferenced vertices are moved to the end, in their original order
+    if (positions[vertexCount - 2] != glm::vec3(10, 0, 0) || positions[vertexCount - 1] != glm::vec3(20, 0, 0))
+    {
+        return test_fail("Unreferenced vertices weren't moved to the end");
+    }
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestPerformance)
+{
+    Sphere sphere;
+    createShuffledSphere(512, 1024, sphere);
+    const uint32_t vertexCount = (uint32_t)sphere.positions.size();
+    const size_t indexCount = sphere.indices.size();
+    std::vector<uint32_t> indices = sphere.indices;
+    VertexCacheStats original = analyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    optimizeVertexCache(indices.data(), indexCount, vertexCount, indices.data());
+    float cacheTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    VertexCacheStats cacheOrder = analyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+    start = CpuTimer::getCurrentTimePoint();
+    optimizeOverdraw(indices.data(), indexCount, sphere.positions.data(), sizeof(glm::vec3), vertexCount, indices.data());
+    float overdrawTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    VertexCacheStats overdrawOrder = analyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+    std::vector<uint32_t> remap(vertexCount);
+    start = CpuTimer::getCurrentTimePoint();
+    optimizeVertexFetch(indices.data(), indexCount, vertexCount, remap.data());
+    remapVertexStream(remap.data(), vertexCount, sizeof(glm::vec3), sphere.positions.data());
+    float fetchTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << indexCount / 3 << " triangles, " << vertexCount << " vertices\n";
+    std::cout << "Original:      ACMR " << original.getAcmr() << ", ATVR " << original.getAtvr() << "\n";
+    std::cout << "Vertex cache:  ACMR " << cacheOrder.getAcmr() << ", ATVR " << cacheOrder.getAtvr() << ", " << cacheTime << "ms\n";
+    std::cout << "Overdraw:      ACMR " << overdrawOrder.getAcmr() << ", ATVR " << overdrawOrder.getAtvr() << ", " << overdrawTime << "ms\n";
+    std::cout << "Vertex fetch:  " << fetchTime << "ms\n";
+    return test_pass();
+}
+
+void MeshOptimizerTest::createShuffledSphere(uint32_t rings, uint32_t segments, Sphere& sphere)
+{
+    sphere.positions.clear();
+    sphere.indices.clear();
+    for (uint32_t r = 0; r <= rings; r++)
+    {
+        const float theta = (float)M_PI * (float)r / (float)rings;
+        for (uint32_t s = 0; s <= segments; s++)
+        {
+            const float phi = 2 * (float)M_PI * (float)s / (float)segments;
+            sphere.positions.push_back(glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t r = 0; r < rings; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            const uint32_t v = r * (segments + 1) + s;
+            triangles.push_back({ v, v + segments + 1, v + 1 });
+            triangles.push_back({ v + 1, v + segments + 1, v + segments + 2 });
+        }
+    }
+
+    srand(rings);
+    for (size_t i = triangles.size() - 1; i > 0; i--)
+    {
+        std::swap(triangles[i], triangles[rand() % (i + 1)]);
+    }
+    for (const auto& triangle : triangles)
+    {
+        sphere.indices.insert(sphere.indices.end(), triangle.begin(), triangle.end());
+    }
+}
+
+bool MeshOptimizerTest::isTrianglePermutation(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    auto sortTriangles = [](const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        for (size_t t = 0; t < triangles.size(); t++)
+        {
+            triangles[t] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+    return sortTriangles(a) == sortTriangles(b);
+}
+
+int main()
+{
+    MeshOptimizerTest mot;
+    mot.init();
+    mot.run();
+    return 0;
+}
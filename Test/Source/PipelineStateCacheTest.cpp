@@ -0,0 +1,259 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "PipelineStateCacheTest.h"
+
+void PipelineStateCacheTest::addTests()
+{
+    addTestToList<TestContentKeys>();
+    addTestToList<TestHitsAndMisses>();
+    addTestToList<TestLruEviction>();
+    addTestToList<TestSaveAndPrebuild>();
+}
+
+GraphicsStateObject::Desc PipelineStateCacheTest::createDesc(const GraphicsProgram::SharedPtr& pProgram)
+{
+    VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+    pBufferLayout->addElement(VERTEX_POSITION_NAME, 0u, ResourceFormat::RGBA32Float, 1u, VERTEX_POSITION_LOC);
+    pBufferLayout->addElement(VERTEX_NORMAL_NAME, 4u * sizeof(float), ResourceFormat::RGB32Float, 1u, VERTEX_NORMAL_LOC);
+    VertexLayout::SharedPtr pLayout = VertexLayout::create();
+    pLayout->addBufferLayout(0u, pBufferLayout);
+
+    Fbo::Desc fboDesc;
+    fboDesc.setColorTarget(0, ResourceFormat::RGBA8Unorm).setDepthStencilTarget(ResourceFormat::D32Float);
+
+    GraphicsStateObject::Desc desc;
+    desc.setProgramVersion(pProgram->getActiveVersion());
+    desc.setRootSignature(RootSignature::create(pProgram->getActiveVersion()->getReflector().get()));
+    desc.setVertexLayout(pLayout);
+    desc.setFboFormats(fboDesc);
+    desc.setPrimitiveType(GraphicsStateObject::PrimitiveType::Triangle);
+    return desc;
+}
+
+testing_func(PipelineStateCacheTest, TestContentKeys)
+{
+    PipelineStateCache::UniquePtr pCache = PipelineStateCache::create();
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+    GraphicsStateObject::Desc desc = createDesc(pProgram);
+
+    // Missing states hash like the default ones
+    const PipelineStateCache::Key defaultKey = pCache->computeKey(desc);
+    desc.setBlendState(BlendState::create(BlendState::Desc()));
+    desc.setDepthStencilState(DepthStencilState::create(DepthStencilState::Desc()));
+    if(pCache->computeKey(desc) != defaultKey)
+    {
+        return test_fail("Default states and missing states have different keys");
+    }
+
+    // Separately created objects with the same content, set in a different order
+    BlendState::Desc blendDesc;
+    blendDesc.setRtBlend(0, true).setRtParams(0, BlendState::BlendOp::Add, BlendState::BlendOp::Add, BlendState::BlendFunc::SrcAlpha, BlendState::BlendFunc::OneMinusSrcAlpha, BlendState::BlendFunc::One, BlendState::BlendFunc::Zero);
+    RasterizerState::Desc rastDesc;
+    rastDesc.setCullMode(RasterizerState::CullMode::None);
+
+    GraphicsStateObject::Desc descA = createDesc(pProgram);
+    descA.setBlendState(BlendState::create(blendDesc));
+    descA.setRasterizerState(RasterizerState::create(rastDesc));
+
+    GraphicsStateObject::Desc descB = createDesc(GraphicsProgram::createFromFile("", "Simple.ps.hlsl"));
+    descB.setRasterizerState(RasterizerState::create(rastDesc));
+    descB.setBlendState(BlendState::create(blendDesc));
+
+    const PipelineStateCache::Key keyA = pCache->computeKey(descA);
+    if(keyA != pCache->computeKey(descB))
+    {
+        return test_fail("Equivalent descriptors have different keys");
+    }
+    if(keyA == defaultKey)
+    {
+        return test_fail("Different blend and rasterizer states have the same key");
+    }
+
+    descB.setSampleMask(0x1);
+    if(pCache->computeKey(descB) == keyA)
+    {
+        return test_fail("Different sample masks have the same key");
+    }
+
+    Fbo::Desc fboDesc = descA.getFboDesc();
+    fboDesc.setColorTarget(0, ResourceFormat::RGBA16Float);
+    descA.setFboFormats(fboDesc);
+    if(pCache->computeKey(descA) == keyA)
+    {
+        return test_fail("Different render-target formats have the same key");
+    }
+
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestHitsAndMisses)
+{
+    PipelineStateCache::UniquePtr pCache = PipelineStateCache::create();
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+
+    GraphicsStateObject::SharedPtr pGso = pCache->getGso(createDesc(pProgram));
+    GraphicsStateObject::SharedPtr pSameGso = pCache->getGso(createDesc(pProgram));
+    if(pGso == nullptr || pGso != pSameGso)
+    {
+        return test_fail("Equivalent descriptors didn't return the same GSO");
+    }
+
+    GraphicsStateObject::Desc desc = createDesc(pProgram);
+    desc.setSampleMask(0x1);
+    if(pCache->getGso(desc) == pGso)
+    {
+        return test_fail("A different descriptor returned the same GSO");
+    }
+
+    PipelineStateCache::Stats stats = pCache->getStats();
+    // The descriptors have separately created vertex layouts and root signatures, so the hit compared their content
+    if(stats.hits != 1 || stats.misses != 2 || stats.collisions != 0 || pCache->getSize() != 2)
+    {
+        return test_fail("Wrong statistics. Hits: " + std::to_string(stats.hits) + ", misses: " + std::to_string(stats.misses) + ", collisions: " + std::to_string(stats.collisions));
+    }
+
+    pCache->resetStats();
+    if(pCache->getStats().hits != 0 || pCache->getStats().misses != 0)
+    {
+        return test_fail("resetStats() didn't reset the statistics");
+    }
+
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestLruEviction)
+{
+    PipelineStateCache::UniquePtr pCache = PipelineStateCache::create(2);
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+
+    GraphicsStateObject::Desc descs[3];
+    for(uint32_t i = 0; i < arraysize(descs); i++)
+    {
+        descs[i] = createDesc(pProgram);
+        descs[i].setSampleMask(i + 1);
+    }
+
+    // Touch the first descriptor after the second one, so that the second one is the least recently used
+    pCache->getGso(descs[0]);
+    pCache->getGso(descs[1]);
+    pCache->getGso(descs[0]);
+    pCache->getGso(descs[2]);
+
+    PipelineStateCache::Stats stats = pCache->getStats();
+    if(stats.evictions != 1 || pCache->getSize() != 2)
+    {
+        return test_fail("Expected a single eviction");
+    }
+
+    pCache->resetStats();
+    pCache->getGso(descs[0]);
+    pCache->getGso(descs[2]);
+    if(pCache->getStats().hits != 2)
+    {
+        return test_fail("Recently used GSOs were evicted");
+    }
+
+    pCache->getGso(descs[1]);
+    if(pCache->getStats().misses != 1)
+    {
+        return test_fail("The least recently used GSO wasn't evicted");
+    }
+
+    pCache->setCapacity(1);
+    if(pCache->getSize() != 1)
+    {
+        return test_fail("setCapacity() didn't evict GSOs");
+    }
+
+    return test_pass();
+}
+
+testing_func(PipelineStateCacheTest, TestSaveAndPrebuild)
+{
+    const std::string filename = "PipelineStateCacheTest.bin";
+    const uint32_t descCount = 3;
+    std::vector<PipelineStateCache::Key> keys;
+    {
+        PipelineStateCache::UniquePtr pCache = PipelineStateCache::create();
+        GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+        for(uint32_t i = 0; i < descCount; i++)
+        {
+            GraphicsStateObject::Desc desc = createDesc(pProgram);
+            desc.setSampleMask(i + 1);
+            keys.push_back(pCache->computeKey(desc));
+            pCache->getGso(desc, pProgram.get());
+        }
+
+        // Descriptors without a program aren't recorded
+        GraphicsStateObject::Desc desc = createDesc(pProgram);
+        desc.setSampleMask(0xff);
+        pCache->getGso(desc);
+
+        if(pCache->saveDescriptors(filename) == false)
+        {
+            return test_fail("Can't save the descriptors");
+        }
+    }
+
+    PipelineStateCache::UniquePtr pCache = PipelineStateCache::create();
+    const uint32_t created = pCache->prebuild(filename);
+    std::remove(filename.c_str());
+    if(created != descCount || pCache->getStats().prebuilt != descCount)
+    {
+        return test_fail("Expected " + std::to_string(descCount) + " prebuilt GSOs, got " + std::to_string(created));
+    }
+
+    // The application's own objects must find the prebuilt GSOs
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+    for(uint32_t i = 0; i < descCount; i++)
+    {
+        GraphicsStateObject::Desc desc = createDesc(pProgram);
+        desc.setSampleMask(i + 1);
+        if(pCache->computeKey(desc) != keys[i])
+        {
+            return test_fail("Key changed between runs");
+        }
+        pCache->getGso(desc);
+    }
+
+    PipelineStateCache::Stats stats = pCache->getStats();
+    if(stats.hits != descCount || stats.misses != 0)
+    {
+        return test_fail("Lookups after prebuild() weren't hits");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    PipelineStateCacheTest pscTest;
+    pscTest.init(true);
+    pscTest.run();
+    return 0;
+}
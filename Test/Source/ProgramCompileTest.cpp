@@ -0,0 +1,163 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramCompileTest.h"
+#include "Utils/ShaderCache.h"
+#include "Utils/ThreadPool.h"
+
+void ProgramCompileTest::addTests()
+{
+    addTestToList<TestAsyncFallback>();
+    addTestToList<TestFallbackWithoutVersion>();
+    addTestToList<TestPrecompile>();
+}
+
+testing_func(ProgramCompileTest, TestAsyncFallback)
+{
+    GraphicsProgram::SharedPtr pProgram = createProgram();
+    pProgram->addDefine("_VARIANT", "0");
+    ProgramVersion::SharedConstPtr pBase = pProgram->getActiveVersion();
+
+    pProgram->addDefine("_VARIANT", "1");
+    ProgramVersion::SharedConstPtr pPrevious = pProgram->getActiveVersionAsync(Program::AsyncFallback::PreviousVersion);
+    ProgramVersion::SharedConstPtr pNone = pProgram->getActiveVersionAsync(Program::AsyncFallback::None);
+    bool readyBeforeWait = pProgram->isActiveVersionReady();
+
+    pProgram->waitForCompilation();
+    bool readyAfterWait = pProgram->isActiveVersionReady();
+    ProgramVersion::SharedConstPtr pVariant = pProgram->getActiveVersionAsync(Program::AsyncFallback::None);
+
+    if (pBase == nullptr || pVariant == nullptr)
+    {
+        return test_fail("Failed to compile the program");
+    }
+    if (readyBeforeWait == false && (pPrevious != pBase || pNone != nullptr))
+    {
+        return test_fail("Fallback didn't follow the policy while compiling");
+    }
+    if (readyAfterWait == false || pVariant == pBase)
+    {
+        return test_fail("Background compilation didn't produce the new version");
+    }
+
+    // Switching back doesn't need compilation
+    pProgram->addDefine("_VARIANT", "0");
+    if (pProgram->isActiveVersionReady() == false || pProgram->getActiveVersionAsync(Program::AsyncFallback::None) != pBase)
+    {
+        return test_fail("Existing version wasn't reused");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramCompileTest, TestFallbackWithoutVersion)
+{
+    // Nothing was compiled yet, so there is no previous version. The call must return right away instead of compiling on this thread.
+    GraphicsProgram::SharedPtr pProgram = createProgram();
+    pProgram->addDefine("_VARIANT", "2");
+    ProgramVersion::SharedConstPtr pPrevious = pProgram->getActiveVersionAsync(Program::AsyncFallback::PreviousVersion);
+    bool readyBeforeWait = pProgram->isActiveVersionReady();
+
+    pProgram->waitForCompilation();
+    ProgramVersion::SharedConstPtr pCompiled = pProgram->getActiveVersionAsync(Program::AsyncFallback::PreviousVersion);
+
+    if (readyBeforeWait == false && pPrevious != nullptr)
+    {
+        return test_fail("PreviousVersion fallback returned a version before any was compiled");
+    }
+    if (pCompiled == nullptr)
+    {
+        return test_fail("Background compilation didn't produce a version");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramCompileTest, TestPrecompile)
+{
+    const uint32_t variantCount = 16;
+    std::vector<Program::DefineList> defineLists(variantCount);
+    for (uint32_t v = 0; v < variantCount; v++)
+    {
+        defineLists[v].add("_VARIANT", std::to_string(v + 100));
+    }
+
+    // Link the variants one after the other, the way drawing with them would
+    GraphicsProgram::SharedPtr pSerial = createProgram();
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (const auto& defines : defineLists)
+    {
+        pSerial->replaceAllDefines(defines);
+        pSerial->getActiveVersion();
+    }
+    double serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Same variants with different values, so that the compiler does the same amount of work
+    for (auto& defines : defineLists)
+    {
+        defines["_VARIANT"] = std::to_string(std::stoi(defines["_VARIANT"]) + variantCount);
+    }
+    GraphicsProgram::SharedPtr pParallel = createProgram();
+    start = CpuTimer::getCurrentTimePoint();
+    pParallel->precompile(defineLists);
+    pParallel->waitForCompilation();
+    double parallelTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    for (const auto& defines : defineLists)
+    {
+        pParallel->replaceAllDefines(defines);
+        if (pParallel->isActiveVersionReady() == false)
+        {
+            return test_fail("Precompiled version isn't ready");
+        }
+    }
+
+    std::cout << variantCount << " variants, " << ThreadPool::getGlobalPool().getThreadCount() + 1 << " threads: serial " << serialTime << "ms, parallel " << parallelTime << "ms\n";
+    return test_pass();
+}
+
+GraphicsProgram::SharedPtr ProgramCompileTest::createProgram()
+{
+    static const std::string kVS = "float4 main(float4 pos : POSITION) : SV_POSITION { return pos; }";
+    std::string ps = "cbuffer PerFrame { float4 gData[256]; };\nfloat4 main(float4 pos : SV_POSITION) : SV_TARGET\n{\n    float4 c = _VARIANT;\n";
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        std::string n = std::to_string(i);
+        ps += "    [unroll] for(int i" + n + " = 0; i" + n + " < 16; i" + n + "++) { c += sin(gData[i" + n + " * " + n + " % 256] * pos) * cos(c.yzwx + " + n + "); }\n";
+    }
+    ps += "    return c;\n}\n";
+    return GraphicsProgram::createFromString(kVS, ps);
+}
+
+int main()
+{
+    // Measure the compiler, not the shader cache
+    ShaderCache::setDirectory("");
+
+    ProgramCompileTest pct;
+    pct.init(true);
+    pct.run();
+    return 0;
+}
@@ -0,0 +1,207 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramDefinesTest.h"
+
+void ProgramDefinesTest::addTests()
+{
+    addTestToList<TestDefineSet>();
+    addTestToList<TestVariantLookup>();
+    addTestToList<TestPerDrawToggling>();
+}
+
+testing_func(ProgramDefinesTest, TestDefineSet)
+{
+    using DefineSet = Program::DefineSet;
+    DefineSet a, b;
+    a.add(DefineSet::intern("A"));
+    a.add(DefineSet::intern("B", "1"));
+    a.add(DefineSet::intern("C", "x"));
+
+    // Same defines in a different order, with one value changed along the way
+    b.add(DefineSet::intern("C", "x"));
+    b.add(DefineSet::intern("B", "2"));
+    b.add(DefineSet::intern("A"));
+    if (a == b)
+    {
+        return test_fail("Sets with different values are equal");
+    }
+
+    b.add(DefineSet::intern("B", "1"));
+    if ((a == b) == false || a.getHash() != b.getHash())
+    {
+        return test_fail("Sets with the same defines aren't equal");
+    }
+
+    if (b.add(DefineSet::intern("A")) || b.remove(DefineSet::intern("D")))
+    {
+        return test_fail("Set changed by a redundant add or remove");
+    }
+
+    Program::DefineList list = a.getDefineList();
+    if (list.size() != 3 || list["A"] != "" || list["B"] != "1" || list["C"] != "x" || (DefineSet(list) == a) == false)
+    {
+        return test_fail("Conversion to a define list failed");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramDefinesTest, TestVariantLookup)
+{
+    GraphicsProgram::SharedPtr pProgram = createProgram();
+    const ProgramVersion* pBase = pProgram->getActiveVersion().get();
+
+    pProgram->addDefine("_RED");
+    pProgram->addDefine("_SCALE", "2");
+    const ProgramVersion* pVariant = pProgram->getActiveVersion().get();
+
+    // Reach the same set in a different order
+    pProgram->clearDefines();
+    pProgram->addDefine("_SCALE", "3");
+    pProgram->addDefine("_RED");
+    pProgram->addDefine("_SCALE", "2");
+    const ProgramVersion* pSameVariant = pProgram->getActiveVersion().get();
+    const Program::DefineList defines = pProgram->getActiveDefinesList();
+
+    pProgram->removeDefine("_RED");
+    pProgram->removeDefine(Program::DefineSet::intern("_SCALE"));
+    const ProgramVersion* pSameBase = pProgram->getActiveVersion().get();
+
+    if (pBase == nullptr || pVariant == nullptr)
+    {
+        return test_fail("Failed to create the program");
+    }
+    if (pBase == pVariant)
+    {
+        return test_fail("Different define sets returned the same version");
+    }
+    if (pSameVariant != pVariant || pSameBase != pBase)
+    {
+        return test_fail("Equal define sets returned different versions");
+    }
+    if (defines.size() != 2 || defines.at("_SCALE") != "2")
+    {
+        return test_fail("Active define list doesn't match the defines");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramDefinesTest, TestPerDrawToggling)
+{
+    // Emulate a renderer which toggles a per-model and a per-material define for every draw
+    GraphicsProgram::SharedPtr pProgram = createProgram();
+    const uint32_t drawCount = 1000000;
+    const Program::DefineSet::Define red = Program::DefineSet::intern("_RED");
+    const Program::DefineSet::Define scale = Program::DefineSet::intern("_SCALE", "2");
+
+    // Link all the variants up front
+    for (uint32_t v = 0; v < 4; v++)
+    {
+        (v & 1) ? pProgram->addDefine(red) : pProgram->removeDefine(red);
+        (v & 2) ? pProgram->addDefine(scale) : pProgram->removeDefine(scale);
+        pProgram->getActiveVersion();
+    }
+
+    // String API
+    const ProgramVersion* pLast = nullptr;
+    uint32_t versionChanges = 0;
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t d = 0; d < drawCount; d++)
+    {
+        (d & 1) ? pProgram->addDefine("_RED") : pProgram->removeDefine("_RED");
+        (d & 2) ? pProgram->addDefine("_SCALE", "2") : pProgram->removeDefine("_SCALE");
+        const ProgramVersion* pVersion = pProgram->getActiveVersion().get();
+        versionChanges += (pVersion != pLast) ? 1 : 0;
+        pLast = pVersion;
+    }
+    double stringTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Interned defines
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t d = 0; d < drawCount; d++)
+    {
+        (d & 1) ? pProgram->addDefine(red) : pProgram->removeDefine(red);
+        (d & 2) ? pProgram->addDefine(scale) : pProgram->removeDefine(scale);
+        const ProgramVersion* pVersion = pProgram->getActiveVersion().get();
+        versionChanges += (pVersion != pLast) ? 1 : 0;
+        pLast = pVersion;
+    }
+    double internedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // The previous implementation, a map keyed by the define list
+    std::map<Program::DefineList, const ProgramVersion*> versionMap;
+    Program::DefineList defineList;
+    for (uint32_t v = 0; v < 4; v++)
+    {
+        Program::DefineList variant;
+        if (v & 1) variant.add("_RED");
+        if (v & 2) variant.add("_SCALE", "2");
+        versionMap[variant] = pLast;
+    }
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t d = 0; d < drawCount; d++)
+    {
+        (d & 1) ? defineList.add("_RED") : defineList.remove("_RED");
+        (d & 2) ? defineList.add("_SCALE", "2") : defineList.remove("_SCALE");
+        versionChanges += (versionMap.find(defineList)->second != nullptr) ? 0 : 1;
+    }
+    double mapTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    if (versionChanges != drawCount * 2)
+    {
+        return test_fail("Active version didn't follow the defines");
+    }
+
+    std::cout << drawCount << " draws: string defines " << stringTime * 1e6 / drawCount << "ns, interned defines " << internedTime * 1e6 / drawCount << "ns, map of define lists " << mapTime * 1e6 / drawCount << "ns per draw\n";
+    return test_pass();
+}
+
+GraphicsProgram::SharedPtr ProgramDefinesTest::createProgram()
+{
+    static const std::string kVS = "float4 main(float4 pos : POSITION) : SV_POSITION { return pos; }";
+    static const std::string kPS =
+        "#ifndef _SCALE\n"
+        "#define _SCALE 1\n"
+        "#endif\n"
+        "float4 main() : SV_TARGET\n"
+        "{\n"
+        "#ifdef _RED\n"
+        "    return float4(1, 0, 0, 1) * _SCALE;\n"
+        "#else\n"
+        "    return float4(0, 0, 1, 1) * _SCALE;\n"
+        "#endif\n"
+        "}\n";
+    return GraphicsProgram::createFromString(kVS, kPS);
+}
+
+int main()
+{
+    ProgramDefinesTest pdt;
+    pdt.init(true);
+    pdt.run();
+    return 0;
+}
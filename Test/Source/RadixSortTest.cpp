@@ -0,0 +1,140 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "RadixSortTest.h"
+#include <algorithm>
+#include <random>
+
+void RadixSortTest::addTests()
+{
+    addTestToList<TestStability>();
+    addTestToList<TestAllEqualKeys>();
+    addTestToList<TestFullWidthKeys>();
+}
+
+testing_func(RadixSortTest, TestStability)
+{
+    // Few distinct keys, so that most of them are duplicates. Include the sizes where the sort returns early.
+    std::mt19937_64 rng(1);
+    const uint32_t counts[] = { 0, 1, 2, 3, 257, 10007 };
+    for (uint32_t count : counts)
+    {
+        std::vector<uint64_t> keys(count);
+        for (auto& key : keys)
+        {
+            key = (rng() % 7) << 20;
+        }
+
+        if (matchesStableSort(keys) == false)
+        {
+            return test_fail("Sorting " + std::to_string(count) + " keys with duplicates doesn't match std::stable_sort()");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(RadixSortTest, TestAllEqualKeys)
+{
+    // Every pass is skipped, the payload must keep its order
+    const uint64_t keyValues[] = { 0, 0x123456789ABCDEF0ull, ~0ull };
+    for (uint64_t keyValue : keyValues)
+    {
+        std::vector<uint64_t> keys(1000, keyValue);
+        if (matchesStableSort(keys) == false)
+        {
+            return test_fail("Sorting equal keys changed the order");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(RadixSortTest, TestFullWidthKeys)
+{
+    // Keys which differ in every byte, including the most significant one, and the extreme values
+    std::mt19937_64 rng(2);
+    std::vector<uint64_t> keys(20011);
+    for (auto& key : keys)
+    {
+        key = rng();
+    }
+    keys[0] = 0;
+    keys[1] = ~0ull;
+    keys[2] = 1ull << 63;
+    keys[3] = keys[4];
+    if (matchesStableSort(keys) == false)
+    {
+        return test_fail("Sorting random 64-bit keys doesn't match std::stable_sort()");
+    }
+
+    // Only the top byte differs
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        keys[i] = ((uint64_t)(i * 37 % 256) << 56) | 0x00FF00FF00FF00FFull;
+    }
+    if (matchesStableSort(keys) == false)
+    {
+        return test_fail("Sorting keys which only differ in the top byte doesn't match std::stable_sort()");
+    }
+    return test_pass();
+}
+
+bool RadixSortTest::matchesStableSort(const std::vector<uint64_t>& keys)
+{
+    std::vector<uint64_t> sortedKeys = keys;
+    std::vector<uint32_t> values(keys.size());
+    for (uint32_t i = 0; i < (uint32_t)values.size(); i++)
+    {
+        values[i] = i;
+    }
+    std::vector<uint64_t> tempKeys;
+    std::vector<uint32_t> tempValues;
+    radixSort(sortedKeys, values, tempKeys, tempValues);
+
+    std::vector<uint32_t> expected(keys.size());
+    for (uint32_t i = 0; i < (uint32_t)expected.size(); i++)
+    {
+        expected[i] = i;
+    }
+    std::stable_sort(expected.begin(), expected.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (values[i] != expected[i] || sortedKeys[i] != keys[expected[i]])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    RadixSortTest rst;
+    rst.init();
+    rst.run();
+    return 0;
+}
@@ -0,0 +1,220 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ResourceAllocatorTest.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <random>
+
+const size_t ResourceAllocatorTest::kPageSize;
+
+bool ResourceAllocatorTest::MockBackend::createPage(size_t size, ResourceHandle& pResourceHandle, GpuAddress& gpuAddress, uint8_t*& pData)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPages.push_back(std::make_unique<uint8_t[]>(size));
+    pData = mPages.back().get();
+    pResourceHandle = nullptr;
+    gpuAddress = mNextGpuAddress;
+    mNextGpuAddress += size;
+    return true;
+}
+
+void ResourceAllocatorTest::addTests()
+{
+    addTestToList<TestAllocationsDontOverlap>();
+    addTestToList<TestFenceRetirement>();
+    addTestToList<TestMegaPagePooling>();
+    addTestToList<TestMultithreadedStress>();
+}
+
+testing_func(ResourceAllocatorTest, TestAllocationsDontOverlap)
+{
+    MockBackend* pBackend = new MockBackend;
+    ResourceAllocator::SharedPtr pAllocator = ResourceAllocator::create(kPageSize, std::unique_ptr<MockBackend>(pBackend));
+
+    std::mt19937 rng(0);
+    std::vector<std::pair<GpuAddress, size_t>> ranges;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        size_t size = 1 + rng() % 1000;
+        size_t alignment = size_t(1) << (rng() % 9);
+        ResourceAllocator::AllocationData data = pAllocator->allocate(size, alignment);
+        if (data.pData == nullptr || data.gpuAddress % alignment != 0)
+        {
+            return test_fail("Allocation failed or is misaligned");
+        }
+        ranges.push_back({ data.gpuAddress, size });
+    }
+
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++)
+    {
+        if (ranges[i - 1].first + ranges[i - 1].second > ranges[i].first)
+        {
+            return test_fail("Allocations overlap");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ResourceAllocatorTest, TestFenceRetirement)
+{
+    MockBackend* pBackend = new MockBackend;
+    ResourceAllocator::SharedPtr pAllocator = ResourceAllocator::create(kPageSize, std::unique_ptr<MockBackend>(pBackend));
+
+    // Each frame fills two pages and releases everything
+    auto runFrame = [&]()
+    {
+        std::vector<ResourceAllocator::AllocationData> allocations;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            allocations.push_back(pAllocator->allocate(kPageSize / 4));
+        }
+        for (auto& data : allocations)
+        {
+            pAllocator->release(data);
+        }
+        pBackend->cpuValue++;
+        pAllocator->executeDeferredReleases();
+    };
+
+    // While the GPU doesn't make progress, nothing can be reused
+    for (uint32_t frame = 0; frame < 4; frame++)
+    {
+        runFrame();
+    }
+    uint32_t pageCount = pAllocator->getStats().pageCount;
+    if (pageCount < 8)
+    {
+        return test_fail("Pages were reused before the GPU finished with them");
+    }
+
+    // With the GPU one frame behind, the pages are recycled
+    for (uint32_t frame = 0; frame < 100; frame++)
+    {
+        pBackend->gpuValue = pBackend->cpuValue.load();
+        runFrame();
+    }
+    if (pAllocator->getStats().pageCount > pageCount + 3)
+    {
+        return test_fail("Completed pages weren't recycled");
+    }
+    return test_pass();
+}
+
+testing_func(ResourceAllocatorTest, TestMegaPagePooling)
+{
+    MockBackend* pBackend = new MockBackend;
+    ResourceAllocator::SharedPtr pAllocator = ResourceAllocator::create(kPageSize, std::unique_ptr<MockBackend>(pBackend));
+
+    // Allocations of different sizes in the same size class share the pages
+    for (uint32_t frame = 0; frame < 100; frame++)
+    {
+        ResourceAllocator::AllocationData data = pAllocator->allocate(kPageSize * 3 + frame * 100);
+        if (data.pData == nullptr)
+        {
+            return test_fail("Large allocation failed");
+        }
+        data.pData[kPageSize * 3] = 1;
+        pAllocator->release(data);
+        pBackend->gpuValue = pBackend->cpuValue++;
+        pAllocator->executeDeferredReleases();
+    }
+
+    ResourceAllocator::Stats stats = pAllocator->getStats();
+    if (stats.megaPageCount > 2 || stats.megaPageReuseCount < 98)
+    {
+        return test_fail("Mega-pages weren't reused");
+    }
+    return test_pass();
+}
+
+testing_func(ResourceAllocatorTest, TestMultithreadedStress)
+{
+    MockBackend* pBackend = new MockBackend;
+    ResourceAllocator::SharedPtr pAllocator = ResourceAllocator::create(kPageSize, std::unique_ptr<MockBackend>(pBackend));
+    ThreadPool& pool = ThreadPool::getGlobalPool();
+    const uint32_t taskCount = (pool.getThreadCount() + 1) * 4;
+    const uint32_t allocationsPerTask = 1000;
+    const uint32_t frameCount = 200;
+    const uint32_t framesInFlight = 2;
+    std::atomic<uint32_t> errorCount(0);
+
+    // Every task stamps its allocations and checks the stamps before releasing them, which catches memory handed out twice
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        pool.parallelFor(taskCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            std::vector<ResourceAllocator::AllocationData> allocations(allocationsPerTask);
+            for (uint32_t task = begin; task < end; task++)
+            {
+                const uint8_t stamp = uint8_t(task * 31 + frame);
+                for (uint32_t i = 0; i < allocationsPerTask; i++)
+                {
+                    size_t size = (i % 100 == 99) ? kPageSize * 2 : 16 + (i * 7919) % 256;
+                    allocations[i] = pAllocator->allocate(size, 16);
+                    memset(allocations[i].pData, stamp, 16);
+                }
+                for (auto& data : allocations)
+                {
+                    if (data.pData[0] != stamp || data.pData[15] != stamp)
+                    {
+                        errorCount++;
+                    }
+                    pAllocator->release(data);
+                }
+            }
+        });
+
+        // Submit the frame. The GPU is a couple of frames behind.
+        pBackend->cpuValue++;
+        if (pBackend->cpuValue > framesInFlight)
+        {
+            pBackend->gpuValue = pBackend->cpuValue - framesInFlight;
+        }
+        pAllocator->executeDeferredReleases();
+    }
+    double time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    if (errorCount != 0)
+    {
+        return test_fail("Memory was handed out to more than one allocation");
+    }
+
+    ResourceAllocator::Stats stats = pAllocator->getStats();
+    std::cout << frameCount * taskCount * allocationsPerTask << " allocations on " << pool.getThreadCount() + 1 << " threads: " << time << "ms, " << stats.pageCount << " pages, " << stats.megaPageCount << " mega-pages created, " << stats.megaPageReuseCount << " reused\n";
+    return test_pass();
+}
+
+int main()
+{
+    ResourceAllocatorTest rat;
+    rat.init();
+    rat.run();
+    return 0;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "API/LowLevel/ResourceAllocator.h"
+
+class ResourceAllocatorTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestAllocationsDontOverlap);
+    register_testing_func(TestFenceRetirement);
+    register_testing_func(TestMegaPagePooling);
+    register_testing_func(TestMultithreadedStress);
+
+    /** Allocates pages from CPU memory, and uses a fence which the test advances
+    */
+    class MockBackend : public ResourceAllocator::Backend
+    {
+    public:
+        bool createPage(size_t size, ResourceHandle& pResourceHandle, GpuAddress& gpuAddress, uint8_t*& pData) override;
+        uint64_t getCpuFenceValue() const override { return cpuValue; }
+        uint64_t getGpuFenceValue() const override { return gpuValue; }
+
+        std::atomic<uint64_t> cpuValue{ 0 };
+        std::atomic<uint64_t> gpuValue{ 0 };
+    private:
+        std::mutex mMutex;
+        std::vector<std::unique_ptr<uint8_t[]>> mPages;
+        GpuAddress mNextGpuAddress = 0x10000;
+    };
+
+    static const size_t kPageSize = 64 * 1024;
+};
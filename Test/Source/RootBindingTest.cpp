@@ -0,0 +1,189 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "RootBindingTest.h"
+
+void RootBindingTest::addTests()
+{
+    addTestToList<TestRedundantBindings>();
+    addTestToList<TestChangedSlots>();
+    addTestToList<TestInvalidation>();
+    addTestToList<TestSwitchingVars>();
+}
+
+testing_func(RootBindingTest, TestRedundantBindings)
+{
+    ComputeVars::SharedPtr pVars = createVars();
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    RootBindingCache bindings;
+    RecordingSink sink;
+
+    // The first apply sets everything: the root signature, the CBV, and the texture, UAV and sampler tables
+    pVars->apply(pContext, bindings, &sink);
+    if (sink.rootSignatureCount != 1 || sink.cbvCount != 1 || sink.tableCount != 3)
+    {
+        return test_fail("First apply didn't set all the bindings");
+    }
+
+    // Nothing changed, so nothing is issued
+    sink.clear();
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        pVars->apply(pContext, bindings, &sink);
+    }
+    if (sink.getTotal() != 0)
+    {
+        return test_fail("Applying unchanged vars issued bindings");
+    }
+    return test_pass();
+}
+
+testing_func(RootBindingTest, TestChangedSlots)
+{
+    ComputeVars::SharedPtr pVars = createVars();
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    RootBindingCache bindings;
+    RecordingSink sink;
+    pVars->apply(pContext, bindings, &sink);
+
+    // Changing a texture only re-issues its table
+    sink.clear();
+    pVars->setTexture("gTex", Texture::create2D(4, 4, ResourceFormat::RGBA8Unorm, 1, 1));
+    pVars->apply(pContext, bindings, &sink);
+    if (sink.rootSignatureCount != 0 || sink.cbvCount != 0 || sink.tableCount != 1)
+    {
+        return test_fail("Changing a texture issued the wrong bindings");
+    }
+
+    // Updating the constant buffer may move it, but mustn't touch the tables
+    sink.clear();
+    pVars["PerFrame"]->setVariable("gScale", glm::vec4(2));
+    pVars->apply(pContext, bindings, &sink);
+    if (sink.rootSignatureCount != 0 || sink.cbvCount > 1 || sink.tableCount != 0)
+    {
+        return test_fail("Updating a constant buffer issued the wrong bindings");
+    }
+
+    // Binding a new constant buffer re-issues the CBV
+    sink.clear();
+    pVars->setConstantBuffer("PerFrame", ConstantBuffer::create(pVars->getReflection()->getBufferDesc("PerFrame", ProgramReflection::BufferReflection::Type::Constant)));
+    pVars->apply(pContext, bindings, &sink);
+    if (sink.rootSignatureCount != 0 || sink.cbvCount != 1 || sink.tableCount != 0)
+    {
+        return test_fail("Binding a new constant buffer issued the wrong bindings");
+    }
+    return test_pass();
+}
+
+testing_func(RootBindingTest, TestInvalidation)
+{
+    ComputeVars::SharedPtr pVars = createVars();
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    RootBindingCache bindings;
+    RecordingSink sink;
+    pVars->apply(pContext, bindings, &sink);
+    const uint32_t fullCount = sink.getTotal();
+
+    // After the command list is reset, everything needs to be set again
+    sink.clear();
+    bindings.invalidate();
+    pVars->apply(pContext, bindings, &sink);
+    if (sink.getTotal() != fullCount)
+    {
+        return test_fail("Invalidating the bindings didn't re-issue all of them");
+    }
+
+    // A different root signature invalidates the root arguments
+    sink.clear();
+    ComputeVars::SharedPtr pOtherVars = createVars();
+    pOtherVars->apply(pContext, bindings, &sink);
+    if (sink.getTotal() != fullCount)
+    {
+        return test_fail("Changing the root signature didn't re-issue all the bindings");
+    }
+    return test_pass();
+}
+
+testing_func(RootBindingTest, TestSwitchingVars)
+{
+    // Two vars which share the root signature and all the resources except for the constant buffer
+    ComputeVars::SharedPtr pVars = createVars();
+    ComputeVars::SharedPtr pOtherVars = createVars(pVars->getRootSignature());
+    pOtherVars->setTexture("gTex", pVars->getTexture("gTex"));
+    pOtherVars->setTypedBuffer("gOut", pVars->getTypedBuffer("gOut"));
+    pOtherVars->setSampler("gSampler", pVars->getSampler("gSampler"));
+
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    RootBindingCache bindings;
+    RecordingSink sink;
+    pVars->apply(pContext, bindings, &sink);
+    const uint32_t fullCount = sink.getTotal();
+
+    sink.clear();
+    const uint32_t applyCount = 1000;
+    for (uint32_t i = 0; i < applyCount; i++)
+    {
+        ComputeVars* pCurrent = (i & 1) ? pVars.get() : pOtherVars.get();
+        pCurrent->apply(pContext, bindings, &sink);
+    }
+    if (sink.rootSignatureCount != 0 || sink.tableCount != 0 || sink.cbvCount != applyCount)
+    {
+        return test_fail("Switching vars should only re-issue the CBV");
+    }
+
+    std::cout << applyCount << " applies alternating between 2 vars: " << sink.getTotal() << " bindings issued, " << applyCount * fullCount << " without tracking\n";
+    return test_pass();
+}
+
+ComputeVars::SharedPtr RootBindingTest::createVars(const RootSignature::SharedPtr& pRootSig)
+{
+    static const std::string kCS =
+        "cbuffer PerFrame { float4 gScale; };\n"
+        "Texture2D gTex;\n"
+        "SamplerState gSampler;\n"
+        "RWBuffer<float4> gOut;\n"
+        "[numthreads(1, 1, 1)]\n"
+        "void main()\n"
+        "{\n"
+        "    gOut[0] = gScale * gTex.SampleLevel(gSampler, float2(0.5, 0.5), 0);\n"
+        "}\n";
+    static Program::SharedPtr spProgram = ComputeProgram::createFromString(kCS);
+
+    ComputeVars::SharedPtr pVars = ComputeVars::create(spProgram->getActiveVersion()->getReflector(), true, pRootSig);
+    pVars->setTexture("gTex", Texture::create2D(4, 4, ResourceFormat::RGBA8Unorm, 1, 1));
+    pVars->setSampler("gSampler", Sampler::create(Sampler::Desc()));
+    pVars->setTypedBuffer("gOut", TypedBuffer<glm::vec4>::create(1));
+    return pVars;
+}
+
+int main()
+{
+    RootBindingTest rbt;
+    rbt.init(true);
+    rbt.run();
+    return 0;
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+
+class RootBindingTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestRedundantBindings);
+    register_testing_func(TestChangedSlots);
+    register_testing_func(TestInvalidation);
+    register_testing_func(TestSwitchingVars);
+
+    /** Records the bindings which ProgramVars issues instead of writing them into a command list
+    */
+    class RecordingSink : public RootBindingCache::Sink
+    {
+    public:
+        void setRootSignature(const RootSignature* pRootSig) override { rootSignatureCount++; }
+        void setRootConstantBufferView(uint32_t rootOffset, uint64_t gpuAddress) override { cbvCount++; }
+        void setRootDescriptorTable(uint32_t rootOffset, uint64_t gpuHandle) override { tableCount++; }
+        void clear() { rootSignatureCount = 0; cbvCount = 0; tableCount = 0; }
+        uint32_t getTotal() const { return rootSignatureCount + cbvCount + tableCount; }
+
+        uint32_t rootSignatureCount = 0;
+        uint32_t cbvCount = 0;
+        uint32_t tableCount = 0;
+    };
+
+    /** Create compute vars with a constant buffer, a texture, a sampler and a UAV, with all the resources bound
+        \param[in] pRootSig Optional. Share the root signature with other vars.
+    */
+    static ComputeVars::SharedPtr createVars(const RootSignature::SharedPtr& pRootSig = nullptr);
+};
@@ -0,0 +1,291 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneRendererTest.h"
+#include "Utils/ThreadPool.h"
+
+void SceneRendererTest::addTests()
+{
+    addTestToList<TestParallelDrawOrder>();
+    addTestToList<TestMeshInstanceChanges>();
+    addTestToList<TestDrawStats>();
+    addTestToList<TestSortKeyOverflow>();
+}
+
+testing_func(SceneRendererTest, TestParallelDrawOrder)
+{
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Scene::SharedPtr pScene = createScene(pContext);
+    if (pScene == nullptr)
+    {
+        return test_fail("Failed to create the scene");
+    }
+
+    RecordingRenderer::UniquePtr pRenderer = RecordingRenderer::create(pScene);
+    // Flat culling splits the culling itself across the threads, so it exercises more of the parallel path than the BVH
+    pRenderer->setHierarchicalCullState(false);
+
+    const bool sortStates[] = { false, true };
+    for (bool sorted : sortStates)
+    {
+        pRenderer->setDrawSortState(sorted);
+        pRenderer->setThreadPool(nullptr);
+        pRenderer->draws.clear();
+        pRenderer->renderScene(pContext, pScene->getActiveCamera().get());
+        const std::vector<RecordingRenderer::Draw> reference = pRenderer->draws;
+
+        const uint32_t totalCount = pScene->getInstanceTable().getEntryCount();
+        if (reference.empty() || reference.size() == totalCount)
+        {
+            return test_fail("The camera should see some of the instances but not all");
+        }
+
+        const uint32_t threadCounts[] = { 1, 3, 7 };
+        for (uint32_t threadCount : threadCounts)
+        {
+            ThreadPool::UniquePtr pPool = ThreadPool::create(threadCount);
+            pRenderer->setThreadPool(pPool.get());
+            pRenderer->draws.clear();
+            pRenderer->renderScene(pContext, pScene->getActiveCamera().get());
+            pRenderer->setThreadPool(nullptr);
+
+            if (pRenderer->draws != reference)
+            {
+                return test_fail(std::string(sorted ? "Sorted" : "Unsorted") + " draw order with " + std::to_string(threadCount) + " worker threads doesn't match the serial order");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SceneRendererTest, TestMeshInstanceChanges)
+{
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Scene::SharedPtr pScene = createScene(pContext);
+    if (pScene == nullptr)
+    {
+        return test_fail("Failed to create the scene");
+    }
+
+    // The model is shared by all the instances, so changing its mesh instance affects every model instance
+    RecordingRenderer::UniquePtr pRenderer = RecordingRenderer::create(pScene);
+    const Model::MeshInstance::SharedPtr& pMeshInstance = pScene->getModel(0)->getMeshInstance(0, 0);
+    auto countDraws = [&]()
+    {
+        pRenderer->draws.clear();
+        pRenderer->renderScene(pContext, pScene->getActiveCamera().get());
+        uint32_t count = 0;
+        for (const auto& draw : pRenderer->draws)
+        {
+            count += (draw.pMeshInstance == pMeshInstance.get()) ? 1 : 0;
+        }
+        return count;
+    };
+
+    ThreadPool::UniquePtr pPool = ThreadPool::create(3);
+    ThreadPool* pools[] = { nullptr, pPool.get() };
+    for (ThreadPool* pThreadPool : pools)
+    {
+        pRenderer->setThreadPool(pThreadPool);
+        const std::string mode = pThreadPool ? " with parallel traversal" : "";
+        const uint32_t visibleCount = countDraws();
+        if (visibleCount == 0)
+        {
+            return test_fail("The mesh instance isn't drawn" + mode);
+        }
+
+        pMeshInstance->setVisible(false);
+        const uint32_t hiddenCount = countDraws();
+        pMeshInstance->setVisible(true);
+        if (hiddenCount != 0 || countDraws() != visibleCount)
+        {
+            return test_fail("Toggling the mesh instance visibility didn't change the draws" + mode);
+        }
+
+        // Move the mesh instance behind the camera, so every instance of it is culled
+        const glm::vec3 translation = pMeshInstance->getTranslation();
+        pMeshInstance->setTranslation(glm::vec3(-1e5f, 0, -1e5f), true);
+        const uint32_t movedCount = countDraws();
+        pMeshInstance->setTranslation(translation, true);
+        if (movedCount != 0 || countDraws() != visibleCount)
+        {
+            return test_fail("Moving the mesh instance didn't change the culling result" + mode);
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SceneRendererTest, TestDrawStats)
+{
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Model::SharedPtr pModels[] = { Model::createFromFile("teapot.obj"), Model::createFromFile("sphere.obj") };
+    if (pModels[0] == nullptr || pModels[1] == nullptr)
+    {
+        return test_fail("Failed to load the models");
+    }
+
+    // Interleave the instances of both models in space, so that sorting by depth alone would switch meshes all the time
+    const uint32_t instanceCount = 8;
+    Scene::SharedPtr pScene = Scene::create();
+    uint32_t meshCount = 0;
+    for (uint32_t m = 0; m < arraysize(pModels); m++)
+    {
+        meshCount += pModels[m]->getMeshCount();
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            pScene->addModelInstance(pModels[m], "Instance" + std::to_string(i), glm::vec3(float(i * 2 + m) * 3, 0, 0));
+        }
+    }
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setDepthRange(0.1f, 1000.0f);
+    pScene->setActiveCamera(pScene->addCamera(pCamera));
+    bindState(pContext);
+
+    // Without culling every mesh of every model instance is drawn once
+    SceneRenderer::UniquePtr pRenderer = SceneRenderer::create(pScene);
+    pRenderer->setObjectCullState(false);
+    pRenderer->renderScene(pContext, pCamera.get());
+    const SceneRenderer::DrawStats unsorted = pRenderer->getDrawStats();
+    pRenderer->setDrawSortState(true);
+    pRenderer->renderScene(pContext, pCamera.get());
+    const SceneRenderer::DrawStats sorted = pRenderer->getDrawStats();
+
+    const uint32_t expectedDraws = instanceCount * meshCount;
+    if (unsorted.drawCalls != expectedDraws || sorted.drawCalls != expectedDraws)
+    {
+        return test_fail("Unexpected number of draw calls");
+    }
+    if (unsorted.vaoBinds != expectedDraws || unsorted.materialBinds < instanceCount * arraysize(pModels))
+    {
+        return test_fail("Unsorted submission should rebind the VAO and material for every model instance");
+    }
+    if (sorted.vaoBinds > meshCount || sorted.materialBinds > meshCount)
+    {
+        return test_fail("Sorted submission should bind every mesh and material once");
+    }
+    if (unsorted.variantChanges != 0 || sorted.variantChanges != 0)
+    {
+        return test_fail("The models aren't skinned, the program variant shouldn't change");
+    }
+
+    // The first frame transforms every entry, later frames only the entries of instances which moved
+    const uint32_t entryCount = pScene->getInstanceTable().getEntryCount();
+    if (unsorted.updatedEntries != entryCount || sorted.updatedEntries != 0)
+    {
+        return test_fail("The renderer should report the entries updated by its own instance table update");
+    }
+    uint32_t modelEntryCount = 0;
+    for (uint32_t meshID = 0; meshID < pModels[0]->getMeshCount(); meshID++)
+    {
+        modelEntryCount += pModels[0]->getMeshInstanceCount(meshID);
+    }
+    pScene->getModelInstance(0, 0)->setTranslation(glm::vec3(0, 1, 0), false);
+    pRenderer->renderScene(pContext, pCamera.get());
+    if (pRenderer->getDrawStats().updatedEntries != modelEntryCount)
+    {
+        return test_fail("Moving a model instance should update its entries only");
+    }
+    return test_pass();
+}
+
+testing_func(SceneRendererTest, TestSortKeyOverflow)
+{
+    // More model instances than the sort key can hold. The renderer must fall back to the unsorted order rather than batch aliased keys.
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Scene::SharedPtr pScene = createScene(pContext, 65);
+    if (pScene == nullptr)
+    {
+        return test_fail("Failed to create the scene");
+    }
+
+    RecordingRenderer::UniquePtr pRenderer = RecordingRenderer::create(pScene);
+    pRenderer->renderScene(pContext, pScene->getActiveCamera().get());
+    const std::vector<RecordingRenderer::Draw> unsorted = pRenderer->draws;
+
+    pRenderer->setDrawSortState(true);
+    pRenderer->draws.clear();
+    pRenderer->renderScene(pContext, pScene->getActiveCamera().get());
+    if (unsorted.empty() || pRenderer->draws != unsorted)
+    {
+        return test_fail("Sorted submission didn't fall back to the scene order when the key overflowed");
+    }
+    return test_pass();
+}
+
+Scene::SharedPtr SceneRendererTest::createScene(RenderContext* pContext, uint32_t gridSize)
+{
+    Model::SharedPtr pModel = Model::createFromFile("teapot.obj");
+    if (pModel == nullptr)
+    {
+        return nullptr;
+    }
+
+    // Enough instances to split the traversal into several chunks
+    Scene::SharedPtr pScene = Scene::create();
+    const float spacing = pModel->getRadius() * 3;
+    for (uint32_t z = 0; z < gridSize; z++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            glm::vec3 translation(x * spacing, 0, z * spacing);
+            pScene->addModelInstance(pModel, "Teapot" + std::to_string(z * gridSize + x), translation, glm::vec3(0, 0.1f * x, 0));
+        }
+    }
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(-spacing, spacing, -spacing));
+    pCamera->setTarget(glm::vec3(gridSize * spacing * 0.5f, 0, gridSize * spacing));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setDepthRange(0.1f, gridSize * spacing);
+    pCamera->setFovY(glm::radians(45.0f));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pScene->setActiveCamera(pScene->addCamera(pCamera));
+
+    bindState(pContext);
+    return pScene;
+}
+
+void SceneRendererTest::bindState(RenderContext* pContext)
+{
+    Fbo::Desc fboDesc;
+    fboDesc.setColorTarget(0, ResourceFormat::RGBA8Unorm).setDepthStencilTarget(ResourceFormat::D32Float);
+
+    GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("", "Simple.ps.hlsl");
+    GraphicsState::SharedPtr pState = GraphicsState::create();
+    pState->setProgram(pProgram);
+    pState->setFbo(FboHelper::create2D(256, 256, fboDesc));
+    pContext->setGraphicsState(pState);
+    pContext->setGraphicsVars(GraphicsVars::create(pProgram->getActiveVersion()->getReflector()));
+}
+
+int main()
+{
+    SceneRendererTest srt;
+    srt.init(true);
+    srt.run();
+    return 0;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "Graphics/Scene/SceneRenderer.h"
+
+class SceneRendererTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestParallelDrawOrder);
+    register_testing_func(TestMeshInstanceChanges);
+    register_testing_func(TestDrawStats);
+    register_testing_func(TestSortKeyOverflow);
+
+    /** Records the mesh instances in the order the renderer submits them. Nothing is drawn.
+    */
+    class RecordingRenderer : public SceneRenderer
+    {
+    public:
+        using UniquePtr = std::unique_ptr<RecordingRenderer>;
+        static UniquePtr create(const Scene::SharedPtr& pScene) { return UniquePtr(new RecordingRenderer(pScene)); }
+
+        struct Draw
+        {
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            bool operator==(const Draw& other) const { return pModelInstance == other.pModelInstance && pMeshInstance == other.pMeshInstance; }
+        };
+        std::vector<Draw> draws;
+
+    protected:
+        RecordingRenderer(const Scene::SharedPtr& pScene) : SceneRenderer(pScene) {}
+        void setPerFrameData(RenderContext* pContext, const CurrentWorkingData& currentData) override {}
+        bool setPerMeshInstanceData(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance, uint32_t drawInstanceID, const CurrentWorkingData& currentData) override
+        {
+            draws.push_back({ pModelInstance.get(), pMeshInstance.get() });
+            return false;
+        }
+    };
+
+    /** Create a gridSize x gridSize grid of teapot instances and a camera which sees part of them. Calls bindState().
+    */
+    static Scene::SharedPtr createScene(RenderContext* pContext, uint32_t gridSize = 48);
+
+    /** Bind a graphics state with a program and a render target, and matching vars, to the render context. renderScene() expects them.
+    */
+    static void bindState(RenderContext* pContext);
+};
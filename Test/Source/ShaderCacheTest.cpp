@@ -0,0 +1,228 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ShaderCacheTest.h"
+#include "Utils/ThreadPool.h"
+#include <fstream>
+
+void ShaderCacheTest::addTests()
+{
+    addTestToList<TestStoreAndLoad>();
+    addTestToList<TestCorruptedFile>();
+    addTestToList<TestConcurrentStores>();
+    addTestToList<TestCompiledShaderReuse>();
+}
+
+testing_func(ShaderCacheTest, TestStoreAndLoad)
+{
+    setTestDirectory();
+    const ShaderCache::Key key = ShaderCache::computeKey("float4 main() : SV_TARGET { return 1; }", "ps_5_0", 0, 47);
+    const ShaderCache::Key otherKey = ShaderCache::computeKey("float4 main() : SV_TARGET { return 1; }", "ps_5_0", 1, 47);
+    if (key == otherKey)
+    {
+        return test_fail("Compiler flags don't affect the key");
+    }
+
+    std::vector<uint8_t> blob(1237);
+    for (size_t i = 0; i < blob.size(); i++)
+    {
+        blob[i] = (uint8_t)(i * 7);
+    }
+
+    std::vector<uint8_t> loaded;
+    bool missed = (ShaderCache::load(key, loaded) == false);
+    bool stored = ShaderCache::store(key, blob.data(), blob.size());
+    bool hit = ShaderCache::load(key, loaded);
+    bool otherMissed = (ShaderCache::load(otherKey, loaded) == false);
+    ShaderCache::load(key, loaded);
+    clearTestDirectory();
+
+    if (missed == false || otherMissed == false)
+    {
+        return test_fail("Found a blob which wasn't stored");
+    }
+    if (stored == false || hit == false)
+    {
+        return test_fail("Failed to store and load a blob");
+    }
+    if (loaded != blob)
+    {
+        return test_fail("Loaded blob doesn't match the stored one");
+    }
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestCorruptedFile)
+{
+    const std::string dir = setTestDirectory();
+    const ShaderCache::Key key = ShaderCache::computeKey("Corrupted", "vs_5_0", 0, 47);
+    std::vector<uint8_t> blob(256, 0x5a);
+    ShaderCache::store(key, blob.data(), blob.size());
+
+    // Flip a byte of the payload
+    const std::string filename = dir + "\\" + key.getFilename();
+    {
+        std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put((char)0x5b);
+    }
+
+    std::vector<uint8_t> loaded;
+    bool rejected = (ShaderCache::load(key, loaded) == false);
+    bool removed = (doesFileExist(filename) == false);
+    bool restored = ShaderCache::store(key, blob.data(), blob.size()) && ShaderCache::load(key, loaded);
+    clearTestDirectory();
+
+    if (rejected == false)
+    {
+        return test_fail("Corrupted blob was loaded");
+    }
+    if (removed == false || restored == false)
+    {
+        return test_fail("Corrupted file wasn't replaced");
+    }
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestConcurrentStores)
+{
+    // Many threads storing the same blobs, the way multiple processes compiling the same shaders would
+    const std::string dir = setTestDirectory();
+    const uint32_t keyCount = 4;
+    const uint32_t storeCount = 256;
+    std::vector<ShaderCache::Key> keys(keyCount);
+    std::vector<std::vector<uint8_t>> blobs(keyCount);
+    for (uint32_t k = 0; k < keyCount; k++)
+    {
+        keys[k] = ShaderCache::computeKey("Shader" + std::to_string(k), "cs_5_0", 0, 47);
+        blobs[k].resize(64 * 1024 + k, (uint8_t)k);
+    }
+
+    ThreadPool::UniquePtr pPool = ThreadPool::create(8);
+    pPool->parallelFor(storeCount, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const uint32_t k = i % keyCount;
+            ShaderCache::store(keys[k], blobs[k].data(), blobs[k].size());
+        }
+    });
+
+    std::string error;
+    for (uint32_t k = 0; k < keyCount; k++)
+    {
+        std::vector<uint8_t> loaded;
+        if (ShaderCache::load(keys[k], loaded) == false || loaded != blobs[k])
+        {
+            error = "Blob " + std::to_string(k) + " is missing or corrupted";
+        }
+    }
+
+    std::vector<std::string> tempFiles;
+    enumerateFiles(dir + "\\*.tmp", tempFiles);
+    clearTestDirectory();
+
+    if (error.size())
+    {
+        return test_fail(error);
+    }
+    if (tempFiles.size())
+    {
+        return test_fail("Temporary files were left in the cache directory");
+    }
+    return test_pass();
+}
+
+testing_func(ShaderCacheTest, TestCompiledShaderReuse)
+{
+    setTestDirectory();
+
+    // A shader which takes a while to compile
+    std::string source = "cbuffer PerFrame { float4 gData[256]; };\nfloat4 main(float4 pos : SV_POSITION) : SV_TARGET\n{\n    float4 c = 0;\n";
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        std::string n = std::to_string(i);
+        source += "    [unroll] for(int i" + n + " = 0; i" + n + " < 16; i" + n + "++) { c += sin(gData[i" + n + " * " + n + " % 256] * pos) * cos(c.yzwx + " + n + "); }\n";
+    }
+    source += "    return c;\n}\n";
+
+    ShaderCache::resetStats();
+    std::string log;
+    auto start = CpuTimer::getCurrentTimePoint();
+    Shader::SharedPtr pCompiled = Shader::create(source, ShaderType::Pixel, log);
+    auto compiled = CpuTimer::getCurrentTimePoint();
+    Shader::SharedPtr pCached = Shader::create(source, ShaderType::Pixel, log);
+    auto cached = CpuTimer::getCurrentTimePoint();
+    ShaderCache::Stats stats = ShaderCache::getStats();
+    clearTestDirectory();
+
+    if (pCompiled == nullptr || pCached == nullptr)
+    {
+        return test_fail("Failed to compile the shader: " + log);
+    }
+    if (stats.stores != 1 || stats.hits != 1)
+    {
+        return test_fail("Second compilation didn't come from the cache");
+    }
+
+    ID3DBlobPtr pCompiledBlob = pCompiled->getCodeBlob();
+    ID3DBlobPtr pCachedBlob = pCached->getCodeBlob();
+    if (pCompiledBlob->GetBufferSize() != pCachedBlob->GetBufferSize() || memcmp(pCompiledBlob->GetBufferPointer(), pCachedBlob->GetBufferPointer(), pCompiledBlob->GetBufferSize()))
+    {
+        return test_fail("Cached blob doesn't match the compiled one");
+    }
+
+    std::cout << "Compiled " << CpuTimer::calcDuration(start, compiled) << "ms, loaded from cache " << CpuTimer::calcDuration(compiled, cached) << "ms\n";
+    return test_pass();
+}
+
+std::string ShaderCacheTest::setTestDirectory()
+{
+    const std::string dir = getExecutableDirectory() + "\\ShaderCacheTest";
+    ShaderCache::setDirectory(dir);
+    clearTestDirectory();
+    return dir;
+}
+
+void ShaderCacheTest::clearTestDirectory()
+{
+    const std::string dir = ShaderCache::getDirectory();
+    std::vector<std::string> files;
+    enumerateFiles(dir + "\\*.*", files);
+    for (const auto& file : files)
+    {
+        std::remove((dir + "\\" + file).c_str());
+    }
+}
+
+int main()
+{
+    ShaderCacheTest sct;
+    sct.init();
+    sct.run();
+    return 0;
+}
@@ -0,0 +1,279 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ShaderPreprocessorTest.h"
+#include "Utils/OS.h"
+#include <fstream>
+
+void ShaderPreprocessorTest::addTests()
+{
+    addTestToList<TestIncludeExpansion>();
+    addTestToList<TestCacheInvalidation>();
+    addTestToList<TestFrameworkShaders>();
+    addTestToList<TestIncludeHeavyShader>();
+}
+
+testing_func(ShaderPreprocessorTest, TestIncludeExpansion)
+{
+    const std::string dir = getTestDirectory();
+    writeFile(dir + "\\Once.h", "#pragma once\nfloat onceValue;\n");
+    writeFile(dir + "\\Nested.h", "#include \"Once.h\"\nfloat nestedValue;");
+    const std::string rootFile = dir + "\\Root.hlsl";
+    std::string shader = "// #include \"Missing.h\"\n/* #include \"Missing.h\"\n*/\n#include \"Nested.h\"\n#include \"Once.h\"\nfloat rootValue;\n";
+    writeFile(rootFile, shader);
+
+    std::string error;
+    Shader::unordered_string_set includeList;
+    bool result = ShaderPreprocessor::parseShader(rootFile, shader, error, includeList);
+    std::remove(rootFile.c_str());
+    std::remove((dir + "\\Once.h").c_str());
+    std::remove((dir + "\\Nested.h").c_str());
+
+    if (result == false)
+    {
+        return test_fail("Preprocessing failed: " + error);
+    }
+    if (includeList.size() != 2)
+    {
+        return test_fail("Expected 2 files in the include list, got " + std::to_string(includeList.size()));
+    }
+    if (countOccurrences(shader, "float onceValue;") != 1 || countOccurrences(shader, "float nestedValue;") != 1 || countOccurrences(shader, "float rootValue;") != 1)
+    {
+        return test_fail("Included files weren't expanded exactly once");
+    }
+    // The skipped '#pragma once' include keeps its line, so the root file's code stays on the same line
+    if (shader.find("#line 5 \"" + replaceSubstring(rootFile, "\\", "/") + "\"\n\nfloat rootValue;") == std::string::npos)
+    {
+        return test_fail("Missing line pragma after the expanded include");
+    }
+    return test_pass();
+}
+
+testing_func(ShaderPreprocessorTest, TestCacheInvalidation)
+{
+    const std::string dir = getTestDirectory();
+    const std::string header = dir + "\\Changing.h";
+    const std::string rootFile = dir + "\\Changing.hlsl";
+    writeFile(header, "float before;\n");
+    writeFile(rootFile, "#include \"Changing.h\"\n");
+
+    std::string error;
+    Shader::unordered_string_set includeList;
+    std::string first = "#include \"Changing.h\"\n";
+    ShaderPreprocessor::parseShader(rootFile, first, error, includeList);
+
+    // Changing the size invalidates the cache entry even if the modification time has a coarse resolution
+    writeFile(header, "float afterTheChange;\n");
+    std::string second = "#include \"Changing.h\"\n";
+    ShaderPreprocessor::parseShader(rootFile, second, error, includeList);
+    std::remove(header.c_str());
+    std::remove(rootFile.c_str());
+
+    if (first.find("float before;") == std::string::npos)
+    {
+        return test_fail("Header wasn't expanded");
+    }
+    if (second.find("float afterTheChange;") == std::string::npos)
+    {
+        return test_fail("Stale include file was returned from the cache");
+    }
+    return test_pass();
+}
+
+testing_func(ShaderPreprocessorTest, TestFrameworkShaders)
+{
+    // Collect the framework's shaders
+    std::vector<std::string> files;
+    const char* kSubDirs[] = { "", "\\Effects", "\\Framework\\Shaders" };
+    const char* kExtensions[] = { "*.hlsl", "*.vs", "*.ps", "*.gs", "*.fs" };
+    for (const auto& dataDir : getDataDirectoriesList())
+    {
+        for (const char* subDir : kSubDirs)
+        {
+            for (const char* extension : kExtensions)
+            {
+                std::vector<std::string> names;
+                enumerateFiles(dataDir + subDir + "\\" + extension, names);
+                for (const auto& name : names)
+                {
+                    files.push_back(dataDir + subDir + "\\" + name);
+                }
+            }
+        }
+    }
+
+    if (files.empty())
+    {
+        return test_fail("Can't find the framework shaders");
+    }
+
+    std::string error;
+    const uint32_t passCount = 100;
+    double coldTime = timePreprocessing(files, passCount, true, error);
+    double warmTime = (coldTime >= 0) ? timePreprocessing(files, passCount, false, error) : -1;
+    if (warmTime < 0)
+    {
+        return test_fail(error);
+    }
+
+    ShaderPreprocessor::IncludeCacheStats stats = ShaderPreprocessor::getIncludeCacheStats();
+    std::cout << files.size() << " framework shaders: cold cache " << coldTime << "ms, warm cache " << warmTime << "ms per pass\n";
+    std::cout << "Include cache: " << stats.fileCount << " files, " << stats.hits << " hits, " << stats.misses << " misses\n";
+    return test_pass();
+}
+
+testing_func(ShaderPreprocessorTest, TestIncludeHeavyShader)
+{
+    // An uber-shader pulling in 256 headers, each including a couple of shared '#pragma once' headers
+    const std::string dir = getTestDirectory();
+    const uint32_t headerCount = 256;
+    std::string body;
+    for (uint32_t l = 0; l < 64; l++)
+    {
+        body += "float4 func" + std::to_string(l) + "(float4 v) { return v * " + std::to_string(l) + "; } // Padding to get a realistic header size\n";
+    }
+
+    std::vector<std::string> headers;
+    std::string root;
+    for (uint32_t h = 0; h < headerCount; h++)
+    {
+        std::string name = "Header" + std::to_string(h) + ".h";
+        std::string content = "#pragma once\n";
+        if (h >= 2)
+        {
+            content += "#include \"Header" + std::to_string(h / 2) + ".h\"\n#include \"Header" + std::to_string(h - 1) + ".h\"\n";
+        }
+        content += "namespace N" + std::to_string(h) + "\n{\n" + body + "}\n";
+        writeFile(dir + "\\" + name, content);
+        headers.push_back(dir + "\\" + name);
+        root += "#include \"" + name + "\"\n";
+    }
+    const std::string rootFile = dir + "\\UberShader.hlsl";
+    writeFile(rootFile, root);
+
+    std::string error;
+    const std::vector<std::string> files = { rootFile };
+    double coldTime = timePreprocessing(files, 10, true, error);
+    double warmTime = (coldTime >= 0) ? timePreprocessing(files, 10, false, error) : -1;
+
+    for (const auto& header : headers)
+    {
+        std::remove(header.c_str());
+    }
+    std::remove(rootFile.c_str());
+
+    if (warmTime < 0)
+    {
+        return test_fail(error);
+    }
+
+    std::cout << headerCount << " headers: cold cache " << coldTime << "ms, warm cache " << warmTime << "ms per shader\n";
+    return test_pass();
+}
+
+double ShaderPreprocessorTest::timePreprocessing(const std::vector<std::string>& files, uint32_t passCount, bool coldCache, std::string& error)
+{
+    std::vector<std::string> sources(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        readFileToString(files[i], sources[i]);
+    }
+
+    Program::DefineList defines;
+    defines.add("_KERNEL_WIDTH", "5");
+
+    // Warm up the cache, unless it's supposed to be cold
+    ShaderPreprocessor::clearIncludeCache();
+    if (coldCache == false)
+    {
+        passCount++;
+    }
+
+    double totalTime = 0;
+    for (uint32_t pass = 0; pass < passCount; pass++)
+    {
+        if (coldCache)
+        {
+            ShaderPreprocessor::clearIncludeCache();
+        }
+
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::string shader = sources[i];
+            std::string errorMsg;
+            Shader::unordered_string_set includeList;
+            if (ShaderPreprocessor::parseShader(files[i], shader, errorMsg, includeList, defines) == false)
+            {
+                error = "Failed to preprocess " + files[i] + ": " + errorMsg;
+                return -1;
+            }
+        }
+
+        // The first pass with a warm cache is the warm up
+        if (coldCache || pass > 0)
+        {
+            totalTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+    }
+
+    return totalTime / (coldCache ? passCount : passCount - 1);
+}
+
+std::string ShaderPreprocessorTest::getTestDirectory()
+{
+    std::string dir = getExecutableDirectory() + "\\ShaderPreprocessorTest";
+    if (isDirectoryExists(dir) == false)
+    {
+        createDirectory(dir);
+    }
+    return dir;
+}
+
+void ShaderPreprocessorTest::writeFile(const std::string& filename, const std::string& content)
+{
+    std::ofstream stream(filename, std::ios::trunc);
+    stream << content;
+}
+
+size_t ShaderPreprocessorTest::countOccurrences(const std::string& str, const std::string& substr)
+{
+    size_t count = 0;
+    for (size_t offset = str.find(substr); offset != std::string::npos; offset = str.find(substr, offset + substr.size()))
+    {
+        count++;
+    }
+    return count;
+}
+
+int main()
+{
+    ShaderPreprocessorTest spt;
+    spt.init();
+    spt.run();
+    return 0;
+}
@@ -0,0 +1,290 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SoftwareRTContextTest.h"
+#include "Graphics/Scene/SceneImporter.h"
+#include "Utils/Math/TriangleBvh.h"
+#include "Utils/ThreadPool.h"
+
+void SoftwareRTContextTest::addTests()
+{
+    addTestToList<TestMatchesScalar>();
+    addTestToList<TestDynamicObject>();
+    addTestToList<TestRaysPerSecond>();
+}
+
+testing_func(SoftwareRTContextTest, TestMatchesScalar)
+{
+    Model::SharedPtr pModel = Model::createFromFile("teapot.obj", Model::KeepCpuGeometry);
+    if (pModel == nullptr)
+    {
+        return test_fail("Failed to load the model");
+    }
+
+    // Overlapping instances, so that the closest hit has to be found across instances
+    Scene::SharedPtr pScene = Scene::create();
+    const float radius = pModel->getRadius();
+    pScene->addModelInstance(pModel, "A");
+    pScene->addModelInstance(pModel, "B", glm::vec3(radius, 0, radius * 0.5f), glm::vec3(0, 1, 0), glm::vec3(0.5f));
+    pScene->addModelInstance(pModel, "C", glm::vec3(-radius, radius * 0.3f, 0), glm::vec3(0.5f, 0, 0.3f), glm::vec3(1.5f, 1, 1));
+
+    SoftwareRTContext::SharedPtr pContext = SoftwareRTContext::create();
+    pContext->newScene(pScene);
+
+    // An odd count, so that the last packet is partial
+    std::vector<Ray> rays;
+    generateRays(pModel->getBoundingBox(), 4001, rays);
+    for (size_t i = 0; i < rays.size(); i += 5)
+    {
+        rays[i].tMax = radius * 2;
+    }
+
+    std::vector<Hit> hits(rays.size());
+    std::vector<uint8_t> occluded(rays.size());
+    pContext->traceClosestHit(rays.data(), (uint32_t)rays.size(), hits.data());
+    pContext->traceAnyHit(rays.data(), (uint32_t)rays.size(), occluded.data());
+
+    uint32_t hitCount = 0;
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        Hit expected = intersectScalar(pScene.get(), rays[i]);
+        const Hit& hit = hits[i];
+        if (hit.isValid() != expected.isValid() || occluded[i] != (expected.isValid() ? 1 : 0))
+        {
+            return test_fail("Ray " + std::to_string(i) + " hit result doesn't match the scalar traversal");
+        }
+        if (expected.isValid())
+        {
+            hitCount++;
+            if (hit.object != expected.object || hit.meshID != expected.meshID || hit.meshInstanceID != expected.meshInstanceID || hit.triangleID != expected.triangleID)
+            {
+                return test_fail("Ray " + std::to_string(i) + " hit a different triangle than the scalar traversal");
+            }
+            if (abs(hit.t - expected.t) > 1e-4f * std::max(1.0f, expected.t) || glm::any(glm::greaterThan(glm::abs(hit.barycentrics - expected.barycentrics), glm::vec2(1e-3f))))
+            {
+                return test_fail("Ray " + std::to_string(i) + " hit distance or barycentrics don't match the scalar traversal");
+            }
+        }
+    }
+
+    if (hitCount == 0 || hitCount == rays.size())
+    {
+        return test_fail("The rays should hit some of the instances and miss others");
+    }
+    return test_pass();
+}
+
+testing_func(SoftwareRTContextTest, TestDynamicObject)
+{
+    Model::SharedPtr pModel = Model::createFromFile("teapot.obj", Model::KeepCpuGeometry);
+    if (pModel == nullptr)
+    {
+        return test_fail("Failed to load the model");
+    }
+
+    SoftwareRTContext::SharedPtr pContext = SoftwareRTContext::create();
+    SoftwareRTContext::DynamicObjectHandle handle = pContext->addDynamicObject(pModel);
+    pContext->updateTransforms();
+
+    Ray ray;
+    ray.origin = pModel->getCenter() - glm::vec3(0, 0, pModel->getRadius() * 4);
+    ray.direction = glm::vec3(0, 0, 1);
+
+    struct Step
+    {
+        glm::vec3 offset;
+        bool hit;
+    };
+    const float radius = pModel->getRadius();
+    const Step steps[] = { { glm::vec3(0), true }, { glm::vec3(radius * 3, 0, 0), false }, { glm::vec3(0, 0, radius), true }, { glm::vec3(0, -radius * 3, 0), false } };
+
+    for (const Step& step : steps)
+    {
+        pContext->setTransform(handle, glm::translate(glm::mat4(), step.offset));
+        pContext->updateTransforms();
+
+        Hit hit;
+        uint8_t occluded;
+        pContext->traceClosestHit(&ray, 1, &hit);
+        pContext->traceAnyHit(&ray, 1, &occluded);
+        if (hit.isValid() != step.hit || occluded != (step.hit ? 1 : 0))
+        {
+            return test_fail("The ray doesn't see the moved object");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SoftwareRTContextTest, TestRaysPerSecond)
+{
+    const std::string scenes[] = { "Scenes\\Sample.fscene", "Scenes\\ogre.fscene" };
+    const uint32_t width = 1280;
+    const uint32_t height = 720;
+
+    for (const std::string& filename : scenes)
+    {
+        Scene::SharedPtr pScene = SceneImporter::loadScene(filename, Model::KeepCpuGeometry, 0);
+        if (pScene == nullptr)
+        {
+            return test_fail("Failed to load " + filename);
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        SoftwareRTContext::SharedPtr pContext = SoftwareRTContext::create();
+        pContext->newScene(pScene);
+        float buildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // The scene bounds, used to place a camera if the scene doesn't have one, and to aim the incoherent rays
+        BoundingBox sceneBox = pScene->getModelInstance(0, 0)->getBoundingBox();
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                sceneBox = BoundingBox::fromUnion(sceneBox, pScene->getModelInstance(modelID, instanceID)->getBoundingBox());
+            }
+        }
+
+        Camera::SharedPtr pCamera = pScene->getActiveCamera();
+        if (pCamera == nullptr)
+        {
+            pCamera = Camera::create();
+            pCamera->setTarget(sceneBox.center);
+            pCamera->setPosition(sceneBox.center - glm::vec3(0, 0, glm::length(sceneBox.extent) * 2));
+        }
+        pCamera->setAspectRatio((float)width / (float)height);
+
+        // Primary rays, traced in 2x2 pixel packets
+        std::vector<Hit> cameraHits;
+        pContext->traceCameraRays(pCamera.get(), width, height, cameraHits);
+        start = CpuTimer::getCurrentTimePoint();
+        pContext->traceCameraRays(pCamera.get(), width, height, cameraHits);
+        float cameraTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        uint32_t cameraHitCount = 0;
+        for (const Hit& hit : cameraHits)
+        {
+            cameraHitCount += hit.isValid() ? 1 : 0;
+        }
+        if (cameraHitCount == 0)
+        {
+            return test_fail("No camera ray hit " + filename);
+        }
+
+        // Incoherent rays through the scene bounds
+        std::vector<Ray> rays;
+        generateRays(sceneBox, width * height, rays);
+        std::vector<Hit> hits(rays.size());
+        std::vector<uint8_t> occluded(rays.size());
+
+        start = CpuTimer::getCurrentTimePoint();
+        pContext->traceClosestHit(rays.data(), (uint32_t)rays.size(), hits.data());
+        float closestHitTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        pContext->traceAnyHit(rays.data(), (uint32_t)rays.size(), occluded.data());
+        float anyHitTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        const float megaRays = (float)(width * height) * 1e-6f;
+        std::cout << filename << ": " << pContext->getInstanceCount() << " mesh instances, " << pContext->getTriangleCount() << " triangles, build " << buildTime << "ms, " << ThreadPool::getGlobalPool().getThreadCount() + 1 << " threads\n";
+        std::cout << "  Camera rays " << megaRays / (cameraTime * 1e-3f) << " MRays/s, incoherent closest hit " << megaRays / (closestHitTime * 1e-3f) << " MRays/s, any hit " << megaRays / (anyHitTime * 1e-3f) << " MRays/s\n";
+    }
+
+    return test_pass();
+}
+
+void SoftwareRTContextTest::generateRays(const BoundingBox& target, uint32_t count, std::vector<Ray>& rays)
+{
+    // Rays start on a sphere around the box and pass through a random point inside it
+    srand(count);
+    auto random = []() { return (float)rand() / RAND_MAX * 2 - 1; };
+    const float radius = glm::length(target.extent) * 2;
+
+    rays.resize(count);
+    for (Ray& ray : rays)
+    {
+        glm::vec3 dir;
+        do
+        {
+            dir = glm::vec3(random(), random(), random());
+        } while (glm::dot(dir, dir) > 1 || glm::dot(dir, dir) < 1e-4f);
+
+        ray.origin = target.center + glm::normalize(dir) * radius;
+        glm::vec3 through = target.center + target.extent * glm::vec3(random(), random(), random());
+        ray.direction = glm::normalize(through - ray.origin);
+        ray.tMax = FLT_MAX;
+    }
+}
+
+SoftwareRTContextTest::Hit SoftwareRTContextTest::intersectScalar(const Scene* pScene, const Ray& ray)
+{
+    Hit closest;
+    float tMax = ray.tMax;
+    uint32_t object = 0;
+    for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+    {
+        for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++, object++)
+        {
+            const Scene::ModelInstance* pInstance = pScene->getModelInstance(modelID, instanceID).get();
+            const Model* pModel = pInstance->getObject().get();
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                const TriangleBvh* pBvh = pModel->getMesh(meshID)->getTriangleBvh();
+                if (pBvh == nullptr)
+                {
+                    continue;
+                }
+                for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                {
+                    glm::mat4 worldToObject = glm::inverse(pInstance->getTransformMatrix() * pModel->getMeshInstance(meshID, meshInstanceID)->getTransformMatrix());
+                    glm::vec3 origin(worldToObject * glm::vec4(ray.origin, 1));
+                    glm::vec3 direction(worldToObject * glm::vec4(ray.direction, 0));
+
+                    TriangleBvh::Hit hit;
+                    if (pBvh->intersectRay(origin, direction, tMax, hit))
+                    {
+                        tMax = hit.t;
+                        closest.object = object;
+                        closest.meshID = meshID;
+                        closest.meshInstanceID = meshInstanceID;
+                        closest.triangleID = hit.triangleID;
+                        closest.t = hit.t;
+                        closest.barycentrics = hit.barycentrics;
+                    }
+                }
+            }
+        }
+    }
+    return closest;
+}
+
+int main()
+{
+    SoftwareRTContextTest srtct;
+    srtct.init(true);
+    srtct.run();
+    return 0;
+}
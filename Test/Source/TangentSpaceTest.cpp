@@ -0,0 +1,251 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TangentSpaceTest.h"
+#include "Utils/ThreadPool.h"
+
+void TangentSpaceTest::addTests()
+{
+    addTestToList<TestPlanarGrid>();
+    addTestToList<TestMatchesScalar>();
+    addTestToList<TestThreadCountInvariance>();
+    addTestToList<TestPerformance>();
+}
+
+testing_func(TangentSpaceTest, TestPlanarGrid)
+{
+    // A flat grid with a planar UV mapping has the same frame everywhere. Use a vertex count which isn't a multiple of the SIMD width.
+    Grid grid;
+    createGrid(67, false, grid);
+    std::vector<glm::vec3> bitangents(grid.vertices.count);
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), bitangents.data());
+
+    const glm::vec3 expected = bitangents[0];
+    if (abs(glm::length(expected) - 1) > 1e-5f || abs(glm::dot(expected, glm::vec3(0, 1, 0))) > 1e-5f)
+    {
+        return test_fail("Bitangent isn't a unit vector in the plane of the grid");
+    }
+
+    for (uint32_t i = 0; i < grid.vertices.count; i++)
+    {
+        if (glm::length(bitangents[i] - expected) > 1e-5f)
+        {
+            return test_fail("Bitangent of vertex " + std::to_string(i) + " doesn't match the rest of the grid");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TangentSpaceTest, TestMatchesScalar)
+{
+    Grid grid;
+    createGrid(13, true, grid);
+
+    // Collapse some UVs so that a few faces build their frame from the normal instead
+    for (uint32_t v = 0; v < (uint32_t)grid.texCrds.size(); v += 11)
+    {
+        grid.texCrds[v + 1] = grid.texCrds[v];
+    }
+    grid.vertices = createTangentSpaceVertices(grid.positions.data(), sizeof(glm::vec3), grid.normals.data(), sizeof(glm::vec3), grid.texCrds.data(), sizeof(glm::vec2), grid.vertices.count, grid.soaData);
+
+    std::vector<glm::vec3> reference;
+    generateScalar(grid, reference);
+    std::vector<glm::vec3> bitangents(grid.vertices.count);
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), bitangents.data());
+
+    for (uint32_t i = 0; i < grid.vertices.count; i++)
+    {
+        if (glm::length(bitangents[i] - reference[i]) > 1e-5f)
+        {
+            return test_fail("Bitangent of vertex " + std::to_string(i) + " doesn't match the scalar reference");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TangentSpaceTest, TestThreadCountInvariance)
+{
+    Grid grid;
+    createGrid(731, true, grid);
+    std::vector<glm::vec3> reference(grid.vertices.count);
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), reference.data());
+
+    const uint32_t threadCounts[] = { 1, 2, 3, 7 };
+    for (uint32_t threadCount : threadCounts)
+    {
+        ThreadPool::UniquePtr pPool = ThreadPool::create(threadCount);
+        std::vector<glm::vec3> bitangents(grid.vertices.count);
+        generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), bitangents.data(), pPool.get());
+
+        if (std::memcmp(bitangents.data(), reference.data(), bitangents.size() * sizeof(glm::vec3)) != 0)
+        {
+            return test_fail("Result with " + std::to_string(threadCount) + " worker threads doesn't match the serial result");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TangentSpaceTest, TestPerformance)
+{
+    // 2237 x 2237 vertices, ~10M triangles
+    Grid grid;
+    createGrid(2237, true, grid);
+    std::vector<glm::vec3> serial(grid.vertices.count);
+    std::vector<glm::vec3> parallel(grid.vertices.count);
+    ThreadPool& pool = ThreadPool::getGlobalPool();
+
+    // Warm up, so that both runs see the same memory state
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), parallel.data(), &pool);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), serial.data());
+    float serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    start = CpuTimer::getCurrentTimePoint();
+    generateTangentSpace(grid.vertices, grid.indices.data(), grid.indices.size(), parallel.data(), &pool);
+    float parallelTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    if (std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(glm::vec3)) != 0)
+    {
+        return test_fail("Parallel result doesn't match the serial result");
+    }
+
+    std::cout << grid.indices.size() / 3 << " triangles: serial " << serialTime << "ms, " << pool.getThreadCount() + 1 << " threads " << parallelTime << "ms (" << serialTime / parallelTime << "x)\n";
+    return test_pass();
+}
+
+void TangentSpaceTest::createGrid(uint32_t gridSize, bool randomize, Grid& grid)
+{
+    const uint32_t vertexCount = gridSize * gridSize;
+    grid.positions.resize(vertexCount);
+    grid.normals.resize(vertexCount);
+    grid.texCrds.resize(vertexCount);
+
+    srand(gridSize);
+    auto randomFloat = [randomize](float range) { return randomize ? range * (2 * (float)rand() / (float)RAND_MAX - 1) : 0.0f; };
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        float x = (float)(v % gridSize);
+        float z = (float)(v / gridSize);
+        grid.positions[v] = glm::vec3(x, randomFloat(0.3f), z);
+        grid.normals[v] = glm::normalize(glm::vec3(randomFloat(0.1f), 1, randomFloat(0.1f)));
+        grid.texCrds[v] = glm::vec2(x, z) / (float)(gridSize - 1);
+    }
+
+    grid.indices.clear();
+    grid.indices.reserve((size_t)(gridSize - 1) * (gridSize - 1) * 6);
+    for (uint32_t y = 0; y < gridSize - 1; y++)
+    {
+        for (uint32_t x = 0; x < gridSize - 1; x++)
+        {
+            uint32_t v = y * gridSize + x;
+            uint32_t quad[6] = { v, v + 1, v + gridSize, v + 1, v + gridSize + 1, v + gridSize };
+            grid.indices.insert(grid.indices.end(), quad, quad + 6);
+        }
+    }
+
+    grid.vertices = createTangentSpaceVertices(grid.positions.data(), sizeof(glm::vec3), grid.normals.data(), sizeof(glm::vec3), grid.texCrds.data(), sizeof(glm::vec2), vertexCount, grid.soaData);
+}
+
+void TangentSpaceTest::generateScalar(const Grid& grid, std::vector<glm::vec3>& bitangents)
+{
+    const uint32_t vertexCount = (uint32_t)grid.positions.size();
+    std::vector<glm::vec3> tangentSums(vertexCount, glm::vec3(0));
+    std::vector<glm::vec3> bitangentSums(vertexCount, glm::vec3(0));
+    std::vector<bool> referenced(vertexCount, false);
+
+    for (size_t i = 0; i < grid.indices.size(); i += 3)
+    {
+        const uint32_t i0 = grid.indices[i];
+        const uint32_t i1 = grid.indices[i + 1];
+        const uint32_t i2 = grid.indices[i + 2];
+        const glm::vec3 e1 = grid.positions[i1] - grid.positions[i0];
+        const glm::vec3 e2 = grid.positions[i2] - grid.positions[i0];
+        glm::vec2 s = grid.texCrds[i1] - grid.texCrds[i0];
+        glm::vec2 t = grid.texCrds[i2] - grid.texCrds[i0];
+        s.y = -s.y;
+        t.y = -t.y;
+
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+        if (s == glm::vec2(0) || t == glm::vec2(0))
+        {
+            const glm::vec3& n = grid.normals[i0];
+            if (abs(n.x) > abs(n.y))
+            {
+                bitangent = glm::vec3(n.z, 0, -n.x) / glm::length(glm::vec2(n.x, n.z));
+            }
+            else
+            {
+                bitangent = glm::vec3(0, n.z, -n.y) / glm::length(glm::vec2(n.y, n.z));
+            }
+            tangent = glm::cross(bitangent, n);
+        }
+        else
+        {
+            const float dirCorrection = (t.x * s.y - t.y * s.x) < 0 ? -1.0f : 1.0f;
+            tangent = (e2 * s.y - e1 * t.y) * dirCorrection;
+            bitangent = (e2 * s.x - e1 * t.x) * dirCorrection;
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint32_t index = grid.indices[i + corner];
+            tangentSums[index] += tangent;
+            bitangentSums[index] += bitangent;
+            referenced[index] = true;
+        }
+    }
+
+    bitangents.assign(vertexCount, glm::vec3(0));
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        if (referenced[v] == false)
+        {
+            continue;
+        }
+
+        const glm::vec3& n = grid.normals[v];
+        const glm::vec3 localTangent = glm::normalize(tangentSums[v] - n * glm::dot(tangentSums[v], n));
+        glm::vec3 localBitangent = glm::normalize(bitangentSums[v] - n * glm::dot(bitangentSums[v], n));
+        localBitangent = glm::normalize(localBitangent - localTangent * glm::dot(localBitangent, localTangent));
+        if (glm::any(glm::isnan(localBitangent)) || glm::any(glm::isinf(localBitangent)))
+        {
+            localBitangent = glm::normalize(glm::cross(localTangent, n));
+        }
+        bitangents[v] = localBitangent;
+    }
+}
+
+int main()
+{
+    TangentSpaceTest tst;
+    tst.init();
+    tst.run();
+    return 0;
+}
@@ -0,0 +1,214 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ThreadPoolTest.h"
+#include "Utils/ThreadPool.h"
+#include <stdexcept>
+
+void ThreadPoolTest::addTests()
+{
+    addTestToList<TestCoverage>();
+    addTestToList<TestNestedLoops>();
+    addTestToList<TestExceptions>();
+    addTestToList<TestWaiterIsolation>();
+}
+
+testing_func(ThreadPoolTest, TestCoverage)
+{
+    const uint32_t threadCounts[] = { 1, 2, 7 };
+    const uint32_t counts[] = { 1, 7, 1000, 4097 };
+    const uint32_t grainSizes[] = { 0, 1, 3, 64, 5000 };
+
+    for (uint32_t threadCount : threadCounts)
+    {
+        ThreadPool::UniquePtr pPool = ThreadPool::create(threadCount);
+        for (uint32_t count : counts)
+        {
+            for (uint32_t grainSize : grainSizes)
+            {
+                std::vector<std::atomic<uint32_t>> visits(count);
+                for (auto& v : visits)
+                {
+                    v = 0;
+                }
+
+                std::atomic<bool> badRange(false);
+                pPool->parallelFor(count, grainSize, [&](uint32_t begin, uint32_t end)
+                {
+                    // Chunks must start on a grain boundary and never exceed the grain size
+                    const uint32_t grain = max(grainSize, 1u);
+                    if ((begin % grain) != 0 || end <= begin || end - begin > grain || end > count)
+                    {
+                        badRange = true;
+                        return;
+                    }
+                    for (uint32_t i = begin; i < end; i++)
+                    {
+                        visits[i]++;
+                    }
+                });
+
+                const std::string config = std::to_string(threadCount) + " threads, count " + std::to_string(count) + ", grain " + std::to_string(grainSize);
+                if (badRange)
+                {
+                    return test_fail("Invalid chunk range with " + config);
+                }
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    if (visits[i] != 1)
+                    {
+                        return test_fail("Item " + std::to_string(i) + " was visited " + std::to_string(visits[i]) + " times with " + config);
+                    }
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ThreadPoolTest, TestNestedLoops)
+{
+    // More outer items than threads, so workers which run an outer item have to wait for inner loops while other workers are busy
+    const uint32_t outerCount = 32;
+    const uint32_t innerCount = 500;
+    ThreadPool::UniquePtr pPool = ThreadPool::create(3);
+    std::vector<std::atomic<uint32_t>> visits(outerCount * innerCount);
+    for (auto& v : visits)
+    {
+        v = 0;
+    }
+
+    pPool->parallelFor(outerCount, 1, [&](uint32_t outerBegin, uint32_t outerEnd)
+    {
+        for (uint32_t o = outerBegin; o < outerEnd; o++)
+        {
+            pPool->parallelFor(innerCount, 7, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    visits[o * innerCount + i]++;
+                }
+            });
+        }
+    });
+
+    for (uint32_t i = 0; i < outerCount * innerCount; i++)
+    {
+        if (visits[i] != 1)
+        {
+            return test_fail("Nested item " + std::to_string(i) + " was visited " + std::to_string(visits[i]) + " times");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ThreadPoolTest, TestExceptions)
+{
+    ThreadPool::UniquePtr pPool = ThreadPool::create(4);
+    bool caught = false;
+    try
+    {
+        pPool->parallelFor(1000, 10, [](uint32_t begin, uint32_t end)
+        {
+            if (begin <= 500 && 500 < end)
+            {
+                throw std::runtime_error("chunk 50");
+            }
+        });
+    }
+    catch (const std::runtime_error& e)
+    {
+        caught = (std::string(e.what()) == "chunk 50");
+    }
+
+    if (caught == false)
+    {
+        return test_fail("The exception thrown by a chunk wasn't propagated to the caller");
+    }
+
+    // The pool must still be usable
+    std::atomic<uint32_t> sum(0);
+    pPool->parallelFor(1000, 10, [&](uint32_t begin, uint32_t end) { sum += end - begin; });
+    if (sum != 1000)
+    {
+        return test_fail("parallelFor() failed after a previous loop threw");
+    }
+    return test_pass();
+}
+
+testing_func(ThreadPoolTest, TestWaiterIsolation)
+{
+    // Fill the workers with slow unrelated tasks. The calling thread must finish its own loop without picking any of them up.
+    ThreadPool::UniquePtr pPool = ThreadPool::create(2);
+    const uint32_t taskCount = 8;
+    std::atomic<uint32_t> finishedTasks(0);
+    std::atomic<bool> ranOnCaller(false);
+    const std::thread::id callerId = std::this_thread::get_id();
+
+    for (uint32_t i = 0; i < taskCount; i++)
+    {
+        pPool->submit([&]()
+        {
+            if (std::this_thread::get_id() == callerId)
+            {
+                ranOnCaller = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            finishedTasks++;
+        });
+    }
+
+    std::atomic<uint32_t> sum(0);
+    pPool->parallelFor(64, 1, [&](uint32_t begin, uint32_t end)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        sum += end - begin;
+    });
+
+    while (finishedTasks < taskCount)
+    {
+        std::this_thread::yield();
+    }
+
+    if (sum != 64)
+    {
+        return test_fail("Not all the items were processed");
+    }
+    if (ranOnCaller)
+    {
+        return test_fail("parallelFor() executed an unrelated task on the calling thread");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ThreadPoolTest tst;
+    tst.init();
+    tst.run();
+    return 0;
+}
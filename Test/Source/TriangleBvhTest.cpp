@@ -0,0 +1,325 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TriangleBvhTest.h"
+#include "glm/geometric.hpp"
+#include <cfloat>
+#include <cmath>
+
+void TriangleBvhTest::addTests()
+{
+    addTestToList<TestMatchesBruteForce>();
+    addTestToList<TestBarycentrics>();
+    addTestToList<TestInvalidIndices>();
+    addTestToList<TestPacketMatchesScalar>();
+    addTestToList<TestRayPerformance>();
+}
+
+testing_func(TriangleBvhTest, TestMatchesBruteForce)
+{
+    TriangleSoup soup;
+    generateTriangles(5000, soup);
+    TriangleBvh::UniquePtr pBvh = TriangleBvh::create(soup.positions.data(), (uint32_t)soup.positions.size(), soup.indices.data(), (uint32_t)soup.indices.size());
+    if (pBvh == nullptr || pBvh->getTriangleCount() != 5000)
+    {
+        return test_fail("Failed to create the BVH");
+    }
+
+    std::vector<Ray> rays;
+    generateRays(2000, rays);
+    uint32_t hitCount = 0;
+    for (uint32_t i = 0; i < rays.size(); i++)
+    {
+        TriangleBvh::Hit expected, hit;
+        bool expectedHit = intersectBruteForce(soup, rays[i], expected);
+        bool bvhHit = pBvh->intersectRay(rays[i].origin, rays[i].direction, FLT_MAX, hit);
+        if (expectedHit != bvhHit)
+        {
+            return test_fail("Ray " + std::to_string(i) + " hit mismatch");
+        }
+
+        // Different triangles can be hit at the same distance, so compare the distances
+        if (bvhHit && std::abs(hit.t - expected.t) > 1e-4f * expected.t)
+        {
+            return test_fail("Ray " + std::to_string(i) + " didn't return the closest hit");
+        }
+        hitCount += bvhHit ? 1 : 0;
+    }
+
+    if (hitCount == 0)
+    {
+        return test_fail("No ray hit the triangles");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestBarycentrics)
+{
+    // Two triangles of a quad in the z=0 plane, a third one behind them
+    const glm::vec3 positions[] = { glm::vec3(0, 0, 0), glm::vec3(2, 0, 0), glm::vec3(2, 2, 0), glm::vec3(0, 2, 0), glm::vec3(0, 0, 5), glm::vec3(2, 0, 5), glm::vec3(0, 2, 5) };
+    const uint32_t indices[] = { 4, 5, 6, 0, 1, 2, 0, 2, 3 };
+    TriangleBvh::UniquePtr pBvh = TriangleBvh::create(positions, arraysize(positions), indices, arraysize(indices));
+
+    TriangleBvh::Hit hit;
+    if (pBvh->intersectRay(glm::vec3(1.5f, 0.5f, -1), glm::vec3(0, 0, 2), FLT_MAX, hit) == false)
+    {
+        return test_fail("Ray missed the quad");
+    }
+
+    if (hit.triangleID != 1 || std::abs(hit.t - 0.5f) > 1e-5f)
+    {
+        return test_fail("Wrong triangle or distance");
+    }
+
+    // The interpolated position must match the hit point
+    glm::vec3 p = positions[0] * (1 - hit.barycentrics.x - hit.barycentrics.y) + positions[1] * hit.barycentrics.x + positions[2] * hit.barycentrics.y;
+    if (glm::length(p - glm::vec3(1.5f, 0.5f, 0)) > 1e-5f)
+    {
+        return test_fail("Barycentrics don't match the hit point");
+    }
+
+    // Triangles are double-sided, and tMax is respected
+    if (pBvh->intersectRay(glm::vec3(0.5f, 0.5f, 10), glm::vec3(0, 0, -1), FLT_MAX, hit) == false || hit.triangleID != 0)
+    {
+        return test_fail("Back-facing triangle wasn't hit");
+    }
+
+    if (pBvh->intersectRay(glm::vec3(0.5f, 1.5f, -1), glm::vec3(0, 0, 1), 0.5f, hit))
+    {
+        return test_fail("Hit beyond tMax");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestInvalidIndices)
+{
+    const glm::vec3 positions[] = { glm::vec3(0, 0, 0), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) };
+    const uint32_t indices[] = { 0, 1, 3 };
+    if (TriangleBvh::create(positions, arraysize(positions), indices, arraysize(indices)) != nullptr)
+    {
+        return test_fail("BVH was created with out of range indices");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestPacketMatchesScalar)
+{
+    TriangleSoup soup;
+    generateTriangles(5000, soup);
+    TriangleBvh::UniquePtr pBvh = TriangleBvh::create(soup.positions.data(), (uint32_t)soup.positions.size(), soup.indices.data(), (uint32_t)soup.indices.size());
+
+    std::vector<Ray> rays;
+    generateRays(2001, rays);
+    uint32_t hitCount = 0;
+    for (uint32_t first = 0; first < rays.size(); first += 4)
+    {
+        // The last packet is partially filled
+        RayPacket4 closestPacket;
+        closestPacket.clear();
+        for (uint32_t lane = 0; lane < 4 && first + lane < rays.size(); lane++)
+        {
+            closestPacket.setRay(lane, rays[first + lane].origin, rays[first + lane].direction, FLT_MAX);
+        }
+        RayPacket4 anyPacket = closestPacket;
+
+        TriangleBvh::PacketHit packetHit;
+        const uint32_t closestMask = pBvh->intersectPacket(closestPacket, packetHit, false);
+        TriangleBvh::PacketHit anyHit;
+        const uint32_t anyMask = pBvh->intersectPacket(anyPacket, anyHit, true);
+
+        for (uint32_t lane = 0; lane < 4 && first + lane < rays.size(); lane++)
+        {
+            const uint32_t i = first + lane;
+            TriangleBvh::Hit hit;
+            const bool scalarHit = pBvh->intersectRay(rays[i].origin, rays[i].direction, FLT_MAX, hit);
+            const bool packetHitLane = (closestMask & (1 << lane)) != 0;
+            if (scalarHit != packetHitLane || scalarHit != ((anyMask & (1 << lane)) != 0))
+            {
+                return test_fail("Ray " + std::to_string(i) + " hit mismatch");
+            }
+
+            if (scalarHit)
+            {
+                if (std::abs(closestPacket.tMax[lane] - hit.t) > 1e-4f * hit.t)
+                {
+                    return test_fail("Ray " + std::to_string(i) + " didn't return the closest hit");
+                }
+                if ((anyPacket.activeMask & (1 << lane)) || anyPacket.tMax[lane] < hit.t * (1 - 1e-4f))
+                {
+                    return test_fail("Any-hit query of ray " + std::to_string(i) + " is inconsistent");
+                }
+                hitCount++;
+            }
+        }
+
+        if (closestMask & ~((first + 4 <= rays.size()) ? 0xF : (1u << (rays.size() - first)) - 1))
+        {
+            return test_fail("An inactive lane hit a triangle");
+        }
+    }
+
+    if (hitCount == 0)
+    {
+        return test_fail("No ray hit the triangles");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestRayPerformance)
+{
+    const uint32_t triangleCounts[] = { 10000, 100000 };
+    const uint32_t rayCount = 200;
+
+    for (uint32_t triangleCount : triangleCounts)
+    {
+        TriangleSoup soup;
+        generateTriangles(triangleCount, soup);
+        std::vector<Ray> rays;
+        generateRays(rayCount, rays);
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        TriangleBvh::UniquePtr pBvh = TriangleBvh::create(soup.positions.data(), (uint32_t)soup.positions.size(), soup.indices.data(), (uint32_t)soup.indices.size());
+        float buildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        uint32_t bruteForceHits = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (const Ray& ray : rays)
+        {
+            TriangleBvh::Hit hit;
+            bruteForceHits += intersectBruteForce(soup, ray, hit) ? 1 : 0;
+        }
+        float bruteForceTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / rayCount;
+
+        uint32_t bvhHits = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (const Ray& ray : rays)
+        {
+            TriangleBvh::Hit hit;
+            bvhHits += pBvh->intersectRay(ray.origin, ray.direction, FLT_MAX, hit) ? 1 : 0;
+        }
+        float bvhTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / rayCount;
+
+        uint32_t packetHits = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t first = 0; first < rayCount; first += 4)
+        {
+            RayPacket4 packet;
+            packet.clear();
+            for (uint32_t lane = 0; lane < 4 && first + lane < rayCount; lane++)
+            {
+                packet.setRay(lane, rays[first + lane].origin, rays[first + lane].direction, FLT_MAX);
+            }
+            TriangleBvh::PacketHit hit;
+            uint32_t mask = pBvh->intersectPacket(packet, hit, false);
+            for (; mask; mask &= mask - 1) packetHits++;
+        }
+        float packetTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / rayCount;
+
+        if (bvhHits != bruteForceHits || packetHits != bruteForceHits)
+        {
+            return test_fail("BVH hit " + std::to_string(bvhHits) + " rays, packets " + std::to_string(packetHits) + ", brute force " + std::to_string(bruteForceHits));
+        }
+
+        std::cout << triangleCount << " triangles: build " << buildTime << "ms, per ray: brute force " << bruteForceTime << "ms, BVH " << bvhTime << "ms (" << bruteForceTime / bvhTime << "x), packets " << packetTime << "ms\n";
+    }
+
+    return test_pass();
+}
+
+void TriangleBvhTest::generateTriangles(uint32_t count, TriangleSoup& soup)
+{
+    soup.positions.resize(count * 3);
+    soup.indices.resize(count * 3);
+
+    srand(count);
+    auto randomFloat = [](float minVal, float maxVal) { return minVal + (maxVal - minVal) * (float)rand() / (float)RAND_MAX; };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(randomFloat(-100, 100), randomFloat(-100, 100), randomFloat(-100, 100));
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            soup.positions[i * 3 + j] = center + glm::vec3(randomFloat(-4, 4), randomFloat(-4, 4), randomFloat(-4, 4));
+            soup.indices[i * 3 + j] = i * 3 + j;
+        }
+    }
+}
+
+void TriangleBvhTest::generateRays(uint32_t count, std::vector<Ray>& rays)
+{
+    rays.resize(count);
+    srand(count + 1);
+    auto randomFloat = [](float minVal, float maxVal) { return minVal + (maxVal - minVal) * (float)rand() / (float)RAND_MAX; };
+
+    // Rays from outside the triangle cloud towards random points inside it
+    for (Ray& ray : rays)
+    {
+        ray.origin = glm::vec3(randomFloat(-20, 20), randomFloat(-20, 20), -200);
+        glm::vec3 target(randomFloat(-100, 100), randomFloat(-100, 100), randomFloat(-100, 100));
+        ray.direction = glm::normalize(target - ray.origin);
+    }
+}
+
+bool TriangleBvhTest::intersectBruteForce(const TriangleSoup& soup, const Ray& ray, TriangleBvh::Hit& hit)
+{
+    // Reference implementation which tests every triangle
+    float tClosest = FLT_MAX;
+    for (uint32_t i = 0; i < soup.indices.size() / 3; i++)
+    {
+        const glm::vec3& v0 = soup.positions[soup.indices[i * 3 + 0]];
+        const glm::vec3 e1 = soup.positions[soup.indices[i * 3 + 1]] - v0;
+        const glm::vec3 e2 = soup.positions[soup.indices[i * 3 + 2]] - v0;
+
+        glm::vec3 p = glm::cross(ray.direction, e2);
+        float det = glm::dot(e1, p);
+        if (det == 0.0f) continue;
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) continue;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float t = glm::dot(e2, q) * invDet;
+        if (t >= 0.0f && t < tClosest)
+        {
+            tClosest = t;
+            hit.triangleID = i;
+            hit.t = t;
+            hit.barycentrics = glm::vec2(u, v);
+        }
+    }
+    return tClosest != FLT_MAX;
+}
+
+int main()
+{
+    TriangleBvhTest tbt;
+    tbt.init();
+    tbt.run();
+    return 0;
+}
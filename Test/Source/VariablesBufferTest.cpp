@@ -0,0 +1,254 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VariablesBufferTest.h"
+
+void VariablesBufferTest::addTests()
+{
+    addTestToList<TestDirtyRanges>();
+    addTestToList<TestRangeLimit>();
+    addTestToList<TestConstantBufferUpload>();
+    addTestToList<TestVariableHandles>();
+    addTestToList<TestHandlePerformance>();
+}
+
+testing_func(VariablesBufferTest, TestDirtyRanges)
+{
+    StructuredBuffer::SharedPtr pBuffer = StructuredBuffer::create(createProgram(), "gData", 64);
+    pBuffer->uploadToGPU();
+    VariablesBuffer::beginNewFrame();
+
+    const glm::vec4 value(1, 2, 3, 4);
+    const size_t elementSize = pBuffer->getElementSize();
+
+    // Two distant variables are copied separately
+    pBuffer->setBlob(&value, 3 * elementSize, sizeof(value));
+    pBuffer->setBlob(&value, 40 * elementSize, sizeof(value));
+    pBuffer->uploadToGPU();
+    VariablesBuffer::UploadStats stats = VariablesBuffer::getUploadStats();
+    if (stats.uploadCount != 2 || stats.bytesUploaded != 2 * sizeof(value) || stats.bytesWritten != 2 * sizeof(value))
+    {
+        return test_fail("Distant variables weren't uploaded as separate ranges");
+    }
+
+    // Nearby variables are merged into a single copy
+    VariablesBuffer::beginNewFrame();
+    pBuffer->setBlob(&value, 5 * elementSize, sizeof(value));
+    pBuffer->setBlob(&value, 5 * elementSize + 100, sizeof(value));
+    pBuffer->uploadToGPU();
+    stats = VariablesBuffer::getUploadStats();
+    if (stats.uploadCount != 1 || stats.bytesUploaded != 100 + sizeof(value))
+    {
+        return test_fail("Nearby variables weren't merged");
+    }
+
+    // Nothing changed, nothing to upload
+    VariablesBuffer::beginNewFrame();
+    pBuffer->uploadToGPU();
+    if (VariablesBuffer::getUploadStats().uploadCount != 0)
+    {
+        return test_fail("Clean buffer was uploaded");
+    }
+    return test_pass();
+}
+
+testing_func(VariablesBufferTest, TestRangeLimit)
+{
+    const size_t elementCount = 64;
+    const uint32_t frameCount = 1000;
+    StructuredBuffer::SharedPtr pBuffer = StructuredBuffer::create(createProgram(), "gData", elementCount);
+    pBuffer->uploadToGPU();
+    VariablesBuffer::beginNewFrame();
+
+    // Update a few random elements per frame
+    uint32_t maxCopiesPerFrame = 0;
+    uint64_t totalWritten = 0;
+    uint64_t totalUploaded = 0;
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        for (uint32_t i = 0; i < 12; i++)
+        {
+            glm::vec4 value((float)frame);
+            pBuffer->setBlob(&value, (rand() % elementCount) * pBuffer->getElementSize(), sizeof(value));
+        }
+        pBuffer->uploadToGPU();
+        VariablesBuffer::beginNewFrame();
+
+        const VariablesBuffer::UploadStats& stats = VariablesBuffer::getLastFrameUploadStats();
+        if (stats.uploadCount == 0 || stats.bytesUploaded > pBuffer->getSize())
+        {
+            return test_fail("Modified elements weren't uploaded");
+        }
+        maxCopiesPerFrame = max(maxCopiesPerFrame, stats.uploadCount);
+        totalWritten += stats.bytesWritten;
+        totalUploaded += stats.bytesUploaded;
+    }
+
+    if (maxCopiesPerFrame > 8)
+    {
+        return test_fail("Number of copies per upload isn't bounded");
+    }
+
+    std::cout << frameCount << " frames: " << totalWritten << " bytes written, " << totalUploaded << " bytes uploaded, " << (uint64_t)frameCount * pBuffer->getSize() << " bytes with full uploads\n";
+    return test_pass();
+}
+
+testing_func(VariablesBufferTest, TestConstantBufferUpload)
+{
+    Program::SharedPtr pProgram = createProgram();
+    ConstantBuffer::SharedPtr pCB = ConstantBuffer::create(pProgram, "PerFrame");
+    pCB->setVariable("gValues[7]", glm::vec4(5));
+    pCB->uploadToGPU();
+    VariablesBuffer::beginNewFrame();
+
+    // Constant buffers are renamed on upload. Only the modified variable is copied from the CPU data, the rest is carried over from the previous allocation.
+    pCB->setVariable("gScale", glm::vec4(2));
+    pCB->uploadToGPU();
+    const VariablesBuffer::UploadStats& stats = VariablesBuffer::getUploadStats();
+    if (stats.uploadCount != 1 || stats.bytesUploaded != sizeof(glm::vec4) || stats.bytesWritten != sizeof(glm::vec4) || stats.bytesCarriedOver != pCB->getSize() - sizeof(glm::vec4))
+    {
+        return test_fail("Constant buffer upload copied the wrong ranges");
+    }
+
+    // Rename the buffer again to read the uploaded allocation
+    const void* pUploaded = nullptr;
+    pCB->mapWriteDiscard(pUploaded);
+    const glm::vec4* pValues = (const glm::vec4*)pUploaded;
+    if (pValues == nullptr || pValues[pCB->getVariableOffset("gScale") / sizeof(glm::vec4)] != glm::vec4(2) || pValues[pCB->getVariableOffset("gValues[7]") / sizeof(glm::vec4)] != glm::vec4(5))
+    {
+        return test_fail("The uploaded allocation doesn't contain the buffer data");
+    }
+    return test_pass();
+}
+
+testing_func(VariablesBufferTest, TestVariableHandles)
+{
+    Program::SharedPtr pProgram = createProgram();
+    ConstantBuffer::SharedPtr pCB = ConstantBuffer::create(pProgram, "PerFrame");
+    Program::SharedPtr pOtherProgram = createProgram();
+    ConstantBuffer::SharedPtr pOtherCB = ConstantBuffer::create(pOtherProgram, "PerFrame");
+
+    // The handles match the name lookups, including array elements
+    ProgramReflection::VariableHandle scale = pCB->getVariableHandle("gScale");
+    ProgramReflection::VariableHandle values = pCB->getVariableHandle("gValues");
+    if (scale.isValid() == false || values.isValid() == false || pCB->getVariableHandle("gMissing").isValid())
+    {
+        return test_fail("Handle validity doesn't match the buffer declaration");
+    }
+    if (scale.offset != pCB->getVariableOffset("gScale") || values[5].offset != pCB->getVariableOffset("gValues[5]") || pCB->getVariableHandle("gValues[5]").offset != values[5].offset)
+    {
+        return test_fail("Handle offsets don't match the name lookups");
+    }
+    if (values.arraySize != 64 || values[5].arraySize != 59 || values.arrayStride != sizeof(glm::vec4))
+    {
+        return test_fail("Wrong array size or stride");
+    }
+
+    // Buffers from different programs with the same declaration share handles, buffers with a different layout don't
+    static const std::string kOtherCS = "cbuffer PerFrame { float4 gValues[64]; float4 gScale; };\nRWBuffer<float4> gOut;\n[numthreads(1, 1, 1)] void main() { gOut[0] = gScale + gValues[3]; }\n";
+    Program::SharedPtr pDifferentProgram = ComputeProgram::createFromString(kOtherCS);
+    ConstantBuffer::SharedPtr pDifferentCB = ConstantBuffer::create(pDifferentProgram, "PerFrame");
+    if (pOtherCB->isHandleCompatible(scale) == false || pDifferentCB->isHandleCompatible(scale))
+    {
+        return test_fail("Layout compatibility check failed");
+    }
+
+    // Setting through handles marks the same bytes as setting by name
+    pCB->uploadToGPU();
+    VariablesBuffer::beginNewFrame();
+    glm::vec4 data[3] = { glm::vec4(1), glm::vec4(2), glm::vec4(3) };
+    pCB->setVariable(scale, glm::vec4(2));
+    pCB->setVariableArray(values[10], data, 3);
+    if (VariablesBuffer::getUploadStats().bytesWritten != sizeof(glm::vec4) * 4)
+    {
+        return test_fail("Setting through handles wrote the wrong number of bytes");
+    }
+
+    // Handles from a different layout and writes past the end of the array are ignored
+    const bool showBox = Logger::isBoxShownOnError();
+    Logger::showBoxOnError(false);
+    VariablesBuffer::beginNewFrame();
+    pCB->setVariable(pDifferentCB->getVariableHandle("gScale"), glm::vec4(4));
+    pCB->setVariableArray(values[62], data, 3);
+    pCB->setBlob(pDifferentCB->getVariableHandle("gScale"), data, sizeof(glm::vec4));
+    pCB->setBlob(data, pCB->getSize() - sizeof(glm::vec4), sizeof(data));
+    Logger::showBoxOnError(showBox);
+    if (VariablesBuffer::getUploadStats().bytesWritten != 0)
+    {
+        return test_fail("Setting through an incompatible handle wrote to the buffer");
+    }
+    return test_pass();
+}
+
+testing_func(VariablesBufferTest, TestHandlePerformance)
+{
+    const uint32_t iterations = 100000;
+    Program::SharedPtr pProgram = createProgram();
+    ConstantBuffer::SharedPtr pCB = ConstantBuffer::create(pProgram, "PerFrame");
+    ProgramReflection::VariableHandle values = pCB->getVariableHandle("gValues");
+    const std::string names[4] = { "gValues[0]", "gValues[21]", "gValues[42]", "gValues[63]" };
+    const uint32_t indices[4] = { 0, 21, 42, 63 };
+
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pCB->setVariable(names[i & 3], glm::vec4((float)i));
+    }
+    double nameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        pCB->setVariable(values[indices[i & 3]], glm::vec4((float)i));
+    }
+    double handleTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::cout << iterations << " array element updates: by name " << nameTime << "ms, by handle " << handleTime << "ms\n";
+    return test_pass();
+}
+
+Program::SharedPtr VariablesBufferTest::createProgram()
+{
+    static const std::string kCS =
+        "struct Data { float4 value; float4 pad[63]; };\n"
+        "RWStructuredBuffer<Data> gData;\n"
+        "cbuffer PerFrame { float4 gScale; float4 gValues[64]; };\n"
+        "[numthreads(64, 1, 1)]\n"
+        "void main(uint3 id : SV_DispatchThreadID)\n"
+        "{\n"
+        "    gData[id.x].value = gData[id.x].value * gScale + gValues[id.x] + gData[id.x].pad[id.x % 63];\n"
+        "}\n";
+    return ComputeProgram::createFromString(kCS);
+}
+
+int main()
+{
+    VariablesBufferTest vbt;
+    vbt.init(true);
+    vbt.run();
+    return 0;
+}